@@ -0,0 +1,270 @@
+#include "core/callback_monitor.h"
+
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/ts_logging_qt.h"
+
+const int32_t CallbackMonitor::kSlots;
+const int32_t CallbackMonitor::kRingSize;
+const int32_t CallbackMonitor::kGuard;
+const uint64_t CallbackMonitor::kFree;
+const uint64_t CallbackMonitor::kTombstone;
+
+namespace {
+    const uint64_t kTimeMask = (1ull << 48) - 1;
+    const uint64_t kFramesMask = 0xFFFF;
+
+    const char* hook_name(CallbackMonitor::Hook hook)
+    {
+        switch (hook)
+        {
+        case CallbackMonitor::Hook::PLAYBACK_PRE:
+            return "pre process";
+        case CallbackMonitor::Hook::PLAYBACK_POST:
+            return "post process";
+        case CallbackMonitor::Hook::PLAYBACK_MIXED:
+            return "mixed playback";
+        default:
+            return "captured";
+        }
+    }
+}
+
+CallbackMonitor::CallbackMonitor(QObject* parent)
+    : QObject(parent)
+    , m_slots(new Slot[kSlots])
+{
+    this->setObjectName("CallbackMonitor");
+    for (int32_t i = 0; i < kSlots; ++i)
+    {
+        m_slots[i].key.store(kFree, std::memory_order_relaxed);
+        m_slots[i].written.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t CallbackMonitor::make_key(uint64 serverConnectionHandlerID, anyID clientID, Hook hook)
+{
+    return (serverConnectionHandlerID << 24) | (static_cast<uint64_t>(clientID) << 8) | (static_cast<uint64_t>(hook) + 1);
+}
+
+int32_t CallbackMonitor::index_of(uint64_t key)
+{
+    return static_cast<int32_t>((key * 0x9E3779B97F4A7C15ull) >> 56) & (kSlots - 1);
+}
+
+//! Timestamp a callback; a clock read, a hash probe and two relaxed stores
+/*!
+ * \brief CallbackMonitor::record call first thing in the callback, before any processing
+ * \param frame_count the frame count of the callback
+ */
+void CallbackMonitor::record(uint64 serverConnectionHandlerID, anyID clientID, Hook hook, int32_t frame_count)
+{
+    const auto kNow = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    auto slot = acquire(make_key(serverConnectionHandlerID, clientID, hook));
+    if (!slot)
+    {
+        m_overflow_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const auto kWritten = slot->written.load(std::memory_order_relaxed);
+    const auto kEntry = ((static_cast<uint64_t>(kNow) & kTimeMask) << 16) | (static_cast<uint64_t>(frame_count) & kFramesMask);
+    slot->entries[kWritten & (kRingSize - 1)].store(kEntry, std::memory_order_relaxed);
+    slot->written.store(kWritten + 1, std::memory_order_release);
+}
+
+const CallbackMonitor::Slot* CallbackMonitor::find(uint64_t key) const
+{
+    auto index = index_of(key);
+    for (int32_t probe = 0; probe < kSlots; ++probe, index = (index + 1) & (kSlots - 1))
+    {
+        const auto kKey = m_slots[index].key.load(std::memory_order_acquire);
+        if (kKey == key)
+            return &m_slots[index];
+
+        if (kKey == kFree)
+            break;
+    }
+    return nullptr;
+}
+
+//! The slot of the key, taking a free one on the first callback; nullptr when all are taken
+CallbackMonitor::Slot* CallbackMonitor::acquire(uint64_t key)
+{
+    for (int32_t attempt = 0; attempt < 4; ++attempt)   // a lost race for a free slot probes again
+    {
+        auto index = index_of(key);
+        auto tombstone = -1;
+        auto probe = 0;
+        for (; probe < kSlots; ++probe, index = (index + 1) & (kSlots - 1))
+        {
+            const auto kKey = m_slots[index].key.load(std::memory_order_acquire);
+            if (kKey == key)
+                return &m_slots[index];
+
+            if ((kKey == kTombstone) && (tombstone < 0))
+                tombstone = index;
+            else if (kKey == kFree)
+                break;
+        }
+
+        Slot* slot = nullptr;
+        if (tombstone >= 0)
+            slot = claim(tombstone, kTombstone, key);
+        else if (probe < kSlots)
+            slot = claim(index, kFree, key);
+        else
+            return nullptr;
+
+        if (slot)
+            return slot;
+    }
+    return nullptr;
+}
+
+CallbackMonitor::Slot* CallbackMonitor::claim(int32_t index, uint64_t expected, uint64_t key)
+{
+    auto& slot = m_slots[index];
+    if (!slot.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel))
+        return (expected == key) ? &slot : nullptr;
+
+    slot.written.store(0, std::memory_order_release);
+    return &slot;
+}
+
+//! Jitter percentiles, gaps and frame size changes over the last kRingSize callbacks
+/*!
+ * \brief CallbackMonitor::GetStats Qt thread
+ * \param hook which callback; Hook::PLAYBACK_MIXED and Hook::CAPTURED with clientID 0
+ * \param result the statistics
+ * \return false when fewer than two callbacks were recorded
+ */
+bool CallbackMonitor::GetStats(uint64 serverConnectionHandlerID, anyID clientID, Hook hook, Stats& result) const
+{
+    auto slot = find(make_key(serverConnectionHandlerID, clientID, hook));
+    if (!slot)
+        return false;
+
+    const auto kWritten = slot->written.load(std::memory_order_acquire);
+    const auto kCount = qMin<uint32_t>(kWritten, kRingSize - kGuard);
+    if (kCount < 2)
+        return false;
+
+    result = Stats();
+    QVector<float> jitter;
+    jitter.reserve(kCount);
+    auto previous = slot->entries[(kWritten - kCount) & (kRingSize - 1)].load(std::memory_order_relaxed);
+    for (auto i = kWritten - kCount + 1; i != kWritten; ++i)
+    {
+        const auto kEntry = slot->entries[i & (kRingSize - 1)].load(std::memory_order_relaxed);
+        const auto kPreviousFrames = static_cast<int32_t>(previous & kFramesMask);
+        const auto kFrames = static_cast<int32_t>(kEntry & kFramesMask);
+        const auto kInterval = (((kEntry >> 16) - (previous >> 16)) & kTimeMask) * 1e-6f;
+        const auto kNominal = kPreviousFrames * 1000.0f / kSampleRate;
+        previous = kEntry;
+
+        if (kFrames != kPreviousFrames)
+            ++result.frame_changes;
+
+        if (kInterval > kPauseMs)
+            continue;
+
+        if (kInterval > kGapFactor * kNominal)
+            ++result.gaps;
+
+        jitter.append(qAbs(kInterval - kNominal));
+    }
+
+    result.frames = static_cast<int32_t>(previous & kFramesMask);
+    result.interval_ms = result.frames * 1000.0f / kSampleRate;
+    result.count = jitter.size();
+    if (jitter.isEmpty())
+        return true;
+
+    std::sort(jitter.begin(), jitter.end());
+    const auto kLast = jitter.size() - 1;
+    result.jitter_p50_ms = jitter.at(qMin(kLast, jitter.size() / 2));
+    result.jitter_p95_ms = jitter.at(qMin(kLast, jitter.size() * 95 / 100));
+    result.jitter_p99_ms = jitter.at(qMin(kLast, jitter.size() * 99 / 100));
+    result.jitter_max_ms = jitter.at(kLast);
+    return true;
+}
+
+//! Print the statistics of all callbacks of a server tab to it, e.g. from Plugin_Base::process_command
+void CallbackMonitor::Dump(uint64 serverConnectionHandlerID) const
+{
+    auto is_empty = true;
+    for (int32_t i = 0; i < kSlots; ++i)
+    {
+        const auto kKey = m_slots[i].key.load(std::memory_order_acquire);
+        if ((kKey == kFree) || (kKey == kTombstone) || ((kKey >> 24) != serverConnectionHandlerID))
+            continue;
+
+        const auto kClientId = static_cast<anyID>((kKey >> 8) & 0xFFFF);
+        const auto kHook = static_cast<Hook>((kKey & 0xFF) - 1);
+        Stats stats;
+        if (!GetStats(serverConnectionHandlerID, kClientId, kHook, stats))
+            continue;
+
+        is_empty = false;
+        TSLogging::Print(QString("Client %1 %2: %3 callbacks of %4 frames (%5 ms), jitter p50 %6 p95 %7 p99 %8 max %9 ms, %10 gaps, %11 frame size changes")
+                         .arg(kClientId).arg(hook_name(kHook)).arg(stats.count).arg(stats.frames).arg(stats.interval_ms, 0, 'f', 1)
+                         .arg(stats.jitter_p50_ms, 0, 'f', 2).arg(stats.jitter_p95_ms, 0, 'f', 2).arg(stats.jitter_p99_ms, 0, 'f', 2).arg(stats.jitter_max_ms, 0, 'f', 2)
+                         .arg(stats.gaps).arg(stats.frame_changes), serverConnectionHandlerID);
+    }
+
+    if (is_empty)
+        TSLogging::Print("No callbacks recorded", serverConnectionHandlerID);
+
+    if (const auto kOverflow = overflow_count())
+        TSLogging::Print(QString("%1 callbacks not recorded, all slots taken").arg(kOverflow), serverConnectionHandlerID);
+}
+
+//! Forget the callbacks of a server tab; its slots are reused
+void CallbackMonitor::Reset(uint64 serverConnectionHandlerID)
+{
+    for (int32_t i = 0; i < kSlots; ++i)
+    {
+        auto kKey = m_slots[i].key.load(std::memory_order_acquire);
+        if ((kKey != kFree) && (kKey != kTombstone) && ((kKey >> 24) == serverConnectionHandlerID))
+            m_slots[i].key.compare_exchange_strong(kKey, kTombstone, std::memory_order_acq_rel);
+    }
+}
+
+uint32_t CallbackMonitor::overflow_count() const
+{
+    return m_overflow_count.load(std::memory_order_relaxed);
+}
+
+void CallbackMonitor::onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
+{
+    Q_UNUSED(errorNumber);
+    if (newStatus == STATUS_DISCONNECTED)
+        Reset(serverConnectionHandlerID);
+}
+
+//! One line for the client: the playback callbacks, or the capture callbacks when it is me
+bool CallbackMonitor::onInfoDataChanged(uint64 serverConnectionHandlerID, uint64 id, PluginItemType type, uint64 mine, QTextStream &data)
+{
+    if (type != PLUGIN_CLIENT)
+        return false;
+
+    Stats stats;
+    const auto kClientId = static_cast<anyID>(id);
+    if (id == mine)
+    {
+        if (!GetStats(serverConnectionHandlerID, 0, Hook::CAPTURED, stats))
+            return false;
+    }
+    else if (!GetStats(serverConnectionHandlerID, kClientId, Hook::PLAYBACK_PRE, stats)
+             && !GetStats(serverConnectionHandlerID, kClientId, Hook::PLAYBACK_POST, stats))
+        return false;
+
+    data << "Callbacks: " << QString::number(stats.interval_ms, 'f', 1) << " ms, jitter p50 "
+         << QString::number(stats.jitter_p50_ms, 'f', 1) << " p99 " << QString::number(stats.jitter_p99_ms, 'f', 1)
+         << " ms, " << stats.gaps << " gaps";
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QTextStream>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "teamspeak/public_definitions.h"
+
+#include "core/ts_infodata_qt.h"
+
+// Arrival times of the playback / capture callbacks, per client and hook, to tell jitter, gaps (loss, underruns)
+// and frame size changes apart. The audio threads only take a timestamp and store it into a fixed size ring
+// (no locks, no allocations); the statistics are computed on demand on the Qt thread.
+// Enabled by Plugin_Base::callback_monitor(); register it with TSInfoData for the info panel.
+class CallbackMonitor : public QObject, public InfoDataInterface
+{
+    Q_OBJECT
+    Q_INTERFACES(InfoDataInterface)
+
+public:
+    enum class Hook : uint_least8_t
+    {
+        PLAYBACK_PRE = 0,
+        PLAYBACK_POST,
+        PLAYBACK_MIXED, // clientID 0
+        CAPTURED        // clientID 0
+    };
+
+    struct Stats
+    {
+        int32_t count = 0;              // intervals in the window, pauses excluded
+        int32_t frames = 0;             // of the last callback
+        int32_t frame_changes = 0;
+        int32_t gaps = 0;               // longer than kGapFactor times the nominal interval
+        float interval_ms = 0.0f;       // nominal, from the frame count of the last callback
+        float jitter_p50_ms = 0.0f;     // |interval - nominal|
+        float jitter_p95_ms = 0.0f;
+        float jitter_p99_ms = 0.0f;
+        float jitter_max_ms = 0.0f;
+    };
+
+    explicit CallbackMonitor(QObject* parent = nullptr);
+
+    void record(uint64 serverConnectionHandlerID, anyID clientID, Hook hook, int32_t frame_count);  // audio threads
+
+    bool GetStats(uint64 serverConnectionHandlerID, anyID clientID, Hook hook, Stats& result) const;
+    void Dump(uint64 serverConnectionHandlerID) const;
+    void Reset(uint64 serverConnectionHandlerID);
+    uint32_t overflow_count() const;    // callbacks not recorded, all slots taken
+
+    bool onInfoDataChanged(uint64 serverConnectionHandlerID, uint64 id, enum PluginItemType type, uint64 mine, QTextStream &data) override;
+
+public slots:
+    void onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber);
+
+private:
+    static const int32_t kSlots = 256;          // open addressing; power of 2
+    static const int32_t kRingSize = 512;       // ~5 s of 10 ms callbacks; power of 2
+    static const int32_t kGuard = 8;            // oldest entries skipped, the writer may be overwriting them
+    static const uint64_t kFree = 0;
+    static const uint64_t kTombstone = ~0ull;
+    const int32_t kSampleRate = 48000;
+    const float kGapFactor = 1.5f;
+    const float kPauseMs = 250.0f;              // longer intervals are talk pauses, not gaps
+
+    struct Slot
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<uint32_t> written;
+        std::array<std::atomic<uint64_t>, kRingSize> entries;   // steady clock (ns, 48 bits) << 16 | frame count
+    };
+
+    static uint64_t make_key(uint64 serverConnectionHandlerID, anyID clientID, Hook hook);
+    static int32_t index_of(uint64_t key);
+    const Slot* find(uint64_t key) const;
+    Slot* acquire(uint64_t key);
+    Slot* claim(int32_t index, uint64_t expected, uint64_t key);
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint32_t> m_overflow_count{0};
+};
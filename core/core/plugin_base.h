@@ -2,10 +2,13 @@
 
 #include <QtCore/QObject>
 
+#include <atomic>
+
 #include "core/translator.h"
 #include "core/ts_context_menu_qt.h"
 #include "core/ts_infodata_qt.h"
 #include "core/talkers.h"
+#include "core/callback_monitor.h"
 
 class Plugin_Base : public QObject
 {
@@ -20,6 +23,7 @@ public:
 	TSContextMenu& context_menu();
 	TSInfoData& info_data();
 	Talkers& talkers();
+	CallbackMonitor& callback_monitor();
 
 	// Plugin funcs
 
@@ -87,11 +91,16 @@ public:
 	void onChannelPasswordChangedEvent(uint64 serverConnectionHandlerID, uint64 channelID);
 	void onPlaybackShutdownCompleteEvent(uint64 serverConnectionHandlerID);
 	void onSoundDeviceListChangedEvent(const char* modeID, int playOrCap);*/
+	// Audio callbacks: forward all four ts3plugin_onEdit*VoiceDataEvent exports to these, never call the on_* hooks
+	// directly. They open the ScratchArena::CallbackScope the DSP code allocates from (without it the arena of the
+	// audio thread is never rewound and runs out) and record the callback timing in the CallbackMonitor.
 	void onEditPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int sampleCount, int channels);
 	virtual void on_playback_pre_process(uint64 sch_id, anyID client_id, short* samples, int frame_count, int channels) {};
 	void onEditPostProcessVoiceDataEvent(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask);
 	virtual void on_playback_post_process(uint64 sch_id, anyID client_id, std::int16_t* samples, std::int32_t frame_count, std::int32_t channels, const std::uint32_t* channel_speaker_array, std::uint32_t* channel_fill_mask) {};
+	void onEditMixedPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask);
 	virtual void on_playback_master(uint64 sch_id, std::int16_t* samples, std::int32_t frame_count, std::int32_t channels, const std::uint32_t* channel_speaker_array, std::uint32_t* channel_fill_mask) {};
+	void onEditCapturedVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, int* edited);
 	virtual void on_captured(uint64 sch_id, std::int16_t* samples, std::int32_t frame_count, std::int32_t channels, std::int32_t* edited) {};
 	virtual void on_custom_3d_rolloff_calculation(uint64 sch_id, anyID client_id, float distance, float* volume) {};
 	/*void onCustom3dRolloffCalculationWaveEvent(uint64 serverConnectionHandlerID, uint64 waveHandle, float distance, float* volume);
@@ -165,6 +174,7 @@ private:
 	TSContextMenu* m_context_menu = nullptr;
 	TSInfoData* m_info_data = nullptr;
 	Talkers* m_talkers = nullptr;
+	std::atomic<CallbackMonitor*> m_callback_monitor{nullptr};	// read by the audio threads
 
 	anyID my_id_move_event(uint64 sch_id, anyID client_id, uint64 new_channel_id, int visibility);
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Per audio thread bump allocator for DSP temporaries.
+// Plugin_Base opens a CallbackScope at the start of every playback / capture callback, which rewinds the arena,
+// so anything allocated here lives until the callback returns. Never hand arena memory to another thread.
+// That needs the plugin to forward its ts3plugin_onEdit*VoiceDataEvent exports to Plugin_Base::onEdit*VoiceDataEvent;
+// other threads that use the arena (DspPipeline workers) reset it themselves.
+//
+// Build with TS_QT_ALLOC_CHECK to replace the global operator new / delete with versions that assert
+// when they are called inside a CallbackScope (debug builds only, as they rely on Q_ASSERT).
+class ScratchArena
+{
+public:
+    static const size_t kDefaultCapacity = 256 * 1024;
+    static const size_t kAlignment = 32;   // AVX
+
+    // Marks the calling thread as being inside an audio callback and rewinds its arena
+    class CallbackScope
+    {
+    public:
+        CallbackScope();
+        ~CallbackScope();
+
+        CallbackScope(const CallbackScope&) = delete;
+        CallbackScope& operator=(const CallbackScope&) = delete;
+    };
+
+    static ScratchArena& local();
+    static bool is_in_callback();
+    static size_t global_high_water_mark();
+    static uint32_t global_overflow_count();
+
+    void reserve(size_t capacity);  // outside of callbacks only
+    void reset();
+
+    void* allocate(size_t bytes, size_t alignment = kAlignment);
+    template <typename T>
+    T* allocate_array(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T) > kAlignment ? alignof(T) : kAlignment)); }
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+    size_t high_water_mark() const { return m_high_water_mark; }
+
+    ScratchArena() = default;
+    ~ScratchArena();
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+private:
+    unsigned char* m_buffer = nullptr;
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+    size_t m_high_water_mark = 0;
+};
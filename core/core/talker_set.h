@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+
+#include "teamspeak/public_definitions.h"
+
+#include <array>
+
+// Client ids of one server tab: a dense bitset over all anyID values (8 KB) plus a summary of its non-empty words.
+// insert / remove / contains are O(1) without allocations; iteration skips empty ranges by counting trailing zeros.
+class TalkerBitset
+{
+public:
+    bool contains(anyID clientID) const;
+    bool insert(anyID clientID);    // false when contained already
+    bool remove(anyID clientID);    // false when not contained
+    int count() const { return m_count; }
+    int next(int from) const;       // lowest client id >= from, -1 if none
+
+private:
+    static const int kWords = 65536 / 64;
+    static const int kSummaryWords = kWords / 64;
+
+    std::array<quint64, kWords> m_words{};
+    std::array<quint64, kSummaryWords> m_summary{};     // bit i: m_words[i] != 0
+    int m_count = 0;
+};
+
+// The talkers of all server tabs. Read like the QMultiMap it replaced: key() is the server connection handler id,
+// value() the client id; iteration is by server tab, then by ascending client id.
+class TalkerSet
+{
+public:
+    class const_iterator
+    {
+    public:
+        uint64 key() const { return m_server.key(); }
+        anyID value() const { return static_cast<anyID>(m_id); }
+        anyID operator*() const { return value(); }
+        const_iterator& operator++();
+        bool operator==(const const_iterator& other) const { return (m_server == other.m_server) && (m_id == other.m_id); }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class TalkerSet;
+        const_iterator(QHash<uint64, TalkerBitset>::const_iterator server, QHash<uint64, TalkerBitset>::const_iterator end);
+        void settle(int from);
+
+        QHash<uint64, TalkerBitset>::const_iterator m_server;
+        QHash<uint64, TalkerBitset>::const_iterator m_end;
+        int m_id = -1;
+    };
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_iterator constBegin() const { return begin(); }
+    const_iterator constEnd() const { return end(); }
+
+    bool contains(uint64 serverConnectionHandlerID) const;
+    bool contains(uint64 serverConnectionHandlerID, anyID clientID) const;
+    int count(uint64 serverConnectionHandlerID) const;
+    int size() const;
+    bool isEmpty() const { return size() == 0; }
+    QList<anyID> values(uint64 serverConnectionHandlerID) const;
+
+    bool insert(uint64 serverConnectionHandlerID, anyID clientID);
+    bool remove(uint64 serverConnectionHandlerID, anyID clientID);
+    void remove(uint64 serverConnectionHandlerID);
+
+private:
+    QHash<uint64, TalkerBitset> m_servers;  // kept while connected, so talk toggles never allocate
+};
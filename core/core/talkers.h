@@ -1,13 +1,13 @@
 #pragma once
 
 #include <QtCore/QObject>
-#include <QtCore/QMultiMap>
 
 #include "teamspeak/public_definitions.h"
 
 #include <unordered_map>
 
 #include "module.h"
+#include "talker_set.h"
 
 class TalkInterface
 {
@@ -28,8 +28,8 @@ public:
     bool onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID);
     void onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber);
 
-    const QMultiMap<uint64, anyID>& GetTalkerMap() const;
-    const QMultiMap<uint64, anyID>& GetWhisperMap() const;
+    const TalkerSet& GetTalkerMap() const;
+    const TalkerSet& GetWhisperMap() const;
     uint64 isMeTalking() const;
 
     unsigned int RefreshTalkers(uint64 serverConnectionHandlerID);
@@ -44,6 +44,6 @@ private:
     uint64 m_meTalkingScHandler = 0;
     bool m_meTalkingIsWhisper;
 
-    QMultiMap<uint64, anyID> TalkerMap;
-    QMultiMap<uint64, anyID> WhisperMap;
+    TalkerSet TalkerMap;
+    TalkerSet WhisperMap;
 };
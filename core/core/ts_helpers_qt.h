@@ -20,6 +20,7 @@ namespace TSHelpers
 
     int IsClientQuery(uint64 serverConnectionHandlerID, anyID clientID);
     unsigned int GetClientUID(uint64 serverConnectionHandlerID, anyID clientID, QString &result);
+    unsigned int GetServerUID(uint64 serverConnectionHandlerID, QString &result);
     unsigned int GetTalkStatus(uint64 serverConnectionHandlerID, anyID clientID, int &status, int &isWhispering);
     unsigned int GetSubChannels(uint64 serverConnectionHandlerID, uint64 channelId, QVector<uint64> *result);
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QtCore/QHash>
+
+#include "teamspeak/public_definitions.h"
+
+// Own client id, own channel and connection status per server tab, so talk, move and info events don't
+// need client lib round trips. Filled on STATUS_CONNECTION_ESTABLISHED, updated from own move events,
+// dropped after the disconnect has been handled; Plugin_Base forwards those. While STATUS_DISCONNECTED is being
+// handled the status reads disconnected, but the own client id is still the cached one. A tab it knows nothing about, e.g. one connected before
+// the plugin was loaded, is read from the client lib on first use and cached from then on if it is connected.
+// Client lib event thread only, not for the audio callbacks.
+class TSSessionCache
+{
+public:
+    static TSSessionCache* instance();
+
+    void onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus);
+    void onClientMove(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID);
+    void drop(uint64 serverConnectionHandlerID);
+
+    unsigned int GetConnectionStatus(uint64 serverConnectionHandlerID, int& result);
+    unsigned int GetMyClientID(uint64 serverConnectionHandlerID, anyID& result);
+    unsigned int GetMyChannelID(uint64 serverConnectionHandlerID, uint64& result);
+
+private:
+    TSSessionCache() = default;
+
+    struct Session
+    {
+        int status = STATUS_DISCONNECTED;
+        bool has_ids = false;   // my_id and channel_id are valid
+        anyID my_id = 0;
+        uint64 channel_id = 0;
+    };
+
+    Session* find(uint64 serverConnectionHandlerID);
+    Session* seed(uint64 serverConnectionHandlerID, int status);
+    unsigned int fill(uint64 serverConnectionHandlerID, Session& session);
+
+    QHash<uint64, Session> m_sessions;
+};
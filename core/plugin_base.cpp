@@ -10,6 +10,8 @@
 #include "core/ts_logging_qt.h"
 #include "core/ts_settings_qt.h"
 #include "core/ts_helpers_qt.h"
+#include "core/scratch_arena.h"
+#include "core/ts_session_cache.h"
 
 Plugin_Base::Plugin_Base(const char* plugin_id, QObject *parent)
 	: QObject(parent)
@@ -53,6 +55,18 @@ Talkers& Plugin_Base::talkers()
 	return *m_talkers;
 }
 
+//! Timestamp the playback and capture callbacks from now on; see CallbackMonitor
+CallbackMonitor& Plugin_Base::callback_monitor()
+{
+	auto monitor = m_callback_monitor.load(std::memory_order_relaxed);
+	if (!monitor)
+	{
+		monitor = new CallbackMonitor(this);
+		m_callback_monitor.store(monitor, std::memory_order_release);
+	}
+	return *monitor;
+}
+
 int Plugin_Base::init()
 {
 	TSLogging::Log("init");
@@ -162,7 +176,7 @@ void Plugin_Base::currentServerConnectionChanged(uint64 serverConnectionHandlerI
 	// event will fire twice on connecting to a new tab; first before connecting, second after established by our manual trigger
 	unsigned int error;
 	int status;
-	if ((error = ts3Functions.getConnectionStatus(serverConnectionHandlerID, &status)) != ERROR_ok)
+	if ((error = TSSessionCache::instance()->GetConnectionStatus(serverConnectionHandlerID, status)) != ERROR_ok)
 	{
 		TSLogging::Error("ts3plugin_currentServerConnectionChanged", serverConnectionHandlerID, error);
 		return;
@@ -176,7 +190,11 @@ void Plugin_Base::currentServerConnectionChanged(uint64 serverConnectionHandlerI
 
 void Plugin_Base::onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
 {
+	TSSessionCache::instance()->onConnectStatusChanged(serverConnectionHandlerID, newStatus);
 	talkers().onConnectStatusChangeEvent(serverConnectionHandlerID, newStatus, errorNumber);
+	if (auto monitor = m_callback_monitor.load(std::memory_order_relaxed))
+		monitor->onConnectStatusChanged(serverConnectionHandlerID, newStatus, errorNumber);
+
 	if (newStatus == STATUS_CONNECTION_ESTABLISHED)
 	{
 		currentServerConnectionChanged(serverConnectionHandlerID);
@@ -185,18 +203,20 @@ void Plugin_Base::onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, i
 		unsigned int error;
 		// Get My Id on this handler
 		anyID myID;
-		if ((error = ts3Functions.getClientID(serverConnectionHandlerID, &myID)) != ERROR_ok)
+		if ((error = TSSessionCache::instance()->GetMyClientID(serverConnectionHandlerID, myID)) != ERROR_ok)
 			TSLogging::Error("(ts3plugin_onConnectStatusChangeEvent) Error getting my clientID");
 		{
 			// Get My channel on this handler
 			uint64 channelID;
-			if ((error = ts3Functions.getChannelOfClient(serverConnectionHandlerID, myID, &channelID)) != ERROR_ok)
+			if ((error = TSSessionCache::instance()->GetMyChannelID(serverConnectionHandlerID, channelID)) != ERROR_ok)
 				TSLogging::Error("(ts3plugin_onConnectStatusChangeEvent) Error getting my clients channel id", serverConnectionHandlerID, error);
 			else
 				onClientMoveEvent(serverConnectionHandlerID, myID, 0, channelID, ENTER_VISIBILITY, "");
 		}
 	}
 	on_connect_status_changed(serverConnectionHandlerID, newStatus, errorNumber);
+	if (newStatus == STATUS_DISCONNECTED)
+		TSSessionCache::instance()->drop(serverConnectionHandlerID);
 }
 
 void Plugin_Base::onClientMoveEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char * moveMessage)
@@ -226,16 +246,44 @@ void Plugin_Base::onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int
 	on_talk_status_changed(serverConnectionHandlerID, status, isReceivedWhisper, clientID, kIsMe);
 }
 
+// Audio callbacks; each one rewinds the scratch arena of the calling audio thread
+
 void Plugin_Base::onEditPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, anyID clientID, short * samples, int sampleCount, int channels)
 {
+	ScratchArena::CallbackScope scope;
+	if (auto monitor = m_callback_monitor.load(std::memory_order_acquire))
+		monitor->record(serverConnectionHandlerID, clientID, CallbackMonitor::Hook::PLAYBACK_PRE, sampleCount);
+
 	on_playback_pre_process(serverConnectionHandlerID, clientID, samples, sampleCount, channels);
 }
 
 void Plugin_Base::onEditPostProcessVoiceDataEvent(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask)
 {
+	ScratchArena::CallbackScope scope;
+	if (auto monitor = m_callback_monitor.load(std::memory_order_acquire))
+		monitor->record(serverConnectionHandlerID, clientID, CallbackMonitor::Hook::PLAYBACK_POST, sampleCount);
+
 	on_playback_post_process(serverConnectionHandlerID, clientID, samples, sampleCount, channels, channelSpeakerArray, channelFillMask);
 }
 
+void Plugin_Base::onEditMixedPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask)
+{
+	ScratchArena::CallbackScope scope;
+	if (auto monitor = m_callback_monitor.load(std::memory_order_relaxed))
+		monitor->record(serverConnectionHandlerID, 0, CallbackMonitor::Hook::PLAYBACK_MIXED, sampleCount);
+
+	on_playback_master(serverConnectionHandlerID, samples, sampleCount, channels, channelSpeakerArray, channelFillMask);
+}
+
+void Plugin_Base::onEditCapturedVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, int* edited)
+{
+	ScratchArena::CallbackScope scope;
+	if (auto monitor = m_callback_monitor.load(std::memory_order_acquire))
+		monitor->record(serverConnectionHandlerID, 0, CallbackMonitor::Hook::CAPTURED, sampleCount);
+
+	on_captured(serverConnectionHandlerID, samples, sampleCount, channels, edited);
+}
+
 void Plugin_Base::onMenuItemEvent(uint64 serverConnectionHandlerID, PluginMenuType type, int menuItemID, uint64 selectedItemID)
 {
 	context_menu().onMenuItemEvent(serverConnectionHandlerID, type, menuItemID, selectedItemID);
@@ -263,27 +311,33 @@ void Plugin_Base::onMenuItemEvent(uint64 serverConnectionHandlerID, PluginMenuTy
 
 anyID Plugin_Base::my_id_move_event(uint64 sch_id, anyID client_id, uint64 new_channel_id, int visibility)
 {
+	// Get My Id on this handler
 	unsigned int error;
+	anyID my_id;
+	auto sessions = TSSessionCache::instance();
+	if ((error = sessions->GetMyClientID(sch_id, my_id)) != ERROR_ok)
+	{
+		TSLogging::Error("(ts3plugin_onClientMoveEvent)", sch_id, error);
+		return 0;
+	}
+
 	if (new_channel_id == 0)  // When we disconnect, we get moved to chan 0 before the connection event
-	{                       // However, we aren't able to get our own id etc. anymore via the API for comparison
-		int con_status;     // Therefor, unless we cache our ids for no other benefit, this is a workaround by filtering those out
-		if ((error = ts3Functions.getConnectionStatus(sch_id, &con_status)) != ERROR_ok)
+	{                       // The session cache still holds the tab as connected then; for our own move only,
+		if (client_id == my_id) // ask the API and filter it out. Leaves of others need no round trip
 		{
-			TSLogging::Error("(filter_move_event)", sch_id, error);
-			return 0;
+			int con_status;
+			if ((error = ts3Functions.getConnectionStatus(sch_id, &con_status)) != ERROR_ok)
+			{
+				TSLogging::Error("(filter_move_event)", sch_id, error);
+				return 0;
+			}
+			if (con_status == STATUS_DISCONNECTED)
+				return 0;
 		}
-		if (con_status == STATUS_DISCONNECTED)
-			return 0;
 	}
 	else if ((visibility != LEAVE_VISIBILITY) && (TSHelpers::IsClientQuery(sch_id, client_id)))
 		return 0;
 
-	// Get My Id on this handler
-	anyID my_id;
-	if ((error = ts3Functions.getClientID(sch_id, &my_id)) != ERROR_ok)
-	{
-		TSLogging::Error("(ts3plugin_onClientMoveEvent)", sch_id, error);
-		return 0;
-	}
+	sessions->onClientMove(sch_id, client_id, new_channel_id);
 	return my_id;
 }
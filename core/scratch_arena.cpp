@@ -0,0 +1,203 @@
+#include "core/scratch_arena.h"
+
+#include <QtCore/QtGlobal>
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace {
+    thread_local int t_callback_depth = 0;
+    std::atomic<size_t> s_high_water_mark{0};
+    std::atomic<uint32_t> s_overflow_count{0};
+}
+
+const size_t ScratchArena::kDefaultCapacity;
+const size_t ScratchArena::kAlignment;
+
+ScratchArena::CallbackScope::CallbackScope()
+{
+    auto& arena = ScratchArena::local();
+    if (t_callback_depth++ == 0)
+    {
+        if (arena.capacity() == 0)   // first callback on this thread; allocate before the checks are armed
+        {
+            --t_callback_depth;
+            arena.reserve(kDefaultCapacity);
+            ++t_callback_depth;
+        }
+        arena.reset();
+    }
+}
+
+ScratchArena::CallbackScope::~CallbackScope()
+{
+    --t_callback_depth;
+}
+
+//! The arena of the calling thread
+ScratchArena& ScratchArena::local()
+{
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+//! Is the calling thread inside a playback / capture callback?
+bool ScratchArena::is_in_callback()
+{
+    return t_callback_depth > 0;
+}
+
+//! Highest arena usage (bytes) seen on any audio thread
+size_t ScratchArena::global_high_water_mark()
+{
+    return s_high_water_mark.load(std::memory_order_relaxed);
+}
+
+//! Number of allocations that did not fit into an arena
+uint32_t ScratchArena::global_overflow_count()
+{
+    return s_overflow_count.load(std::memory_order_relaxed);
+}
+
+ScratchArena::~ScratchArena()
+{
+    delete[] m_buffer;
+}
+
+//! (Re)allocates the backing buffer; must not be called inside a callback
+void ScratchArena::reserve(size_t capacity)
+{
+    Q_ASSERT_X(!is_in_callback(), "ScratchArena::reserve", "called inside an audio callback");
+    if (capacity <= m_capacity || is_in_callback())
+        return;
+
+    delete[] m_buffer;
+    m_buffer = new unsigned char[capacity];
+    m_capacity = capacity;
+    m_used = 0;
+}
+
+void ScratchArena::reset()
+{
+    m_used = 0;
+}
+
+//! Bump allocate; returns nullptr when the arena is exhausted
+/*!
+ * \param bytes size of the block
+ * \param alignment power of two
+ */
+void* ScratchArena::allocate(size_t bytes, size_t alignment)
+{
+    const auto kBase = reinterpret_cast<uintptr_t>(m_buffer);
+    const auto kStart = (kBase + m_used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    const auto kEnd = kStart + bytes;
+    if (!m_buffer || (kEnd > kBase + m_capacity))
+    {
+        s_overflow_count.fetch_add(1, std::memory_order_relaxed);
+        Q_ASSERT_X(false, "ScratchArena::allocate", "arena exhausted");
+        return nullptr;
+    }
+
+    m_used = kEnd - kBase;
+    if (m_used > m_high_water_mark)
+    {
+        m_high_water_mark = m_used;
+        auto global = s_high_water_mark.load(std::memory_order_relaxed);
+        while ((global < m_used) && !s_high_water_mark.compare_exchange_weak(global, m_used, std::memory_order_relaxed))
+        {}
+    }
+    return reinterpret_cast<void*>(kStart);
+}
+
+#ifdef TS_QT_ALLOC_CHECK
+// Any heap allocation inside a playback / capture callback trips these.
+
+void* operator new(std::size_t size)
+{
+    Q_ASSERT_X(!ScratchArena::is_in_callback(), "operator new", "heap allocation inside an audio callback");
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    Q_ASSERT_X(!p || !ScratchArena::is_in_callback(), "operator delete", "heap deallocation inside an audio callback");
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+#ifdef __cpp_aligned_new
+// over-aligned types, e.g. alignas(32) members of DSP state, take these in C++17
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    Q_ASSERT_X(!ScratchArena::is_in_callback(), "operator new", "heap allocation inside an audio callback");
+    const auto kAlignment = qMax(static_cast<std::size_t>(alignment), sizeof(void*));
+#ifdef _MSC_VER
+    if (auto p = _aligned_malloc(size ? size : 1, kAlignment))
+        return p;
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, kAlignment, size ? size : 1) == 0)
+        return p;
+#endif
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    Q_ASSERT_X(!p || !ScratchArena::is_in_callback(), "operator delete", "heap deallocation inside an audio callback");
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+#endif
+#endif
@@ -0,0 +1,159 @@
+#include "core/talker_set.h"
+
+#include <QtCore/QtAlgorithms>
+
+// TalkerBitset
+
+const int TalkerBitset::kWords;
+const int TalkerBitset::kSummaryWords;
+
+bool TalkerBitset::contains(anyID clientID) const
+{
+    return (m_words[clientID >> 6] >> (clientID & 63)) & 1u;
+}
+
+bool TalkerBitset::insert(anyID clientID)
+{
+    const auto kWord = clientID >> 6;
+    const auto kBit = 1ull << (clientID & 63);
+    if (m_words[kWord] & kBit)
+        return false;
+
+    m_words[kWord] |= kBit;
+    m_summary[kWord >> 6] |= 1ull << (kWord & 63);
+    ++m_count;
+    return true;
+}
+
+bool TalkerBitset::remove(anyID clientID)
+{
+    const auto kWord = clientID >> 6;
+    const auto kBit = 1ull << (clientID & 63);
+    if (!(m_words[kWord] & kBit))
+        return false;
+
+    m_words[kWord] &= ~kBit;
+    if (!m_words[kWord])
+        m_summary[kWord >> 6] &= ~(1ull << (kWord & 63));
+
+    --m_count;
+    return true;
+}
+
+int TalkerBitset::next(int from) const
+{
+    if ((from < 0) || (from >= kWords * 64) || (m_count == 0))
+        return -1;
+
+    auto word = from >> 6;
+    const auto kRest = m_words[word] & (~0ull << (from & 63));
+    if (kRest)
+        return (word << 6) + qCountTrailingZeroBits(kRest);
+
+    // the next non-empty word, from the summary
+    ++word;
+    for (auto summary_word = word >> 6; (word < kWords) && (summary_word < kSummaryWords); ++summary_word, word = summary_word << 6)
+    {
+        const auto kSummary = m_summary[summary_word] & (~0ull << (word & 63));
+        if (kSummary)
+        {
+            word = (summary_word << 6) + qCountTrailingZeroBits(kSummary);
+            return (word << 6) + qCountTrailingZeroBits(m_words[word]);
+        }
+    }
+    return -1;
+}
+
+// TalkerSet
+
+TalkerSet::const_iterator::const_iterator(QHash<uint64, TalkerBitset>::const_iterator server, QHash<uint64, TalkerBitset>::const_iterator end)
+    : m_server(server)
+    , m_end(end)
+{
+    settle(0);
+}
+
+//! Move to the first client id >= from, on to the next server tabs when there is none
+void TalkerSet::const_iterator::settle(int from)
+{
+    for (; m_server != m_end; ++m_server, from = 0)
+    {
+        m_id = m_server.value().next(from);
+        if (m_id >= 0)
+            return;
+    }
+    m_id = -1;
+}
+
+TalkerSet::const_iterator& TalkerSet::const_iterator::operator++()
+{
+    settle(m_id + 1);
+    return *this;
+}
+
+TalkerSet::const_iterator TalkerSet::begin() const
+{
+    return const_iterator(m_servers.constBegin(), m_servers.constEnd());
+}
+
+TalkerSet::const_iterator TalkerSet::end() const
+{
+    return const_iterator(m_servers.constEnd(), m_servers.constEnd());
+}
+
+bool TalkerSet::contains(uint64 serverConnectionHandlerID) const
+{
+    return count(serverConnectionHandlerID) > 0;
+}
+
+bool TalkerSet::contains(uint64 serverConnectionHandlerID, anyID clientID) const
+{
+    const auto kIt = m_servers.constFind(serverConnectionHandlerID);
+    return (kIt != m_servers.constEnd()) && kIt.value().contains(clientID);
+}
+
+int TalkerSet::count(uint64 serverConnectionHandlerID) const
+{
+    const auto kIt = m_servers.constFind(serverConnectionHandlerID);
+    return (kIt != m_servers.constEnd()) ? kIt.value().count() : 0;
+}
+
+int TalkerSet::size() const
+{
+    auto result = 0;
+    for (auto it = m_servers.constBegin(); it != m_servers.constEnd(); ++it)
+        result += it.value().count();
+
+    return result;
+}
+
+QList<anyID> TalkerSet::values(uint64 serverConnectionHandlerID) const
+{
+    QList<anyID> result;
+    const auto kIt = m_servers.constFind(serverConnectionHandlerID);
+    if (kIt == m_servers.constEnd())
+        return result;
+
+    const auto& kBits = kIt.value();
+    for (auto id = kBits.next(0); id >= 0; id = kBits.next(id + 1))
+        result.append(static_cast<anyID>(id));
+
+    return result;
+}
+
+bool TalkerSet::insert(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    return m_servers[serverConnectionHandlerID].insert(clientID);
+}
+
+bool TalkerSet::remove(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    auto it = m_servers.find(serverConnectionHandlerID);
+    return (it != m_servers.end()) && it.value().remove(clientID);
+}
+
+//! Forget a server tab, releasing its bitset
+void TalkerSet::remove(uint64 serverConnectionHandlerID)
+{
+    m_servers.remove(serverConnectionHandlerID);
+}
@@ -6,9 +6,12 @@
 #include "ts3_functions.h"
 
 #include "core/ts_logging_qt.h"
+#include "core/ts_session_cache.h"
 
 #include "plugin.h"
 
+// Talkers
+
 Talkers::Talkers(QObject* parent)
 	: QObject(parent)
 {}
@@ -17,14 +20,14 @@ unsigned int Talkers::RefreshTalkers(uint64 serverConnectionHandlerID)
 {
     unsigned int error = ERROR_ok;
     int status;
-    if ((error = ts3Functions.getConnectionStatus(serverConnectionHandlerID, &status)) != ERROR_ok)
+    if ((error = TSSessionCache::instance()->GetConnectionStatus(serverConnectionHandlerID, status)) != ERROR_ok)
         return error;
 
     if (status != STATUS_CONNECTION_ESTABLISHED)
         return ERROR_ok;
 
     anyID myID;
-    if ((error = ts3Functions.getClientID(serverConnectionHandlerID, &myID)) != ERROR_ok)
+    if ((error = TSSessionCache::instance()->GetMyClientID(serverConnectionHandlerID, myID)) != ERROR_ok)
         return error;
 
     int talking;
@@ -100,7 +103,7 @@ void Talkers::DumpTalkStatusChanges(QObject *p, int status)
         unsigned int error;
         // Get My Id on this handler
         anyID myID;
-        if ((error = ts3Functions.getClientID(m_meTalkingScHandler,&myID)) != ERROR_ok)
+        if ((error = TSSessionCache::instance()->GetMyClientID(m_meTalkingScHandler, myID)) != ERROR_ok)
         {
             TSLogging::Error("DumpTalkStatusChanges", m_meTalkingScHandler, error);
             return;
@@ -115,7 +118,7 @@ bool Talkers::onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int stat
 
     // Get My Id on this handler
     anyID myID;
-    if ((error = ts3Functions.getClientID(serverConnectionHandlerID, &myID)) != ERROR_ok)
+    if ((error = TSSessionCache::instance()->GetMyClientID(serverConnectionHandlerID, myID)) != ERROR_ok)
     {
         TSLogging::Error("onTalkStatusChangeEvent", serverConnectionHandlerID, error);
         return false;
@@ -135,15 +138,9 @@ bool Talkers::onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int stat
     if (status == STATUS_TALKING)
     {
         if (isReceivedWhisper)
-        {
-            if (!WhisperMap.contains(serverConnectionHandlerID,clientID))   // pure safety measurement
-                WhisperMap.insert(serverConnectionHandlerID,clientID);
-        }
+            WhisperMap.insert(serverConnectionHandlerID,clientID);   // no-op when contained already
         else
-        {
-            if (!TalkerMap.contains(serverConnectionHandlerID,clientID))
-                TalkerMap.insert(serverConnectionHandlerID,clientID);
-        }
+            TalkerMap.insert(serverConnectionHandlerID,clientID);
     }
     else if (status == STATUS_NOT_TALKING)
     {
@@ -160,10 +157,11 @@ void Talkers::onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int n
 {
     if (newStatus == STATUS_DISCONNECTED)
     {
+        // ids are copied out first; the events remove them from the sets
         if (WhisperMap.contains(serverConnectionHandlerID))
         {
             for (const auto& value : WhisperMap.values(serverConnectionHandlerID))
-                ts3plugin_onTalkStatusChangeEvent(serverConnectionHandlerID, STATUS_NOT_TALKING, 0, value);
+                ts3plugin_onTalkStatusChangeEvent(serverConnectionHandlerID, STATUS_NOT_TALKING, 1, value);
         }
 
         if (TalkerMap.contains(serverConnectionHandlerID))
@@ -171,16 +169,19 @@ void Talkers::onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int n
             for (const auto& value : TalkerMap.values(serverConnectionHandlerID))
                 ts3plugin_onTalkStatusChangeEvent(serverConnectionHandlerID, STATUS_NOT_TALKING, 0, value);
         }
+        WhisperMap.remove(serverConnectionHandlerID);
+        TalkerMap.remove(serverConnectionHandlerID);
     }
     emit ConnectStatusChanged(serverConnectionHandlerID, newStatus, errorNumber);
 }
 
-const QMultiMap<uint64, anyID>& Talkers::GetTalkerMap() const
+//! The talkers of all server tabs; a reference, nothing is copied
+const TalkerSet& Talkers::GetTalkerMap() const
 {
     return TalkerMap;
 }
 
-const QMultiMap<uint64, anyID>& Talkers::GetWhisperMap() const
+const TalkerSet& Talkers::GetWhisperMap() const
 {
     return WhisperMap;
 }
@@ -68,6 +68,20 @@ namespace TSHelpers
         return error;
     }
 
+    unsigned int GetServerUID(uint64 serverConnectionHandlerID, QString &result)
+    {
+        unsigned int error;
+        char* res;
+        if((error = ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_UNIQUE_IDENTIFIER, &res)) != ERROR_ok)
+            TSLogging::Error("(TSHelpers::GetServerUID)",serverConnectionHandlerID,error,true);
+        else
+        {
+            result = QString::fromUtf8(res);
+            ts3Functions.freeMemory(res);
+        }
+        return error;
+    }
+
     unsigned int GetTalkStatus(uint64 serverConnectionHandlerID, anyID clientID, int &status, int &isWhispering)
     {
         unsigned int error;
@@ -8,6 +8,7 @@
 #include "plugin.h"
 
 #include "core/ts_logging_qt.h"
+#include "core/ts_session_cache.h"
 
 const int kInfoDataBufSize = 256;
 
@@ -56,7 +57,7 @@ void TSInfoData::RequestSelfUpdate()
     {
         unsigned int error;
         int status;
-        if ((error = ts3Functions.getConnectionStatus(m_home_id, &status)) != ERROR_ok)
+        if ((error = TSSessionCache::instance()->GetConnectionStatus(m_home_id, status)) != ERROR_ok)
         {
             TSLogging::Error("(TSInfoData::RequestSelfUpdate)", NULL, error, false);
             return;
@@ -64,7 +65,7 @@ void TSInfoData::RequestSelfUpdate()
 
 		// Get My Id on this handler
         anyID my_id;
-        if((error = ts3Functions.getClientID(m_home_id, &my_id)) != ERROR_ok)
+        if((error = TSSessionCache::instance()->GetMyClientID(m_home_id, my_id)) != ERROR_ok)
         {
             TSLogging::Error("(TSInfoData::RequestSelfUpdate)", m_home_id, error);
             return;
@@ -107,7 +108,7 @@ void TSInfoData::onInfoData(uint64 server_connection_id, uint64 id, enum PluginI
     // That's rather not helpfull
     unsigned int error;
     int con_status;
-    if ((error = ts3Functions.getConnectionStatus(server_connection_id, &con_status)) != ERROR_ok)
+    if ((error = TSSessionCache::instance()->GetConnectionStatus(server_connection_id, con_status)) != ERROR_ok)
     {
         TSLogging::Error("(TSInfoData::onInfoData)", server_connection_id, error);
         return;
@@ -125,7 +126,7 @@ void TSInfoData::onInfoData(uint64 server_connection_id, uint64 id, enum PluginI
         unsigned int error;
         // Get My Id on this handler
         anyID my_id;
-        if((error = ts3Functions.getClientID(server_connection_id, &my_id)) != ERROR_ok)
+        if((error = TSSessionCache::instance()->GetMyClientID(server_connection_id, my_id)) != ERROR_ok)
         {
             if (error != ERROR_not_connected)
                 TSLogging::Error("(TSInfoData::onInfoData)", server_connection_id, error);
@@ -139,7 +140,7 @@ void TSInfoData::onInfoData(uint64 server_connection_id, uint64 id, enum PluginI
         {
             // Get My channel on this handler
             uint64 channelID;
-            if ((error = ts3Functions.getChannelOfClient(server_connection_id, my_id, &channelID)) != ERROR_ok)
+            if ((error = TSSessionCache::instance()->GetMyChannelID(server_connection_id, channelID)) != ERROR_ok)
             {
                 TSLogging::Error("(TSInfoData::onInfoData)", server_connection_id, error);
                 return;
@@ -0,0 +1,152 @@
+#include "core/ts_session_cache.h"
+
+#include "teamspeak/public_errors.h"
+#include "ts3_functions.h"
+
+#include "plugin.h"
+
+TSSessionCache* TSSessionCache::instance()
+{
+    static TSSessionCache cache;
+    return &cache;
+}
+
+//! Track the connection status of a server tab
+/*!
+ * \brief TSSessionCache::onConnectStatusChanged forward from ts3plugin_onConnectStatusChangeEvent before anything else
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param newStatus STATUS_CONNECTION_ESTABLISHED fills the ids; STATUS_DISCONNECTED keeps them until drop
+ */
+void TSSessionCache::onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus)
+{
+    auto& session = m_sessions[serverConnectionHandlerID];
+    session.status = newStatus;
+    if (newStatus == STATUS_DISCONNECTED)
+        return;
+
+    session.has_ids = false;
+    if (newStatus == STATUS_CONNECTION_ESTABLISHED)
+        fill(serverConnectionHandlerID, session);
+}
+
+//! Forget a server tab once everyone has handled its disconnect
+/*!
+ * \brief TSSessionCache::drop call after the handlers of STATUS_DISCONNECTED, so they can still read the own client id
+ * \param serverConnectionHandlerID the connection id of the server
+ */
+void TSSessionCache::drop(uint64 serverConnectionHandlerID)
+{
+    m_sessions.remove(serverConnectionHandlerID);
+}
+
+//! Follow own channel changes; moves of others are ignored
+void TSSessionCache::onClientMove(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID)
+{
+    auto it = m_sessions.find(serverConnectionHandlerID);
+    if ((it == m_sessions.end()) || !it.value().has_ids || (it.value().my_id != clientID))
+        return;
+
+    // 0 when moved out on disconnect; the status event follows, the own id stays valid until then
+    it.value().channel_id = newChannelID;
+}
+
+//! Same as ts3Functions.getConnectionStatus
+unsigned int TSSessionCache::GetConnectionStatus(uint64 serverConnectionHandlerID, int& result)
+{
+    const auto kIt = m_sessions.constFind(serverConnectionHandlerID);
+    if (kIt != m_sessions.constEnd())
+    {
+        result = kIt.value().status;
+        return ERROR_ok;
+    }
+
+    const auto kError = ts3Functions.getConnectionStatus(serverConnectionHandlerID, &result);
+    if (kError == ERROR_ok)
+        seed(serverConnectionHandlerID, result);
+
+    return kError;
+}
+
+//! Same as ts3Functions.getClientID
+unsigned int TSSessionCache::GetMyClientID(uint64 serverConnectionHandlerID, anyID& result)
+{
+    auto session = find(serverConnectionHandlerID);
+    if (!session || (!session->has_ids && (session->status != STATUS_CONNECTION_ESTABLISHED)))
+        return ts3Functions.getClientID(serverConnectionHandlerID, &result);
+
+    unsigned int error = ERROR_ok;
+    if (!session->has_ids && ((error = fill(serverConnectionHandlerID, *session)) != ERROR_ok))
+        return error;
+
+    result = session->my_id;
+    return ERROR_ok;
+}
+
+//! Same as ts3Functions.getChannelOfClient with the own client id
+unsigned int TSSessionCache::GetMyChannelID(uint64 serverConnectionHandlerID, uint64& result)
+{
+    auto session = find(serverConnectionHandlerID);
+    if (!session || (!session->has_ids && (session->status != STATUS_CONNECTION_ESTABLISHED)))
+    {
+        unsigned int error;
+        anyID my_id;
+        if ((error = ts3Functions.getClientID(serverConnectionHandlerID, &my_id)) != ERROR_ok)
+            return error;
+
+        return ts3Functions.getChannelOfClient(serverConnectionHandlerID, my_id, &result);
+    }
+
+    unsigned int error = ERROR_ok;
+    if (!session->has_ids && ((error = fill(serverConnectionHandlerID, *session)) != ERROR_ok))
+        return error;
+
+    result = session->channel_id;
+    return ERROR_ok;
+}
+
+//! The session of a tab; a tab without one is looked up in the client lib once
+/*!
+ * rief TSSessionCache::find covers tabs that were connected before the plugin was loaded
+ * \param serverConnectionHandlerID the connection id of the server
+ * 
+eturn the session, or nullptr if the tab is disconnected or unknown to the client lib
+ */
+TSSessionCache::Session* TSSessionCache::find(uint64 serverConnectionHandlerID)
+{
+    auto it = m_sessions.find(serverConnectionHandlerID);
+    if (it != m_sessions.end())
+        return &it.value();
+
+    int status;
+    if (ts3Functions.getConnectionStatus(serverConnectionHandlerID, &status) != ERROR_ok)
+        return nullptr;
+
+    return seed(serverConnectionHandlerID, status);
+}
+
+//! Start the session of a tab from a status read from the client lib; disconnected tabs are not kept
+TSSessionCache::Session* TSSessionCache::seed(uint64 serverConnectionHandlerID, int status)
+{
+    if (status == STATUS_DISCONNECTED)
+        return nullptr;
+
+    auto& session = m_sessions[serverConnectionHandlerID];
+    session.status = status;
+    if (status == STATUS_CONNECTION_ESTABLISHED)
+        fill(serverConnectionHandlerID, session);   // on failure has_ids stays false; the getters retry
+
+    return &session;
+}
+
+unsigned int TSSessionCache::fill(uint64 serverConnectionHandlerID, Session& session)
+{
+    unsigned int error;
+    if ((error = ts3Functions.getClientID(serverConnectionHandlerID, &session.my_id)) != ERROR_ok)
+        return error;
+
+    if ((error = ts3Functions.getChannelOfClient(serverConnectionHandlerID, session.my_id, &session.channel_id)) != ERROR_ok)
+        return error;
+
+    session.has_ids = true;
+    return ERROR_ok;
+}
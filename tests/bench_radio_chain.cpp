@@ -0,0 +1,92 @@
+// Cost of the radio effect chain per talker: band pass -> saturation -> crush -> noise, one DspChain per
+// talker as RadioFx runs them, over 10 ms frames at 48 kHz. Not a test; run it by hand:
+//   bench_radio_chain [talkers] [channels] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "core/scratch_arena.h"
+#include "volume/dsp_chain.h"
+#include "volume/dsp_kernels.h"
+#include "volume/radio_stages.h"
+
+namespace
+{
+    const int32_t kSampleRate = 48000;
+    const int32_t kFrameCount = 480;     // 10 ms, as the client lib delivers them
+    const char* const kIsaNames[] = { "scalar", "SSE2", "AVX2" };
+
+    std::unique_ptr<DspChain> make_chain(uint32_t seed)
+    {
+        std::unique_ptr<DspChain> chain(new DspChain(kSampleRate));
+        chain->add_stage(std::unique_ptr<DspStage>(new RadioBandPass(300.0f, 3000.0f)));
+        chain->add_stage(std::unique_ptr<DspStage>(new RadioSaturation(12.0f)));
+
+        std::unique_ptr<RadioCrush> crush(new RadioCrush());
+        crush->setBits(8);
+        crush->setRing(30.0f, 0.3f);
+        chain->add_stage(std::move(crush));
+
+        std::unique_ptr<RadioNoise> noise(new RadioNoise(seed));
+        noise->setHiss(-40.0f);
+        noise->setCrackle(5.0f, -20.0f);
+        chain->add_stage(std::move(noise));
+        return chain;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int32_t kTalkers = (argc > 1) ? std::max(1, atoi(argv[1])) : 32;
+    const int32_t kChannels = (argc > 2) ? std::max(1, atoi(argv[2])) : 2;
+    const int32_t kFrames = (argc > 3) ? std::max(1, atoi(argv[3])) : 2000;
+    const auto kSamples = kFrameCount * kChannels;
+
+    // speech band tones, a different one per talker
+    std::vector<std::vector<int16_t>> input(kTalkers, std::vector<int16_t>(kSamples));
+    for (int32_t t = 0; t < kTalkers; ++t)
+    {
+        for (int32_t i = 0; i < kSamples; ++i)
+            input[t][i] = static_cast<int16_t>(8000.0f * std::sin(0.05f * (1 + t % 7) * (i / kChannels)));
+    }
+    std::vector<int16_t> samples(kSamples);
+
+    printf("radio chain, %d talkers, %d channels, %d frames of %d samples\n", kTalkers, kChannels, kFrames, kFrameCount);
+    const auto kBest = static_cast<int>(DspKernels::get_best_isa());
+    for (int isa = 0; isa <= kBest; ++isa)
+    {
+        DspKernels::set_isa(static_cast<DspKernels::Isa>(isa));
+
+        std::vector<std::unique_ptr<DspChain>> chains;
+        for (int32_t t = 0; t < kTalkers; ++t)
+        {
+            chains.push_back(make_chain(0x9E3779B9u + t));
+            chains.back()->prepare(kChannels);
+        }
+
+        // the timed loop includes restoring the input, a memcpy of one frame per talker
+        std::chrono::nanoseconds elapsed(0);
+        for (int32_t f = 0; f < kFrames; ++f)
+        {
+            const auto kStart = std::chrono::steady_clock::now();
+            ScratchArena::CallbackScope scope;
+            for (int32_t t = 0; t < kTalkers; ++t)
+            {
+                memcpy(samples.data(), input[t].data(), kSamples * sizeof(int16_t));
+                chains[t]->process(samples.data(), kFrameCount, kChannels);
+            }
+            elapsed += std::chrono::steady_clock::now() - kStart;
+        }
+
+        const auto kPerFrame = static_cast<double>(elapsed.count()) / kFrames;
+        printf("%-6s %10.0f ns per frame, %8.0f ns per talker, %5.2f %% of a 10 ms frame\n",
+               kIsaNames[isa], kPerFrame, kPerFrame / kTalkers, kPerFrame / 1e5);
+    }
+    return 0;
+}
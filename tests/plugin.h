@@ -0,0 +1,8 @@
+#pragma once
+
+// Stands in for the plugin's own plugin.h, which the core units include for the client lib function table.
+// Tests define ts3Functions themselves and point the members they need at fakes.
+
+#include "ts3_functions.h"
+
+extern struct TS3Functions ts3Functions;
@@ -0,0 +1,141 @@
+// DspVolumeAutomix: each talker's share of the total energy, the -30 dB floor, the gain following the share,
+// and talkers leaving the total when they stop or go away
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "test_common.h"
+#include "volume/dsp_volume_automix.h"
+
+namespace
+{
+    const int kFrameCount = 480;
+    const int kTicks = 200;     // 2 s, twenty times the energy time constant
+
+    std::vector<int16_t> make_tone(float amplitude, int channels)
+    {
+        std::vector<int16_t> result(kFrameCount * channels);
+        for (int i = 0; i < kFrameCount; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+                result[i * channels + c] = static_cast<int16_t>(std::lround(amplitude * std::sin(0.0785398f * i)));   // 10 periods
+        }
+        return result;
+    }
+
+    // one 10 ms tick of every talker, in turn, as the audio thread runs them
+    void run(std::vector<DspVolumeAutomix*> talkers, const std::vector<float>& amplitudes, int ticks, int channels = 1)
+    {
+        for (int tick = 0; tick < ticks; ++tick)
+        {
+            for (size_t t = 0; t < talkers.size(); ++t)
+            {
+                auto samples = make_tone(amplitudes[t], channels);
+                talkers[t]->process(samples.data(), kFrameCount, channels);
+            }
+        }
+    }
+
+    bool near(float val, float expected, float tolerance = 0.05f)
+    {
+        return std::abs(val - expected) <= tolerance;
+    }
+
+    void test_share()
+    {
+        // equal talkers: half each
+        {
+            auto state = std::make_shared<AutomixState>();
+            DspVolumeAutomix a(nullptr, state), b(nullptr, state);
+            run({ &a, &b }, { 8000.0f, 8000.0f }, kTicks, 2);
+            CHECK_MSG(near(a.getShare(), -3.01f) && near(b.getShare(), -3.01f), "equal: shares %.2f %.2f dB", a.getShare(), b.getShare());
+        }
+
+        // twice the amplitude, four times the energy: 1/5 and 4/5 of the total
+        {
+            auto state = std::make_shared<AutomixState>();
+            DspVolumeAutomix a(nullptr, state), b(nullptr, state);
+            run({ &a, &b }, { 4000.0f, 8000.0f }, kTicks);
+            CHECK_MSG(near(a.getShare(), -6.99f) && near(b.getShare(), -0.97f), "1:4: shares %.2f %.2f dB", a.getShare(), b.getShare());
+
+            // the gain follows the share; faster down than up, but settled after 2 s either way
+            CHECK_MSG(near(a.getGainCurrent(), a.getShare()) && near(b.getGainCurrent(), b.getShare()),
+                      "1:4: gains %.2f %.2f dB", a.getGainCurrent(), b.getGainCurrent());
+        }
+
+        // four equal talkers: a quarter each, and the attenuated sum is as loud as one of them
+        {
+            auto state = std::make_shared<AutomixState>();
+            DspVolumeAutomix a(nullptr, state), b(nullptr, state), c(nullptr, state), d(nullptr, state);
+            run({ &a, &b, &c, &d }, { 6000.0f, 6000.0f, 6000.0f, 6000.0f }, kTicks);
+            for (auto talker : { &a, &b, &c, &d })
+                CHECK_MSG(near(talker->getShare(), -6.02f), "4 talkers: share %.2f dB", talker->getShare());
+        }
+
+        // alone: no attenuation
+        {
+            DspVolumeAutomix a;
+            run({ &a }, { 8000.0f }, kTicks);
+            CHECK(a.getShare() == VOLUME_0DB);
+            CHECK(a.getGainCurrent() == VOLUME_0DB);
+        }
+    }
+
+    void test_floor()
+    {
+        // 1/200 of the amplitude is -46 dB of the energy; the share stops at -30 dB
+        auto state = std::make_shared<AutomixState>();
+        DspVolumeAutomix quiet(nullptr, state), loud(nullptr, state);
+        run({ &quiet, &loud }, { 100.0f, 20000.0f }, kTicks);
+        CHECK_MSG(quiet.getShare() == -30.0f, "floor: share %.2f dB", quiet.getShare());
+        CHECK(near(quiet.getGainCurrent(), -30.0f));
+        CHECK(near(loud.getShare(), 0.0f));
+    }
+
+    void test_leave()
+    {
+        auto state = std::make_shared<AutomixState>();
+        std::unique_ptr<DspVolumeAutomix> a(new DspVolumeAutomix(nullptr, state));
+        DspVolumeAutomix b(nullptr, state), c(nullptr, state);
+        run({ a.get(), &b, &c }, { 8000.0f, 8000.0f, 8000.0f }, kTicks);
+        CHECK(near(b.getShare(), -4.77f));
+
+        // stopping takes the talker out of the total at once, before its next callback
+        const auto kTotal = state->total();
+        c.setProcessing(false);
+        CHECK(state->total() < kTotal * 3 / 4);
+        run({ a.get(), &b }, { 8000.0f, 8000.0f }, 1);
+        CHECK_MSG(near(b.getShare(), -3.01f, 0.1f), "after stop: share %.2f dB", b.getShare());
+
+        // so does going away
+        a.reset();
+        run({ &b }, { 8000.0f }, 1);
+        CHECK(b.getShare() == VOLUME_0DB);
+
+        // nothing left once the last one stops
+        b.setProcessing(false);
+        CHECK(state->total() == 0);
+    }
+
+    void test_silence()
+    {
+        // a silent talker takes no share; its energy decays out of the total
+        auto state = std::make_shared<AutomixState>();
+        DspVolumeAutomix a(nullptr, state), b(nullptr, state);
+        run({ &a, &b }, { 8000.0f, 8000.0f }, kTicks);
+        run({ &a, &b }, { 0.0f, 8000.0f }, kTicks);
+        CHECK(a.getShare() == VOLUME_0DB);
+        CHECK(a.getPeak() == 0);
+        CHECK_MSG(near(b.getShare(), 0.0f), "after silence: share %.2f dB", b.getShare());
+    }
+}
+
+int main()
+{
+    test_share();
+    test_floor();
+    test_leave();
+    test_silence();
+    return TestCommon::result("automix");
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Minimal checks for the unit tests; no framework, every test is a plain executable run by ctest.
+// A failed check prints the location and the test returns non zero from main.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace TestCommon
+{
+    inline int& failures()
+    {
+        static int s_failures = 0;
+        return s_failures;
+    }
+
+    inline int result(const char* name)
+    {
+        if (failures())
+            printf("%s: %d checks failed\n", name, failures());
+        else
+            printf("%s: passed\n", name);
+
+        return failures() ? 1 : 0;
+    }
+
+    // count values of T at the given element offset from a 32 byte boundary; offset 0 takes the aligned
+    // code paths of the kernels, any other offset the unaligned ones
+    template <typename T>
+    class Buffer
+    {
+    public:
+        Buffer(size_t count, size_t offset = 0)
+            : m_storage((count + offset) * sizeof(T) + 32, 0)
+            , m_count(count)
+        {
+            auto base = reinterpret_cast<uintptr_t>(m_storage.data());
+            base = (base + 31) & ~static_cast<uintptr_t>(31);
+            m_data = reinterpret_cast<T*>(base) + offset;
+        }
+
+        T* data() { return m_data; }
+        const T* data() const { return m_data; }
+        size_t size() const { return m_count; }
+        T& operator[](size_t i) { return m_data[i]; }
+        const T& operator[](size_t i) const { return m_data[i]; }
+
+        void assign(const T* values)
+        {
+            memcpy(m_data, values, m_count * sizeof(T));
+        }
+
+    private:
+        std::vector<unsigned char> m_storage;
+        size_t m_count;
+        T* m_data;
+    };
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            ++TestCommon::failures(); \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (false)
+
+#define CHECK_MSG(condition, ...) \
+    do { \
+        if (!(condition)) \
+        { \
+            ++TestCommon::failures(); \
+            printf("%s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (false)
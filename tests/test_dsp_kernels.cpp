@@ -0,0 +1,413 @@
+// Every DspKernels entry point on every ISA the cpu has, against the scalar version: aligned and unaligned
+// buffers, lengths with odd tails around the vector widths.
+
+#include "volume/dsp_kernels.h"
+
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "test_common.h"
+
+using TestCommon::Buffer;
+
+namespace {
+
+    using Output = std::vector<double>;
+    using Kernel = std::function<Output(std::mt19937& random, int32_t count, size_t offset)>;
+
+    struct Case
+    {
+        const char* name;
+        double tolerance;   // relative to max(1, |reference|); 0: exact
+        Kernel run;
+    };
+
+    const int32_t kCounts[] = { 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 63, 255, 481 };
+    const size_t kOffsets[] = { 0, 1, 3 };
+    const char* kIsaNames[] = { "scalar", "sse2", "avx2" };
+
+    Buffer<int16_t> random_int16(std::mt19937& random, int32_t count, size_t offset)
+    {
+        Buffer<int16_t> result(count, offset);
+        std::uniform_int_distribution<int32_t> distribution(-32768, 32767);
+        for (int32_t i = 0; i < count; ++i)
+            result[i] = static_cast<int16_t>(distribution(random));
+
+        if (count > 2)
+        {
+            result[0] = -32768;
+            result[1] = 32767;
+        }
+        return result;
+    }
+
+    Buffer<float> random_float(std::mt19937& random, int32_t count, size_t offset, float low, float high)
+    {
+        Buffer<float> result(count, offset);
+        std::uniform_real_distribution<float> distribution(low, high);
+        for (int32_t i = 0; i < count; ++i)
+            result[i] = distribution(random);
+
+        return result;
+    }
+
+    template <typename T>
+    void append(Output& output, const T* values, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            output.push_back(static_cast<double>(values[i]));
+    }
+
+    Output run_deinterleave(std::mt19937& random, int32_t count, size_t offset, int32_t channels)
+    {
+        const auto kIn = random_int16(random, count * channels, offset);
+        std::vector<Buffer<float>> planes;
+        std::vector<float*> pointers;
+        for (int32_t c = 0; c < channels; ++c)
+            planes.emplace_back(count, offset);
+
+        for (auto& plane : planes)
+            pointers.push_back(plane.data());
+
+        DspKernels::deinterleave(kIn.data(), pointers.data(), count, channels);
+        Output result;
+        for (const auto& plane : planes)
+            append(result, plane.data(), count);
+
+        return result;
+    }
+
+    Output run_interleave(std::mt19937& random, int32_t count, size_t offset, int32_t channels)
+    {
+        std::vector<Buffer<float>> planes;
+        std::vector<const float*> pointers;
+        for (int32_t c = 0; c < channels; ++c)
+            planes.push_back(random_float(random, count, offset, -1.2f, 1.2f));
+
+        for (const auto& plane : planes)
+            pointers.push_back(plane.data());
+
+        Buffer<int16_t> out(count * channels, offset);
+        DspKernels::interleave(pointers.data(), out.data(), count, channels);
+        Output result;
+        append(result, out.data(), count * channels);
+        return result;
+    }
+
+    Output run_gather_scatter(std::mt19937& random, int32_t count, size_t offset, int32_t channels, uint32_t mask)
+    {
+        const auto kIn = random_int16(random, count * channels, offset);
+        std::vector<Buffer<float>> planes;
+        std::vector<float*> pointers;
+        for (int32_t c = 0; c < channels; ++c)
+            planes.emplace_back(count, offset);
+
+        for (auto& plane : planes)
+            pointers.push_back(plane.data());
+
+        const auto kGathered = DspKernels::gather(kIn.data(), pointers.data(), count, channels, mask);
+        Output result(1, kGathered);
+        for (int32_t p = 0; p < kGathered; ++p)
+        {
+            append(result, planes[p].data(), count);
+            DspKernels::scale(planes[p].data(), count, -0.5f);
+        }
+
+        Buffer<int16_t> out(count * channels, offset);
+        out.assign(kIn.data());
+        std::vector<const float*> const_pointers(pointers.begin(), pointers.end());
+        result.push_back(DspKernels::scatter(const_pointers.data(), out.data(), count, channels, mask));
+        append(result, out.data(), count * channels);
+        return result;
+    }
+
+    Output run_downmix(std::mt19937& random, int32_t count, size_t offset, int32_t channels)
+    {
+        const auto kIn = random_int16(random, count * channels, offset);
+        Buffer<float> out(count, offset);
+        DspKernels::downmix(kIn.data(), out.data(), count, channels);
+        Output result;
+        append(result, out.data(), count);
+        return result;
+    }
+
+    Output run_gain_pan(std::mt19937& random, int32_t count, size_t offset, int32_t channels, int32_t source)
+    {
+        auto samples = random_int16(random, count * channels, offset);
+        DspKernels::apply_gain_pan_q15(samples.data(), count, channels, source, 0, 1, 23170, 40000);
+        Output result;
+        append(result, samples.data(), count * channels);
+        return result;
+    }
+
+    // besides the ISA comparison, the cleared channels must be zero and all others untouched
+    Output run_clear_channels(std::mt19937& random, int32_t count, size_t offset, int32_t channels, uint32_t channel_mask)
+    {
+        auto samples = random_int16(random, count * channels, offset);
+        const std::vector<int16_t> kIn(samples.data(), samples.data() + count * channels);
+        DspKernels::clear_channels(samples.data(), count, channels, channel_mask);
+        for (int32_t i = 0; i < count * channels; ++i)
+        {
+            const auto kExpected = (channel_mask & (1u << (i % channels))) ? 0 : kIn[i];
+            CHECK_MSG(samples[i] == kExpected, "clear_channels %d channels, mask %x: sample %d is %d, expected %d",
+                      channels, channel_mask, i, samples[i], kExpected);
+        }
+        Output result;
+        append(result, samples.data(), count * channels);
+        return result;
+    }
+
+    std::vector<Case> make_cases()
+    {
+        std::vector<Case> cases;
+        cases.push_back({ "int16_to_float", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            const auto kIn = random_int16(random, count, offset);
+            Buffer<float> out(count, offset);
+            DspKernels::int16_to_float(kIn.data(), out.data(), count);
+            Output result;
+            append(result, out.data(), count);
+            return result;
+        } });
+        cases.push_back({ "float_to_int16", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto in = random_float(random, count, offset, -1.2f, 1.2f);
+            if (count > 2)
+                in[2] = 0.5f / 32768.0f;    // a tie, rounds to even
+
+            Buffer<int16_t> out(count, offset);
+            DspKernels::float_to_int16(in.data(), out.data(), count);
+            Output result;
+            append(result, out.data(), count);
+            return result;
+        } });
+        // the noise sequence differs between the ISAs (lanes are consumed in another order); compared is that
+        // every sample lands within 1 LSB of the undithered conversion
+        cases.push_back({ "float_to_int16_dither", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            const auto kIn = random_float(random, count, offset, -1.0f, 1.0f);
+            Buffer<int16_t> plain(count, offset);
+            Buffer<int16_t> out(count, offset);
+            DspKernels::DitherState dither(count);
+            DspKernels::float_to_int16(kIn.data(), plain.data(), count);
+            DspKernels::float_to_int16(kIn.data(), out.data(), count, dither);
+            Output result;
+            for (int32_t i = 0; i < count; ++i)
+                result.push_back(std::abs(out[i] - plain[i]) <= 1);
+
+            return result;
+        } });
+        for (int32_t channels = 1; channels <= 3; ++channels)
+        {
+            cases.push_back({ "deinterleave", 0.0, [channels](std::mt19937& random, int32_t count, size_t offset) {
+                return run_deinterleave(random, count, offset, channels);
+            } });
+            cases.push_back({ "interleave", 0.0, [channels](std::mt19937& random, int32_t count, size_t offset) {
+                return run_interleave(random, count, offset, channels);
+            } });
+            cases.push_back({ "downmix", 1e-6, [channels](std::mt19937& random, int32_t count, size_t offset) {
+                return run_downmix(random, count, offset, channels);
+            } });
+        }
+        cases.push_back({ "gather_scatter_stereo", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_gather_scatter(random, count, offset, 2, 3);
+        } });
+        cases.push_back({ "gather_scatter_masked", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_gather_scatter(random, count, offset, 3, 5);
+        } });
+        cases.push_back({ "measure", 1e-5, [](std::mt19937& random, int32_t count, size_t offset) {
+            const auto kIn = random_int16(random, count, offset);
+            const auto kLevels = DspKernels::measure(kIn.data(), count);
+            return Output{ static_cast<double>(kLevels.peak), kLevels.energy, kLevels.diff_energy, static_cast<double>(kLevels.zero_crossings) };
+        } });
+        cases.push_back({ "is_silent", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            Buffer<int16_t> samples(count, offset);
+            Output result(1, DspKernels::is_silent(samples.data(), count));
+            samples[random() % count] = 1;
+            result.push_back(DspKernels::is_silent(samples.data(), count));
+            return result;
+        } });
+        cases.push_back({ "apply_gain_q15", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            Output result;
+            for (auto gain : { 3277, 32767, 32768, 55705, 131071 })
+            {
+                auto samples = random_int16(random, count, offset);
+                DspKernels::apply_gain_q15(samples.data(), count, gain);
+                append(result, samples.data(), count);
+            }
+            return result;
+        } });
+        cases.push_back({ "apply_gain_pan_q15_stereo", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_gain_pan(random, count, offset, 2, 1);
+        } });
+        cases.push_back({ "apply_gain_pan_q15_multichannel", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_gain_pan(random, count, offset, 4, 0);
+        } });
+        cases.push_back({ "clear_channels_surround", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_clear_channels(random, count, offset, 6, 0x3C);
+        } });
+        cases.push_back({ "clear_channels_odd", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_clear_channels(random, count, offset, 3, 0x4);
+        } });
+        cases.push_back({ "clear_channels_all", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            return run_clear_channels(random, count, offset, 2, 0x3);
+        } });
+        cases.push_back({ "scale", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto samples = random_float(random, count, offset, -1.0f, 1.0f);
+            DspKernels::scale(samples.data(), count, 0.7f);
+            Output result;
+            append(result, samples.data(), count);
+            return result;
+        } });
+        cases.push_back({ "multiply", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto samples = random_float(random, count, offset, -1.0f, 1.0f);
+            const auto kGains = random_float(random, count, offset, 0.0f, 2.0f);
+            DspKernels::multiply(samples.data(), kGains.data(), count);
+            Output result;
+            append(result, samples.data(), count);
+            return result;
+        } });
+        cases.push_back({ "add", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            const auto kIn = random_float(random, count, offset, -1.0f, 1.0f);
+            auto acc = random_float(random, count, offset, -1.0f, 1.0f);
+            DspKernels::add(kIn.data(), acc.data(), count);
+            Output result;
+            append(result, acc.data(), count);
+            return result;
+        } });
+        cases.push_back({ "soft_clip", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto samples = random_float(random, count, offset, -1.0f, 1.0f);
+            DspKernels::soft_clip(samples.data(), count, 3.0f);
+            Output result;
+            append(result, samples.data(), count);
+            return result;
+        } });
+        cases.push_back({ "quantize", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto samples = random_float(random, count, offset, -1.5f, 1.5f);
+            DspKernels::quantize(samples.data(), count, 15.0f);
+            Output result;
+            append(result, samples.data(), count);
+            return result;
+        } });
+        cases.push_back({ "add_noise", 0.0, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto samples = random_float(random, count, offset, -0.5f, 0.5f);
+            DspKernels::DitherState state(count);
+            DspKernels::add_noise(samples.data(), count, 0.01f, state);
+            DspKernels::add_noise(samples.data(), count, 0.01f, state);   // continues the lanes
+            Output result;
+            append(result, samples.data(), count);
+            return result;
+        } });
+        cases.push_back({ "complex_multiply_add", 1e-6, [](std::mt19937& random, int32_t count, size_t offset) {
+            const auto kA = random_float(random, 2 * count, offset, -1.0f, 1.0f);
+            const auto kB = random_float(random, 2 * count, offset, -1.0f, 1.0f);
+            auto acc = random_float(random, 2 * count, offset, -1.0f, 1.0f);
+            DspKernels::complex_multiply_add(kA.data(), kB.data(), acc.data(), count);
+            Output result;
+            append(result, acc.data(), 2 * count);
+            return result;
+        } });
+        cases.push_back({ "compressor_curve", 1e-6, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto magnitudes = random_float(random, count, offset, 0.0f, 1.0f);
+            magnitudes[0] = 0.0f;   // silence, clamped
+            Buffer<float> reduction(count, offset);
+            DspKernels::CompressorCurve curve;
+            curve.threshold = -3.0f;
+            curve.knee = 1.0f;
+            curve.slope = 0.75f;
+            DspKernels::compressor_curve(magnitudes.data(), reduction.data(), count, curve);
+            Output result;
+            append(result, reduction.data(), count);
+            return result;
+        } });
+        cases.push_back({ "fast_exp2", 1e-6, [](std::mt19937& random, int32_t count, size_t offset) {
+            auto in = random_float(random, count, offset, -20.0f, 20.0f);
+            in[0] = -200.0f;    // clamped
+            Buffer<float> out(count, offset);
+            DspKernels::fast_exp2(in.data(), out.data(), count);
+            Output result;
+            append(result, out.data(), count);
+            return result;
+        } });
+        cases.push_back({ "biquad_lanes", 1e-5, [](std::mt19937& random, int32_t count, size_t offset) {
+            const int32_t kSections = 2;
+            const auto kLanes = DspKernels::kBiquadLanes;
+            Buffer<float> coefficients(kSections * 5 * kLanes, offset);
+            for (int32_t s = 0; s < kSections; ++s)
+            {
+                for (int32_t lane = 0; lane < kLanes; ++lane)
+                {
+                    // a stable low pass per lane, cutoffs spread over the lanes
+                    const auto kW = 0.05f + 0.05f * lane;
+                    const auto kAlpha = std::sin(kW) / (2.0f * 0.707f);
+                    const auto kA0 = 1.0f + kAlpha;
+                    const auto kCos = std::cos(kW);
+                    auto c = coefficients.data() + s * 5 * kLanes + lane;
+                    c[0] = (1.0f - kCos) * 0.5f / kA0;
+                    c[kLanes] = (1.0f - kCos) / kA0;
+                    c[2 * kLanes] = (1.0f - kCos) * 0.5f / kA0;
+                    c[3 * kLanes] = -2.0f * kCos / kA0;
+                    c[4 * kLanes] = (1.0f - kAlpha) / kA0;
+                }
+            }
+            Buffer<float> state(kSections * 2 * kLanes, offset);
+            auto data = random_float(random, count * kLanes, offset, -1.0f, 1.0f);
+            DspKernels::biquad_lanes(coefficients.data(), state.data(), data.data(), count, kSections);
+            DspKernels::biquad_lanes(coefficients.data(), state.data(), data.data(), count, kSections);
+            Output result;
+            append(result, data.data(), count * kLanes);
+            append(result, state.data(), kSections * 2 * kLanes);
+            return result;
+        } });
+        return cases;
+    }
+
+    void compare(const Case& test, DspKernels::Isa isa, int32_t count, size_t offset, const Output& reference, const Output& output)
+    {
+        CHECK_MSG(reference.size() == output.size(), "%s %s count %d offset %zu: %zu values, scalar %zu",
+                  test.name, kIsaNames[static_cast<int>(isa)], count, offset, output.size(), reference.size());
+        if (reference.size() != output.size())
+            return;
+
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            const auto kLimit = test.tolerance * std::max(1.0, std::fabs(reference[i]));
+            if (std::fabs(output[i] - reference[i]) <= kLimit)
+                continue;
+
+            CHECK_MSG(false, "%s %s count %d offset %zu: value %zu is %.9g, scalar %.9g",
+                      test.name, kIsaNames[static_cast<int>(isa)], count, offset, i, output[i], reference[i]);
+            return;     // the first mismatch of a run is enough
+        }
+    }
+}
+
+int main()
+{
+    const auto kBest = DspKernels::get_best_isa();
+    printf("best isa: %s\n", kIsaNames[static_cast<int>(kBest)]);
+
+    const auto kCases = make_cases();
+    for (const auto& test : kCases)
+    {
+        for (auto count : kCounts)
+        {
+            for (auto offset : kOffsets)
+            {
+                const auto kSeed = static_cast<uint32_t>(count * 131 + offset);
+                std::mt19937 random(kSeed);
+                DspKernels::set_isa(DspKernels::Isa::SCALAR);
+                const auto kReference = test.run(random, count, offset);
+                for (auto isa : { DspKernels::Isa::SSE2, DspKernels::Isa::AVX2 })
+                {
+                    if (isa > kBest)
+                        continue;
+
+                    random.seed(kSeed);
+                    DspKernels::set_isa(isa);
+                    compare(test, isa, count, offset, kReference, test.run(random, count, offset));
+                }
+            }
+        }
+    }
+    return TestCommon::result("test_dsp_kernels");
+}
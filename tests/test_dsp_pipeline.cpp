@@ -0,0 +1,143 @@
+// DspPipelineSlot: frame N in, processed frame N-1 out, the dry N-1 when the workers missed it, and the
+// restarts on the first frame, a format change and a gap; then the same with the worker threads running
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "test_common.h"
+#include "volume/dsp_pipeline.h"
+
+namespace
+{
+    const int32_t kFrameCount = 480;
+    std::atomic<int> g_processed{0};
+
+    // halves the signal, so wet and dry frames tell apart
+    class HalfStage : public DspStage
+    {
+    public:
+        void process(float* const* planes, int32_t frame_count, int32_t channels) override
+        {
+            for (int32_t c = 0; c < channels; ++c)
+            {
+                for (int32_t i = 0; i < frame_count; ++i)
+                    planes[c][i] *= 0.5f;
+            }
+            g_processed.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    void add_half(DspChain& chain)
+    {
+        chain.add_stage(std::unique_ptr<DspStage>(new HalfStage()));
+    }
+
+    // frame n carries 500 * n, plus 10 per channel to catch swapped channels
+    void fill(std::vector<int16_t>& samples, int n, int32_t channels, int divisor = 1)
+    {
+        samples.resize(kFrameCount * channels);
+        for (int32_t i = 0; i < kFrameCount; ++i)
+        {
+            for (int32_t c = 0; c < channels; ++c)
+                samples[i * channels + c] = static_cast<int16_t>((500 * n + 10 * c) / divisor);
+        }
+    }
+
+    bool is_zero(const std::vector<int16_t>& samples)
+    {
+        return std::all_of(samples.begin(), samples.end(), [](int16_t val) { return val == 0; });
+    }
+
+    void test_dry_fallback()
+    {
+        // workers not started: every frame misses its deadline
+        DspPipeline pipeline(nullptr, 1);
+        pipeline.setChainFactory(add_half);
+        auto slot = pipeline.AddSlot(1, 2);
+
+        std::vector<int16_t> samples, expected;
+        fill(samples, 1, 2);
+        CHECK(slot->exchange(samples.data(), kFrameCount, 2));
+        CHECK_MSG(is_zero(samples), "first frame: no N-1 yet, expected silence");
+        CHECK(slot->missed_deadlines() == 0);
+
+        for (int n = 2; n <= 6; ++n)
+        {
+            fill(samples, n, 2);
+            CHECK(slot->exchange(samples.data(), kFrameCount, 2));
+            fill(expected, n - 1, 2);
+            CHECK_MSG(samples == expected, "frame %d: expected the dry frame %d", n, n - 1);
+        }
+        CHECK(slot->missed_deadlines() == 5);
+        CHECK(pipeline.getMissedDeadlines() == 5);
+
+        // too large for the pipeline: untouched
+        std::vector<int16_t> large(DspPipelineSlot::kMaxSamples + 2, 7);
+        CHECK(!slot->exchange(large.data(), static_cast<int32_t>(large.size()) / 2, 2));
+        CHECK(std::all_of(large.begin(), large.end(), [](int16_t val) { return val == 7; }));
+
+        // a different format and a gap restart with silence
+        fill(samples, 7, 1);
+        CHECK(slot->exchange(samples.data(), kFrameCount, 1));
+        CHECK_MSG(is_zero(samples), "format change: expected silence");
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        fill(samples, 8, 1);
+        CHECK(slot->exchange(samples.data(), kFrameCount, 1));
+        CHECK_MSG(is_zero(samples), "gap: expected silence");
+        CHECK(slot->missed_deadlines() == 5);
+    }
+
+    void test_workers()
+    {
+        DspPipeline pipeline(nullptr, 2);
+        pipeline.setChainFactory(add_half);
+        auto slot = pipeline.AddSlot(1, 2);
+        pipeline.start();
+
+        const int kFrames = 40;
+        std::vector<int16_t> samples, wet, dry;
+        int wet_frames = 0;
+        g_processed.store(0);
+        for (int n = 1; n <= kFrames; ++n)
+        {
+            const auto kMissed = slot->missed_deadlines();
+            fill(samples, n, 2);
+            CHECK(slot->exchange(samples.data(), kFrameCount, 2));
+            if (n == 1)
+                CHECK(is_zero(samples));
+            else
+            {
+                // processed N-1, or dry N-1 counted as a miss; never another frame
+                fill(wet, n - 1, 2, 2);
+                fill(dry, n - 1, 2);
+                const auto kIsWet = (samples == wet);
+                CHECK_MSG(kIsWet || ((samples == dry) && (slot->missed_deadlines() == kMissed + 1)),
+                          "frame %d: neither the processed nor the dry frame %d", n, n - 1);
+                wet_frames += kIsWet;
+            }
+
+            // 10 ms callbacks; well below the restart gap even if the worker is slow to wake
+            const auto kDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(30);
+            while ((g_processed.load(std::memory_order_acquire) < n) && (std::chrono::steady_clock::now() < kDeadline))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        pipeline.stop();
+
+        // on an idle machine all of them; scheduling hiccups may cost a few
+        CHECK_MSG(wet_frames >= (kFrames - 1) * 3 / 4, "only %d of %d frames processed in time", wet_frames, kFrames - 1);
+        CHECK(wet_frames + static_cast<int>(slot->missed_deadlines()) == kFrames - 1);
+    }
+}
+
+int main()
+{
+    test_dry_fallback();
+    test_workers();
+    return TestCommon::result("dsp_pipeline");
+}
@@ -0,0 +1,190 @@
+// DspVolume gain stage: the silent, muted and unity bypasses, the Q15 fixed point gain against a float reference
+// and the float path, and the fade step being per frame whatever the channel count, on every kernel set
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "test_common.h"
+#include "volume/db.h"
+#include "volume/dsp_kernels.h"
+#include "volume/dsp_volume.h"
+
+namespace
+{
+    const int kFrameCount = 480;    // 10 ms at 48 kHz
+    const float kFadePerFrame = 400.0f / 48000.0f;  // GAIN_FADE_RATE
+    const char* const kIsaNames[] = { "scalar", "SSE2", "AVX2" };
+
+    // exposes the float gain path DspVolume subclasses with float stages take
+    class FloatPathVolume : public DspVolume
+    {
+    public:
+        FloatPathVolume() { m_float_path = true; }
+    };
+
+    std::vector<int16_t> make_samples(std::mt19937& random, int count)
+    {
+        std::vector<int16_t> result(count);
+        for (auto& val : result)
+            val = static_cast<int16_t>(random());
+
+        // full scale at both ends, so saturation is covered
+        result[0] = 32767;
+        result[1] = -32768;
+        return result;
+    }
+
+    int max_difference(const std::vector<int16_t>& a, const std::vector<int16_t>& b)
+    {
+        int result = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            result = std::max(result, std::abs(a[i] - b[i]));
+
+        return result;
+    }
+
+    void set_gain(DspVolume& volume, float gain)
+    {
+        volume.setGainDesired(gain);
+        volume.setGainCurrent(gain);
+    }
+
+    void test_bypass(const char* isa, std::mt19937& random)
+    {
+        // unity: left alone
+        for (int channels : { 1, 2, 6 })
+        {
+            DspVolume volume;
+            const auto kInput = make_samples(random, kFrameCount * channels);
+            auto samples = kInput;
+            volume.process(samples.data(), kFrameCount, channels);
+            CHECK_MSG(volume.getBypassMode() == DspVolume::Bypass_Mode::UNITY, "%s: %d channels not bypassed at unity", isa, channels);
+            CHECK_MSG(samples == kInput, "%s: unity gain changed the samples", isa);
+        }
+
+        // digital silence: skipped at any gain, the fade keeps going
+        {
+            DspVolume volume;
+            volume.setGainDesired(-20.0f);
+            std::vector<int16_t> samples(kFrameCount * 2, 0);
+            volume.process(samples.data(), kFrameCount, 2);
+            CHECK_MSG(volume.getBypassMode() == DspVolume::Bypass_Mode::SILENT, "%s: silence not detected", isa);
+            CHECK(std::all_of(samples.begin(), samples.end(), [](int16_t val) { return val == 0; }));
+            CHECK_MSG(std::abs(volume.getGainCurrent() + kFadePerFrame * kFrameCount) < 1e-4f, "%s: fade stalled on silence", isa);
+
+            // a single non zero sample anywhere is not silence
+            for (int position : { 0, 15, 16, 31, 32, kFrameCount * 2 - 1 })
+            {
+                samples.assign(kFrameCount * 2, 0);
+                samples[position] = 1;
+                volume.process(samples.data(), kFrameCount, 2);
+                CHECK_MSG(volume.getBypassMode() == DspVolume::Bypass_Mode::NONE, "%s: sample %d taken for silence", isa, position);
+            }
+        }
+
+        // muted: fades out first, then the buffer is zeroed
+        {
+            DspVolume volume;
+            volume.setMuted(true);
+            int blocks = 0;
+            std::vector<int16_t> samples;
+            do
+            {
+                samples = make_samples(random, kFrameCount * 2);
+                volume.process(samples.data(), kFrameCount, 2);
+                if (volume.getBypassMode() != DspVolume::Bypass_Mode::MUTED)
+                    CHECK(volume.getGainCurrent() > VOLUME_MUTED);
+            }
+            while ((volume.getBypassMode() != DspVolume::Bypass_Mode::MUTED) && (++blocks < 1000));
+
+            // 200 dB at 4 dB per 10 ms
+            CHECK_MSG(blocks == 49, "%s: muted after %d blocks", isa, blocks + 1);
+            CHECK(volume.getGainCurrent() == VOLUME_MUTED);
+            CHECK(std::all_of(samples.begin(), samples.end(), [](int16_t val) { return val == 0; }));
+
+            volume.setMuted(false);
+            samples = make_samples(random, kFrameCount * 2);
+            volume.process(samples.data(), kFrameCount, 2);
+            CHECK_MSG(volume.getBypassMode() == DspVolume::Bypass_Mode::NONE, "%s: unmute did not fade back in", isa);
+        }
+    }
+
+    void test_gain(const char* isa, std::mt19937& random)
+    {
+        // Q15 up to just below 4.0 linear; +12.5 dB goes through the float path either way
+        const float kGains[] = { -60.0f, -30.0f, -12.0f, -6.02f, -0.5f, 0.01f, 3.0f, 6.0f, 11.9f, 12.5f };
+        for (auto gain : kGains)
+        {
+            for (int channels : { 1, 2 })
+            {
+                DspVolume fixed_volume;
+                FloatPathVolume float_volume;
+                set_gain(fixed_volume, gain);
+                set_gain(float_volume, gain);
+
+                // odd count: the kernels' tails
+                const auto kFrames = kFrameCount + 13;
+                const auto kInput = make_samples(random, kFrames * channels);
+                auto fixed = kInput;
+                auto floating = kInput;
+                fixed_volume.process(fixed.data(), kFrames, channels);
+                float_volume.process(floating.data(), kFrames, channels);
+                CHECK(fixed_volume.getBypassMode() == DspVolume::Bypass_Mode::NONE);
+
+                const auto kLinear = db2lin_alt2(gain);
+                std::vector<int16_t> reference(kInput.size());
+                for (size_t i = 0; i < kInput.size(); ++i)
+                {
+                    const auto kVal = std::lround(static_cast<double>(kInput[i]) * kLinear);
+                    reference[i] = static_cast<int16_t>(std::min(32767l, std::max(-32768l, kVal)));
+                }
+
+                CHECK_MSG(max_difference(fixed, reference) <= 1, "%s: %.2f dB, %d LSB off the reference",
+                          isa, gain, max_difference(fixed, reference));
+                CHECK_MSG(max_difference(fixed, floating) <= 1, "%s: %.2f dB, fixed and float path %d LSB apart",
+                          isa, gain, max_difference(fixed, floating));
+            }
+        }
+    }
+
+    void test_fade_step()
+    {
+        // a fade of 4 dB per 10 ms, whatever the channel count
+        for (int channels : { 1, 2, 6 })
+        {
+            DspVolume volume;
+            volume.setGainDesired(-10.0f);
+            std::vector<int16_t> samples(kFrameCount * channels, 1000);
+            const float kExpected[] = { -4.0f, -8.0f, -10.0f, -10.0f };
+            for (auto expected : kExpected)
+            {
+                volume.process(samples.data(), kFrameCount, channels);
+                CHECK_MSG(std::abs(volume.getGainCurrent() - expected) < 1e-4f, "%d channels: gain %.4f, expected %.1f",
+                          channels, volume.getGainCurrent(), expected);
+            }
+
+            // the step scales with the frame count of the block
+            volume.setGainDesired(0.0f);
+            volume.process(samples.data(), kFrameCount / 4, channels);
+            CHECK(std::abs(volume.getGainCurrent() + 9.0f) < 1e-4f);
+            CHECK(std::abs(volume.GetFadeStep(kFrameCount) + 5.0f) < 1e-4f);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 random(29);
+    const auto kBest = static_cast<int>(DspKernels::get_best_isa());
+    for (int isa = 0; isa <= kBest; ++isa)
+    {
+        DspKernels::set_isa(static_cast<DspKernels::Isa>(isa));
+        test_bypass(kIsaNames[isa], random);
+        test_gain(kIsaNames[isa], random);
+    }
+    test_fade_step();
+    return TestCommon::result("dsp_volume");
+}
@@ -0,0 +1,86 @@
+// RealFft against a direct DFT in double precision, and the inverse round trip, for every size the DSP code
+// could ask for
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "test_common.h"
+#include "volume/fft.h"
+
+namespace
+{
+    const double kPi = 3.14159265358979323846;
+
+    std::vector<std::complex<double>> dft(const std::vector<float>& in)
+    {
+        const auto kSize = static_cast<int32_t>(in.size());
+        std::vector<std::complex<double>> out(kSize / 2 + 1);
+        for (int32_t k = 0; k <= kSize / 2; ++k)
+        {
+            std::complex<double> sum;
+            for (int32_t n = 0; n < kSize; ++n)
+                sum += static_cast<double>(in[n]) * std::polar(1.0, -2.0 * kPi * k * n / kSize);
+
+            out[k] = sum;
+        }
+        return out;
+    }
+
+    void test_size(std::mt19937& random, int32_t size)
+    {
+        RealFft fft(size);
+        CHECK(fft.size() == size);
+        CHECK(fft.bin_count() == size / 2 + 1);
+
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        std::vector<float> in(size);
+        for (auto& val : in)
+            val = distribution(random);
+
+        // error of a float FFT grows with log2(size); scaled by the rms of the spectrum, sqrt(size / 3)
+        const auto kTolerance = 1e-6 * std::log2(size) * std::sqrt(size / 3.0) * 4;
+        std::vector<std::complex<float>> bins(fft.bin_count());
+        fft.forward(in.data(), bins.data());
+        const auto kExpected = dft(in);
+        double max_error = 0.0;
+        for (int32_t k = 0; k < fft.bin_count(); ++k)
+            max_error = std::max(max_error, std::abs(std::complex<double>(bins[k]) - kExpected[k]));
+
+        CHECK_MSG(max_error <= kTolerance, "forward, size %d: error %g, tolerance %g", size, max_error, kTolerance);
+        CHECK_MSG(std::abs(bins[0].imag()) <= kTolerance && std::abs(bins[size / 2].imag()) <= kTolerance,
+                  "forward, size %d: DC or Nyquist bin not real", size);
+
+        // inverse is unscaled: inverse(forward(x)) == size * x
+        std::vector<float> out(size);
+        fft.inverse(bins.data(), out.data());
+        max_error = 0.0;
+        for (int32_t i = 0; i < size; ++i)
+            max_error = std::max(max_error, std::abs(out[i] / size - static_cast<double>(in[i])));
+
+        CHECK_MSG(max_error <= 1e-5, "round trip, size %d: error %g", size, max_error);
+
+        // a cosine on bin 1 lands there only, with size / 2 amplitude
+        for (int32_t i = 0; i < size; ++i)
+            in[i] = static_cast<float>(std::cos(2.0 * kPi * i / size));
+
+        fft.forward(in.data(), bins.data());
+        for (int32_t k = 0; k < fft.bin_count(); ++k)
+        {
+            const auto kExpectedMagnitude = (k == 1) ? size / 2.0 : 0.0;
+            CHECK_MSG(std::abs(std::abs(bins[k]) - kExpectedMagnitude) <= kTolerance,
+                      "cosine, size %d: bin %d is %g, expected %g", size, k, std::abs(bins[k]), kExpectedMagnitude);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 random(1234);
+    for (int32_t size = 4; size <= 4096; size *= 2)
+        test_size(random, size);
+
+    return TestCommon::result("fft");
+}
@@ -0,0 +1,201 @@
+// GainAutomation: ramps stepped in 32 frame chunks sampled in their middle, mute ramps ending muted, events
+// landing at their distance inside the block, and events merged into the latest state, in order, when the queue is full
+
+#include <cmath>
+#include <vector>
+
+#include "test_common.h"
+#include "volume/gain_automation.h"
+
+namespace
+{
+    const int32_t kFrameCount = 960;    // 20 ms at 48 kHz
+    const int32_t kRampChunk = 32;
+
+    struct Segment
+    {
+        int32_t position;
+        int32_t count;
+        float gain_db;
+    };
+
+    std::vector<Segment> run_block(GainAutomation& automation, int32_t frame_count = kFrameCount)
+    {
+        std::vector<Segment> result;
+        automation.begin_block(frame_count);
+        float gain_db;
+        for (int32_t position = 0; position < frame_count;)
+        {
+            const auto kCount = automation.next_segment(position, frame_count, gain_db);
+            result.push_back(Segment{ position, kCount, gain_db });
+            position += kCount;
+        }
+        return result;
+    }
+
+    // a second ago: due at the start of the next block
+    GainAutomation::Event make_event(GainAutomation::Type type, float gain_db = 0.0f, float ramp_ms = 0.0f)
+    {
+        GainAutomation::Event event;
+        event.time_us = GainAutomation::now() - 1000000;
+        event.type = type;
+        event.gain_db = gain_db;
+        event.ramp_ms = ramp_ms;
+        return event;
+    }
+
+    void test_ramp()
+    {
+        GainAutomation automation;
+        CHECK(automation.is_idle());
+        run_block(automation);
+
+        // -12 dB over 10 ms: 15 chunks of 32 frames, then the rest of the block at the target
+        CHECK(automation.schedule(make_event(GainAutomation::Type::GAIN, -12.0f, 10.0f)));
+        CHECK(!automation.is_idle());
+        const auto kSegments = run_block(automation);
+        CHECK_MSG(kSegments.size() == 16, "ramp: %d segments", static_cast<int>(kSegments.size()));
+        for (size_t i = 0; i + 1 < kSegments.size(); ++i)
+        {
+            const auto kExpected = -12.0f / 480.0f * (kRampChunk * i + kRampChunk / 2);
+            CHECK_MSG((kSegments[i].count == kRampChunk) && (std::abs(kSegments[i].gain_db - kExpected) < 1e-3f),
+                      "ramp chunk %d: %d frames at %.3f dB, expected %d at %.3f", static_cast<int>(i), kSegments[i].count,
+                      kSegments[i].gain_db, kRampChunk, kExpected);
+        }
+        CHECK(kSegments.back().position == 480 && kSegments.back().count == 480);
+        CHECK(kSegments.back().gain_db == -12.0f);
+
+        // settled: one run per block
+        const auto kSettled = run_block(automation);
+        CHECK(kSettled.size() == 1 && kSettled[0].gain_db == -12.0f);
+
+        // a ramp shorter than a chunk is a single run
+        CHECK(automation.schedule(make_event(GainAutomation::Type::GAIN, 0.0f, 0.5f)));
+        const auto kShort = run_block(automation);
+        CHECK(kShort.size() == 2 && kShort[0].count == 24 && kShort[1].gain_db == 0.0f);
+        CHECK(automation.is_idle());
+    }
+
+    void test_mute()
+    {
+        GainAutomation automation;
+        run_block(automation);
+
+        // 2 ms down to the floor in 3 chunks, muted from there on
+        CHECK(automation.schedule(make_event(GainAutomation::Type::MUTE, 0.0f, 2.0f)));
+        auto segments = run_block(automation);
+        CHECK(segments.size() == 4);
+        CHECK(segments[0].gain_db < 0.0f && segments[0].gain_db > segments[1].gain_db && segments[1].gain_db > segments[2].gain_db);
+        CHECK(segments[2].gain_db > -200.0f);
+        CHECK(segments.back().position == 96 && segments.back().gain_db <= -200.0f);
+        CHECK(run_block(automation)[0].gain_db <= -200.0f);
+
+        // a step back
+        CHECK(automation.schedule(make_event(GainAutomation::Type::UNMUTE)));
+        segments = run_block(automation);
+        CHECK(segments.size() == 1 && segments[0].gain_db == 0.0f);
+        CHECK(automation.is_idle());
+    }
+
+    void test_position()
+    {
+        // two events 2 ms apart split the block 96 frames apart, wherever the block clock puts the first
+        GainAutomation automation;
+        run_block(automation);
+        const auto kNow = GainAutomation::now();
+        auto first = make_event(GainAutomation::Type::GAIN, -6.0f);
+        first.time_us = kNow + 3000;
+        auto second = make_event(GainAutomation::Type::GAIN, -9.0f);
+        second.time_us = kNow + 5000;
+        CHECK(automation.schedule(first));
+        CHECK(automation.schedule(second));
+
+        const auto kSegments = run_block(automation);
+        CHECK_MSG(kSegments.size() == 3, "position: %d segments", static_cast<int>(kSegments.size()));
+        if (kSegments.size() != 3)
+            return;
+
+        CHECK(kSegments[0].position == 0 && kSegments[0].gain_db == 0.0f);
+        CHECK(kSegments[1].position > 0 && kSegments[1].gain_db == -6.0f);
+        CHECK_MSG(std::abs(kSegments[2].position - kSegments[1].position - 96) <= 1, "position: events %d frames apart",
+                  kSegments[2].position - kSegments[1].position);
+        CHECK(kSegments[2].gain_db == -9.0f);
+    }
+
+    void test_merge()
+    {
+        GainAutomation automation;
+        run_block(automation);
+
+        // the ring keeps one slot free
+        int queued = 0;
+        while (automation.schedule(make_event(GainAutomation::Type::GAIN, (queued % 2) ? -3.0f : -20.0f, 1.0f)))
+            ++queued;
+
+        CHECK_MSG(queued == 63, "merge: %d events queued", queued);
+
+        // once one was merged, the later ones are too, so they are not applied before it
+        CHECK(!automation.schedule(make_event(GainAutomation::Type::MUTE, 0.0f, 5.0f)));
+        CHECK(!automation.schedule(make_event(GainAutomation::Type::GAIN, -7.0f)));
+        CHECK(!automation.schedule(make_event(GainAutomation::Type::UNMUTE)));
+
+        // the queue drains at the block start, then the latest gain and mute state apply
+        const auto kSegments = run_block(automation);
+        CHECK(kSegments.size() == 1);
+        CHECK_MSG(kSegments.back().gain_db == -7.0f, "merge: %.2f dB, expected the merged -7", kSegments.back().gain_db);
+
+        // queueing again
+        CHECK(automation.schedule(make_event(GainAutomation::Type::GAIN, 0.0f)));
+        CHECK(run_block(automation).back().gain_db == 0.0f);
+        CHECK(automation.is_idle());
+
+        // a merged mute stays muted
+        for (int i = 0; i < 63; ++i)
+            CHECK(automation.schedule(make_event(GainAutomation::Type::GAIN, -1.0f)));
+
+        CHECK(!automation.schedule(make_event(GainAutomation::Type::MUTE)));
+        CHECK(run_block(automation).back().gain_db <= -200.0f);
+    }
+
+    void test_merge_order()
+    {
+        // merged state waits behind the queued events, and so does everything after it, even with room again
+        GainAutomation automation;
+        run_block(automation);
+        for (int i = 0; i < 10; ++i)
+            CHECK(automation.schedule(make_event(GainAutomation::Type::GAIN, -1.0f)));
+
+        auto later = make_event(GainAutomation::Type::GAIN, -2.0f);
+        later.time_us = GainAutomation::now() + 60000000;
+        while (automation.schedule(later))
+            ;
+
+        CHECK(!automation.schedule(make_event(GainAutomation::Type::GAIN, -7.0f)));
+        CHECK(run_block(automation).back().gain_db == -1.0f);
+        CHECK_MSG(!automation.schedule(make_event(GainAutomation::Type::GAIN, -3.0f)), "merge order: queued ahead of the merged state");
+        CHECK(run_block(automation).back().gain_db == -1.0f);
+    }
+
+    void test_skip()
+    {
+        // silent blocks consume the events all the same
+        GainAutomation automation;
+        run_block(automation);
+        CHECK(automation.schedule(make_event(GainAutomation::Type::GAIN, -5.0f, 5.0f)));
+        automation.begin_block(kFrameCount);
+        automation.skip(kFrameCount);
+        const auto kSegments = run_block(automation);
+        CHECK(kSegments.size() == 1 && kSegments[0].gain_db == -5.0f);
+    }
+}
+
+int main()
+{
+    test_ramp();
+    test_mute();
+    test_position();
+    test_merge();
+    test_merge_order();
+    test_skip();
+    return TestCommon::result("gain_automation");
+}
@@ -0,0 +1,143 @@
+// ReplayHistory: IMA ADPCM round trip quality, block granularity of decode, the ring keeping only the newest
+// blocks, and the downmix of multichannel input
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "test_common.h"
+#include "volume/replay_buffer.h"
+
+namespace
+{
+    const int32_t kSampleRate = 48000;
+    const int32_t kFrameCount = 480;
+
+    // speech band test signal: two tones and a slow amplitude sweep
+    std::vector<int16_t> make_signal(int32_t frames)
+    {
+        std::vector<int16_t> result(frames);
+        for (int32_t i = 0; i < frames; ++i)
+        {
+            const auto kEnvelope = 0.5f + 0.5f * std::sin(0.0005f * i);
+            result[i] = static_cast<int16_t>(kEnvelope * (10000.0f * std::sin(0.031f * i) + 3000.0f * std::sin(0.29f * i)));
+        }
+        return result;
+    }
+
+    void push_frames(ReplayHistory& history, const std::vector<int16_t>& mono, int32_t channels, float right_sign = 1.0f)
+    {
+        std::vector<int16_t> frame(kFrameCount * channels);
+        for (size_t offset = 0; offset < mono.size(); offset += kFrameCount)
+        {
+            for (int32_t i = 0; i < kFrameCount; ++i)
+            {
+                for (int32_t c = 0; c < channels; ++c)
+                    frame[i * channels + c] = static_cast<int16_t>(((c == 1) ? right_sign : 1.0f) * mono[offset + i]);
+            }
+            history.push(frame.data(), kFrameCount, channels);
+        }
+    }
+
+    // SNR of the decoded frames against the end of the reference up to the last complete block
+    double snr_db(const std::vector<int16_t>& reference, uint64_t written, const std::vector<int16_t>& decoded)
+    {
+        const auto kEnd = static_cast<int64_t>(written * ReplayHistory::kBlockFrames);
+        const auto kStart = kEnd - static_cast<int64_t>(decoded.size());
+        double signal = 0.0;
+        double noise = 0.0;
+        for (size_t i = 0; i < decoded.size(); ++i)
+        {
+            const double kRef = reference[kStart + i];
+            signal += kRef * kRef;
+            noise += (kRef - decoded[i]) * (kRef - decoded[i]);
+        }
+        return 10.0 * std::log10(signal / std::max(noise, 1.0));
+    }
+
+    void test_round_trip()
+    {
+        ReplayHistory history(kSampleRate, 10);
+        const auto kSignal = make_signal(kSampleRate * 4);
+        push_frames(history, kSignal, 1);
+        CHECK(history.written() == kSignal.size() / ReplayHistory::kBlockFrames);
+
+        std::vector<int16_t> decoded;
+        const auto kCount = history.decode(decoded, 0);
+        CHECK(kCount == static_cast<int32_t>(history.written() * ReplayHistory::kBlockFrames));
+        CHECK(kCount == static_cast<int32_t>(decoded.size()));
+
+        const auto kSnr = snr_db(kSignal, history.written(), decoded);
+        CHECK_MSG(kSnr > 35.0, "round trip SNR %.1f dB", kSnr);
+    }
+
+    void test_partial_block()
+    {
+        ReplayHistory history(kSampleRate, 10);
+        push_frames(history, make_signal(kFrameCount * 2), 1);     // 960 < kBlockFrames
+        std::vector<int16_t> decoded;
+        CHECK(history.written() == 0);
+        CHECK(history.decode(decoded, 0) == 0);
+        CHECK(decoded.empty());
+    }
+
+    void test_ring()
+    {
+        ReplayHistory history(kSampleRate, 1);
+        CHECK(history.capacity() == (kSampleRate + ReplayHistory::kBlockFrames - 1) / ReplayHistory::kBlockFrames);
+
+        const auto kSignal = make_signal(kSampleRate * 3);
+        push_frames(history, kSignal, 1);
+
+        // only the newest blocks are left, and they are the end of the signal; the block being written
+        // (3 s is no whole number of blocks) has taken the slot of the oldest one
+        CHECK(kSignal.size() % ReplayHistory::kBlockFrames != 0);
+        std::vector<int16_t> decoded;
+        CHECK(history.decode(decoded, 0) == (history.capacity() - 1) * ReplayHistory::kBlockFrames);
+        CHECK_MSG(snr_db(kSignal, history.written(), decoded) > 35.0, "ring: newest blocks do not match the end of the input");
+
+        // max_frames rounds up to whole blocks
+        CHECK(history.decode(decoded, 1) == ReplayHistory::kBlockFrames);
+        CHECK(history.decode(decoded, ReplayHistory::kBlockFrames + 1) == 2 * ReplayHistory::kBlockFrames);
+        CHECK_MSG(snr_db(kSignal, history.written(), decoded) > 35.0, "ring: max_frames did not return the newest blocks");
+    }
+
+    void test_downmix()
+    {
+        const auto kSignal = make_signal(kSampleRate);
+        ReplayHistory mono(kSampleRate, 10);
+        ReplayHistory stereo(kSampleRate, 10);
+        ReplayHistory surround(kSampleRate, 10);
+        ReplayHistory opposed(kSampleRate, 10);
+        push_frames(mono, kSignal, 1);
+        push_frames(stereo, kSignal, 2);
+        push_frames(surround, kSignal, 6);
+        push_frames(opposed, kSignal, 2, -1.0f);
+
+        // identical channels average to the input itself, so the code is the same bit by bit
+        std::vector<int16_t> expected, decoded;
+        mono.decode(expected, 0);
+        stereo.decode(decoded, 0);
+        CHECK(decoded == expected);
+        surround.decode(decoded, 0);
+        CHECK(decoded == expected);
+
+        // left and right in opposite phase cancel
+        opposed.decode(decoded, 0);
+        int32_t peak = 0;
+        for (auto val : decoded)
+            peak = std::max(peak, std::abs(static_cast<int32_t>(val)));
+
+        CHECK_MSG(peak <= 8, "opposed stereo downmix peaks at %d", peak);
+    }
+}
+
+int main()
+{
+    test_round_trip();
+    test_partial_block();
+    test_ring();
+    test_downmix();
+    return TestCommon::result("replay_history");
+}
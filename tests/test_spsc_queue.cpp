@@ -0,0 +1,125 @@
+// SpscQueue: FIFO order, full / empty at the bounds and across wrap around, then a producer and a consumer
+// thread handing over a long sequence
+
+#include <thread>
+
+#include "test_common.h"
+#include "volume/spsc_queue.h"
+
+namespace
+{
+    void test_bounds()
+    {
+        SpscQueue<int, 8> queue;
+        int val = -1;
+        CHECK(queue.empty());
+        CHECK(!queue.front());
+        CHECK(!queue.pop(val));
+
+        // one slot is kept free
+        for (int i = 0; i < 7; ++i)
+            CHECK(queue.push(i));
+
+        CHECK(!queue.push(7));
+        CHECK(!queue.begin_push());
+        CHECK(!queue.empty());
+
+        for (int i = 0; i < 7; ++i)
+        {
+            CHECK(queue.pop(val));
+            CHECK(val == i);
+        }
+        CHECK(queue.empty());
+        CHECK(!queue.pop(val));
+    }
+
+    void test_wrap_around()
+    {
+        SpscQueue<int, 4> queue;
+        int next_push = 0;
+        int next_pop = 0;
+        for (int round = 0; round < 100; ++round)
+        {
+            // fill levels 1..3 in turn, so head and tail pass the end of the ring at every offset
+            const auto kCount = 1 + round % 3;
+            for (int i = 0; i < kCount; ++i)
+            {
+                auto slot = queue.begin_push();
+                CHECK(slot);
+                if (!slot)
+                    return;
+
+                *slot = next_push++;
+                queue.end_push();
+            }
+            for (int i = 0; i < kCount; ++i)
+            {
+                auto slot = queue.front();
+                CHECK(slot && *slot == next_pop);
+                queue.pop();
+                ++next_pop;
+            }
+            CHECK(queue.empty());
+        }
+    }
+
+    void test_threads()
+    {
+        struct Block
+        {
+            uint32_t sequence;
+            uint32_t payload[15];
+        };
+
+        const uint32_t kCount = 200000;
+        SpscQueue<Block, 16> queue;
+        std::thread producer([&queue]() {
+            for (uint32_t i = 0; i < kCount;)
+            {
+                auto slot = queue.begin_push();
+                if (!slot)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                slot->sequence = i;
+                for (uint32_t k = 0; k < 15; ++k)
+                    slot->payload[k] = i * 31 + k;
+
+                queue.end_push();
+                ++i;
+            }
+        });
+
+        uint32_t errors = 0;
+        for (uint32_t i = 0; i < kCount;)
+        {
+            auto slot = queue.front();
+            if (!slot)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // the payload is written before end_push, so it has to be complete here
+            errors += (slot->sequence != i);
+            for (uint32_t k = 0; k < 15; ++k)
+                errors += (slot->payload[k] != i * 31 + k);
+
+            queue.pop();
+            ++i;
+        }
+        producer.join();
+        CHECK_MSG(errors == 0, "threads: %u mismatched values", errors);
+        CHECK(queue.empty());
+    }
+}
+
+int main()
+{
+    test_bounds();
+    test_wrap_around();
+    test_threads();
+    return TestCommon::result("spsc_queue");
+}
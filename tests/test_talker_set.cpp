@@ -0,0 +1,151 @@
+// TalkerBitset against std::set, with ids at the word and summary boundaries, and TalkerSet iteration
+
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "test_common.h"
+#include "core/talker_set.h"
+
+namespace
+{
+    // every id next() returns, in order
+    std::vector<int> collect(const TalkerBitset& bitset)
+    {
+        std::vector<int> result;
+        for (auto id = bitset.next(0); id >= 0; id = bitset.next(id + 1))
+            result.push_back(id);
+
+        return result;
+    }
+
+    void test_boundaries()
+    {
+        // first / last bit of a word, of a summary word and of the whole range
+        const int kIds[] = { 0, 1, 63, 64, 65, 4095, 4096, 4097, 32767, 32768, 65472, 65534, 65535 };
+        TalkerBitset bitset;
+        CHECK(bitset.count() == 0);
+        CHECK(bitset.next(0) == -1);
+        for (auto id : kIds)
+        {
+            CHECK(!bitset.contains(static_cast<anyID>(id)));
+            CHECK(bitset.insert(static_cast<anyID>(id)));
+            CHECK(!bitset.insert(static_cast<anyID>(id)));
+            CHECK(bitset.contains(static_cast<anyID>(id)));
+        }
+        CHECK(bitset.count() == static_cast<int>(sizeof(kIds) / sizeof(kIds[0])));
+        CHECK(collect(bitset) == std::vector<int>(std::begin(kIds), std::end(kIds)));
+
+        // next from inside a gap and past the end
+        CHECK(bitset.next(2) == 63);
+        CHECK(bitset.next(66) == 4095);
+        CHECK(bitset.next(4098) == 32767);
+        CHECK(bitset.next(65536) == -1);
+
+        for (auto id : kIds)
+        {
+            CHECK(bitset.remove(static_cast<anyID>(id)));
+            CHECK(!bitset.remove(static_cast<anyID>(id)));
+        }
+        CHECK(bitset.count() == 0);
+        CHECK(bitset.next(0) == -1);
+    }
+
+    void test_random()
+    {
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> any_id(0, 65535);
+        std::uniform_int_distribution<int> clustered_id(1000, 1200);   // busy server: ids close together
+        TalkerBitset bitset;
+        std::set<int> expected;
+        for (int i = 0; i < 100000; ++i)
+        {
+            const auto kId = (i & 1) ? any_id(random) : clustered_id(random);
+            if (random() & 1)
+                CHECK(bitset.insert(static_cast<anyID>(kId)) == expected.insert(kId).second);
+            else
+                CHECK(bitset.remove(static_cast<anyID>(kId)) == (expected.erase(kId) == 1));
+
+            if ((i % 10000) == 0)
+            {
+                CHECK(bitset.count() == static_cast<int>(expected.size()));
+                CHECK(collect(bitset) == std::vector<int>(expected.begin(), expected.end()));
+            }
+        }
+        CHECK(collect(bitset) == std::vector<int>(expected.begin(), expected.end()));
+    }
+
+    void test_set()
+    {
+        TalkerSet set;
+        CHECK(set.isEmpty());
+        CHECK(set.begin() == set.end());
+
+        std::map<uint64, std::set<anyID>> expected;
+        const uint64 kServers[] = { 1, 2, 7 };
+        for (auto server : kServers)
+        {
+            for (anyID id : { 5, 900, 3, 64 })
+            {
+                const auto kId = static_cast<anyID>(id + server);
+                CHECK(set.insert(server, kId));
+                expected[server].insert(kId);
+            }
+        }
+        CHECK(!set.insert(1, 6));
+        CHECK(set.size() == 12);
+        CHECK(set.count(2) == 4);
+        CHECK(set.contains(7, 12));
+        CHECK(!set.contains(7, 11));
+        CHECK(!set.contains(3));
+
+        // grouped by server tab (in hash order), ascending client ids within
+        std::map<uint64, std::vector<anyID>> seen;
+        uint64 previous_server = 0;
+        for (auto it = set.begin(); it != set.end(); ++it)
+        {
+            CHECK_MSG(seen.count(it.key()) == 0 || it.key() == previous_server, "server %llu not contiguous",
+                      static_cast<unsigned long long>(it.key()));
+            seen[it.key()].push_back(*it);
+            previous_server = it.key();
+        }
+        for (const auto& kServer : expected)
+        {
+            CHECK(seen[kServer.first] == std::vector<anyID>(kServer.second.begin(), kServer.second.end()));
+            const auto kValues = set.values(kServer.first);
+            CHECK(std::set<anyID>(kValues.begin(), kValues.end()) == kServer.second);
+        }
+
+        // a server tab whose talkers all stopped keeps its bitset, but reads like the QMultiMap: not contained,
+        // skipped by iteration
+        for (auto id : expected[2])
+            CHECK(set.remove(2, id));
+
+        CHECK(set.count(2) == 0);
+        CHECK(!set.contains(2));
+        CHECK(set.size() == 8);
+        int iterated = 0;
+        for (auto it = set.begin(); it != set.end(); ++it)
+        {
+            CHECK(it.key() != 2);
+            ++iterated;
+        }
+        CHECK(iterated == 8);
+
+        set.remove(1);
+        set.remove(2);
+        set.remove(7);
+        CHECK(set.isEmpty());
+        CHECK(set.begin() == set.end());
+    }
+}
+
+int main()
+{
+    test_boundaries();
+    test_random();
+    test_set();
+    return TestCommon::result("talker_set");
+}
@@ -0,0 +1,192 @@
+// TSSessionCache against a fake client lib: cached answers without round trips once a tab is established,
+// the client lib fallback for tabs it doesn't hold, seeding of tabs connected before the plugin was loaded,
+// and the own client id outliving STATUS_DISCONNECTED until the tab is dropped
+
+#include <cstring>
+#include <map>
+
+#include "teamspeak/public_errors.h"
+
+#include "test_common.h"
+#include "plugin.h"
+#include "core/ts_session_cache.h"
+
+struct TS3Functions ts3Functions;
+
+namespace
+{
+    struct FakeTab
+    {
+        int status;
+        anyID my_id;
+        uint64 channel_id;
+    };
+
+    std::map<uint64, FakeTab> g_tabs;
+    int g_calls = 0;
+
+    const FakeTab* fake_tab(uint64 serverConnectionHandlerID)
+    {
+        ++g_calls;
+        const auto kIt = g_tabs.find(serverConnectionHandlerID);
+        return (kIt == g_tabs.end()) ? nullptr : &kIt->second;
+    }
+
+    unsigned int fake_get_connection_status(uint64 serverConnectionHandlerID, int* result)
+    {
+        auto tab = fake_tab(serverConnectionHandlerID);
+        if (!tab)
+            return ERROR_not_connected;
+
+        *result = tab->status;
+        return ERROR_ok;
+    }
+
+    unsigned int fake_get_client_id(uint64 serverConnectionHandlerID, anyID* result)
+    {
+        auto tab = fake_tab(serverConnectionHandlerID);
+        if (!tab)
+            return ERROR_not_connected;
+
+        if (tab->status != STATUS_CONNECTION_ESTABLISHED)
+            return ERROR_not_connected;
+
+        *result = tab->my_id;
+        return ERROR_ok;
+    }
+
+    unsigned int fake_get_channel_of_client(uint64 serverConnectionHandlerID, anyID clientID, uint64* result)
+    {
+        auto tab = fake_tab(serverConnectionHandlerID);
+        if (!tab)
+            return ERROR_not_connected;
+
+        if ((tab->status != STATUS_CONNECTION_ESTABLISHED) || (clientID != tab->my_id))
+            return ERROR_not_connected;
+
+        *result = tab->channel_id;
+        return ERROR_ok;
+    }
+
+    // the cache is a process wide singleton; each test uses its own tab ids
+    void test_hit()
+    {
+        auto cache = TSSessionCache::instance();
+        g_tabs[1] = FakeTab{ STATUS_CONNECTING, 0, 0 };
+        cache->onConnectStatusChanged(1, STATUS_CONNECTING);
+        g_tabs[1] = FakeTab{ STATUS_CONNECTION_ESTABLISHED, 42, 7 };
+        cache->onConnectStatusChanged(1, STATUS_CONNECTION_ESTABLISHED);
+
+        g_calls = 0;
+        int status = -1;
+        anyID my_id = 0;
+        uint64 channel_id = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            CHECK(cache->GetConnectionStatus(1, status) == ERROR_ok && status == STATUS_CONNECTION_ESTABLISHED);
+            CHECK(cache->GetMyClientID(1, my_id) == ERROR_ok && my_id == 42);
+            CHECK(cache->GetMyChannelID(1, channel_id) == ERROR_ok && channel_id == 7);
+        }
+        CHECK_MSG(g_calls == 0, "hit: %d client lib calls", g_calls);
+
+        // own moves update the channel, moves of others don't
+        cache->onClientMove(1, 42, 9);
+        cache->onClientMove(1, 43, 11);
+        CHECK(cache->GetMyChannelID(1, channel_id) == ERROR_ok && channel_id == 9);
+        CHECK(g_calls == 0);
+    }
+
+    void test_fallback()
+    {
+        auto cache = TSSessionCache::instance();
+
+        // not established yet: the ids come from the client lib
+        g_tabs[2] = FakeTab{ STATUS_CONNECTED, 5, 3 };
+        cache->onConnectStatusChanged(2, STATUS_CONNECTED);
+        g_calls = 0;
+        anyID my_id = 0;
+        CHECK(cache->GetMyClientID(2, my_id) == ERROR_not_connected);
+        CHECK(g_calls == 1);
+
+        // unknown tab: errors of the client lib are passed on, nothing is cached
+        g_calls = 0;
+        int status = -1;
+        CHECK(cache->GetConnectionStatus(3, status) == ERROR_not_connected);
+        CHECK(cache->GetConnectionStatus(3, status) == ERROR_not_connected);
+        CHECK(g_calls == 2);
+
+        // disconnected tab: answered by the client lib each time
+        g_tabs[4] = FakeTab{ STATUS_DISCONNECTED, 0, 0 };
+        g_calls = 0;
+        CHECK(cache->GetConnectionStatus(4, status) == ERROR_ok && status == STATUS_DISCONNECTED);
+        CHECK(cache->GetConnectionStatus(4, status) == ERROR_ok && status == STATUS_DISCONNECTED);
+        CHECK(g_calls == 2);
+    }
+
+    void test_seed()
+    {
+        // connected before the plugin was loaded: no status event, the first lookup reads the tab once
+        auto cache = TSSessionCache::instance();
+        g_tabs[5] = FakeTab{ STATUS_CONNECTION_ESTABLISHED, 17, 23 };
+        g_calls = 0;
+        anyID my_id = 0;
+        uint64 channel_id = 0;
+        int status = -1;
+        CHECK(cache->GetMyClientID(5, my_id) == ERROR_ok && my_id == 17);
+        CHECK_MSG(g_calls == 3, "seed: %d client lib calls, expected status, id and channel", g_calls);
+        CHECK(cache->GetMyChannelID(5, channel_id) == ERROR_ok && channel_id == 23);
+        CHECK(cache->GetConnectionStatus(5, status) == ERROR_ok && status == STATUS_CONNECTION_ESTABLISHED);
+        CHECK(g_calls == 3);
+
+        // seeded from a status query as well
+        g_tabs[6] = FakeTab{ STATUS_CONNECTION_ESTABLISHED, 18, 24 };
+        g_calls = 0;
+        CHECK(cache->GetConnectionStatus(6, status) == ERROR_ok && status == STATUS_CONNECTION_ESTABLISHED);
+        CHECK(cache->GetMyClientID(6, my_id) == ERROR_ok && my_id == 18);
+        CHECK(g_calls == 3);
+    }
+
+    void test_drop()
+    {
+        auto cache = TSSessionCache::instance();
+        g_tabs[7] = FakeTab{ STATUS_CONNECTION_ESTABLISHED, 30, 2 };
+        cache->onConnectStatusChanged(7, STATUS_CONNECTION_ESTABLISHED);
+
+        // while the disconnect is handled, the client lib no longer knows the own id, the cache still does
+        g_tabs[7] = FakeTab{ STATUS_DISCONNECTED, 0, 0 };
+        cache->onConnectStatusChanged(7, STATUS_DISCONNECTED);
+        g_calls = 0;
+        int status = -1;
+        anyID my_id = 0;
+        CHECK(cache->GetConnectionStatus(7, status) == ERROR_ok && status == STATUS_DISCONNECTED);
+        CHECK(cache->GetMyClientID(7, my_id) == ERROR_ok && my_id == 30);
+        CHECK(g_calls == 0);
+
+        // dropped: back to the client lib
+        cache->drop(7);
+        CHECK(cache->GetMyClientID(7, my_id) == ERROR_not_connected);
+        CHECK(g_calls > 0);
+
+        // reconnect with a new id
+        g_tabs[7] = FakeTab{ STATUS_CONNECTION_ESTABLISHED, 31, 4 };
+        cache->onConnectStatusChanged(7, STATUS_CONNECTING);
+        cache->onConnectStatusChanged(7, STATUS_CONNECTION_ESTABLISHED);
+        g_calls = 0;
+        CHECK(cache->GetMyClientID(7, my_id) == ERROR_ok && my_id == 31);
+        CHECK(g_calls == 0);
+    }
+}
+
+int main()
+{
+    memset(&ts3Functions, 0, sizeof(ts3Functions));
+    ts3Functions.getConnectionStatus = fake_get_connection_status;
+    ts3Functions.getClientID = fake_get_client_id;
+    ts3Functions.getChannelOfClient = fake_get_channel_of_client;
+
+    test_hit();
+    test_fallback();
+    test_seed();
+    test_drop();
+    return TestCommon::result("ts_session_cache");
+}
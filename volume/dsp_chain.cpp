@@ -0,0 +1,85 @@
+#include "volume/dsp_chain.h"
+
+#include "core/scratch_arena.h"
+#include "volume/dsp_kernels.h"
+
+const int32_t DspChain::kMaxChannels;
+
+DspChain::DspChain(int32_t sample_rate, int32_t max_channels)
+    : m_sample_rate(sample_rate)
+    , m_max_channels(max_channels)
+{
+}
+
+void DspChain::add_stage(std::unique_ptr<DspStage> stage)
+{
+    stage->prepare(m_sample_rate, m_max_channels);
+    m_stages.push_back(std::move(stage));
+}
+
+//! Size all stages for up to max_channels; allocates, so never call it from the callbacks or a pipeline worker
+void DspChain::prepare(int32_t max_channels)
+{
+    m_max_channels = max_channels;
+    m_channels = 0;
+    for (auto& stage : m_stages)
+        stage->prepare(m_sample_rate, max_channels);
+}
+
+void DspChain::reset()
+{
+    for (auto& stage : m_stages)
+        stage->reset();
+}
+
+//! Process an interleaved frame in place
+/*!
+ * \param samples interleaved samples
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \return false when the frame was left untouched (no stages, more than max_channels, scratch arena exhausted)
+ */
+bool DspChain::process(int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    if (m_stages.empty() || frame_count <= 0 || channels <= 0 || channels > m_max_channels)
+        return false;
+
+    auto& arena = ScratchArena::local();
+    auto planes = arena.allocate_array<float*>(channels);
+    if (!planes)
+        return false;
+
+    for (int32_t c = 0; c < channels; ++c)
+    {
+        planes[c] = arena.allocate_array<float>(frame_count);
+        if (!planes[c])
+            return false;
+    }
+
+    DspKernels::deinterleave(samples, planes, frame_count, channels);
+    process(planes, frame_count, channels);
+    DspKernels::interleave(planes, samples, frame_count, channels);
+    return true;
+}
+
+//! Process float planes in place
+/*!
+ * \return false when the planes were left untouched (more than max_channels)
+ */
+bool DspChain::process(float* const* planes, int32_t frame_count, int32_t channels)
+{
+    if (channels > m_max_channels)
+        return false;
+
+    // the stages hold state per channel; a new layout starts from scratch, without reallocating
+    if (channels != m_channels)
+    {
+        m_channels = channels;
+        reset();
+    }
+
+    for (auto& stage : m_stages)
+        stage->process(planes, frame_count, channels);
+
+    return true;
+}
@@ -0,0 +1,1248 @@
+#include "volume/dsp_kernels.h"
+
+#include <atomic>
+#include <cmath>
+
+#include "dsp_kernels_impl.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSP_KERNELS_SSE2
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#endif
+
+#if defined(DSP_KERNELS_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+using namespace DspKernels::Impl;
+
+namespace {
+
+    // Scalar
+
+    inline int16_t to_int16(float val)
+    {
+        val = val * kToInt16;
+        val = (val < -32768.0f) ? -32768.0f : ((val > 32767.0f) ? 32767.0f : val);
+        return static_cast<int16_t>(std::lrint(val));
+    }
+
+    void int16_to_float_scalar(const int16_t* in, float* out, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            out[i] = in[i] * kToFloat;
+    }
+
+    void float_to_int16_scalar(const float* in, int16_t* out, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            out[i] = to_int16(in[i]);
+    }
+
+    inline float dither_scalar(DspKernels::DitherState& dither)
+    {
+        const float kToUnit = 1.0f / 4294967296.0f;
+        const auto kR1 = static_cast<int32_t>(xorshift(dither.lanes[0]));
+        const auto kR2 = static_cast<int32_t>(xorshift(dither.lanes[1]));
+        return (kR1 * kToUnit + kR2 * kToUnit) * kToFloat;
+    }
+
+    void float_to_int16_dither_scalar(const float* in, int16_t* out, int32_t count, DspKernels::DitherState& dither)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            out[i] = to_int16(in[i] + dither_scalar(dither));
+    }
+
+    void deinterleave_stereo_scalar(const int16_t* in, float* left, float* right, int32_t frame_count)
+    {
+        for (int32_t i = 0; i < frame_count; ++i)
+        {
+            left[i] = in[2 * i] * kToFloat;
+            right[i] = in[2 * i + 1] * kToFloat;
+        }
+    }
+
+    void interleave_stereo_scalar(const float* left, const float* right, int16_t* out, int32_t frame_count)
+    {
+        for (int32_t i = 0; i < frame_count; ++i)
+        {
+            out[2 * i] = to_int16(left[i]);
+            out[2 * i + 1] = to_int16(right[i]);
+        }
+    }
+
+    void downmix_stereo_scalar(const int16_t* in, float* out, int32_t frame_count)
+    {
+        for (int32_t i = 0; i < frame_count; ++i)
+            out[i] = (in[2 * i] + in[2 * i + 1]) * (kToFloat * 0.5f);
+    }
+
+    bool is_silent_scalar(const int16_t* samples, int32_t count)
+    {
+        int32_t acc = 0;
+        for (int32_t i = 0; i < count; ++i)
+            acc |= samples[i];
+
+        return (acc == 0);
+    }
+
+    void measure_scalar(const int16_t* samples, int32_t count, DspKernels::Levels& result)
+    {
+        accumulate_levels(samples, 0, count, result);
+        normalize_levels(result);
+    }
+
+    // round(sample * gain_q15 / 32768), saturated; matches the vector versions bit by bit
+    inline int16_t gain_q15_scalar(int32_t sample, int32_t gain_int, int32_t gain_frac)
+    {
+        const auto kVal = sample * gain_int + ((sample * gain_frac + (1 << 14)) >> 15);
+        return static_cast<int16_t>((kVal < -32768) ? -32768 : ((kVal > 32767) ? 32767 : kVal));
+    }
+
+    void apply_gain_q15_scalar(int16_t* samples, int32_t count, int32_t gain_q15)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            samples[i] = gain_q15_scalar(samples[i], gain_q15 >> 15, gain_q15 & 0x7FFF);
+    }
+
+    void and_int16_scalar(int16_t* samples, const int16_t* mask, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            samples[i] &= mask[i];
+    }
+
+    void apply_gain_pan_stereo_q15_scalar(int16_t* samples, int32_t frame_count, int32_t source, int32_t gain_left_q15, int32_t gain_right_q15)
+    {
+        for (int32_t i = 0; i < frame_count; ++i)
+        {
+            const int32_t kIn = samples[2 * i + source];
+            samples[2 * i] = gain_q15_scalar(kIn, gain_left_q15 >> 15, gain_left_q15 & 0x7FFF);
+            samples[2 * i + 1] = gain_q15_scalar(kIn, gain_right_q15 >> 15, gain_right_q15 & 0x7FFF);
+        }
+    }
+
+    void scale_scalar(float* samples, int32_t count, float gain)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            samples[i] *= gain;
+    }
+
+    void multiply_scalar(float* samples, const float* gains, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            samples[i] *= gains[i];
+    }
+
+    void add_scalar(const float* in, float* acc, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            acc[i] += in[i];
+    }
+
+    void soft_clip_scalar_block(float* samples, int32_t count, float drive)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            samples[i] = soft_clip_scalar(samples[i], drive);
+    }
+
+    void quantize_scalar_block(float* samples, int32_t count, float levels)
+    {
+        const auto kInv = 1.0f / levels;
+        for (int32_t i = 0; i < count; ++i)
+            samples[i] = quantize_scalar(samples[i], levels, kInv);
+    }
+
+    void add_noise_scalar_block(float* samples, int32_t count, float amplitude, DspKernels::DitherState& state)
+    {
+        add_noise_scalar(samples, 0, count, amplitude, state);
+    }
+
+    void complex_multiply_add_scalar(const float* a, const float* b, float* acc, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            const auto kRe = a[2 * i] * b[2 * i] - a[2 * i + 1] * b[2 * i + 1];
+            const auto kIm = a[2 * i] * b[2 * i + 1] + a[2 * i + 1] * b[2 * i];
+            acc[2 * i] += kRe;
+            acc[2 * i + 1] += kIm;
+        }
+    }
+
+    void compressor_curve_scalar(const float* magnitudes, float* reduction, int32_t count, const DspKernels::CompressorCurve& curve)
+    {
+        const auto kHalfKnee = knee_half(curve);
+        const auto kInvTwiceKnee = 1.0f / (4.0f * kHalfKnee);
+        for (int32_t i = 0; i < count; ++i)
+            reduction[i] = curve_scalar(fast_log2_scalar(magnitudes[i]), curve, kHalfKnee, kInvTwiceKnee);
+    }
+
+    void fast_exp2_scalar_block(const float* in, float* out, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+            out[i] = fast_exp2_scalar(in[i]);
+    }
+
+    void biquad_lanes_scalar(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections)
+    {
+        const auto kLanes = DspKernels::kBiquadLanes;
+        for (int32_t s = 0; s < sections; ++s)
+        {
+            const auto kC = coefficients + s * 5 * kLanes;
+            auto z = state + s * 2 * kLanes;
+            for (int32_t lane = 0; lane < kLanes; ++lane)
+            {
+                const auto kB0 = kC[lane];
+                const auto kB1 = kC[kLanes + lane];
+                const auto kB2 = kC[2 * kLanes + lane];
+                const auto kA1 = kC[3 * kLanes + lane];
+                const auto kA2 = kC[4 * kLanes + lane];
+                auto z1 = z[lane];
+                auto z2 = z[kLanes + lane];
+                for (int32_t i = 0; i < frame_count; ++i)
+                {
+                    const auto kX = data[i * kLanes + lane];
+                    const auto kY = kB0 * kX + z1;
+                    z1 = kB1 * kX - kA1 * kY + z2;
+                    z2 = kB2 * kX - kA2 * kY;
+                    data[i * kLanes + lane] = kY;
+                }
+                z[lane] = z1;
+                z[kLanes + lane] = z2;
+            }
+        }
+        flush_biquad_state(state, sections);
+    }
+
+#if defined(DSP_KERNELS_SSE2)
+    // SSE2; every kernel comes in an aligned and an unaligned flavour
+
+    template <bool kAligned> inline __m128i load_si(const void* p)
+    {
+        return kAligned ? _mm_load_si128(static_cast<const __m128i*>(p)) : _mm_loadu_si128(static_cast<const __m128i*>(p));
+    }
+
+    template <bool kAligned> inline void store_si(void* p, __m128i val)
+    {
+        if (kAligned)
+            _mm_store_si128(static_cast<__m128i*>(p), val);
+        else
+            _mm_storeu_si128(static_cast<__m128i*>(p), val);
+    }
+
+    template <bool kAligned> inline __m128 load_ps(const float* p)
+    {
+        return kAligned ? _mm_load_ps(p) : _mm_loadu_ps(p);
+    }
+
+    template <bool kAligned> inline void store_ps(float* p, __m128 val)
+    {
+        if (kAligned)
+            _mm_store_ps(p, val);
+        else
+            _mm_storeu_ps(p, val);
+    }
+
+    inline __m128i to_int32_sse2(__m128 val)
+    {
+        val = _mm_mul_ps(val, _mm_set1_ps(kToInt16));
+        val = _mm_min_ps(_mm_max_ps(val, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+        return _mm_cvtps_epi32(val);
+    }
+
+    inline __m128 xorshift_unit_sse2(__m128i& state)
+    {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+        return _mm_mul_ps(_mm_cvtepi32_ps(state), _mm_set1_ps(1.0f / 4294967296.0f));
+    }
+
+    template <bool kAligned>
+    void int16_to_float_sse2(const int16_t* in, float* out, int32_t count)
+    {
+        const auto kScale = _mm_set1_ps(kToFloat);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kIn = load_si<kAligned>(in + i);
+            const auto kLo = _mm_srai_epi32(_mm_unpacklo_epi16(kIn, kIn), 16);
+            const auto kHi = _mm_srai_epi32(_mm_unpackhi_epi16(kIn, kIn), 16);
+            store_ps<kAligned>(out + i, _mm_mul_ps(_mm_cvtepi32_ps(kLo), kScale));
+            store_ps<kAligned>(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(kHi), kScale));
+        }
+        int16_to_float_scalar(in + i, out + i, count - i);
+    }
+
+    template <bool kAligned>
+    void float_to_int16_sse2(const float* in, int16_t* out, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kLo = to_int32_sse2(load_ps<kAligned>(in + i));
+            const auto kHi = to_int32_sse2(load_ps<kAligned>(in + i + 4));
+            store_si<kAligned>(out + i, _mm_packs_epi32(kLo, kHi));
+        }
+        float_to_int16_scalar(in + i, out + i, count - i);
+    }
+
+    template <bool kAligned>
+    void float_to_int16_dither_sse2(const float* in, int16_t* out, int32_t count, DspKernels::DitherState& dither)
+    {
+        auto state_a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither.lanes));
+        auto state_b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither.lanes + 4));
+        const auto kLsb = _mm_set1_ps(kToFloat);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kTpdfLo = _mm_mul_ps(_mm_add_ps(xorshift_unit_sse2(state_a), xorshift_unit_sse2(state_b)), kLsb);
+            const auto kTpdfHi = _mm_mul_ps(_mm_add_ps(xorshift_unit_sse2(state_a), xorshift_unit_sse2(state_b)), kLsb);
+            const auto kLo = to_int32_sse2(_mm_add_ps(load_ps<kAligned>(in + i), kTpdfLo));
+            const auto kHi = to_int32_sse2(_mm_add_ps(load_ps<kAligned>(in + i + 4), kTpdfHi));
+            store_si<kAligned>(out + i, _mm_packs_epi32(kLo, kHi));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither.lanes), state_a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither.lanes + 4), state_b);
+        float_to_int16_dither_scalar(in + i, out + i, count - i, dither);
+    }
+
+    template <bool kAligned>
+    void deinterleave_stereo_sse2(const int16_t* in, float* left, float* right, int32_t frame_count)
+    {
+        const auto kScale = _mm_set1_ps(kToFloat);
+        int32_t i = 0;
+        for (; i + 4 <= frame_count; i += 4)
+        {
+            const auto kIn = load_si<kAligned>(in + 2 * i);
+            const auto kLo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(kIn, kIn), 16));   // L0 R0 L1 R1
+            const auto kHi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(kIn, kIn), 16));   // L2 R2 L3 R3
+            store_ps<kAligned>(left + i, _mm_mul_ps(_mm_shuffle_ps(kLo, kHi, _MM_SHUFFLE(2, 0, 2, 0)), kScale));
+            store_ps<kAligned>(right + i, _mm_mul_ps(_mm_shuffle_ps(kLo, kHi, _MM_SHUFFLE(3, 1, 3, 1)), kScale));
+        }
+        deinterleave_stereo_scalar(in + 2 * i, left + i, right + i, frame_count - i);
+    }
+
+    template <bool kAligned>
+    void interleave_stereo_sse2(const float* left, const float* right, int16_t* out, int32_t frame_count)
+    {
+        int32_t i = 0;
+        for (; i + 4 <= frame_count; i += 4)
+        {
+            const auto kLeft = load_ps<kAligned>(left + i);
+            const auto kRight = load_ps<kAligned>(right + i);
+            const auto kLo = to_int32_sse2(_mm_unpacklo_ps(kLeft, kRight));
+            const auto kHi = to_int32_sse2(_mm_unpackhi_ps(kLeft, kRight));
+            store_si<kAligned>(out + 2 * i, _mm_packs_epi32(kLo, kHi));
+        }
+        interleave_stereo_scalar(left + i, right + i, out + 2 * i, frame_count - i);
+    }
+
+    template <bool kAligned>
+    void downmix_stereo_sse2(const int16_t* in, float* out, int32_t frame_count)
+    {
+        const auto kOnes = _mm_set1_epi16(1);
+        const auto kScale = _mm_set1_ps(kToFloat * 0.5f);
+        int32_t i = 0;
+        for (; i + 4 <= frame_count; i += 4)
+        {
+            const auto kSums = _mm_madd_epi16(load_si<kAligned>(in + 2 * i), kOnes);
+            store_ps<kAligned>(out + i, _mm_mul_ps(_mm_cvtepi32_ps(kSums), kScale));
+        }
+        downmix_stereo_scalar(in + 2 * i, out + i, frame_count - i);
+    }
+
+    template <bool kAligned>
+    bool is_silent_sse2(const int16_t* samples, int32_t count)
+    {
+        const auto kZero = _mm_setzero_si128();
+        int32_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            auto acc = _mm_or_si128(load_si<kAligned>(samples + i), load_si<kAligned>(samples + i + 8));
+            acc = _mm_or_si128(acc, _mm_or_si128(load_si<kAligned>(samples + i + 16), load_si<kAligned>(samples + i + 24)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, kZero)) != 0xFFFF)
+                return false;
+        }
+        return is_silent_scalar(samples + i, count - i);
+    }
+
+    // the previous sample of every lane comes from shifting in the last lane of the previous vector
+    template <bool kAligned>
+    void measure_sse2(const int16_t* samples, int32_t count, DspKernels::Levels& result)
+    {
+        if (count <= 0)
+            return;
+
+        const auto kZero = _mm_setzero_si128();
+        const auto kOnes = _mm_set1_epi16(1);
+        auto last = _mm_set1_epi16(samples[0]);
+        auto peak = kZero;
+        auto crossings = kZero;
+        auto energy = _mm_setzero_ps();
+        auto diff_energy = _mm_setzero_ps();
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kIn = load_si<kAligned>(samples + i);
+            const auto kPrev = _mm_or_si128(_mm_slli_si128(kIn, 2), _mm_srli_si128(last, 14));
+            const auto kMag = _mm_max_epi16(kIn, _mm_subs_epi16(kZero, kIn));   // |x|, -32768 saturates
+            auto diff = _mm_subs_epi16(kIn, kPrev);
+            diff = _mm_max_epi16(diff, _mm_subs_epi16(kZero, diff));
+            peak = _mm_max_epi16(peak, kMag);
+            energy = _mm_add_ps(energy, _mm_cvtepi32_ps(_mm_madd_epi16(kMag, kMag)));
+            diff_energy = _mm_add_ps(diff_energy, _mm_cvtepi32_ps(_mm_madd_epi16(diff, diff)));
+            crossings = _mm_add_epi16(crossings, _mm_srli_epi16(_mm_xor_si128(kIn, kPrev), 15));
+            last = kIn;
+        }
+        peak = _mm_max_epi16(peak, _mm_shuffle_epi32(peak, _MM_SHUFFLE(1, 0, 3, 2)));
+        peak = _mm_max_epi16(peak, _mm_shuffle_epi32(peak, _MM_SHUFFLE(2, 3, 0, 1)));
+        peak = _mm_max_epi16(peak, _mm_shufflelo_epi16(peak, _MM_SHUFFLE(2, 3, 0, 1)));
+        crossings = _mm_madd_epi16(crossings, kOnes);
+        crossings = _mm_add_epi32(crossings, _mm_shuffle_epi32(crossings, _MM_SHUFFLE(1, 0, 3, 2)));
+        crossings = _mm_add_epi32(crossings, _mm_shuffle_epi32(crossings, _MM_SHUFFLE(2, 3, 0, 1)));
+        energy = _mm_add_ps(energy, _mm_movehl_ps(energy, energy));
+        energy = _mm_add_ss(energy, _mm_shuffle_ps(energy, energy, _MM_SHUFFLE(1, 1, 1, 1)));
+        diff_energy = _mm_add_ps(diff_energy, _mm_movehl_ps(diff_energy, diff_energy));
+        diff_energy = _mm_add_ss(diff_energy, _mm_shuffle_ps(diff_energy, diff_energy, _MM_SHUFFLE(1, 1, 1, 1)));
+
+        result.peak = static_cast<int16_t>(_mm_cvtsi128_si32(peak));
+        result.zero_crossings = _mm_cvtsi128_si32(crossings);
+        result.energy = _mm_cvtss_f32(energy);
+        result.diff_energy = _mm_cvtss_f32(diff_energy);
+        accumulate_levels(samples, i, count, result);
+        normalize_levels(result);
+    }
+
+    template <bool kAligned>
+    void apply_gain_q15_sse2(int16_t* samples, int32_t count, int32_t gain_q15)
+    {
+        const auto kInt = gain_q15 >> 15;
+        const auto kFrac = _mm_set1_epi16(static_cast<int16_t>(gain_q15 & 0x7FFF));
+#if !defined(__SSSE3__)
+        const auto kRound = _mm_set1_epi32(1 << 14);
+#endif
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kIn = load_si<kAligned>(samples + i);
+#if defined(__SSSE3__)
+            auto acc = _mm_mulhrs_epi16(kIn, kFrac);
+#else
+            const auto kLo = _mm_mullo_epi16(kIn, kFrac);
+            const auto kHi = _mm_mulhi_epi16(kIn, kFrac);
+            const auto kP0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(kLo, kHi), kRound), 15);
+            const auto kP1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(kLo, kHi), kRound), 15);
+            auto acc = _mm_packs_epi32(kP0, kP1);
+#endif
+            for (int32_t k = 0; k < kInt; ++k)
+                acc = _mm_adds_epi16(acc, kIn);
+
+            store_si<kAligned>(samples + i, acc);
+        }
+        apply_gain_q15_scalar(samples + i, count - i, gain_q15);
+    }
+
+    template <bool kAligned>
+    void and_int16_sse2(int16_t* samples, const int16_t* mask, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            store_si<kAligned>(samples + i, _mm_and_si128(load_si<kAligned>(samples + i), load_si<kAligned>(mask + i)));
+
+        and_int16_scalar(samples + i, mask + i, count - i);
+    }
+
+    // the source lane of every frame is duplicated, then the lanes take the left / right gain alternately
+    template <bool kAligned>
+    void apply_gain_pan_stereo_q15_sse2(int16_t* samples, int32_t frame_count, int32_t source, int32_t gain_left_q15, int32_t gain_right_q15)
+    {
+        const auto kIntLeft = gain_left_q15 >> 15;
+        const auto kIntRight = gain_right_q15 >> 15;
+        const auto kIntMax = (kIntLeft > kIntRight) ? kIntLeft : kIntRight;
+        const auto kFrac = _mm_set_epi16(
+            static_cast<int16_t>(gain_right_q15 & 0x7FFF), static_cast<int16_t>(gain_left_q15 & 0x7FFF),
+            static_cast<int16_t>(gain_right_q15 & 0x7FFF), static_cast<int16_t>(gain_left_q15 & 0x7FFF),
+            static_cast<int16_t>(gain_right_q15 & 0x7FFF), static_cast<int16_t>(gain_left_q15 & 0x7FFF),
+            static_cast<int16_t>(gain_right_q15 & 0x7FFF), static_cast<int16_t>(gain_left_q15 & 0x7FFF));
+        __m128i int_masks[3];   // lanes with an integer part above k
+        for (int32_t k = 0; k < 3; ++k)
+        {
+            const int16_t kLeft = (kIntLeft > k) ? -1 : 0;
+            const int16_t kRight = (kIntRight > k) ? -1 : 0;
+            int_masks[k] = _mm_set_epi16(kRight, kLeft, kRight, kLeft, kRight, kLeft, kRight, kLeft);
+        }
+#if !defined(__SSSE3__)
+        const auto kRound = _mm_set1_epi32(1 << 14);
+#endif
+        int32_t i = 0;
+        for (; i + 4 <= frame_count; i += 4)
+        {
+            auto in = load_si<kAligned>(samples + 2 * i);
+            if (source == 0)
+                in = _mm_shufflehi_epi16(_mm_shufflelo_epi16(in, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+            else
+                in = _mm_shufflehi_epi16(_mm_shufflelo_epi16(in, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+#if defined(__SSSE3__)
+            auto acc = _mm_mulhrs_epi16(in, kFrac);
+#else
+            const auto kLo = _mm_mullo_epi16(in, kFrac);
+            const auto kHi = _mm_mulhi_epi16(in, kFrac);
+            const auto kP0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(kLo, kHi), kRound), 15);
+            const auto kP1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(kLo, kHi), kRound), 15);
+            auto acc = _mm_packs_epi32(kP0, kP1);
+#endif
+            for (int32_t k = 0; k < kIntMax; ++k)
+                acc = _mm_adds_epi16(acc, _mm_and_si128(in, int_masks[k]));
+
+            store_si<kAligned>(samples + 2 * i, acc);
+        }
+        apply_gain_pan_stereo_q15_scalar(samples + 2 * i, frame_count - i, source, gain_left_q15, gain_right_q15);
+    }
+
+    template <bool kAligned>
+    void scale_sse2(float* samples, int32_t count, float gain)
+    {
+        const auto kGain = _mm_set1_ps(gain);
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            store_ps<kAligned>(samples + i, _mm_mul_ps(load_ps<kAligned>(samples + i), kGain));
+
+        scale_scalar(samples + i, count - i, gain);
+    }
+
+    template <bool kAligned>
+    void multiply_sse2(float* samples, const float* gains, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            store_ps<kAligned>(samples + i, _mm_mul_ps(load_ps<kAligned>(samples + i), load_ps<kAligned>(gains + i)));
+
+        multiply_scalar(samples + i, gains + i, count - i);
+    }
+
+    template <bool kAligned>
+    void add_sse2(const float* in, float* acc, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            store_ps<kAligned>(acc + i, _mm_add_ps(load_ps<kAligned>(acc + i), load_ps<kAligned>(in + i)));
+
+        add_scalar(in + i, acc + i, count - i);
+    }
+
+    template <bool kAligned>
+    void soft_clip_sse2(float* samples, int32_t count, float drive)
+    {
+        const auto kDrive = _mm_set1_ps(drive);
+        const auto kMin = _mm_set1_ps(-1.0f);
+        const auto kMax = _mm_set1_ps(1.0f);
+        const auto kHalf = _mm_set1_ps(0.5f);
+        const auto kOneHalf = _mm_set1_ps(1.5f);
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto kVal = _mm_min_ps(_mm_max_ps(_mm_mul_ps(load_ps<kAligned>(samples + i), kDrive), kMin), kMax);
+            store_ps<kAligned>(samples + i, _mm_mul_ps(kVal, _mm_sub_ps(kOneHalf, _mm_mul_ps(_mm_mul_ps(kHalf, kVal), kVal))));
+        }
+        soft_clip_scalar_block(samples + i, count - i, drive);
+    }
+
+    template <bool kAligned>
+    void quantize_sse2(float* samples, int32_t count, float levels)
+    {
+        const auto kLevels = _mm_set1_ps(levels);
+        const auto kInv = _mm_set1_ps(1.0f / levels);
+        const auto kMin = _mm_set1_ps(-1.0f);
+        const auto kMax = _mm_set1_ps(1.0f);
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto kVal = _mm_min_ps(_mm_max_ps(load_ps<kAligned>(samples + i), kMin), kMax);
+            store_ps<kAligned>(samples + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(kVal, kLevels))), kInv));
+        }
+        quantize_scalar_block(samples + i, count - i, levels);
+    }
+
+    // lanes 0..3 in one register, 4..7 in the other, eight samples per step
+    template <bool kAligned>
+    void add_noise_sse2(float* samples, int32_t count, float amplitude, DspKernels::DitherState& state)
+    {
+        auto state_a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state.lanes));
+        auto state_b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state.lanes + 4));
+        const auto kUnit = _mm_set1_ps(kToUnitSigned);
+        const auto kAmplitude = _mm_set1_ps(amplitude);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            state_a = _mm_xor_si128(state_a, _mm_slli_epi32(state_a, 13));
+            state_a = _mm_xor_si128(state_a, _mm_srli_epi32(state_a, 17));
+            state_a = _mm_xor_si128(state_a, _mm_slli_epi32(state_a, 5));
+            state_b = _mm_xor_si128(state_b, _mm_slli_epi32(state_b, 13));
+            state_b = _mm_xor_si128(state_b, _mm_srli_epi32(state_b, 17));
+            state_b = _mm_xor_si128(state_b, _mm_slli_epi32(state_b, 5));
+            const auto kNoiseA = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(state_a), kUnit), kAmplitude);
+            const auto kNoiseB = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(state_b), kUnit), kAmplitude);
+            store_ps<kAligned>(samples + i, _mm_add_ps(load_ps<kAligned>(samples + i), kNoiseA));
+            store_ps<kAligned>(samples + i + 4, _mm_add_ps(load_ps<kAligned>(samples + i + 4), kNoiseB));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state.lanes), state_a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state.lanes + 4), state_b);
+        add_noise_scalar(samples, i, count, amplitude, state);
+    }
+
+    // (ar, ai) * (br, bi): a * (br, br) + (-ai, ar) * (bi, bi)
+    template <bool kAligned>
+    void complex_multiply_add_sse2(const float* a, const float* b, float* acc, int32_t count)
+    {
+        const auto kSign = _mm_castsi128_ps(_mm_set_epi32(0, static_cast<int32_t>(0x80000000u), 0, static_cast<int32_t>(0x80000000u)));
+        int32_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const auto kA = load_ps<kAligned>(a + 2 * i);
+            const auto kB = load_ps<kAligned>(b + 2 * i);
+            const auto kBRe = _mm_shuffle_ps(kB, kB, _MM_SHUFFLE(2, 2, 0, 0));
+            const auto kBIm = _mm_shuffle_ps(kB, kB, _MM_SHUFFLE(3, 3, 1, 1));
+            const auto kASwap = _mm_xor_ps(_mm_shuffle_ps(kA, kA, _MM_SHUFFLE(2, 3, 0, 1)), kSign);
+            const auto kProduct = _mm_add_ps(_mm_mul_ps(kA, kBRe), _mm_mul_ps(kASwap, kBIm));
+            store_ps<kAligned>(acc + 2 * i, _mm_add_ps(load_ps<kAligned>(acc + 2 * i), kProduct));
+        }
+        complex_multiply_add_scalar(a + 2 * i, b + 2 * i, acc + 2 * i, count - i);
+    }
+
+    inline __m128 fast_log2_sse2(__m128 val)
+    {
+        val = _mm_max_ps(val, _mm_set1_ps(kMinMagnitude));
+        const auto kBits = _mm_castps_si128(val);
+        const auto kExponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(kBits, 23), _mm_set1_epi32(127)));
+        const auto kMantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(kBits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+        auto poly = _mm_add_ps(_mm_set1_ps(kLog2C2), _mm_mul_ps(kMantissa, _mm_set1_ps(kLog2C3)));
+        poly = _mm_add_ps(_mm_set1_ps(kLog2C1), _mm_mul_ps(kMantissa, poly));
+        poly = _mm_add_ps(_mm_set1_ps(kLog2C0), _mm_mul_ps(kMantissa, poly));
+        return _mm_add_ps(kExponent, _mm_mul_ps(_mm_sub_ps(kMantissa, _mm_set1_ps(1.0f)), poly));
+    }
+
+    template <bool kAligned>
+    void compressor_curve_sse2(const float* magnitudes, float* reduction, int32_t count, const DspKernels::CompressorCurve& curve)
+    {
+        const auto kHalfKnee = knee_half(curve);
+        const auto kInvTwiceKnee = 1.0f / (4.0f * kHalfKnee);
+        const auto kThreshold = _mm_set1_ps(curve.threshold);
+        const auto kHalf = _mm_set1_ps(kHalfKnee);
+        const auto kKnee = _mm_set1_ps(2.0f * kHalfKnee);
+        const auto kInv = _mm_set1_ps(kInvTwiceKnee);
+        const auto kSlope = _mm_set1_ps(curve.slope);
+        const auto kZero = _mm_setzero_ps();
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto kOver = _mm_sub_ps(fast_log2_sse2(load_ps<kAligned>(magnitudes + i)), kThreshold);
+            const auto kInKnee = _mm_min_ps(_mm_max_ps(_mm_add_ps(kOver, kHalf), kZero), kKnee);
+            const auto kAbove = _mm_max_ps(_mm_sub_ps(kOver, kHalf), kZero);
+            const auto kResult = _mm_mul_ps(kSlope, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(kInKnee, kInKnee), kInv), kAbove));
+            store_ps<kAligned>(reduction + i, kResult);
+        }
+        for (; i < count; ++i)
+            reduction[i] = curve_scalar(fast_log2_scalar(magnitudes[i]), curve, kHalfKnee, kInvTwiceKnee);
+    }
+
+    template <bool kAligned>
+    void fast_exp2_sse2(const float* in, float* out, int32_t count)
+    {
+        const auto kMin = _mm_set1_ps(-126.0f);
+        const auto kMax = _mm_set1_ps(126.0f);
+        const auto kOne = _mm_set1_ps(1.0f);
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto kVal = _mm_min_ps(_mm_max_ps(load_ps<kAligned>(in + i), kMin), kMax);
+            auto whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(kVal));
+            whole = _mm_sub_ps(whole, _mm_and_ps(_mm_cmpgt_ps(whole, kVal), kOne));
+            const auto kFraction = _mm_sub_ps(kVal, whole);
+            const auto kScale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(whole), _mm_set1_epi32(127)), 23));
+            auto poly = _mm_add_ps(_mm_set1_ps(kExp2C2), _mm_mul_ps(kFraction, _mm_set1_ps(kExp2C3)));
+            poly = _mm_add_ps(_mm_set1_ps(kExp2C1), _mm_mul_ps(kFraction, poly));
+            poly = _mm_add_ps(kOne, _mm_mul_ps(kFraction, poly));
+            store_ps<kAligned>(out + i, _mm_mul_ps(kScale, poly));
+        }
+        for (; i < count; ++i)
+            out[i] = fast_exp2_scalar(in[i]);
+    }
+
+    // Two halves of four lanes; the recursion runs along the frames, the vector across the talkers
+    template <bool kAligned>
+    void biquad_lanes_sse2(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections)
+    {
+        const auto kLanes = DspKernels::kBiquadLanes;
+        for (int32_t s = 0; s < sections; ++s)
+        {
+            for (int32_t half = 0; half < kLanes; half += 4)
+            {
+                const auto kC = coefficients + s * 5 * kLanes + half;
+                auto z = state + s * 2 * kLanes + half;
+                const auto kB0 = load_ps<kAligned>(kC);
+                const auto kB1 = load_ps<kAligned>(kC + kLanes);
+                const auto kB2 = load_ps<kAligned>(kC + 2 * kLanes);
+                const auto kA1 = load_ps<kAligned>(kC + 3 * kLanes);
+                const auto kA2 = load_ps<kAligned>(kC + 4 * kLanes);
+                auto z1 = load_ps<kAligned>(z);
+                auto z2 = load_ps<kAligned>(z + kLanes);
+                for (int32_t i = 0; i < frame_count; ++i)
+                {
+                    const auto kX = load_ps<kAligned>(data + i * kLanes + half);
+                    const auto kY = _mm_add_ps(_mm_mul_ps(kB0, kX), z1);
+                    z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(kB1, kX), _mm_mul_ps(kA1, kY)), z2);
+                    z2 = _mm_sub_ps(_mm_mul_ps(kB2, kX), _mm_mul_ps(kA2, kY));
+                    store_ps<kAligned>(data + i * kLanes + half, kY);
+                }
+                store_ps<kAligned>(z, z1);
+                store_ps<kAligned>(z + kLanes, z2);
+            }
+        }
+        flush_biquad_state(state, sections);
+    }
+
+    // Pick the aligned flavour when every buffer is 16 byte aligned
+
+    void int16_to_float_sse2_any(const int16_t* in, float* out, int32_t count)
+    {
+        if (is_aligned(in, 16) && is_aligned(out, 16))
+            int16_to_float_sse2<true>(in, out, count);
+        else
+            int16_to_float_sse2<false>(in, out, count);
+    }
+
+    void float_to_int16_sse2_any(const float* in, int16_t* out, int32_t count)
+    {
+        if (is_aligned(in, 16) && is_aligned(out, 16))
+            float_to_int16_sse2<true>(in, out, count);
+        else
+            float_to_int16_sse2<false>(in, out, count);
+    }
+
+    void float_to_int16_dither_sse2_any(const float* in, int16_t* out, int32_t count, DspKernels::DitherState& dither)
+    {
+        if (is_aligned(in, 16) && is_aligned(out, 16))
+            float_to_int16_dither_sse2<true>(in, out, count, dither);
+        else
+            float_to_int16_dither_sse2<false>(in, out, count, dither);
+    }
+
+    void deinterleave_stereo_sse2_any(const int16_t* in, float* left, float* right, int32_t frame_count)
+    {
+        if (is_aligned(in, 16) && is_aligned(left, 16) && is_aligned(right, 16))
+            deinterleave_stereo_sse2<true>(in, left, right, frame_count);
+        else
+            deinterleave_stereo_sse2<false>(in, left, right, frame_count);
+    }
+
+    void interleave_stereo_sse2_any(const float* left, const float* right, int16_t* out, int32_t frame_count)
+    {
+        if (is_aligned(out, 16) && is_aligned(left, 16) && is_aligned(right, 16))
+            interleave_stereo_sse2<true>(left, right, out, frame_count);
+        else
+            interleave_stereo_sse2<false>(left, right, out, frame_count);
+    }
+
+    void downmix_stereo_sse2_any(const int16_t* in, float* out, int32_t frame_count)
+    {
+        if (is_aligned(in, 16) && is_aligned(out, 16))
+            downmix_stereo_sse2<true>(in, out, frame_count);
+        else
+            downmix_stereo_sse2<false>(in, out, frame_count);
+    }
+
+    bool is_silent_sse2_any(const int16_t* samples, int32_t count)
+    {
+        return is_aligned(samples, 16) ? is_silent_sse2<true>(samples, count) : is_silent_sse2<false>(samples, count);
+    }
+
+    void measure_sse2_any(const int16_t* samples, int32_t count, DspKernels::Levels& result)
+    {
+        if (is_aligned(samples, 16))
+            measure_sse2<true>(samples, count, result);
+        else
+            measure_sse2<false>(samples, count, result);
+    }
+
+    void apply_gain_q15_sse2_any(int16_t* samples, int32_t count, int32_t gain_q15)
+    {
+        if (is_aligned(samples, 16))
+            apply_gain_q15_sse2<true>(samples, count, gain_q15);
+        else
+            apply_gain_q15_sse2<false>(samples, count, gain_q15);
+    }
+
+    void and_int16_sse2_any(int16_t* samples, const int16_t* mask, int32_t count)
+    {
+        if (is_aligned(samples, 16) && is_aligned(mask, 16))
+            and_int16_sse2<true>(samples, mask, count);
+        else
+            and_int16_sse2<false>(samples, mask, count);
+    }
+
+    void apply_gain_pan_stereo_q15_sse2_any(int16_t* samples, int32_t frame_count, int32_t source, int32_t gain_left_q15, int32_t gain_right_q15)
+    {
+        if (is_aligned(samples, 16))
+            apply_gain_pan_stereo_q15_sse2<true>(samples, frame_count, source, gain_left_q15, gain_right_q15);
+        else
+            apply_gain_pan_stereo_q15_sse2<false>(samples, frame_count, source, gain_left_q15, gain_right_q15);
+    }
+
+    void scale_sse2_any(float* samples, int32_t count, float gain)
+    {
+        if (is_aligned(samples, 16))
+            scale_sse2<true>(samples, count, gain);
+        else
+            scale_sse2<false>(samples, count, gain);
+    }
+
+    void multiply_sse2_any(float* samples, const float* gains, int32_t count)
+    {
+        if (is_aligned(samples, 16) && is_aligned(gains, 16))
+            multiply_sse2<true>(samples, gains, count);
+        else
+            multiply_sse2<false>(samples, gains, count);
+    }
+
+    void add_sse2_any(const float* in, float* acc, int32_t count)
+    {
+        if (is_aligned(in, 16) && is_aligned(acc, 16))
+            add_sse2<true>(in, acc, count);
+        else
+            add_sse2<false>(in, acc, count);
+    }
+
+    void soft_clip_sse2_any(float* samples, int32_t count, float drive)
+    {
+        if (is_aligned(samples, 16))
+            soft_clip_sse2<true>(samples, count, drive);
+        else
+            soft_clip_sse2<false>(samples, count, drive);
+    }
+
+    void quantize_sse2_any(float* samples, int32_t count, float levels)
+    {
+        if (is_aligned(samples, 16))
+            quantize_sse2<true>(samples, count, levels);
+        else
+            quantize_sse2<false>(samples, count, levels);
+    }
+
+    void add_noise_sse2_any(float* samples, int32_t count, float amplitude, DspKernels::DitherState& state)
+    {
+        if (is_aligned(samples, 16))
+            add_noise_sse2<true>(samples, count, amplitude, state);
+        else
+            add_noise_sse2<false>(samples, count, amplitude, state);
+    }
+
+    void complex_multiply_add_sse2_any(const float* a, const float* b, float* acc, int32_t count)
+    {
+        if (is_aligned(a, 16) && is_aligned(b, 16) && is_aligned(acc, 16))
+            complex_multiply_add_sse2<true>(a, b, acc, count);
+        else
+            complex_multiply_add_sse2<false>(a, b, acc, count);
+    }
+
+    void compressor_curve_sse2_any(const float* magnitudes, float* reduction, int32_t count, const DspKernels::CompressorCurve& curve)
+    {
+        if (is_aligned(magnitudes, 16) && is_aligned(reduction, 16))
+            compressor_curve_sse2<true>(magnitudes, reduction, count, curve);
+        else
+            compressor_curve_sse2<false>(magnitudes, reduction, count, curve);
+    }
+
+    void fast_exp2_sse2_any(const float* in, float* out, int32_t count)
+    {
+        if (is_aligned(in, 16) && is_aligned(out, 16))
+            fast_exp2_sse2<true>(in, out, count);
+        else
+            fast_exp2_sse2<false>(in, out, count);
+    }
+
+    void biquad_lanes_sse2_any(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections)
+    {
+        if (is_aligned(coefficients, 16) && is_aligned(state, 16) && is_aligned(data, 16))
+            biquad_lanes_sse2<true>(coefficients, state, data, frame_count, sections);
+        else
+            biquad_lanes_sse2<false>(coefficients, state, data, frame_count, sections);
+    }
+#endif
+
+    bool cpu_has_avx2()
+    {
+#if defined(DSP_KERNELS_X86)
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool kOsXSave = (info[2] & (1 << 27)) != 0;
+        const bool kAvx = (info[2] & (1 << 28)) != 0;
+        if (!kOsXSave || !kAvx || ((_xgetbv(0) & 6) != 6))
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+#else
+        return false;
+#endif
+    }
+
+    struct Tables
+    {
+        Tables()
+        {
+            auto& scalar = table[static_cast<int>(DspKernels::Isa::SCALAR)];
+            scalar.int16_to_float = int16_to_float_scalar;
+            scalar.float_to_int16 = float_to_int16_scalar;
+            scalar.float_to_int16_dither = float_to_int16_dither_scalar;
+            scalar.deinterleave_stereo = deinterleave_stereo_scalar;
+            scalar.interleave_stereo = interleave_stereo_scalar;
+            scalar.downmix_stereo = downmix_stereo_scalar;
+            scalar.is_silent = is_silent_scalar;
+            scalar.measure = measure_scalar;
+            scalar.apply_gain_q15 = apply_gain_q15_scalar;
+            scalar.and_int16 = and_int16_scalar;
+            scalar.apply_gain_pan_stereo_q15 = apply_gain_pan_stereo_q15_scalar;
+            scalar.scale = scale_scalar;
+            scalar.multiply = multiply_scalar;
+            scalar.add = add_scalar;
+            scalar.soft_clip = soft_clip_scalar_block;
+            scalar.quantize = quantize_scalar_block;
+            scalar.add_noise = add_noise_scalar_block;
+            scalar.complex_multiply_add = complex_multiply_add_scalar;
+            scalar.compressor_curve = compressor_curve_scalar;
+            scalar.fast_exp2 = fast_exp2_scalar_block;
+            scalar.biquad_lanes = biquad_lanes_scalar;
+            best = DspKernels::Isa::SCALAR;
+
+            auto& sse2 = table[static_cast<int>(DspKernels::Isa::SSE2)];
+            sse2 = scalar;
+#if defined(DSP_KERNELS_SSE2)
+            sse2.int16_to_float = int16_to_float_sse2_any;
+            sse2.float_to_int16 = float_to_int16_sse2_any;
+            sse2.float_to_int16_dither = float_to_int16_dither_sse2_any;
+            sse2.deinterleave_stereo = deinterleave_stereo_sse2_any;
+            sse2.interleave_stereo = interleave_stereo_sse2_any;
+            sse2.downmix_stereo = downmix_stereo_sse2_any;
+            sse2.is_silent = is_silent_sse2_any;
+            sse2.measure = measure_sse2_any;
+            sse2.apply_gain_q15 = apply_gain_q15_sse2_any;
+            sse2.and_int16 = and_int16_sse2_any;
+            sse2.apply_gain_pan_stereo_q15 = apply_gain_pan_stereo_q15_sse2_any;
+            sse2.scale = scale_sse2_any;
+            sse2.multiply = multiply_sse2_any;
+            sse2.add = add_sse2_any;
+            sse2.soft_clip = soft_clip_sse2_any;
+            sse2.quantize = quantize_sse2_any;
+            sse2.add_noise = add_noise_sse2_any;
+            sse2.complex_multiply_add = complex_multiply_add_sse2_any;
+            sse2.compressor_curve = compressor_curve_sse2_any;
+            sse2.fast_exp2 = fast_exp2_sse2_any;
+            sse2.biquad_lanes = biquad_lanes_sse2_any;
+            best = DspKernels::Isa::SSE2;
+#endif
+
+            auto& avx2 = table[static_cast<int>(DspKernels::Isa::AVX2)];
+            avx2 = sse2;
+#if defined(DSP_KERNELS_X86)
+            if (cpu_has_avx2() && fill_avx2(avx2))
+                best = DspKernels::Isa::AVX2;
+#endif
+        }
+
+        Table table[3];
+        DspKernels::Isa best;
+    };
+
+    const Tables& tables()
+    {
+        static const Tables kTables;
+        return kTables;
+    }
+
+    std::atomic<int> s_isa{-1};     // -1: best available
+
+    inline const Table& active()
+    {
+        const auto& kTables = tables();
+        const auto kIsa = s_isa.load(std::memory_order_relaxed);
+        return kTables.table[(kIsa < 0) ? static_cast<int>(kTables.best) : kIsa];
+    }
+
+    inline uint32_t valid_mask(int32_t channels, uint32_t channel_mask)
+    {
+        return (channels >= 32) ? channel_mask : (channel_mask & ((1u << channels) - 1));
+    }
+}
+
+namespace DspKernels
+{
+    Isa get_isa()
+    {
+        const auto kIsa = s_isa.load(std::memory_order_relaxed);
+        return (kIsa < 0) ? get_best_isa() : static_cast<Isa>(kIsa);
+    }
+
+    Isa get_best_isa()
+    {
+        return tables().best;
+    }
+
+    void set_isa(Isa isa)
+    {
+        if (isa > get_best_isa())
+            isa = get_best_isa();
+
+        s_isa.store(static_cast<int>(isa), std::memory_order_relaxed);
+    }
+
+    DitherState::DitherState(uint32_t seed)
+    {
+        for (auto& lane : lanes)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            lane = seed ? seed : 1u;
+        }
+    }
+
+    void int16_to_float(const int16_t* in, float* out, int32_t count)
+    {
+        active().int16_to_float(in, out, count);
+    }
+
+    void float_to_int16(const float* in, int16_t* out, int32_t count)
+    {
+        active().float_to_int16(in, out, count);
+    }
+
+    void float_to_int16(const float* in, int16_t* out, int32_t count, DitherState& dither)
+    {
+        active().float_to_int16_dither(in, out, count, dither);
+    }
+
+    void deinterleave(const int16_t* in, float* const* planes, int32_t frame_count, int32_t channels)
+    {
+        if (channels == 1)
+            active().int16_to_float(in, planes[0], frame_count);
+        else if (channels == 2)
+            active().deinterleave_stereo(in, planes[0], planes[1], frame_count);
+        else
+            gather(in, planes, frame_count, channels, ~0u);
+    }
+
+    void interleave(const float* const* planes, int16_t* out, int32_t frame_count, int32_t channels)
+    {
+        if (channels == 1)
+            active().float_to_int16(planes[0], out, frame_count);
+        else if (channels == 2)
+            active().interleave_stereo(planes[0], planes[1], out, frame_count);
+        else
+            scatter(planes, out, frame_count, channels, ~0u);
+    }
+
+    //! Deinterleave the channels set in channel_mask into consecutive planes
+    /*!
+     * \return number of planes written
+     */
+    int32_t gather(const int16_t* in, float* const* planes, int32_t frame_count, int32_t channels, uint32_t channel_mask)
+    {
+        channel_mask = valid_mask(channels, channel_mask);
+        if ((channels == 2) && (channel_mask == 3))
+        {
+            active().deinterleave_stereo(in, planes[0], planes[1], frame_count);
+            return 2;
+        }
+
+        int32_t plane = 0;
+        for (int32_t c = 0; c < channels && c < 32; ++c)
+        {
+            if (!(channel_mask & (1u << c)))
+                continue;
+
+            auto out = planes[plane++];
+            for (int32_t i = 0; i < frame_count; ++i)
+                out[i] = in[i * channels + c] * kToFloat;
+        }
+        return plane;
+    }
+
+    //! Interleave consecutive planes into the channels set in channel_mask; other channels are left untouched
+    /*!
+     * \return number of planes read
+     */
+    int32_t scatter(const float* const* planes, int16_t* out, int32_t frame_count, int32_t channels, uint32_t channel_mask)
+    {
+        channel_mask = valid_mask(channels, channel_mask);
+        if ((channels == 2) && (channel_mask == 3))
+        {
+            active().interleave_stereo(planes[0], planes[1], out, frame_count);
+            return 2;
+        }
+
+        int32_t plane = 0;
+        for (int32_t c = 0; c < channels && c < 32; ++c)
+        {
+            if (!(channel_mask & (1u << c)))
+                continue;
+
+            auto in = planes[plane++];
+            for (int32_t i = 0; i < frame_count; ++i)
+                out[i * channels + c] = to_int16(in[i]);
+        }
+        return plane;
+    }
+
+    void downmix(const int16_t* in, float* out, int32_t frame_count, int32_t channels)
+    {
+        if (channels == 1)
+            active().int16_to_float(in, out, frame_count);
+        else if (channels == 2)
+            active().downmix_stereo(in, out, frame_count);
+        else
+        {
+            const auto kScale = kToFloat / channels;
+            for (int32_t i = 0; i < frame_count; ++i)
+            {
+                int32_t sum = 0;
+                for (int32_t c = 0; c < channels; ++c)
+                    sum += in[i * channels + c];
+
+                out[i] = sum * kScale;
+            }
+        }
+    }
+
+    bool is_silent(const int16_t* samples, int32_t count)
+    {
+        return active().is_silent(samples, count);
+    }
+
+    Levels measure(const int16_t* samples, int32_t count)
+    {
+        Levels result;
+        active().measure(samples, count, result);
+        return result;
+    }
+
+    void apply_gain_q15(int16_t* samples, int32_t count, int32_t gain_q15)
+    {
+        active().apply_gain_q15(samples, count, gain_q15);
+    }
+
+    //! Zero the channels set in channel_mask, e.g. the ones a stage moved into the stereo pair
+    void clear_channels(int16_t* samples, int32_t frame_count, int32_t channels, uint32_t channel_mask)
+    {
+        channel_mask = valid_mask(channels, channel_mask);
+        if (!channel_mask || (frame_count <= 0))
+            return;
+
+        if (channel_mask == valid_mask(channels, ~0u))
+        {
+            memset(samples, 0, static_cast<size_t>(frame_count) * channels * sizeof(int16_t));
+            return;
+        }
+
+        // the keep pattern repeats every lcm(channels, 16) samples, whole vectors of any ISA
+        auto period = channels;
+        while (period % 16)
+            period += channels;
+
+        alignas(32) int16_t pattern[32 * 16];
+        for (int32_t i = 0; i < period; ++i)
+            pattern[i] = (channel_mask & (1u << (i % channels))) ? 0 : -1;
+
+        const auto kCount = frame_count * channels;
+        for (int32_t i = 0; i < kCount; i += period)
+            active().and_int16(samples + i, pattern, (kCount - i < period) ? (kCount - i) : period);
+    }
+
+    //! Write the source channel to left and right with their gains, e.g. a mono talker panned in a stereo buffer
+    /*!
+     * \param source channel index of the signal; may be left or right
+     * \param left channel index
+     * \param right channel index
+     */
+    void apply_gain_pan_q15(int16_t* samples, int32_t frame_count, int32_t channels,
+                            int32_t source, int32_t left, int32_t right, int32_t gain_left_q15, int32_t gain_right_q15)
+    {
+        if ((channels == 2) && (left == 0) && (right == 1))
+        {
+            active().apply_gain_pan_stereo_q15(samples, frame_count, source, gain_left_q15, gain_right_q15);
+            return;
+        }
+
+        for (int32_t i = 0; i < frame_count; ++i)
+        {
+            auto frame = samples + i * channels;
+            const int32_t kIn = frame[source];
+            frame[left] = gain_q15_scalar(kIn, gain_left_q15 >> 15, gain_left_q15 & 0x7FFF);
+            frame[right] = gain_q15_scalar(kIn, gain_right_q15 >> 15, gain_right_q15 & 0x7FFF);
+        }
+    }
+
+    void scale(float* samples, int32_t count, float gain)
+    {
+        active().scale(samples, count, gain);
+    }
+
+    void multiply(float* samples, const float* gains, int32_t count)
+    {
+        active().multiply(samples, gains, count);
+    }
+
+    void add(const float* in, float* acc, int32_t count)
+    {
+        active().add(in, acc, count);
+    }
+
+    void soft_clip(float* samples, int32_t count, float drive)
+    {
+        active().soft_clip(samples, count, drive);
+    }
+
+    void quantize(float* samples, int32_t count, float levels)
+    {
+        active().quantize(samples, count, levels);
+    }
+
+    void add_noise(float* samples, int32_t count, float amplitude, DitherState& state)
+    {
+        active().add_noise(samples, count, amplitude, state);
+    }
+
+    void complex_multiply_add(const float* a, const float* b, float* acc, int32_t count)
+    {
+        active().complex_multiply_add(a, b, acc, count);
+    }
+
+    void compressor_curve(const float* magnitudes, float* reduction, int32_t count, const CompressorCurve& curve)
+    {
+        active().compressor_curve(magnitudes, reduction, count, curve);
+    }
+
+    void fast_exp2(const float* in, float* out, int32_t count)
+    {
+        active().fast_exp2(in, out, count);
+    }
+
+    void biquad_lanes(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections)
+    {
+        active().biquad_lanes(coefficients, state, data, frame_count, sections);
+    }
+}
@@ -0,0 +1,692 @@
+// AVX2 kernels; this file is built with AVX2 code generation enabled (see CMakeLists.txt)
+// and only entered after the runtime CPU check in dsp_kernels.cpp.
+
+#include "dsp_kernels_impl.h"
+
+#if defined(DSP_KERNELS_X86)
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+using namespace DspKernels::Impl;
+
+namespace {
+
+    template <bool kAligned> inline __m256i load_si(const void* p)
+    {
+        return kAligned ? _mm256_load_si256(static_cast<const __m256i*>(p)) : _mm256_loadu_si256(static_cast<const __m256i*>(p));
+    }
+
+    template <bool kAligned> inline void store_si(void* p, __m256i val)
+    {
+        if (kAligned)
+            _mm256_store_si256(static_cast<__m256i*>(p), val);
+        else
+            _mm256_storeu_si256(static_cast<__m256i*>(p), val);
+    }
+
+    template <bool kAligned> inline __m128i load_si128(const void* p)
+    {
+        return kAligned ? _mm_load_si128(static_cast<const __m128i*>(p)) : _mm_loadu_si128(static_cast<const __m128i*>(p));
+    }
+
+    template <bool kAligned> inline __m256 load_ps(const float* p)
+    {
+        return kAligned ? _mm256_load_ps(p) : _mm256_loadu_ps(p);
+    }
+
+    template <bool kAligned> inline void store_ps(float* p, __m256 val)
+    {
+        if (kAligned)
+            _mm256_store_ps(p, val);
+        else
+            _mm256_storeu_ps(p, val);
+    }
+
+    inline __m256i to_int32(__m256 val)
+    {
+        val = _mm256_mul_ps(val, _mm256_set1_ps(kToInt16));
+        val = _mm256_min_ps(_mm256_max_ps(val, _mm256_set1_ps(-32768.0f)), _mm256_set1_ps(32767.0f));
+        return _mm256_cvtps_epi32(val);
+    }
+
+    // packs works per 128 bit lane; restore sample order afterwards
+    inline __m256i pack_int16(__m256i lo, __m256i hi)
+    {
+        return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    inline int16_t to_int16(float val)
+    {
+        auto scaled = _mm_set_ss(val * kToInt16);
+        scaled = _mm_min_ss(_mm_max_ss(scaled, _mm_set_ss(-32768.0f)), _mm_set_ss(32767.0f));
+        return static_cast<int16_t>(_mm_cvtss_si32(scaled));
+    }
+
+    inline __m256 xorshift_unit(__m256i& state)
+    {
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+        state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(state), _mm256_set1_ps(1.0f / 4294967296.0f));
+    }
+
+    template <bool kAligned>
+    void int16_to_float(const int16_t* in, float* out, int32_t count)
+    {
+        const auto kScale = _mm256_set1_ps(kToFloat);
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto kIn = load_si<kAligned>(in + i);
+            const auto kLo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(kIn));
+            const auto kHi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(kIn, 1));
+            store_ps<kAligned>(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(kLo), kScale));
+            store_ps<kAligned>(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(kHi), kScale));
+        }
+        for (; i < count; ++i)
+            out[i] = in[i] * kToFloat;
+    }
+
+    template <bool kAligned>
+    void float_to_int16(const float* in, int16_t* out, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16)
+            store_si<kAligned>(out + i, pack_int16(to_int32(load_ps<kAligned>(in + i)), to_int32(load_ps<kAligned>(in + i + 8))));
+
+        for (; i < count; ++i)
+            out[i] = to_int16(in[i]);
+    }
+
+    template <bool kAligned>
+    void float_to_int16_dither(const float* in, int16_t* out, int32_t count, DspKernels::DitherState& dither)
+    {
+        auto state_a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dither.lanes));
+        auto state_b = _mm256_permute4x64_epi64(state_a, _MM_SHUFFLE(1, 0, 3, 2));
+        state_b = _mm256_xor_si256(state_b, _mm256_set1_epi32(0x5bd1e995));
+        const auto kLsb = _mm256_set1_ps(kToFloat);
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto kTpdfLo = _mm256_mul_ps(_mm256_add_ps(xorshift_unit(state_a), xorshift_unit(state_b)), kLsb);
+            const auto kTpdfHi = _mm256_mul_ps(_mm256_add_ps(xorshift_unit(state_a), xorshift_unit(state_b)), kLsb);
+            const auto kLo = to_int32(_mm256_add_ps(load_ps<kAligned>(in + i), kTpdfLo));
+            const auto kHi = to_int32(_mm256_add_ps(load_ps<kAligned>(in + i + 8), kTpdfHi));
+            store_si<kAligned>(out + i, pack_int16(kLo, kHi));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither.lanes), state_a);
+
+        const float kToUnit = 1.0f / 4294967296.0f;
+        for (; i < count; ++i)
+        {
+            const auto kR1 = static_cast<int32_t>(xorshift(dither.lanes[0]));
+            const auto kR2 = static_cast<int32_t>(xorshift(dither.lanes[1]));
+            out[i] = to_int16(in[i] + (kR1 * kToUnit + kR2 * kToUnit) * kToFloat);
+        }
+    }
+
+    template <bool kAligned>
+    void deinterleave_stereo(const int16_t* in, float* left, float* right, int32_t frame_count)
+    {
+        const auto kScale = _mm256_set1_ps(kToFloat);
+        int32_t i = 0;
+        for (; i + 8 <= frame_count; i += 8)
+        {
+            const auto kFrames = _mm256_cvtepi16_epi32(load_si128<kAligned>(in + 2 * i));     // L0 R0 .. L3 R3
+            const auto kFrames2 = _mm256_cvtepi16_epi32(load_si128<kAligned>(in + 2 * i + 8)); // L4 R4 .. L7 R7
+            // sort each register into four left and four right samples, then combine the halves
+            const auto kIdx = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            const auto kA = _mm256_permutevar8x32_epi32(kFrames, kIdx);    // L0..L3 R0..R3
+            const auto kB = _mm256_permutevar8x32_epi32(kFrames2, kIdx);   // L4..L7 R4..R7
+            const auto kLeft = _mm256_permute2x128_si256(kA, kB, 0x20);
+            const auto kRight = _mm256_permute2x128_si256(kA, kB, 0x31);
+            store_ps<kAligned>(left + i, _mm256_mul_ps(_mm256_cvtepi32_ps(kLeft), kScale));
+            store_ps<kAligned>(right + i, _mm256_mul_ps(_mm256_cvtepi32_ps(kRight), kScale));
+        }
+        for (; i < frame_count; ++i)
+        {
+            left[i] = in[2 * i] * kToFloat;
+            right[i] = in[2 * i + 1] * kToFloat;
+        }
+    }
+
+    template <bool kAligned>
+    void interleave_stereo(const float* left, const float* right, int16_t* out, int32_t frame_count)
+    {
+        int32_t i = 0;
+        for (; i + 8 <= frame_count; i += 8)
+        {
+            const auto kLeft = load_ps<kAligned>(left + i);
+            const auto kRight = load_ps<kAligned>(right + i);
+            // unpack works per 128 bit lane: lo = L0 R0 L1 R1 | L4 R4 L5 R5, hi = L2 R2 L3 R3 | L6 R6 L7 R7
+            const auto kLo = to_int32(_mm256_unpacklo_ps(kLeft, kRight));
+            const auto kHi = to_int32(_mm256_unpackhi_ps(kLeft, kRight));
+            // packs per lane yields frames 0 1 2 3 | 4 5 6 7 already in order
+            store_si<kAligned>(out + 2 * i, _mm256_packs_epi32(kLo, kHi));
+        }
+        for (; i < frame_count; ++i)
+        {
+            out[2 * i] = to_int16(left[i]);
+            out[2 * i + 1] = to_int16(right[i]);
+        }
+    }
+
+    template <bool kAligned>
+    void downmix_stereo(const int16_t* in, float* out, int32_t frame_count)
+    {
+        const auto kOnes = _mm256_set1_epi16(1);
+        const auto kScale = _mm256_set1_ps(kToFloat * 0.5f);
+        int32_t i = 0;
+        for (; i + 8 <= frame_count; i += 8)
+        {
+            const auto kSums = _mm256_madd_epi16(load_si<kAligned>(in + 2 * i), kOnes);
+            store_ps<kAligned>(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(kSums), kScale));
+        }
+        for (; i < frame_count; ++i)
+            out[i] = (in[2 * i] + in[2 * i + 1]) * (kToFloat * 0.5f);
+    }
+
+    // the previous sample of every lane comes from shifting in the last lane of the previous vector
+    template <bool kAligned>
+    void measure(const int16_t* samples, int32_t count, DspKernels::Levels& result)
+    {
+        if (count <= 0)
+            return;
+
+        const auto kZero = _mm256_setzero_si256();
+        const auto kOnes = _mm256_set1_epi16(1);
+        auto last = _mm256_set1_epi16(samples[0]);
+        auto peak = kZero;
+        auto crossings = kZero;
+        auto energy = _mm256_setzero_ps();
+        auto diff_energy = _mm256_setzero_ps();
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto kIn = load_si<kAligned>(samples + i);
+            const auto kPrev = _mm256_alignr_epi8(kIn, _mm256_permute2x128_si256(last, kIn, 0x21), 14);
+            const auto kMag = _mm256_max_epi16(kIn, _mm256_subs_epi16(kZero, kIn));   // |x|, -32768 saturates
+            auto diff = _mm256_subs_epi16(kIn, kPrev);
+            diff = _mm256_max_epi16(diff, _mm256_subs_epi16(kZero, diff));
+            peak = _mm256_max_epi16(peak, kMag);
+            energy = _mm256_add_ps(energy, _mm256_cvtepi32_ps(_mm256_madd_epi16(kMag, kMag)));
+            diff_energy = _mm256_add_ps(diff_energy, _mm256_cvtepi32_ps(_mm256_madd_epi16(diff, diff)));
+            crossings = _mm256_add_epi16(crossings, _mm256_srli_epi16(_mm256_xor_si256(kIn, kPrev), 15));
+            last = kIn;
+        }
+        auto peak4 = _mm_max_epi16(_mm256_castsi256_si128(peak), _mm256_extracti128_si256(peak, 1));
+        peak4 = _mm_max_epi16(peak4, _mm_shuffle_epi32(peak4, _MM_SHUFFLE(1, 0, 3, 2)));
+        peak4 = _mm_max_epi16(peak4, _mm_shuffle_epi32(peak4, _MM_SHUFFLE(2, 3, 0, 1)));
+        peak4 = _mm_max_epi16(peak4, _mm_shufflelo_epi16(peak4, _MM_SHUFFLE(2, 3, 0, 1)));
+        crossings = _mm256_madd_epi16(crossings, kOnes);
+        auto crossings4 = _mm_add_epi32(_mm256_castsi256_si128(crossings), _mm256_extracti128_si256(crossings, 1));
+        crossings4 = _mm_add_epi32(crossings4, _mm_shuffle_epi32(crossings4, _MM_SHUFFLE(1, 0, 3, 2)));
+        crossings4 = _mm_add_epi32(crossings4, _mm_shuffle_epi32(crossings4, _MM_SHUFFLE(2, 3, 0, 1)));
+        auto energy4 = _mm_add_ps(_mm256_castps256_ps128(energy), _mm256_extractf128_ps(energy, 1));
+        energy4 = _mm_add_ps(energy4, _mm_movehl_ps(energy4, energy4));
+        energy4 = _mm_add_ss(energy4, _mm_shuffle_ps(energy4, energy4, _MM_SHUFFLE(1, 1, 1, 1)));
+        auto diff4 = _mm_add_ps(_mm256_castps256_ps128(diff_energy), _mm256_extractf128_ps(diff_energy, 1));
+        diff4 = _mm_add_ps(diff4, _mm_movehl_ps(diff4, diff4));
+        diff4 = _mm_add_ss(diff4, _mm_shuffle_ps(diff4, diff4, _MM_SHUFFLE(1, 1, 1, 1)));
+
+        result.peak = static_cast<int16_t>(_mm_cvtsi128_si32(peak4));
+        result.zero_crossings = _mm_cvtsi128_si32(crossings4);
+        result.energy = _mm_cvtss_f32(energy4);
+        result.diff_energy = _mm_cvtss_f32(diff4);
+        accumulate_levels(samples, i, count, result);
+        normalize_levels(result);
+    }
+
+    template <bool kAligned>
+    bool is_silent(const int16_t* samples, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 64 <= count; i += 64)
+        {
+            auto acc = _mm256_or_si256(load_si<kAligned>(samples + i), load_si<kAligned>(samples + i + 16));
+            acc = _mm256_or_si256(acc, _mm256_or_si256(load_si<kAligned>(samples + i + 32), load_si<kAligned>(samples + i + 48)));
+            if (!_mm256_testz_si256(acc, acc))
+                return false;
+        }
+        int32_t acc = 0;
+        for (; i < count; ++i)
+            acc |= samples[i];
+
+        return (acc == 0);
+    }
+
+    template <bool kAligned>
+    void apply_gain_q15(int16_t* samples, int32_t count, int32_t gain_q15)
+    {
+        const auto kInt = gain_q15 >> 15;
+        const auto kFracScalar = gain_q15 & 0x7FFF;
+        const auto kFrac = _mm256_set1_epi16(static_cast<int16_t>(kFracScalar));
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto kIn = load_si<kAligned>(samples + i);
+            auto acc = _mm256_mulhrs_epi16(kIn, kFrac);
+            for (int32_t k = 0; k < kInt; ++k)
+                acc = _mm256_adds_epi16(acc, kIn);
+
+            store_si<kAligned>(samples + i, acc);
+        }
+        for (; i < count; ++i)
+        {
+            const int32_t kSample = samples[i];
+            const auto kVal = kSample * kInt + ((kSample * kFracScalar + (1 << 14)) >> 15);
+            samples[i] = static_cast<int16_t>((kVal < -32768) ? -32768 : ((kVal > 32767) ? 32767 : kVal));
+        }
+    }
+
+    template <bool kAligned>
+    void and_int16(int16_t* samples, const int16_t* mask, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16)
+            store_si<kAligned>(samples + i, _mm256_and_si256(load_si<kAligned>(samples + i), load_si<kAligned>(mask + i)));
+
+        for (; i < count; ++i)
+            samples[i] &= mask[i];
+    }
+
+    template <bool kAligned>
+    void scale(float* samples, int32_t count, float gain)
+    {
+        const auto kGain = _mm256_set1_ps(gain);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            store_ps<kAligned>(samples + i, _mm256_mul_ps(load_ps<kAligned>(samples + i), kGain));
+
+        for (; i < count; ++i)
+            samples[i] *= gain;
+    }
+
+    template <bool kAligned>
+    void multiply(float* samples, const float* gains, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            store_ps<kAligned>(samples + i, _mm256_mul_ps(load_ps<kAligned>(samples + i), load_ps<kAligned>(gains + i)));
+
+        for (; i < count; ++i)
+            samples[i] *= gains[i];
+    }
+
+    template <bool kAligned>
+    void add(const float* in, float* acc, int32_t count)
+    {
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            store_ps<kAligned>(acc + i, _mm256_add_ps(load_ps<kAligned>(acc + i), load_ps<kAligned>(in + i)));
+
+        for (; i < count; ++i)
+            acc[i] += in[i];
+    }
+
+    template <bool kAligned>
+    void soft_clip(float* samples, int32_t count, float drive)
+    {
+        const auto kDrive = _mm256_set1_ps(drive);
+        const auto kMin = _mm256_set1_ps(-1.0f);
+        const auto kMax = _mm256_set1_ps(1.0f);
+        const auto kHalf = _mm256_set1_ps(0.5f);
+        const auto kOneHalf = _mm256_set1_ps(1.5f);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kVal = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(load_ps<kAligned>(samples + i), kDrive), kMin), kMax);
+            store_ps<kAligned>(samples + i, _mm256_mul_ps(kVal, _mm256_sub_ps(kOneHalf, _mm256_mul_ps(_mm256_mul_ps(kHalf, kVal), kVal))));
+        }
+        for (; i < count; ++i)
+            samples[i] = soft_clip_scalar(samples[i], drive);
+    }
+
+    template <bool kAligned>
+    void quantize(float* samples, int32_t count, float levels)
+    {
+        const auto kInvScalar = 1.0f / levels;
+        const auto kLevels = _mm256_set1_ps(levels);
+        const auto kInv = _mm256_set1_ps(kInvScalar);
+        const auto kMin = _mm256_set1_ps(-1.0f);
+        const auto kMax = _mm256_set1_ps(1.0f);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kVal = _mm256_min_ps(_mm256_max_ps(load_ps<kAligned>(samples + i), kMin), kMax);
+            store_ps<kAligned>(samples + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtps_epi32(_mm256_mul_ps(kVal, kLevels))), kInv));
+        }
+        for (; i < count; ++i)
+            samples[i] = quantize_scalar(samples[i], levels, kInvScalar);
+    }
+
+    // all eight lanes in one register
+    template <bool kAligned>
+    void add_noise(float* samples, int32_t count, float amplitude, DspKernels::DitherState& state)
+    {
+        auto lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.lanes));
+        const auto kUnit = _mm256_set1_ps(kToUnitSigned);
+        const auto kAmplitude = _mm256_set1_ps(amplitude);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            lanes = _mm256_xor_si256(lanes, _mm256_slli_epi32(lanes, 13));
+            lanes = _mm256_xor_si256(lanes, _mm256_srli_epi32(lanes, 17));
+            lanes = _mm256_xor_si256(lanes, _mm256_slli_epi32(lanes, 5));
+            const auto kNoise = _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(lanes), kUnit), kAmplitude);
+            store_ps<kAligned>(samples + i, _mm256_add_ps(load_ps<kAligned>(samples + i), kNoise));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state.lanes), lanes);
+        add_noise_scalar(samples, i, count, amplitude, state);
+    }
+
+    // (ar, ai) * (br, bi): a * (br, br) + (-ai, ar) * (bi, bi)
+    template <bool kAligned>
+    void complex_multiply_add(const float* a, const float* b, float* acc, int32_t count)
+    {
+        const auto kSign = _mm256_castsi256_ps(_mm256_set1_epi64x(static_cast<int64_t>(0x80000000ull)));
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto kA = load_ps<kAligned>(a + 2 * i);
+            const auto kB = load_ps<kAligned>(b + 2 * i);
+            const auto kBRe = _mm256_moveldup_ps(kB);
+            const auto kBIm = _mm256_movehdup_ps(kB);
+            const auto kASwap = _mm256_xor_ps(_mm256_permute_ps(kA, _MM_SHUFFLE(2, 3, 0, 1)), kSign);
+            const auto kProduct = _mm256_add_ps(_mm256_mul_ps(kA, kBRe), _mm256_mul_ps(kASwap, kBIm));
+            store_ps<kAligned>(acc + 2 * i, _mm256_add_ps(load_ps<kAligned>(acc + 2 * i), kProduct));
+        }
+        for (; i < count; ++i)
+        {
+            const auto kRe = a[2 * i] * b[2 * i] - a[2 * i + 1] * b[2 * i + 1];
+            const auto kIm = a[2 * i] * b[2 * i + 1] + a[2 * i + 1] * b[2 * i];
+            acc[2 * i] += kRe;
+            acc[2 * i + 1] += kIm;
+        }
+    }
+
+    // Pick the aligned flavour when every buffer is 32 byte aligned
+
+    void int16_to_float_any(const int16_t* in, float* out, int32_t count)
+    {
+        if (is_aligned(in, 32) && is_aligned(out, 32))
+            int16_to_float<true>(in, out, count);
+        else
+            int16_to_float<false>(in, out, count);
+    }
+
+    void float_to_int16_any(const float* in, int16_t* out, int32_t count)
+    {
+        if (is_aligned(in, 32) && is_aligned(out, 32))
+            float_to_int16<true>(in, out, count);
+        else
+            float_to_int16<false>(in, out, count);
+    }
+
+    void float_to_int16_dither_any(const float* in, int16_t* out, int32_t count, DspKernels::DitherState& dither)
+    {
+        if (is_aligned(in, 32) && is_aligned(out, 32))
+            float_to_int16_dither<true>(in, out, count, dither);
+        else
+            float_to_int16_dither<false>(in, out, count, dither);
+    }
+
+    void deinterleave_stereo_any(const int16_t* in, float* left, float* right, int32_t frame_count)
+    {
+        if (is_aligned(in, 16) && is_aligned(left, 32) && is_aligned(right, 32))
+            deinterleave_stereo<true>(in, left, right, frame_count);
+        else
+            deinterleave_stereo<false>(in, left, right, frame_count);
+    }
+
+    void interleave_stereo_any(const float* left, const float* right, int16_t* out, int32_t frame_count)
+    {
+        if (is_aligned(out, 32) && is_aligned(left, 32) && is_aligned(right, 32))
+            interleave_stereo<true>(left, right, out, frame_count);
+        else
+            interleave_stereo<false>(left, right, out, frame_count);
+    }
+
+    void downmix_stereo_any(const int16_t* in, float* out, int32_t frame_count)
+    {
+        if (is_aligned(in, 32) && is_aligned(out, 32))
+            downmix_stereo<true>(in, out, frame_count);
+        else
+            downmix_stereo<false>(in, out, frame_count);
+    }
+
+    bool is_silent_any(const int16_t* samples, int32_t count)
+    {
+        return is_aligned(samples, 32) ? is_silent<true>(samples, count) : is_silent<false>(samples, count);
+    }
+
+    void measure_any(const int16_t* samples, int32_t count, DspKernels::Levels& result)
+    {
+        if (is_aligned(samples, 32))
+            measure<true>(samples, count, result);
+        else
+            measure<false>(samples, count, result);
+    }
+
+    void apply_gain_q15_any(int16_t* samples, int32_t count, int32_t gain_q15)
+    {
+        if (is_aligned(samples, 32))
+            apply_gain_q15<true>(samples, count, gain_q15);
+        else
+            apply_gain_q15<false>(samples, count, gain_q15);
+    }
+
+    void scale_any(float* samples, int32_t count, float gain)
+    {
+        if (is_aligned(samples, 32))
+            scale<true>(samples, count, gain);
+        else
+            scale<false>(samples, count, gain);
+    }
+
+    inline __m256 fast_log2(__m256 val)
+    {
+        val = _mm256_max_ps(val, _mm256_set1_ps(kMinMagnitude));
+        const auto kBits = _mm256_castps_si256(val);
+        const auto kExponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(kBits, 23), _mm256_set1_epi32(127)));
+        const auto kMantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(kBits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+        auto poly = _mm256_add_ps(_mm256_set1_ps(kLog2C2), _mm256_mul_ps(kMantissa, _mm256_set1_ps(kLog2C3)));
+        poly = _mm256_add_ps(_mm256_set1_ps(kLog2C1), _mm256_mul_ps(kMantissa, poly));
+        poly = _mm256_add_ps(_mm256_set1_ps(kLog2C0), _mm256_mul_ps(kMantissa, poly));
+        return _mm256_add_ps(kExponent, _mm256_mul_ps(_mm256_sub_ps(kMantissa, _mm256_set1_ps(1.0f)), poly));
+    }
+
+    template <bool kAligned>
+    void compressor_curve(const float* magnitudes, float* reduction, int32_t count, const DspKernels::CompressorCurve& curve)
+    {
+        const auto kHalfKnee = knee_half(curve);
+        const auto kInvTwiceKnee = 1.0f / (4.0f * kHalfKnee);
+        const auto kThreshold = _mm256_set1_ps(curve.threshold);
+        const auto kHalf = _mm256_set1_ps(kHalfKnee);
+        const auto kKnee = _mm256_set1_ps(2.0f * kHalfKnee);
+        const auto kInv = _mm256_set1_ps(kInvTwiceKnee);
+        const auto kSlope = _mm256_set1_ps(curve.slope);
+        const auto kZero = _mm256_setzero_ps();
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kOver = _mm256_sub_ps(fast_log2(load_ps<kAligned>(magnitudes + i)), kThreshold);
+            const auto kInKnee = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(kOver, kHalf), kZero), kKnee);
+            const auto kAbove = _mm256_max_ps(_mm256_sub_ps(kOver, kHalf), kZero);
+            const auto kResult = _mm256_mul_ps(kSlope, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(kInKnee, kInKnee), kInv), kAbove));
+            store_ps<kAligned>(reduction + i, kResult);
+        }
+        for (; i < count; ++i)
+            reduction[i] = curve_scalar(fast_log2_scalar(magnitudes[i]), curve, kHalfKnee, kInvTwiceKnee);
+    }
+
+    template <bool kAligned>
+    void fast_exp2(const float* in, float* out, int32_t count)
+    {
+        const auto kMin = _mm256_set1_ps(-126.0f);
+        const auto kMax = _mm256_set1_ps(126.0f);
+        const auto kOne = _mm256_set1_ps(1.0f);
+        int32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto kVal = _mm256_min_ps(_mm256_max_ps(load_ps<kAligned>(in + i), kMin), kMax);
+            const auto kWhole = _mm256_floor_ps(kVal);
+            const auto kFraction = _mm256_sub_ps(kVal, kWhole);
+            const auto kScale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(kWhole), _mm256_set1_epi32(127)), 23));
+            auto poly = _mm256_add_ps(_mm256_set1_ps(kExp2C2), _mm256_mul_ps(kFraction, _mm256_set1_ps(kExp2C3)));
+            poly = _mm256_add_ps(_mm256_set1_ps(kExp2C1), _mm256_mul_ps(kFraction, poly));
+            poly = _mm256_add_ps(kOne, _mm256_mul_ps(kFraction, poly));
+            store_ps<kAligned>(out + i, _mm256_mul_ps(kScale, poly));
+        }
+        for (; i < count; ++i)
+            out[i] = fast_exp2_scalar(in[i]);
+    }
+
+    // All eight lanes in one register
+    template <bool kAligned>
+    void biquad_lanes(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections)
+    {
+        const auto kLanes = DspKernels::kBiquadLanes;
+        for (int32_t s = 0; s < sections; ++s)
+        {
+            const auto kC = coefficients + s * 5 * kLanes;
+            auto z = state + s * 2 * kLanes;
+            const auto kB0 = load_ps<kAligned>(kC);
+            const auto kB1 = load_ps<kAligned>(kC + kLanes);
+            const auto kB2 = load_ps<kAligned>(kC + 2 * kLanes);
+            const auto kA1 = load_ps<kAligned>(kC + 3 * kLanes);
+            const auto kA2 = load_ps<kAligned>(kC + 4 * kLanes);
+            auto z1 = load_ps<kAligned>(z);
+            auto z2 = load_ps<kAligned>(z + kLanes);
+            for (int32_t i = 0; i < frame_count; ++i)
+            {
+                const auto kX = load_ps<kAligned>(data + i * kLanes);
+                const auto kY = _mm256_add_ps(_mm256_mul_ps(kB0, kX), z1);
+                z1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(kB1, kX), _mm256_mul_ps(kA1, kY)), z2);
+                z2 = _mm256_sub_ps(_mm256_mul_ps(kB2, kX), _mm256_mul_ps(kA2, kY));
+                store_ps<kAligned>(data + i * kLanes, kY);
+            }
+            store_ps<kAligned>(z, z1);
+            store_ps<kAligned>(z + kLanes, z2);
+        }
+        flush_biquad_state(state, sections);
+    }
+
+    void and_int16_any(int16_t* samples, const int16_t* mask, int32_t count)
+    {
+        if (is_aligned(samples, 32) && is_aligned(mask, 32))
+            and_int16<true>(samples, mask, count);
+        else
+            and_int16<false>(samples, mask, count);
+    }
+
+    void multiply_any(float* samples, const float* gains, int32_t count)
+    {
+        if (is_aligned(samples, 32) && is_aligned(gains, 32))
+            multiply<true>(samples, gains, count);
+        else
+            multiply<false>(samples, gains, count);
+    }
+
+    void add_any(const float* in, float* acc, int32_t count)
+    {
+        if (is_aligned(in, 32) && is_aligned(acc, 32))
+            add<true>(in, acc, count);
+        else
+            add<false>(in, acc, count);
+    }
+
+    void soft_clip_any(float* samples, int32_t count, float drive)
+    {
+        if (is_aligned(samples, 32))
+            soft_clip<true>(samples, count, drive);
+        else
+            soft_clip<false>(samples, count, drive);
+    }
+
+    void quantize_any(float* samples, int32_t count, float levels)
+    {
+        if (is_aligned(samples, 32))
+            quantize<true>(samples, count, levels);
+        else
+            quantize<false>(samples, count, levels);
+    }
+
+    void add_noise_any(float* samples, int32_t count, float amplitude, DspKernels::DitherState& state)
+    {
+        if (is_aligned(samples, 32))
+            add_noise<true>(samples, count, amplitude, state);
+        else
+            add_noise<false>(samples, count, amplitude, state);
+    }
+
+    void complex_multiply_add_any(const float* a, const float* b, float* acc, int32_t count)
+    {
+        if (is_aligned(a, 32) && is_aligned(b, 32) && is_aligned(acc, 32))
+            complex_multiply_add<true>(a, b, acc, count);
+        else
+            complex_multiply_add<false>(a, b, acc, count);
+    }
+
+    void compressor_curve_any(const float* magnitudes, float* reduction, int32_t count, const DspKernels::CompressorCurve& curve)
+    {
+        if (is_aligned(magnitudes, 32) && is_aligned(reduction, 32))
+            compressor_curve<true>(magnitudes, reduction, count, curve);
+        else
+            compressor_curve<false>(magnitudes, reduction, count, curve);
+    }
+
+    void fast_exp2_any(const float* in, float* out, int32_t count)
+    {
+        if (is_aligned(in, 32) && is_aligned(out, 32))
+            fast_exp2<true>(in, out, count);
+        else
+            fast_exp2<false>(in, out, count);
+    }
+
+    void biquad_lanes_any(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections)
+    {
+        if (is_aligned(coefficients, 32) && is_aligned(state, 32) && is_aligned(data, 32))
+            biquad_lanes<true>(coefficients, state, data, frame_count, sections);
+        else
+            biquad_lanes<false>(coefficients, state, data, frame_count, sections);
+    }
+}
+
+bool DspKernels::Impl::fill_avx2(Table& table)
+{
+    table.int16_to_float = int16_to_float_any;
+    table.float_to_int16 = float_to_int16_any;
+    table.float_to_int16_dither = float_to_int16_dither_any;
+    table.deinterleave_stereo = deinterleave_stereo_any;
+    table.interleave_stereo = interleave_stereo_any;
+    table.downmix_stereo = downmix_stereo_any;
+    table.is_silent = is_silent_any;
+    table.measure = measure_any;
+    table.apply_gain_q15 = apply_gain_q15_any;
+    table.and_int16 = and_int16_any;
+    table.scale = scale_any;
+    table.multiply = multiply_any;
+    table.add = add_any;
+    table.soft_clip = soft_clip_any;
+    table.quantize = quantize_any;
+    table.add_noise = add_noise_any;
+    table.complex_multiply_add = complex_multiply_add_any;
+    table.compressor_curve = compressor_curve_any;
+    table.fast_exp2 = fast_exp2_any;
+    table.biquad_lanes = biquad_lanes_any;
+    return true;
+}
+
+#else
+
+bool DspKernels::Impl::fill_avx2(Table& table)
+{
+    (void)table;
+    return false;
+}
+
+#endif // __AVX2__
+
+#endif // DSP_KERNELS_X86
@@ -0,0 +1,186 @@
+#pragma once
+
+// Internal to the kernel library: the per ISA implementations behind DspKernels
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "volume/dsp_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DSP_KERNELS_X86
+#endif
+
+namespace DspKernels
+{
+    namespace Impl
+    {
+        struct Table
+        {
+            void (*int16_to_float)(const int16_t* in, float* out, int32_t count);
+            void (*float_to_int16)(const float* in, int16_t* out, int32_t count);
+            void (*float_to_int16_dither)(const float* in, int16_t* out, int32_t count, DitherState& dither);
+            void (*deinterleave_stereo)(const int16_t* in, float* left, float* right, int32_t frame_count);
+            void (*interleave_stereo)(const float* left, const float* right, int16_t* out, int32_t frame_count);
+            void (*downmix_stereo)(const int16_t* in, float* out, int32_t frame_count);
+            bool (*is_silent)(const int16_t* samples, int32_t count);
+            void (*measure)(const int16_t* samples, int32_t count, Levels& result);   // result zero initialized
+            void (*apply_gain_q15)(int16_t* samples, int32_t count, int32_t gain_q15);
+            void (*and_int16)(int16_t* samples, const int16_t* mask, int32_t count);  // samples[i] &= mask[i]
+            void (*apply_gain_pan_stereo_q15)(int16_t* samples, int32_t frame_count, int32_t source, int32_t gain_left_q15, int32_t gain_right_q15);
+            void (*scale)(float* samples, int32_t count, float gain);
+            void (*multiply)(float* samples, const float* gains, int32_t count);
+            void (*add)(const float* in, float* acc, int32_t count);
+            void (*soft_clip)(float* samples, int32_t count, float drive);
+            void (*quantize)(float* samples, int32_t count, float levels);
+            void (*add_noise)(float* samples, int32_t count, float amplitude, DitherState& state);
+            void (*complex_multiply_add)(const float* a, const float* b, float* acc, int32_t count);
+            void (*compressor_curve)(const float* magnitudes, float* reduction, int32_t count, const CompressorCurve& curve);
+            void (*fast_exp2)(const float* in, float* out, int32_t count);
+            void (*biquad_lanes)(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections);
+        };
+
+        // Internal linkage: the AVX2 translation unit is built with other code generation flags, so a shared
+        // out of line copy of these could end up with AVX2 instructions in the scalar and SSE2 paths.
+        namespace
+        {
+            const float kToFloat = 1.0f / 32768.0f;
+            const float kToInt16 = 32768.0f;
+
+            inline bool is_aligned(const void* p, size_t alignment)
+            {
+                return (reinterpret_cast<uintptr_t>(p) & (alignment - 1)) == 0;
+            }
+
+            inline uint32_t xorshift(uint32_t& state)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return state;
+            }
+
+            // scalar meter, also head and tail of the vector versions; magnitudes saturate at 32767 like theirs
+            inline int32_t saturated_magnitude(int32_t val)
+            {
+                val = (val < 0) ? -val : val;
+                return (val > 32767) ? 32767 : val;
+            }
+
+            inline void accumulate_levels(const int16_t* samples, int32_t begin, int32_t end, Levels& sums)
+            {
+                int64_t acc = 0;
+                int64_t diff_acc = 0;
+                int32_t previous = (begin > 0) ? samples[begin - 1] : samples[0];
+                for (int32_t i = begin; i < end; ++i)
+                {
+                    const int32_t kVal = samples[i];
+                    const auto kMag = saturated_magnitude(kVal);
+                    const auto kDiff = saturated_magnitude(kVal - previous);
+                    sums.peak = (kMag > sums.peak) ? kMag : sums.peak;
+                    acc += kMag * kMag;
+                    diff_acc += kDiff * kDiff;
+                    sums.zero_crossings += static_cast<uint32_t>(kVal ^ previous) >> 31;
+                    previous = kVal;
+                }
+                sums.energy += static_cast<float>(acc);
+                sums.diff_energy += static_cast<float>(diff_acc);
+            }
+
+            inline void normalize_levels(Levels& sums)
+            {
+                sums.energy *= kToFloat * kToFloat;
+                sums.diff_energy *= kToFloat * kToFloat;
+            }
+
+            // Polynomial log2 / exp2 shared by all ISAs, so every version computes the same curve.
+            // log2(m) = (m - 1) * p(m) for the mantissa m in [1, 2); 2^f = 1 + f * q(f) for f in [0, 1)
+            const float kLog2C0 = 2.52454373f;
+            const float kLog2C1 = -1.57819749f;
+            const float kLog2C2 = 0.57648564f;
+            const float kLog2C3 = -0.08428509f;
+            const float kExp2C1 = 0.69542908f;
+            const float kExp2C2 = 0.22694386f;
+            const float kExp2C3 = 0.07737736f;
+            const float kMinMagnitude = 1e-9f;  // -180 dB; log2 of silence
+
+            inline float fast_log2_scalar(float val)
+            {
+                val = (val > kMinMagnitude) ? val : kMinMagnitude;
+                uint32_t bits;
+                memcpy(&bits, &val, sizeof(bits));
+                const auto kExponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+                bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+                float mantissa;
+                memcpy(&mantissa, &bits, sizeof(mantissa));
+                return kExponent + (mantissa - 1.0f) * (kLog2C0 + mantissa * (kLog2C1 + mantissa * (kLog2C2 + mantissa * kLog2C3)));
+            }
+
+            inline float fast_exp2_scalar(float val)
+            {
+                val = (val < -126.0f) ? -126.0f : ((val > 126.0f) ? 126.0f : val);
+                auto whole = static_cast<float>(static_cast<int32_t>(val));
+                whole -= (whole > val) ? 1.0f : 0.0f;
+                const auto kFraction = val - whole;
+                const auto kBits = static_cast<uint32_t>(static_cast<int32_t>(whole) + 127) << 23;
+                float scale;
+                memcpy(&scale, &kBits, sizeof(scale));
+                return scale * (1.0f + kFraction * (kExp2C1 + kFraction * (kExp2C2 + kFraction * kExp2C3)));
+            }
+
+            // knee: 0 below threshold - knee / 2, slope * over above threshold + knee / 2, quadratic in between
+            inline float curve_scalar(float level, const CompressorCurve& curve, float half_knee, float inv_twice_knee)
+            {
+                const auto kOver = level - curve.threshold;
+                auto in_knee = kOver + half_knee;
+                in_knee = (in_knee < 0.0f) ? 0.0f : ((in_knee > 2.0f * half_knee) ? 2.0f * half_knee : in_knee);
+                const auto kAbove = (kOver - half_knee > 0.0f) ? kOver - half_knee : 0.0f;
+                return curve.slope * (in_knee * in_knee * inv_twice_knee + kAbove);
+            }
+
+            inline float knee_half(const CompressorCurve& curve)
+            {
+                return (curve.knee > 1e-4f) ? 0.5f * curve.knee : 0.5e-4f;
+            }
+
+            // Radio effects; the vector versions run the same operations in the same order
+            const float kToUnitSigned = 1.0f / 2147483648.0f;
+
+            inline float soft_clip_scalar(float val, float drive)
+            {
+                val = val * drive;
+                val = (val < -1.0f) ? -1.0f : ((val > 1.0f) ? 1.0f : val);
+                return val * (1.5f - 0.5f * val * val);
+            }
+
+            inline float quantize_scalar(float val, float levels, float inv_levels)
+            {
+                val = (val < -1.0f) ? -1.0f : ((val > 1.0f) ? 1.0f : val);
+                return static_cast<float>(static_cast<int32_t>(std::nearbyint(val * levels))) * inv_levels;
+            }
+
+            // sample i of a call takes lane i % 8
+            inline void add_noise_scalar(float* samples, int32_t begin, int32_t end, float amplitude, DitherState& state)
+            {
+                for (int32_t i = begin; i < end; ++i)
+                    samples[i] += (static_cast<int32_t>(xorshift(state.lanes[i & 7])) * kToUnitSigned) * amplitude;
+            }
+
+            // a decayed filter would otherwise carry denormals into the next frame
+            inline void flush_biquad_state(float* state, int32_t sections)
+            {
+                for (int32_t i = 0; i < sections * 2 * kBiquadLanes; ++i)
+                {
+                    if ((state[i] < 1e-15f) && (state[i] > -1e-15f))
+                        state[i] = 0.0f;
+                }
+            }
+        }
+
+#if defined(DSP_KERNELS_X86)
+        bool fill_avx2(Table& table);  // false when built without AVX2 support
+#endif
+    }
+}
@@ -0,0 +1,423 @@
+#include "volume/dsp_pipeline.h"
+
+#include <QtCore/QThread>
+#include <QtCore/QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/scratch_arena.h"
+#include "volume/dsp_kernels.h"
+#include "volume/eq_bank.h"
+
+namespace {
+    // a longer pause between two frames is a new talk burst; the frame queued before it is stale
+    const auto kRestartGap = std::chrono::milliseconds(50);
+    const int kWakeTimeout = 50;                // ms; workers check for interruption at least this often
+    const int32_t kMaxDefaultWorkers = 2;       // the chains are light next to the client, more threads only add wakeups
+}
+
+class DspPipelineWorker : public QThread
+{
+public:
+    DspPipelineWorker(DspPipeline* pipeline, size_t index)
+        : QThread(pipeline)
+        , m_pipeline(pipeline)
+        , m_index(index)
+    {}
+
+protected:
+    void run() override
+    {
+        ScratchArena::local().reserve(ScratchArena::kDefaultCapacity);
+
+        std::vector<std::shared_ptr<DspPipelineSlot>> active;
+        uint32_t generation = ~0u;
+        while (!isInterruptionRequested())
+        {
+            m_pipeline->m_wakeup->tryAcquire(1, kWakeTimeout);
+            while (m_pipeline->process_pending(active, generation, m_index))
+                ;
+        }
+    }
+
+private:
+    DspPipeline* m_pipeline;
+    size_t m_index;
+};
+
+// DspPipelineSlot
+
+const int32_t DspPipelineSlot::kMaxSamples;
+
+DspPipelineSlot::DspPipelineSlot(std::unique_ptr<DspChain> chain)
+    : m_chain(std::move(chain))
+{
+}
+
+//! Swap frame N for the processed frame N-1; audio thread, no locks, no allocation
+/*!
+ * \param samples interleaved samples; frame N on entry, frame N-1 on return
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \return false when the frame was too large for the pipeline and left untouched
+ */
+bool DspPipelineSlot::exchange(int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    const auto kCount = frame_count * channels;
+    if (kCount <= 0 || kCount > kMaxSamples)
+        return false;
+
+    const auto kNow = std::chrono::steady_clock::now();
+    auto& previous = m_dry[m_dry_index];
+    const bool kRestart = (m_sequence == 0)
+            || (kNow - m_last_exchange > kRestartGap)
+            || (previous.frame_count != frame_count)
+            || (previous.channels != channels);
+    m_last_exchange = kNow;
+    ++m_sequence;
+
+    // frame N to the workers; if their queue is full N will come out dry
+    if (auto in = m_input.begin_push())
+    {
+        in->sequence = m_sequence;
+        in->frame_count = frame_count;
+        in->channels = channels;
+        memcpy(in->samples.data(), samples, kCount * sizeof(int16_t));
+        m_input.end_push();
+        if (m_wakeup)
+            m_wakeup->release();
+    }
+
+    auto& current = m_dry[m_dry_index ^ 1];
+    current.sequence = m_sequence;
+    current.frame_count = frame_count;
+    current.channels = channels;
+    memcpy(current.samples.data(), samples, kCount * sizeof(int16_t));
+    m_dry_index ^= 1;
+
+    // frame N-1 back; drop results that are older
+    const Frame* wet = nullptr;
+    while (auto out = m_output.front())
+    {
+        if (out->sequence + 1 < m_sequence)
+        {
+            m_output.pop();
+            continue;
+        }
+        if (out->sequence + 1 == m_sequence)
+            wet = out;
+
+        break;
+    }
+
+    if (kRestart)
+        memset(samples, 0, kCount * sizeof(int16_t));
+    else if (wet && (wet->frame_count == frame_count) && (wet->channels == channels))
+        memcpy(samples, wet->samples.data(), kCount * sizeof(int16_t));
+    else
+    {
+        memcpy(samples, previous.samples.data(), kCount * sizeof(int16_t));
+        m_missed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (wet)
+        m_output.pop();
+
+    return true;
+}
+
+//! Run the chain over all queued frames; worker thread
+/*!
+ * \return true if a frame was processed
+ */
+bool DspPipelineSlot::process_pending()
+{
+    if (m_busy.test_and_set(std::memory_order_acquire))
+        return false;
+
+    bool processed = false;
+    while (auto in = m_input.front())
+    {
+        if (auto out = m_output.begin_push())
+        {
+            out->sequence = in->sequence;
+            out->frame_count = in->frame_count;
+            out->channels = in->channels;
+            memcpy(out->samples.data(), in->samples.data(), in->frame_count * in->channels * sizeof(int16_t));
+            m_chain->process(out->samples.data(), out->frame_count, out->channels);
+            ScratchArena::local().reset();
+            m_output.end_push();
+        }
+        m_input.pop();
+        processed = true;
+    }
+
+    m_busy.clear(std::memory_order_release);
+    return processed;
+}
+
+// DspPipeline
+
+//! Constructor
+/*!
+ * \param parent the parent
+ * \param worker_count number of worker threads, 0: one less than the number of cores, at most kMaxDefaultWorkers
+ * \param sample_rate sample rate the chains are prepared for
+ */
+DspPipeline::DspPipeline(QObject* parent, int32_t worker_count, int32_t sample_rate)
+    : QObject(parent)
+    , m_sample_rate(sample_rate)
+    , m_worker_count(worker_count > 0 ? worker_count : qBound(1, QThread::idealThreadCount() - 1, kMaxDefaultWorkers))
+    , m_wakeup(std::make_shared<QSemaphore>())
+{
+    this->setObjectName("DspPipeline");
+}
+
+DspPipeline::~DspPipeline()
+{
+    stop();
+}
+
+//! Sets up the chain of slots added from now on
+void DspPipeline::setChainFactory(ChainFactory factory)
+{
+    m_chain_factory = std::move(factory);
+}
+
+//! Run a per talker EQ after the chain of every slot added from now on; set before start()
+/*!
+ * Mono frames of up to EqBank::kLanes talkers are filtered in one pass, see EqBank.
+ * \param bank the bank, must outlive the workers; nullptr for none
+ */
+void DspPipeline::setEqBank(EqBank* bank)
+{
+    m_eq_bank = bank;
+}
+
+//! Create a slot for a client; hand it to the DspVolume of that client
+std::shared_ptr<DspPipelineSlot> DspPipeline::AddSlot(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    std::unique_ptr<DspChain> chain(new DspChain(m_sample_rate));
+    if (m_chain_factory)
+        m_chain_factory(*chain);
+
+    auto slot = std::make_shared<DspPipelineSlot>(std::move(chain));
+    slot->m_wakeup = m_wakeup;
+    if (m_eq_bank)
+        slot->m_eq_lane = m_eq_bank->AddLane(serverConnectionHandlerID, clientID);
+
+    QMutexLocker locker(&m_mutex);
+    m_slots.insert(qMakePair(serverConnectionHandlerID, clientID), slot);
+    m_generation.fetch_add(1, std::memory_order_release);
+    return slot;
+}
+
+void DspPipeline::RemoveSlot(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    if (m_eq_bank)
+        m_eq_bank->RemoveLane(serverConnectionHandlerID, clientID);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_slots.remove(qMakePair(serverConnectionHandlerID, clientID)))
+        m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void DspPipeline::RemoveSlots(uint64 serverConnectionHandlerID)
+{
+    if (m_eq_bank)
+        m_eq_bank->RemoveLanes(serverConnectionHandlerID);
+
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_slots.begin(); it != m_slots.end();)
+    {
+        if (it.key().first == serverConnectionHandlerID)
+            it = m_slots.erase(it);
+        else
+            ++it;
+    }
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void DspPipeline::RemoveSlots()
+{
+    if (m_eq_bank)
+        m_eq_bank->RemoveLanes();
+
+    QMutexLocker locker(&m_mutex);
+    if (m_slots.isEmpty())
+        return;
+
+    m_slots.clear();
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+//! Frames that fell back to the dry signal, summed over all slots
+uint32_t DspPipeline::getMissedDeadlines()
+{
+    uint32_t result = 0;
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_slots.cbegin(); it != m_slots.cend(); ++it)
+        result += it.value()->missed_deadlines();
+
+    return result;
+}
+
+void DspPipeline::start()
+{
+    if (m_workers.empty())
+    {
+        for (int32_t i = 0; i < m_worker_count; ++i)
+            m_workers.push_back(new DspPipelineWorker(this, static_cast<size_t>(i)));
+    }
+
+    for (auto worker : m_workers)
+    {
+        if (!worker->isRunning())
+            worker->start(QThread::HighPriority);   // above the GUI, below the client audio threads
+    }
+}
+
+void DspPipeline::stop()
+{
+    for (auto worker : m_workers)
+        worker->requestInterruption();
+
+    m_wakeup->release(static_cast<int>(m_workers.size()));
+    for (auto worker : m_workers)
+        worker->wait();
+}
+
+// worker threads
+
+//! One pass over all slots
+/*!
+ * \param active the workers copy of the slot list, refreshed when the generation changed
+ * \param generation the generation of the copy
+ * \param first index of the worker; workers start at different slots to spread the load
+ * \return true if a frame was processed
+ */
+bool DspPipeline::process_pending(std::vector<std::shared_ptr<DspPipelineSlot>>& active, uint32_t& generation, size_t first)
+{
+    const auto kGeneration = m_generation.load(std::memory_order_acquire);
+    if (kGeneration != generation)
+    {
+        QMutexLocker locker(&m_mutex);
+        active.clear();
+        for (auto it = m_slots.cbegin(); it != m_slots.cend(); ++it)
+            active.push_back(it.value());
+
+        // slots of one EQ group next to each other, slots without a lane last
+        if (m_eq_bank)
+        {
+            std::sort(active.begin(), active.end(), [](const std::shared_ptr<DspPipelineSlot>& a, const std::shared_ptr<DspPipelineSlot>& b) {
+                return static_cast<uint32_t>(a->m_eq_lane) < static_cast<uint32_t>(b->m_eq_lane);
+            });
+        }
+        generation = kGeneration;
+    }
+
+    bool processed = false;
+    const auto kSize = active.size();
+    size_t end = 0;
+    if (m_eq_bank)
+    {
+        for (size_t begin = 0; begin < kSize && active[begin]->m_eq_lane >= 0; begin = end)
+        {
+            const auto kGroup = active[begin]->m_eq_lane / EqBank::kLanes;
+            end = begin + 1;
+            while (end < kSize && active[end]->m_eq_lane >= 0 && active[end]->m_eq_lane / EqBank::kLanes == kGroup)
+                ++end;
+
+            processed |= process_group(active.data() + begin, end - begin, kGroup);
+        }
+    }
+
+    const auto kUngrouped = kSize - end;
+    for (size_t i = 0; i < kUngrouped; ++i)
+        processed |= active[end + (first + i) % kUngrouped]->process_pending();
+
+    return processed;
+}
+
+//! Run the chains of the slots of one EQ group, then the EQ over one frame of each in a single pass
+/*!
+ * Repeats until the slots have no frames left. Frames the EQ cannot take (not mono, a different frame count
+ * than the rest of the batch when nothing else is queued) go through the chain only.
+ * \param members the slots of the group
+ * \param count number of slots
+ * \param group the EqBank group
+ * \return true if a frame was processed
+ */
+bool DspPipeline::process_group(const std::shared_ptr<DspPipelineSlot>* members, size_t count, int32_t group)
+{
+    if (!m_eq_bank->try_lock_group(group))
+        return false;
+
+    bool processed = false;
+    auto& arena = ScratchArena::local();
+    for (;;)
+    {
+        std::array<float*, EqBank::kLanes> planes;
+        std::array<DspPipelineSlot*, EqBank::kLanes> owners;
+        std::array<DspPipelineSlot::Frame*, EqBank::kLanes> frames;
+        planes.fill(nullptr);
+        owners.fill(nullptr);
+        int32_t frame_count = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto slot = members[i].get();
+            if (slot->m_busy.test_and_set(std::memory_order_acquire))
+                continue;
+
+            auto in = slot->m_input.front();
+            const bool kFits = in && (in->channels == 1) && (frame_count == 0 || in->frame_count == frame_count);
+            auto out = kFits ? slot->m_output.begin_push() : nullptr;
+            auto plane = out ? arena.allocate_array<float>(in->frame_count) : nullptr;
+            if (!plane)
+            {
+                slot->m_busy.clear(std::memory_order_release);
+                continue;
+            }
+
+            frame_count = in->frame_count;
+            out->sequence = in->sequence;
+            out->frame_count = in->frame_count;
+            out->channels = in->channels;
+            memcpy(out->samples.data(), in->samples.data(), in->frame_count * sizeof(int16_t));
+            slot->m_chain->process(out->samples.data(), out->frame_count, out->channels);
+            DspKernels::int16_to_float(out->samples.data(), plane, frame_count);
+
+            const auto kLane = slot->m_eq_lane % EqBank::kLanes;
+            planes[kLane] = plane;
+            owners[kLane] = slot;
+            frames[kLane] = out;
+        }
+        if (frame_count == 0)
+        {
+            arena.reset();
+            break;
+        }
+
+        m_eq_bank->process(group, planes.data(), frame_count);
+        for (int32_t lane = 0; lane < EqBank::kLanes; ++lane)
+        {
+            auto slot = owners[lane];
+            if (!slot)
+                continue;
+
+            DspKernels::float_to_int16(planes[lane], frames[lane]->samples.data(), frame_count);
+            slot->m_output.end_push();
+            slot->m_input.pop();
+            slot->m_busy.clear(std::memory_order_release);
+        }
+        arena.reset();
+        processed = true;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        processed |= members[i]->process_pending();
+
+    m_eq_bank->unlock_group(group);
+    return processed;
+}
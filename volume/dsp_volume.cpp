@@ -1,6 +1,15 @@
 #include "volume/dsp_volume.h"
 
+#include <cstring>
+
 #include "volume/db.h"
+#include "volume/dsp_helpers.h"
+#include "volume/dsp_kernels.h"
+#include "volume/dsp_pipeline.h"
+#include "volume/pan_law.h"
+#include "volume/replay_buffer.h"
+#include "volume/spectrum_analyzer.h"
+#include "volume/vca_groups.h"
 
 const float GAIN_FADE_RATE = (400.0f);	// Rate to fade at (dB per second)
 
@@ -9,6 +18,11 @@ DspVolume::DspVolume(QObject *parent) :
 {
 }
 
+DspVolume::~DspVolume()
+{
+    keyVoiceSidechain(false);
+}
+
 // Properties
 
 //! Sets the current gain (dB) either set by user interaction or gain adjustment
@@ -65,6 +79,8 @@ bool DspVolume::isProcessing() const
 void DspVolume::setProcessing(bool val)
 {
     m_isProcessing = val;
+    if (!val)
+        keyVoiceSidechain(false);   // its callbacks stop with the talk status
 }
 
 //! Mutes the volume
@@ -87,20 +103,362 @@ bool DspVolume::isMuted() const
     return m_muted;
 }
 
+//! Sets the gain (dB) of the volume rules matching the client
+/*!
+  Added on top of the current gain; thread safe, the audio thread picks it up with the next frame and fades to it
+  \param val the rule gain (dB)
+*/
+void DspVolume::setGainRule(float val)
+{
+    m_gainRule.store(val, std::memory_order_relaxed);
+}
+
+//! Gets the gain (dB) of the volume rules matching the client
+float DspVolume::getGainRule() const
+{
+    return m_gainRule.load(std::memory_order_relaxed);
+}
+
+//! Attach the group offsets of a VcaGroups object
+/*!
+  Set it before the first process call
+  \param state VcaGroups::state()
+*/
+void DspVolume::setVcaState(std::shared_ptr<const VcaState> state)
+{
+    m_vca_state = std::move(state);
+}
+
+//! Sets the VCA groups the client belongs to; thread safe
+/*!
+  \param group_mask bit n set: member of group n
+*/
+void DspVolume::setVcaGroups(uint32_t group_mask)
+{
+    m_vca_groups.store(group_mask, std::memory_order_relaxed);
+}
+
+uint32_t DspVolume::getVcaGroups() const
+{
+    return m_vca_groups.load(std::memory_order_relaxed);
+}
+
+//! Gate the client; decided per frame on the same meter pass as the voice activity detector
+/*!
+  Thread safe; the gate starts open
+  \param parameters thresholds, hold time and range
+*/
+void DspVolume::setNoiseGate(const NoiseGate::Parameters& parameters)
+{
+    m_noise_gate.setParameters(parameters);
+    m_noise_gate.setEnabled(true);
+}
+
+void DspVolume::clearNoiseGate()
+{
+    m_noise_gate.setEnabled(false);
+}
+
+bool DspVolume::isGateEnabled() const
+{
+    return m_noise_gate.isEnabled();
+}
+
+//! Is the gate open (or disabled)?
+bool DspVolume::isGateOpen() const
+{
+    return !m_noise_gate.isEnabled() || m_noise_gate.isOpen();
+}
+
+//! Run the noise gate on the levels of the frame
+/*!
+  A gate closed completely zeroes the frame; the caller then takes the silence fast path for all later work.
+  \param levels DspKernels::measure of the frame; zero for digital silence
+  \param sampleCount number of frames
+  \param channels number of channels
+  \param isSilent the buffer is all zeros
+  \return the buffer is all zeros now
+*/
+bool DspVolume::processGate(short *samples, int sampleCount, int channels, const DspKernels::Levels& levels, bool isSilent)
+{
+    if (!m_noise_gate.isEnabled())
+        return isSilent;
+
+    m_noise_gate.update(levels, sampleCount, channels);
+    if (isSilent)
+    {
+        m_noise_gate.advance(sampleCount);
+        return true;
+    }
+    return m_noise_gate.apply(samples, sampleCount, channels);
+}
+
+//! Feed the unprocessed samples to a spectrum analyzer
+/*!
+  Set it before the first process call; nullptr to detach
+  \param tap the clients tap of a SpectrumAnalyzer
+*/
+void DspVolume::setSpectrumTap(std::shared_ptr<SpectrumTap> tap)
+{
+    m_spectrum_tap = std::move(tap);
+}
+
+//! Attach a queue of timestamped gain and mute events
+/*!
+  Set it before the first process call; nullptr to detach.
+  The automation gain comes on top of all other gains.
+  \param automation fed through scheduleGain / scheduleMute
+*/
+void DspVolume::setGainAutomation(std::shared_ptr<GainAutomation> automation)
+{
+    m_gain_automation = std::move(automation);
+}
+
+bool DspVolume::hasGainAutomation() const
+{
+    return m_gain_automation != nullptr;
+}
+
+//! Move the automation gain at a point in time, with sample offset precision
+/*!
+  Call from one thread only, in time order, e.g. from the talk status event handler with the time of the event
+  \param gain_db the automation gain (dB)
+  \param ramp_ms ramp duration; 0: step
+  \param time_us GainAutomation::now() based; defaults to now
+  \return false without automation. With its queue full, the event is merged into the latest state
+  and takes effect at the next block instead of at its time (GainAutomation::schedule), it is never lost.
+*/
+bool DspVolume::scheduleGain(float gain_db, float ramp_ms, int64_t time_us)
+{
+    if (!m_gain_automation)
+        return false;
+
+    GainAutomation::Event event;
+    event.time_us = time_us;
+    event.type = GainAutomation::Type::GAIN;
+    event.gain_db = gain_db;
+    event.ramp_ms = ramp_ms;
+    m_gain_automation->schedule(event);
+    return true;
+}
+
+//! Mute or unmute at a point in time; see scheduleGain
+bool DspVolume::scheduleMute(bool val, float ramp_ms, int64_t time_us)
+{
+    if (!m_gain_automation)
+        return false;
+
+    GainAutomation::Event event;
+    event.time_us = time_us;
+    event.type = val ? GainAutomation::Type::MUTE : GainAutomation::Type::UNMUTE;
+    event.ramp_ms = ramp_ms;
+    m_gain_automation->schedule(event);
+    return true;
+}
+
+//! Record the unprocessed samples for instant replay
+/*!
+  Set it before the first process call; nullptr to detach
+  \param history the clients history of a ReplayBuffer
+*/
+void DspVolume::setReplayHistory(std::shared_ptr<ReplayHistory> history)
+{
+    m_replay_history = std::move(history);
+}
+
+//! Run the heavy processing of the pipelined mode; adds one frame of latency
+/*!
+  Set it before the first process call; nullptr to process inline
+  \param slot the clients slot of a DspPipeline
+*/
+void DspVolume::setPipelineSlot(std::shared_ptr<DspPipelineSlot> slot)
+{
+    m_pipeline_slot = std::move(slot);
+}
+
+//! Publish the voice activity of this client to a sidechain, e.g. to key a DspVolumeDucker
+/*!
+  Set it before the first process call; nullptr to detach.
+  The detector then runs on every frame; a few scalar operations on top of one meter pass.
+  \param sidechain shared with the ducking volumes
+*/
+void DspVolume::setVoiceSidechain(std::shared_ptr<VoiceSidechain> sidechain)
+{
+    keyVoiceSidechain(false);
+    m_voice_sidechain = std::move(sidechain);
+}
+
+//! Did the voice activity detector classify the last frame as voice (including hangover)?
+bool DspVolume::isVoiceActive() const
+{
+    return m_voice_active.load(std::memory_order_relaxed);
+}
+
+//! Run the voice activity detector on the levels of the frame and key the sidechain
+/*!
+  \param levels DspKernels::measure of the unprocessed frame; zero for digital silence
+  \param sampleCount number of frames
+  \param channels number of channels
+  \return is voice active
+*/
+bool DspVolume::processVoiceActivity(const DspKernels::Levels& levels, int sampleCount, int channels)
+{
+    const auto kIsActive = m_voice_activity.update(levels, sampleCount, channels);
+    m_voice_active.store(kIsActive, std::memory_order_relaxed);
+    if (m_voice_sidechain)
+        keyVoiceSidechain(kIsActive);
+
+    return kIsActive;
+}
+
+void DspVolume::keyVoiceSidechain(bool val)
+{
+    if (!m_voice_sidechain || (m_voice_keyed.exchange(val) == val))
+        return;
+
+    if (val)
+        m_voice_sidechain->m_active.fetch_add(1, std::memory_order_relaxed);
+    else
+        m_voice_sidechain->m_active.fetch_sub(1, std::memory_order_relaxed);
+}
+
+//! Place the client in the stereo image; takes effect in processPanned
+/*!
+  Thread safe
+  \param position -1 (left) .. 1 (right)
+*/
+void DspVolume::setPan(float position)
+{
+    m_pan.store(qBound(-1.0f, position, 1.0f), std::memory_order_relaxed);
+    m_is_panned.store(true, std::memory_order_relaxed);
+}
+
+//! Leave the channels as the client lib mixed them
+void DspVolume::clearPan()
+{
+    m_is_panned.store(false, std::memory_order_relaxed);
+}
+
+bool DspVolume::isPanned() const
+{
+    return m_is_panned.load(std::memory_order_relaxed);
+}
+
+float DspVolume::getPan() const
+{
+    return m_pan.load(std::memory_order_relaxed);
+}
+
+//! Whether the stages need the multichannel post process buffer instead of the mono pre process one
+/*!
+  Panning needs the speaker layout. Subclasses with stages of their own that need it override this.
+*/
+bool DspVolume::needsMultichannel() const
+{
+    return isPanned();
+}
+
+//! Mark the current block as processed in the pre process stage, so the post process stage skips it
+void DspVolume::setPreProcessed(bool val)
+{
+    m_is_pre_processed.store(val, std::memory_order_relaxed);
+}
+
+//! Was the current block processed in the pre process stage? Clears the mark.
+bool DspVolume::takePreProcessed()
+{
+    return m_is_pre_processed.exchange(false, std::memory_order_relaxed);
+}
+
+//! Feed the spectrum tap and the replay history and exchange the frame with the pipeline, if attached
+/*!
+  Called at the start of process, before any gain is applied
+  \param samples the buffer
+  \param sampleCount number of frames
+  \param channels number of channels
+*/
+void DspVolume::processTaps(short *samples, int sampleCount, int channels)
+{
+    if (m_spectrum_tap)
+        m_spectrum_tap->push(samples, sampleCount, channels);
+
+    if (m_replay_history)
+        m_replay_history->push(samples, sampleCount, channels);
+
+    if (m_pipeline_slot)
+        m_pipeline_slot->exchange(samples, sampleCount, channels);
+}
+
 void DspVolume::process(short *samples, int sampleCount, int channels)
 {
+    processTaps(samples, sampleCount, channels);
+
+    const auto kFrames = sampleCount;
     sampleCount = sampleCount * channels;
-    setGainCurrent(GetFadeStep(sampleCount));
-    doProcess(samples,sampleCount);
+    auto is_silent = DspKernels::is_silent(samples, sampleCount);
+    if (m_voice_sidechain || isGateEnabled())
+    {
+        const auto kLevels = is_silent ? DspKernels::Levels() : DspKernels::measure(samples, sampleCount);
+        if (m_voice_sidechain)
+            processVoiceActivity(kLevels, kFrames, channels);
+
+        is_silent = processGate(samples, kFrames, channels, kLevels, is_silent);
+    }
+
+    setGainCurrent(GetFadeStep(kFrames));
+    processGain(samples, sampleCount, channels, is_silent);
 }
 
-float DspVolume::GetFadeStep(int sampleCount)
+//! Process a post process buffer, placing the client between the front left and right speakers
+/*!
+  Call from on_playback_post_process instead of process. The talker is read from one of its filled front channels
+  and written to both with the pan law gains times the volume gain, in one pass; other channels it filled are cleared.
+  Falls back to process when not panned or there is no left / right speaker.
+  \param samples the buffer
+  \param sampleCount number of frames
+  \param channels number of channels
+  \param channelSpeakerArray the speaker of each channel
+  \param channelFillMask the channels holding audio; updated
+*/
+void DspVolume::processPanned(short *samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask)
+{
+    if (!isPanned() || !channelSpeakerArray || (channels < 2) || (channels > 32))
+    {
+        process(samples, sampleCount, channels);
+        return;
+    }
+
+    int left, right;
+    const auto kHasStereo = getStereoPair(channelSpeakerArray, channels, left, right);
+    const auto kFillMask = channelFillMask ? *channelFillMask : ~0u;
+    const auto kSource = !kHasStereo ? -1 : ((kFillMask & (1u << left)) ? left : ((kFillMask & (1u << right)) ? right : -1));
+    if (kSource < 0)
+    {
+        process(samples, sampleCount, channels);
+        return;
+    }
+
+    m_pan_layout.source = kSource;
+    m_pan_layout.left = left;
+    m_pan_layout.right = right;
+    m_pan_layout.channels = channels;
+    m_pan_layout.position = getPan();
+    process(samples, sampleCount, channels);
+    m_pan_layout.source = -1;
+
+    const auto kStereo = (1u << left) | (1u << right);
+    DspKernels::clear_channels(samples, sampleCount, channels, kFillMask & ~kStereo);
+    if (channelFillMask)
+        *channelFillMask = (*channelFillMask & ~((channels == 32) ? ~0u : ((1u << channels) - 1))) | kStereo;
+}
+
+float DspVolume::GetFadeStep(int frameCount)
 {
     // compute manual gain
     float current_gain = getGainCurrent();
     float desired_gain = getGainDesired();
     if (isMuted()) {
-        float fade_step = (GAIN_FADE_RATE / m_sampleRate) * sampleCount;
+        float fade_step = (GAIN_FADE_RATE / m_sampleRate) * frameCount;
         if (current_gain < VOLUME_MUTED - fade_step) {
             current_gain += fade_step;
         }
@@ -113,7 +471,7 @@ float DspVolume::GetFadeStep(int sampleCount)
     }
     else if (current_gain != desired_gain)
     {
-        float fade_step = (GAIN_FADE_RATE / m_sampleRate) * sampleCount;
+        float fade_step = (GAIN_FADE_RATE / m_sampleRate) * frameCount;
         if (current_gain < desired_gain - fade_step) {
             current_gain += fade_step;
         }
@@ -127,13 +485,182 @@ float DspVolume::GetFadeStep(int sampleCount)
     return current_gain;
 }
 
+//! Which work did the last process call skip?
+/*!
+ * \brief DspVolume::getBypassMode
+ * \return the bypass mode of the last processed frame
+ */
+DspVolume::Bypass_Mode DspVolume::getBypassMode() const
+{
+    return m_bypass_mode;
+}
+
+//! Apply the current gain plus the rule gain, taking the fast paths where possible
+/*!
+  Call after the fade step has been computed, so fades keep advancing while bypassed.
+  \param samples the buffer
+  \param sampleCount number of samples (frames * channels)
+  \param channels number of channels
+  \param isSilent the buffer is all zeros
+*/
+void DspVolume::processGain(short *samples, int sampleCount, int channels, bool isSilent)
+{
+    const auto kCurrent = getGainCurrent();
+    const auto kGain = kCurrent + stepGainOffset((channels > 0) ? sampleCount / channels : 0);
+    if (m_gain_automation && (channels > 0))
+    {
+        m_gain_automation->begin_block(sampleCount / channels);
+        if (!m_gain_automation->is_idle())
+        {
+            processAutomation(samples, sampleCount, channels, kGain, isSilent, (kCurrent <= VOLUME_MUTED) || (kGain <= VOLUME_MUTED));
+            return;
+        }
+    }
+
+    if (isSilent)
+        m_bypass_mode = Bypass_Mode::SILENT;
+    else if ((kCurrent <= VOLUME_MUTED) || (kGain <= VOLUME_MUTED))
+    {
+        m_bypass_mode = Bypass_Mode::MUTED;
+        memset(samples, 0, sampleCount * sizeof(short));
+    }
+    else if (m_pan_layout.source >= 0)
+    {
+        m_bypass_mode = Bypass_Mode::NONE;
+        doProcessPanned(samples, sampleCount, kGain);
+    }
+    else if (kGain == VOLUME_0DB)
+        m_bypass_mode = Bypass_Mode::UNITY;
+    else
+    {
+        m_bypass_mode = Bypass_Mode::NONE;
+        doProcess(samples, sampleCount, kGain);
+    }
+}
+
+//! Apply the gain in runs split at the automation events and ramp steps
+/*!
+  \param sampleCount number of samples (frames * channels)
+  \param gain the gain (dB) without the automation
+  \param isSilent the buffer is all zeros; the events are consumed all the same
+  \param isMuted the gain without the automation mutes; same
+*/
+void DspVolume::processAutomation(short *samples, int sampleCount, int channels, float gain, bool isSilent, bool isMuted)
+{
+    const auto kFrames = sampleCount / channels;
+    if (isSilent || isMuted)
+    {
+        m_gain_automation->skip(kFrames);
+        m_bypass_mode = isSilent ? Bypass_Mode::SILENT : Bypass_Mode::MUTED;
+        if (!isSilent)
+            memset(samples, 0, sampleCount * sizeof(short));
+
+        return;
+    }
+
+    m_bypass_mode = Bypass_Mode::NONE;
+    float automation_gain;
+    for (int position = 0; position < kFrames;)
+    {
+        const auto kCount = m_gain_automation->next_segment(position, kFrames, automation_gain);
+        const auto kGain = gain + automation_gain;
+        auto segment = samples + position * channels;
+        if ((automation_gain <= VOLUME_MUTED) || (kGain <= VOLUME_MUTED))
+            memset(segment, 0, kCount * channels * sizeof(short));
+        else if (m_pan_layout.source >= 0)
+            doProcessPanned(segment, kCount * channels, kGain);
+        else if (kGain != VOLUME_0DB)
+            doProcess(segment, kCount * channels, kGain);
+
+        position += kCount;
+    }
+}
+
+//! Fade the gain offset one step towards the rule gain plus the VCA group offsets
+/*!
+  The sum of the group offsets is only recomputed when a group gain or the membership changed.
+  \param frameCount number of frames
+  \return the offset (dB) to apply to this frame
+*/
+float DspVolume::stepGainOffset(int frameCount)
+{
+    if (m_vca_state)
+    {
+        const auto kEpoch = m_vca_state->epoch();
+        const auto kMask = m_vca_groups.load(std::memory_order_relaxed);
+        if ((kEpoch != m_vca_epoch) || (kMask != m_vca_mask))
+        {
+            m_vca_epoch = kEpoch;
+            m_vca_mask = kMask;
+            m_vca_sum = m_vca_state->sum(kMask);
+        }
+    }
+
+    const auto kTarget = m_gainRule.load(std::memory_order_relaxed) + m_vca_sum;
+    if (m_gainOffset != kTarget)
+    {
+        const float kFadeStep = (GAIN_FADE_RATE / m_sampleRate) * frameCount;
+        if (m_gainOffset < kTarget - kFadeStep)
+            m_gainOffset += kFadeStep;
+        else if (m_gainOffset > kTarget + kFadeStep)
+            m_gainOffset -= kFadeStep;
+        else
+            m_gainOffset = kTarget;
+    }
+    return m_gainOffset;
+}
+
 //! Apply volume (no need to care for channels)
-void DspVolume::doProcess(short *samples, int sampleCount)
+/*!
+  Runs in Q15 fixed point unless a float stage is involved or the gain exceeds the fixed point range;
+  both paths round to nearest and agree within 1 LSB.
+  \param gain the gain (dB)
+*/
+void DspVolume::doProcess(short *samples, int sampleCount, float gain)
 {
-    float mix_gain = db2lin_alt2(m_gainCurrent);
-    for ( int i_sample=0; i_sample<sampleCount; ++i_sample )
+    float mix_gain = db2lin_alt2(gain);
+    if (!m_float_path && (mix_gain < DspKernels::kGainQ15Max))
+    {
+        DspKernels::apply_gain_q15(samples, sampleCount, static_cast<int32_t>(mix_gain * 32768.0f + 0.5f));
+        return;
+    }
+
+    const int kChunk = 256;
+    alignas(32) float buffer[kChunk];
+    for (int i_sample = 0; i_sample < sampleCount; i_sample += kChunk)
+    {
+        const auto kCount = qMin(kChunk, sampleCount - i_sample);
+        DspKernels::int16_to_float(samples + i_sample, buffer, kCount);
+        DspKernels::scale(buffer, kCount, mix_gain);
+        DspKernels::float_to_int16(buffer, samples + i_sample, kCount);
+    }
+}
+
+//! Apply volume and pan law in one pass; see processPanned
+/*!
+  \param sampleCount number of samples (frames * channels)
+  \param gain the gain (dB)
+*/
+void DspVolume::doProcessPanned(short *samples, int sampleCount, float gain)
+{
+    const auto& kLayout = m_pan_layout;
+    const auto& kPan = PanLaw::gains(kLayout.position);
+    const auto kMixGain = db2lin_alt2(gain);
+    const auto kGainLeft = kMixGain * kPan.left;
+    const auto kGainRight = kMixGain * kPan.right;
+    const auto kFrames = sampleCount / kLayout.channels;
+    if (!m_float_path && (kGainLeft < DspKernels::kGainQ15Max) && (kGainRight < DspKernels::kGainQ15Max))
+    {
+        DspKernels::apply_gain_pan_q15(samples, kFrames, kLayout.channels, kLayout.source, kLayout.left, kLayout.right,
+                                       static_cast<int32_t>(kGainLeft * 32768.0f + 0.5f), static_cast<int32_t>(kGainRight * 32768.0f + 0.5f));
+        return;
+    }
+
+    for (int i = 0; i < kFrames; ++i)
     {
-        int temp = samples[i_sample] * mix_gain;
-        samples[i_sample] = qBound(-32768, temp, 32767);
+        auto frame = samples + i * kLayout.channels;
+        const float kIn = frame[kLayout.source];
+        frame[kLayout.left] = static_cast<short>(qBound(-32768, qRound(kIn * kGainLeft), 32767));
+        frame[kLayout.right] = static_cast<short>(qBound(-32768, qRound(kIn * kGainRight), 32767));
     }
 }
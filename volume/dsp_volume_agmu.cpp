@@ -3,7 +3,7 @@
 #include <QtCore/QVarLengthArray>
 #include <QtCore/qmath.h>
 
-#include "volume/dsp_helpers.h"
+#include "volume/dsp_kernels.h"
 #include "volume/db.h"
 #include "core/ts_logging_qt.h"
 
@@ -16,27 +16,36 @@ DspVolumeAGMU::DspVolumeAGMU(QObject *parent)
 
 void DspVolumeAGMU::process(int16_t* samples, int32_t sample_count, int32_t channels)
 {
+    processTaps(samples, sample_count, channels);
+
+    const auto kFrames = sample_count;
     sample_count = sample_count * channels;
-    auto peak = getPeak(samples, sample_count);
-    peak = qMax(m_peak, peak);
-    if (peak != m_peak)
+    auto is_silent = DspKernels::is_silent(samples, sample_count);
+    const auto kLevels = is_silent ? DspKernels::Levels() : DspKernels::measure(samples, sample_count);
+    // learn from speech only; clicks, breathing and codec artifacts would pin the peak
+    if (processVoiceActivity(kLevels, kFrames, channels) && !is_silent)
     {
-        m_peak = peak;
-        setGainDesired(computeGainDesired());
+        const auto peak = qMax(m_peak, static_cast<int16_t>(kLevels.peak));
+        if (peak != m_peak)
+        {
+            m_peak = peak;
+            setGainDesired(computeGainDesired());
+        }
     }
-    setGainCurrent(GetFadeStep(sample_count));
-    doProcess(samples, sample_count);
+    is_silent = processGate(samples, kFrames, channels, kLevels, is_silent);
+    setGainCurrent(GetFadeStep(kFrames));
+    processGain(samples, sample_count, channels, is_silent);
 }
 
 // Compute gain change
-float DspVolumeAGMU::GetFadeStep(int sampleCount)
+float DspVolumeAGMU::GetFadeStep(int32_t frame_count)
 {
     auto current_gain = getGainCurrent();
     auto desired_gain = getGainDesired();
     if (current_gain != desired_gain)
     {
-        float fade_step_down = (kRateQuieter / m_sampleRate) * sampleCount;
-        float fade_step_up = (kRateLouder / m_sampleRate) * sampleCount;
+        float fade_step_down = (kRateQuieter / m_sampleRate) * frame_count;
+        float fade_step_up = (kRateLouder / m_sampleRate) * frame_count;
         if (current_gain < desired_gain - fade_step_up)
             current_gain += fade_step_up;
         else if (current_gain > desired_gain + fade_step_down)
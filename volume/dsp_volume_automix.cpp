@@ -0,0 +1,111 @@
+#include "volume/dsp_volume_automix.h"
+
+#include <QtCore/qmath.h>
+
+#include <cmath>
+
+#include "volume/dsp_kernels.h"
+
+const uint64_t AutomixState::kUnity;
+
+DspVolumeAutomix::DspVolumeAutomix(QObject* parent, std::shared_ptr<AutomixState> state)
+    : DspVolume(parent)
+    , m_state(state ? std::move(state) : std::make_shared<AutomixState>())
+{
+}
+
+DspVolumeAutomix::~DspVolumeAutomix()
+{
+    publish(0);
+}
+
+// Funcs
+
+//! Measure, publish the own energy, read the total; O(1) per talker and tick
+void DspVolumeAutomix::process(int16_t* samples, int32_t sample_count, int32_t channels)
+{
+    processTaps(samples, sample_count, channels);
+
+    const auto kFrames = sample_count;
+    sample_count = sample_count * channels;
+    auto is_silent = DspKernels::is_silent(samples, sample_count);
+
+    float mean_square = 0.0f;
+    const auto kLevels = (is_silent || sample_count <= 0) ? DspKernels::Levels() : DspKernels::measure(samples, sample_count);
+    if (m_voice_sidechain)
+        processVoiceActivity(kLevels, kFrames, channels);
+
+    // a gated talker takes no share of the total
+    is_silent = processGate(samples, kFrames, channels, kLevels, is_silent);
+    if (sample_count > 0 && !is_silent)
+        mean_square = kLevels.energy / sample_count;
+
+    m_peak.store(is_silent ? 0 : static_cast<int16_t>(kLevels.peak), std::memory_order_relaxed);
+
+    const auto kAlpha = qMin(1.0f, kFrames / (kTimeConstant * m_sampleRate));
+    m_energy += kAlpha * (mean_square - m_energy);
+
+    const auto kOwn = static_cast<uint64_t>(m_energy * AutomixState::kUnity);
+    publish(kOwn);
+    if (!m_talking.load())   // stopped while publishing; do not leave a stale share behind
+        publish(0);
+
+    const auto kTotal = m_state->total();
+    auto share = VOLUME_0DB;
+    if (kOwn > 0 && kTotal > kOwn)
+        share = qMax(kShareMin, 10.0f * std::log10(static_cast<float>(kOwn) / kTotal));
+
+    m_share.store(share, std::memory_order_relaxed);
+
+    setGainCurrent(GetFadeStep(kFrames));
+    processGain(samples, sample_count, channels, is_silent);
+}
+
+//! Fade towards the desired gain plus the share, faster down than up
+float DspVolumeAutomix::GetFadeStep(int32_t frame_count)
+{
+    auto current_gain = getGainCurrent();
+    const auto kDesiredGain = isMuted() ? VOLUME_MUTED : getGainDesired() + m_share.load(std::memory_order_relaxed);
+    if (current_gain != kDesiredGain)
+    {
+        const float kFadeStepDown = (kRateQuieter / m_sampleRate) * frame_count;
+        const float kFadeStepUp = (kRateLouder / m_sampleRate) * frame_count;
+        if (current_gain < kDesiredGain - kFadeStepUp)
+            current_gain += kFadeStepUp;
+        else if (current_gain > kDesiredGain + kFadeStepDown)
+            current_gain -= kFadeStepDown;
+        else
+            current_gain = kDesiredGain;
+    }
+    return current_gain;
+}
+
+//! A talker that stops leaves the total right away; its callbacks stop with it
+void DspVolumeAutomix::setProcessing(bool val)
+{
+    m_talking.store(val);
+    if (!val)
+        publish(0);
+
+    DspVolume::setProcessing(val);
+}
+
+float DspVolumeAutomix::getShare() const
+{
+    return m_share.load(std::memory_order_relaxed);
+}
+
+int16_t DspVolumeAutomix::getPeak() const
+{
+    return m_peak.load(std::memory_order_relaxed);
+}
+
+//! Replace the own part of the total; lock free, exact, no drift
+void DspVolumeAutomix::publish(uint64_t energy)
+{
+    const auto kPrevious = m_published.exchange(energy);
+    if (energy >= kPrevious)
+        m_state->m_total.fetch_add(energy - kPrevious, std::memory_order_relaxed);
+    else
+        m_state->m_total.fetch_sub(kPrevious - energy, std::memory_order_relaxed);
+}
@@ -0,0 +1,189 @@
+#include "volume/dsp_volume_compressor.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPair>
+#include <QtCore/qmath.h>
+
+#include <cmath>
+
+namespace
+{
+    const float kDbPerLog2 = 6.0206f;       // 20 * log10(2)
+    const int kCacheSize = 256;             // entries; a slider sweep must not grow the cache forever
+}
+
+const int32_t DspVolumeCompressor::kFresh;
+const int32_t DspVolumeCompressor::kChunk;
+
+bool DspVolumeCompressor::Parameters::operator==(const Parameters& other) const
+{
+    return (threshold_db == other.threshold_db)
+            && (ratio == other.ratio)
+            && (knee_db == other.knee_db)
+            && (attack_ms == other.attack_ms)
+            && (release_ms == other.release_ms)
+            && (makeup_db == other.makeup_db);
+}
+
+uint qHash(const DspVolumeCompressor::Parameters& key, uint seed)
+{
+    seed ^= qHash(key.threshold_db) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.ratio) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.knee_db) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.attack_ms) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.release_ms) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.makeup_db) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+DspVolumeCompressor::DspVolumeCompressor(QObject* parent)
+    : DspVolume(parent)
+{
+    const auto kCoefficients = Lookup(m_parameters, m_sampleRate);
+    for (auto& coefficients : m_coefficients)
+        coefficients = kCoefficients;
+}
+
+// Parameters
+
+//! Change the parameters; thread safe against the audio thread, takes effect with the next frame
+void DspVolumeCompressor::setParameters(const Parameters& parameters)
+{
+    if (parameters == m_parameters)
+        return;
+
+    m_parameters = parameters;
+    m_coefficients[m_back] = Lookup(parameters, m_sampleRate);
+    m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) & ~kFresh;
+}
+
+DspVolumeCompressor::Parameters DspVolumeCompressor::getParameters() const
+{
+    return m_parameters;
+}
+
+float DspVolumeCompressor::getGainReduction() const
+{
+    return m_gain_reduction.load(std::memory_order_relaxed);
+}
+
+//! The coefficients of a parameter set; computed once per set and sample rate, then served from the cache
+DspVolumeCompressor::Coefficients DspVolumeCompressor::Lookup(const Parameters& parameters, int32_t sample_rate)
+{
+    static QMutex s_mutex;
+    static QHash<QPair<Parameters, int32_t>, Coefficients> s_cache;
+
+    const auto kKey = qMakePair(parameters, sample_rate);
+    QMutexLocker locker(&s_mutex);
+    auto it = s_cache.constFind(kKey);
+    if (it != s_cache.constEnd())
+        return it.value();
+
+    Coefficients result;
+    result.curve.threshold = parameters.threshold_db / kDbPerLog2;
+    result.curve.knee = qMax(0.0f, parameters.knee_db) / kDbPerLog2;
+    result.curve.slope = 1.0f - 1.0f / qMax(1.0f, parameters.ratio);
+    result.attack = std::exp(-1000.0f / (qMax(0.01f, parameters.attack_ms) * sample_rate));
+    result.release = std::exp(-1000.0f / (qMax(0.01f, parameters.release_ms) * sample_rate));
+    result.makeup = parameters.makeup_db / kDbPerLog2;
+
+    if (s_cache.size() >= kCacheSize)
+        s_cache.clear();
+
+    s_cache.insert(kKey, result);
+    return result;
+}
+
+// Funcs
+
+void DspVolumeCompressor::process(int16_t* samples, int32_t sample_count, int32_t channels)
+{
+    processTaps(samples, sample_count, channels);
+
+    const auto kFrames = sample_count;
+    sample_count = sample_count * channels;
+    auto is_silent = DspKernels::is_silent(samples, sample_count);
+    if (m_voice_sidechain || isGateEnabled())
+    {
+        const auto kLevels = is_silent ? DspKernels::Levels() : DspKernels::measure(samples, sample_count);
+        if (m_voice_sidechain)
+            processVoiceActivity(kLevels, kFrames, channels);
+
+        is_silent = processGate(samples, kFrames, channels, kLevels, is_silent);
+    }
+
+    if (m_middle.load(std::memory_order_relaxed) & kFresh)
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & ~kFresh;
+
+    if (is_silent)
+        release(kFrames);
+    else if (channels > 0)
+        compress(samples, kFrames, channels);
+
+    setGainCurrent(GetFadeStep(kFrames));
+    processGain(samples, sample_count, channels, is_silent);
+}
+
+//! Detect, compute and apply the gain reduction; block-wise except for the envelope
+void DspVolumeCompressor::compress(int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    const auto& kCoefficients = m_coefficients[m_front];
+    const auto kToFloat = 1.0f / 32768.0f;
+    alignas(32) float levels[kChunk];
+    alignas(32) float gains[kChunk];
+    auto envelope = m_envelope;
+    auto peak_reduction = 0.0f;
+    for (int32_t offset = 0; offset < frame_count; offset += kChunk)
+    {
+        const auto kCount = qMin(kChunk, frame_count - offset);
+        auto frames = samples + offset * channels;
+
+        // peak of all channels: linked stereo, the image does not shift
+        for (int32_t i = 0; i < kCount; ++i)
+        {
+            int32_t peak = 0;
+            for (int32_t c = 0; c < channels; ++c)
+                peak = qMax(peak, qAbs(static_cast<int32_t>(frames[i * channels + c])));
+
+            levels[i] = peak * kToFloat;
+        }
+        DspKernels::compressor_curve(levels, gains, kCount, kCoefficients.curve);
+
+        for (int32_t i = 0; i < kCount; ++i)
+        {
+            const auto kTarget = gains[i];
+            const auto kCoefficient = (kTarget > envelope) ? kCoefficients.attack : kCoefficients.release;
+            envelope = kTarget + kCoefficient * (envelope - kTarget);
+            peak_reduction = qMax(peak_reduction, envelope);
+            gains[i] = kCoefficients.makeup - envelope;
+        }
+        DspKernels::fast_exp2(gains, gains, kCount);
+
+        for (int32_t i = 0; i < kCount; ++i)
+        {
+            for (int32_t c = 0; c < channels; ++c)
+            {
+                auto& sample = frames[i * channels + c];
+                sample = static_cast<int16_t>(qBound(-32768, qRound(sample * gains[i]), 32767));
+            }
+        }
+    }
+    m_envelope = envelope;
+    m_gain_reduction.store(peak_reduction * kDbPerLog2, std::memory_order_relaxed);
+}
+
+//! Let the envelope recover over a silent frame
+void DspVolumeCompressor::release(int32_t frame_count)
+{
+    if (m_envelope <= 0.0f)
+        return;
+
+    const auto kRelease = m_coefficients[m_front].release;
+    for (int32_t i = 0; i < frame_count; ++i)
+        m_envelope *= kRelease;
+
+    m_envelope = (m_envelope < 1e-6f) ? 0.0f : m_envelope;
+    m_gain_reduction.store(m_envelope * kDbPerLog2, std::memory_order_relaxed);
+}
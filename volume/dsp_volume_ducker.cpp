@@ -1,5 +1,7 @@
 #include "volume/dsp_volume_ducker.h"
 
+#include <QtCore/QtGlobal>
+
 DspVolumeDucker::DspVolumeDucker(QObject *parent)
 {
     this->setParent(parent);
@@ -36,9 +38,44 @@ bool DspVolumeDucker::getGainAdjustment() const
     return m_gainAdjustment;
 }
 
+//! Start or stop ducking
+/*!
+ * With gain automation attached, the duck and its release are scheduled as ramps at the time of the call,
+ * instead of being faded once per block.
+ * \brief DspVolumeDucker::setGainAdjustment
+ * \param val true: duck
+ */
 void DspVolumeDucker::setGainAdjustment(bool val)
 {
+    if (m_gainAdjustment == val)
+        return;
+
     m_gainAdjustment = val;
+    if (isAutomated())
+        scheduleDuck();
+}
+
+bool DspVolumeDucker::isAutomated() const
+{
+    return hasGainAutomation() && !m_sidechain_key;
+}
+
+//! Ramp to the duck gain at the attack rate, or back to 0dB at the decay rate when not ducking or blocked
+/*!
+ * Every call schedules the full current target, not a change, so a merged event (queue full while the client
+ * is not talking) still ends up in the right state.
+ */
+void DspVolumeDucker::scheduleDuck()
+{
+    const auto kDepth = qAbs(getGainDesired());
+    bool is_scheduled;
+    if (m_gainAdjustment && !m_isDuckBlocked)
+        is_scheduled = scheduleGain(getGainDesired(), 1000.0f * kDepth / m_attackRate);
+    else
+        is_scheduled = scheduleGain(VOLUME_0DB, m_isDuckBlocked ? 0.0f : 1000.0f * kDepth / m_decayRate);
+
+    if (!is_scheduled)  // automation detached; GetFadeStep follows m_gainAdjustment from the 0dB start
+        setGainCurrent(VOLUME_0DB);
 }
 
 bool DspVolumeDucker::isDuckBlocked() const
@@ -48,14 +85,40 @@ bool DspVolumeDucker::isDuckBlocked() const
 
 void DspVolumeDucker::setDuckBlocked(bool val)
 {
+    if (m_isDuckBlocked == val)
+        return;
+
     m_isDuckBlocked = val;
+    if (isAutomated() && m_gainAdjustment)
+    {
+        scheduleDuck();
+    }
+}
+
+//! Duck while any source of the sidechain carries voice, instead of following setGainAdjustment
+/*!
+ * The talk status flag is also raised by push to talk noise; the sidechain is keyed by the voice activity detectors
+ * of its sources only. Set it before the first process call; nullptr to go back to setGainAdjustment.
+ * \brief DspVolumeDucker::setSidechainKey
+ * \param key the sidechain the ducking sources publish to via DspVolume::setVoiceSidechain
+ */
+void DspVolumeDucker::setSidechainKey(std::shared_ptr<const VoiceSidechain> key)
+{
+    m_sidechain_key = std::move(key);
+}
+
+bool DspVolumeDucker::isDucking() const
+{
+    return m_sidechain_key ? m_sidechain_key->is_active() : m_gainAdjustment;
 }
 
 void DspVolumeDucker::setProcessing(bool val)
 {
-    if(true==val)
+    if (isAutomated())
+        setGainCurrent(VOLUME_0DB);
+    else if(true==val)
     {
-        if (true==getGainAdjustment())
+        if (true==isDucking())
             setGainCurrent(getGainDesired());
         else
             setGainCurrent(VOLUME_0DB);
@@ -68,19 +131,22 @@ void DspVolumeDucker::setProcessing(bool val)
 
 
 // virtual funcs
-float DspVolumeDucker::GetFadeStep(int sampleCount)
+float DspVolumeDucker::GetFadeStep(int frameCount)
 {
     // compute ducker gain
     float current_gain = getGainCurrent();
-    if (isDuckBlocked() || isMuted())
+    if (isAutomated())  // the ducker gain is the automation gain
+        current_gain = VOLUME_0DB;
+    else if (isDuckBlocked() || isMuted())
         current_gain = VOLUME_0DB;
     else
     {
         auto desired_gain = getGainDesired();
-        if ((m_gainAdjustment == true) && (current_gain != desired_gain))   // is attacking / adjusting
+        const auto kIsDucking = isDucking();
+        if ((kIsDucking == true) && (current_gain != desired_gain))   // is attacking / adjusting
         {
-            float fade_step_down = (m_attackRate / m_sampleRate) * sampleCount;
-            float fade_step_up = (m_decayRate / m_sampleRate) * sampleCount;
+            float fade_step_down = (m_attackRate / m_sampleRate) * frameCount;
+            float fade_step_up = (m_decayRate / m_sampleRate) * frameCount;
             if (current_gain < desired_gain - fade_step_up)
                 current_gain += fade_step_up;
             else if (current_gain > desired_gain + fade_step_down)
@@ -88,9 +154,9 @@ float DspVolumeDucker::GetFadeStep(int sampleCount)
             else
                 current_gain = desired_gain;
         }
-        else if ((m_gainAdjustment == false) && (current_gain != VOLUME_0DB))    // is releasing
+        else if ((kIsDucking == false) && (current_gain != VOLUME_0DB))    // is releasing
         {
-            float fade_step = (m_decayRate / m_sampleRate) * sampleCount;
+            float fade_step = (m_decayRate / m_sampleRate) * frameCount;
             if (current_gain < VOLUME_0DB - fade_step)
                 current_gain += fade_step;
             else if (current_gain > VOLUME_0DB + fade_step)
@@ -0,0 +1,437 @@
+#include "volume/echo_suppressor.h"
+
+#include <QtCore/qmath.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "volume/db.h"
+#include "volume/dsp_kernels.h"
+#include "volume/wav_file.h"
+
+namespace
+{
+    const int32_t kChunk = 256;     // frames read from the reference at once
+}
+
+// EchoReference
+
+const int32_t EchoReference::kSize;
+const int32_t EchoReference::kGuard;
+
+EchoReference::EchoReference()
+    : m_ring(kSize, 0.0f)
+{
+}
+
+//! Append the mixed playback; call from on_playback_master
+void EchoReference::push(const int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    if (channels <= 0)
+        return;
+
+    alignas(32) float buffer[kChunk];
+    auto head = m_head.load(std::memory_order_relaxed);
+    for (int32_t offset = 0; offset < frame_count; offset += kChunk)
+    {
+        const auto kCount = qMin(kChunk, frame_count - offset);
+        DspKernels::downmix(samples + offset * channels, buffer, kCount, channels);
+        for (int32_t i = 0; i < kCount; ++i)
+            m_ring[(head + i) & (kSize - 1)] = buffer[i];
+
+        head += kCount;
+    }
+    m_head.store(head, std::memory_order_release);
+}
+
+//! Copy samples by absolute position; samples not pushed yet or about to be overwritten read as silence
+void EchoReference::read(int64_t position, float* out, int32_t count) const
+{
+    const auto kHead = static_cast<int64_t>(head());
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const auto kPosition = position + i;
+        const auto kIsAvailable = (kPosition >= 0) && (kPosition < kHead) && (kPosition >= kHead - (kSize - kGuard));
+        out[i] = kIsAvailable ? m_ring[kPosition & (kSize - 1)] : 0.0f;
+    }
+}
+
+// EchoDelayEstimator
+
+const int32_t EchoDelayEstimator::kMaxLag;
+const int32_t EchoDelayEstimator::kWindow;
+
+EchoDelayEstimator::EchoDelayEstimator()
+    : m_reference(kWindow + kMaxLag, 0.0f)
+    , m_mic(kWindow, 0.0f)
+    , m_correlation(kMaxLag, 0.0)
+    , m_reference_energy(kMaxLag, 0.0)
+{
+}
+
+void EchoDelayEstimator::reset()
+{
+    std::fill(m_reference.begin(), m_reference.end(), 0.0f);
+    std::fill(m_mic.begin(), m_mic.end(), 0.0f);
+    std::fill(m_correlation.begin(), m_correlation.end(), 0.0);
+    std::fill(m_reference_energy.begin(), m_reference_energy.end(), 0.0);
+    m_mic_energy = 0.0;
+    m_reference_mean = 0.0f;
+    m_mic_mean = 0.0f;
+    m_block = 0;
+    m_lag = -1;
+    m_candidate = -1;
+}
+
+//! Level envelope with its slow mean removed, so only onsets and decays correlate
+float EchoDelayEstimator::envelope(float energy, float& mean)
+{
+    const auto kLevel = std::sqrt(energy);
+    mean += 0.02f * (kLevel - mean);
+    return kLevel - mean;
+}
+
+//! Add one block of both signals; lag n correlates the mic with the reference n blocks earlier
+void EchoDelayEstimator::update(float reference_energy, float mic_energy)
+{
+    const auto kReferenceSize = static_cast<int64_t>(m_reference.size());
+    const auto kR = envelope(reference_energy, m_reference_mean);
+    const auto kM = envelope(mic_energy, m_mic_mean);
+    const auto kOldM = m_mic[m_block % kWindow];
+    m_reference[m_block % kReferenceSize] = kR;
+    m_mic[m_block % kWindow] = kM;
+
+    for (int32_t lag = 0; lag < kMaxLag; ++lag)
+    {
+        const auto kNew = m_reference[(m_block - lag + kReferenceSize) % kReferenceSize];
+        const auto kOld = m_reference[(m_block - lag - kWindow + 2 * kReferenceSize) % kReferenceSize];
+        m_correlation[lag] += static_cast<double>(kM) * kNew - static_cast<double>(kOldM) * kOld;
+        m_reference_energy[lag] += static_cast<double>(kNew) * kNew - static_cast<double>(kOld) * kOld;
+    }
+    m_mic_energy += static_cast<double>(kM) * kM - static_cast<double>(kOldM) * kOldM;
+
+    if ((++m_block % kEvaluateInterval) == 0 && m_block >= kWindow)
+        evaluate();
+}
+
+//! Switch to the best lag once it won two evaluations in a row and the current one stopped correlating
+void EchoDelayEstimator::evaluate()
+{
+    auto best = -1;
+    auto best_correlation = static_cast<double>(kMinCorrelation);
+    auto is_current_valid = false;
+    for (int32_t lag = 0; lag < kMaxLag; ++lag)
+    {
+        const auto kNorm = m_reference_energy[lag] * m_mic_energy;
+        if (kNorm <= 1e-12)
+            continue;
+
+        const auto kCorrelation = m_correlation[lag] / std::sqrt(kNorm);
+        if (lag == m_lag)
+            is_current_valid = kCorrelation > kKeepCorrelation;
+
+        if (kCorrelation > best_correlation)
+        {
+            best_correlation = kCorrelation;
+            best = lag;
+        }
+    }
+    // near end talk may briefly correlate elsewhere; a lag that still explains the echo is kept
+    if ((best >= 0) && (best == m_candidate) && !is_current_valid)
+        m_lag = best;
+
+    m_candidate = best;
+}
+
+// EchoSuppressor
+
+const int32_t EchoSuppressor::kBlockSize;
+const int32_t EchoSuppressor::kPartitions;
+const int32_t EchoSuppressor::kFftSize;
+const int32_t EchoSuppressor::kBins;
+
+EchoSuppressor::EchoSuppressor(std::shared_ptr<const EchoReference> reference)
+    : m_reference(std::move(reference))
+    , m_fft(kFftSize)
+    , m_history(kPartitions, Spectrum(kBins))
+    , m_weights(kPartitions, Spectrum(kBins))
+    , m_acc(kBins)
+    , m_error(kBins)
+    , m_power(kBins, 0.0f)
+    , m_window(kFftSize, 0.0f)
+    , m_time(kFftSize, 0.0f)
+    , m_block_peaks(kPartitions, 0.0f)
+    , m_mic_block(kBlockSize, 0.0f)
+    , m_reference_block(kBlockSize, 0.0f)
+    , m_out_block(kBlockSize, 0.0f)
+    , m_read(2 * kChunk, 0.0f)
+{
+}
+
+void EchoSuppressor::setEnabled(bool val)
+{
+    m_enabled.store(val, std::memory_order_relaxed);
+}
+
+bool EchoSuppressor::isEnabled() const
+{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+void EchoSuppressor::setSuppression(float val)
+{
+    m_suppression.store(qMin(val, 0.0f), std::memory_order_relaxed);
+}
+
+float EchoSuppressor::getSuppression() const
+{
+    return m_suppression.load(std::memory_order_relaxed);
+}
+
+int32_t EchoSuppressor::getDelay() const
+{
+    return m_delay.load(std::memory_order_relaxed);
+}
+
+float EchoSuppressor::getErle() const
+{
+    return m_erle.load(std::memory_order_relaxed);
+}
+
+//! Start over: search the delay again and forget the echo path; audio thread
+void EchoSuppressor::reset()
+{
+    m_estimator.reset();
+    m_delay.store(-1, std::memory_order_relaxed);
+    restart_filter();
+    std::fill(m_mic_block.begin(), m_mic_block.end(), 0.0f);
+    std::fill(m_reference_block.begin(), m_reference_block.end(), 0.0f);
+    std::fill(m_out_block.begin(), m_out_block.end(), 0.0f);
+    m_fill = 0;
+    m_reference_energy = 0.0f;
+    m_mic_energy = 0.0f;
+}
+
+void EchoSuppressor::restart_filter()
+{
+    for (auto& spectrum : m_history)
+        std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+    for (auto& spectrum : m_weights)
+        std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+
+    std::fill(m_power.begin(), m_power.end(), 0.0f);
+    std::fill(m_window.begin(), m_window.end(), 0.0f);
+    std::fill(m_block_peaks.begin(), m_block_peaks.end(), 0.0f);
+    m_pos = 0;
+    m_constrain = 0;
+    m_double_talk = 0;
+    m_gain = 1.0f;
+    m_echo_energy = 0.0f;
+    m_error_energy = 0.0f;
+}
+
+//! Remove the echo of the playback from a captured frame
+/*!
+ * The frame is matched with the reference pushed up to the start of this callback; multi channel input is
+ * processed as its downmix, which is written to all channels.
+ * \param samples the captured frame
+ * \param frame_count number of frames
+ * \param channels number of channels
+ */
+void EchoSuppressor::process(int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    if (!isEnabled() || !m_reference || channels <= 0)
+        return;
+
+    const auto kStart = static_cast<int64_t>(m_reference->head()) - frame_count;
+    const auto kDelay = m_delay.load(std::memory_order_relaxed);
+    auto unaligned = m_read.data();
+    auto aligned = m_read.data() + kChunk;
+    alignas(32) float mic[kChunk];
+    for (int32_t offset = 0; offset < frame_count; offset += kChunk)
+    {
+        const auto kCount = qMin(kChunk, frame_count - offset);
+        m_reference->read(kStart + offset, unaligned, kCount);
+        m_reference->read(kStart + offset - qMax(kDelay, 0), aligned, kCount);
+        DspKernels::downmix(samples + offset * channels, mic, kCount, channels);
+
+        for (int32_t i = 0; i < kCount; ++i)
+        {
+            m_mic_block[m_fill] = mic[i];
+            m_reference_block[m_fill] = (kDelay >= 0) ? aligned[i] : 0.0f;
+            m_reference_energy += unaligned[i] * unaligned[i];
+            m_mic_energy += mic[i] * mic[i];
+            mic[i] = m_out_block[m_fill];
+            if (++m_fill == kBlockSize)
+            {
+                process_block();
+                m_fill = 0;
+            }
+        }
+
+        for (int32_t i = 0; i < kCount; ++i)
+        {
+            const auto kOut = static_cast<int16_t>(qBound(-32768, qRound(mic[i] * 32768.0f), 32767));
+            for (int32_t c = 0; c < channels; ++c)
+                samples[(offset + i) * channels + c] = kOut;
+        }
+    }
+}
+
+void EchoSuppressor::process_block()
+{
+    m_estimator.update(m_reference_energy, m_mic_energy);
+    m_reference_energy = 0.0f;
+    m_mic_energy = 0.0f;
+
+    const auto kLag = m_estimator.lag();
+    const auto kDelay = (kLag < 0) ? -1 : qMax(kLag - kDelayMargin, 0) * kBlockSize;
+    if (kDelay != m_delay.load(std::memory_order_relaxed))
+    {
+        m_delay.store(kDelay, std::memory_order_relaxed);
+        restart_filter();     // the reference of the next frame is aligned to the new delay
+    }
+
+    // reference spectrum and its power
+    memmove(m_window.data(), m_window.data() + kBlockSize, kBlockSize * sizeof(float));
+    memcpy(m_window.data() + kBlockSize, m_reference_block.data(), kBlockSize * sizeof(float));
+    m_fft.forward(m_window.data(), m_history[m_pos].data());
+    const auto& kX = m_history[m_pos];
+    for (int32_t k = 0; k < kBins; ++k)
+        m_power[k] += 0.2f * (std::norm(kX[k]) - m_power[k]);
+
+    float reference_peak = 0.0f;
+    float reference_energy = 0.0f;
+    for (auto val : m_reference_block)
+    {
+        reference_peak = qMax(reference_peak, std::fabs(val));
+        reference_energy += val * val;
+    }
+    m_block_peaks[m_pos] = reference_peak;
+
+    // echo estimate
+    std::fill(m_acc.begin(), m_acc.end(), std::complex<float>());
+    for (int32_t p = 0; p < kPartitions; ++p)
+    {
+        const auto& kHistory = m_history[(m_pos - p + kPartitions) % kPartitions];
+        DspKernels::complex_multiply_add(reinterpret_cast<const float*>(kHistory.data()),
+                                         reinterpret_cast<const float*>(m_weights[p].data()),
+                                         reinterpret_cast<float*>(m_acc.data()), kBins);
+    }
+    m_fft.inverse(m_acc.data(), m_time.data());
+
+    const auto kScale = 1.0f / kFftSize;
+    float mic_peak = 0.0f;
+    float echo_energy = 0.0f;
+    float error_energy = 0.0f;
+    for (int32_t i = 0; i < kBlockSize; ++i)
+    {
+        const auto kEcho = m_time[kBlockSize + i] * kScale;
+        const auto kError = m_mic_block[i] - kEcho;
+        mic_peak = qMax(mic_peak, std::fabs(m_mic_block[i]));
+        echo_energy += kEcho * kEcho;
+        error_energy += kError * kError;
+        m_out_block[i] = kError;
+    }
+
+    // double talk: the near end is louder than the far end could make it
+    float far_peak = 0.0f;
+    for (auto peak : m_block_peaks)
+        far_peak = qMax(far_peak, peak);
+
+    if (mic_peak > kGeigel * far_peak)
+        m_double_talk = kDoubleTalkHold;
+    else if (m_double_talk > 0)
+        --m_double_talk;
+
+    const auto kFarEndActive = reference_energy > 1e-6f * kBlockSize;
+    if ((m_double_talk == 0) && kFarEndActive)
+    {
+        // normalized gradient, applied to every partition
+        memset(m_time.data(), 0, kBlockSize * sizeof(float));
+        memcpy(m_time.data() + kBlockSize, m_out_block.data(), kBlockSize * sizeof(float));
+        m_fft.forward(m_time.data(), m_error.data());
+
+        const auto kRegularization = 1e-3f * kFftSize;
+        const auto kStep = kStepSize / kPartitions;
+        for (int32_t k = 0; k < kBins; ++k)
+            m_error[k] *= kStep / (m_power[k] + kRegularization);
+
+        for (int32_t p = 0; p < kPartitions; ++p)
+        {
+            const auto& kHistory = m_history[(m_pos - p + kPartitions) % kPartitions];
+            auto& weights = m_weights[p];
+            for (int32_t k = 0; k < kBins; ++k)
+                weights[k] += std::conj(kHistory[k]) * m_error[k];
+        }
+
+        // keep one partition a linear convolution per block
+        auto& weights = m_weights[m_constrain];
+        m_fft.inverse(weights.data(), m_time.data());
+        for (int32_t i = 0; i < kBlockSize; ++i)
+            m_time[i] *= kScale;
+        memset(m_time.data() + kBlockSize, 0, kBlockSize * sizeof(float));
+        m_fft.forward(m_time.data(), weights.data());
+        m_constrain = (m_constrain + 1) % kPartitions;
+    }
+    m_pos = (m_pos + 1) % kPartitions;
+
+    // residual suppression, faded over the block
+    m_echo_energy += 0.1f * (echo_energy - m_echo_energy);
+    m_error_energy += 0.1f * (error_energy - m_error_energy);
+    if (kFarEndActive && m_error_energy > 0.0f)
+        m_erle.store(10.0f * std::log10((m_echo_energy + m_error_energy) / m_error_energy), std::memory_order_relaxed);
+
+    auto target = 1.0f;
+    if (kFarEndActive && (m_double_talk == 0))
+    {
+        const auto kFloor = db2lin(m_suppression.load(std::memory_order_relaxed));
+        target = qBound(kFloor, error_energy / (error_energy + kOverSuppression * echo_energy + 1e-12f), 1.0f);
+    }
+    const auto kStart = m_gain;
+    m_gain = (target < m_gain) ? target : m_gain + 0.1f * (target - m_gain);
+    for (int32_t i = 0; i < kBlockSize; ++i)
+        m_out_block[i] *= kStart + (m_gain - kStart) * (i + 1) / kBlockSize;
+}
+
+//! Offline run over recordings, e.g. to tune or test the suppressor
+/*!
+ * Feeds the playback to the reference and the mic to the suppressor in 10 ms frames, as the client would.
+ * \param playback_path recorded playback (WAV, 16 bit, 48 kHz)
+ * \param mic_path recorded mic (WAV, 16 bit, 48 kHz), starting at the same time
+ * \param out_path the processed mic (WAV)
+ * \param error the reason when it failed
+ * \return true on success
+ */
+bool EchoSuppressor::ProcessFiles(const QString& playback_path, const QString& mic_path, const QString& out_path, QString* error)
+{
+    std::vector<int16_t> playback, mic;
+    WavFile::Format playback_format, mic_format;
+    if (!WavFile::Read(playback_path, playback, playback_format, error) || !WavFile::Read(mic_path, mic, mic_format, error))
+        return false;
+
+    if ((playback_format.sample_rate != 48000) || (mic_format.sample_rate != 48000))
+    {
+        if (error)
+            *error = QString("Echo suppression runs at 48 kHz");
+        return false;
+    }
+
+    auto reference = std::make_shared<EchoReference>();
+    EchoSuppressor suppressor(reference);
+    const int32_t kFrames = 480;
+    const auto kMicFrames = static_cast<int32_t>(mic.size() / mic_format.channels);
+    const auto kPlaybackFrames = static_cast<int32_t>(playback.size() / playback_format.channels);
+    std::vector<int16_t> silence(kFrames * playback_format.channels, 0);
+    for (int32_t frame = 0; frame < kMicFrames; frame += kFrames)
+    {
+        const auto kCount = qMin(kFrames, kMicFrames - frame);
+        if (frame + kCount <= kPlaybackFrames)
+            reference->push(playback.data() + frame * playback_format.channels, kCount, playback_format.channels);
+        else
+            reference->push(silence.data(), kCount, playback_format.channels);
+
+        suppressor.process(mic.data() + frame * mic_format.channels, kCount, mic_format.channels);
+    }
+    return WavFile::Write(out_path, mic.data(), kMicFrames, mic_format, error);
+}
@@ -0,0 +1,384 @@
+#include "volume/eq_bank.h"
+
+#include <QtCore/qmath.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "core/scratch_arena.h"
+
+const int32_t EqBank::kLanes;
+const int32_t EqBank::kSections;
+const int32_t EqBank::kMaxGroups;
+const int32_t EqBank::kMaxLanes;
+const int32_t EqBank::kFlatSet;
+const int32_t EqBank::kCoefficients;
+const int32_t EqBank::kGroupFloats;
+
+bool EqBank::Settings::operator==(const Settings& other) const
+{
+    return (highpass_hz == other.highpass_hz)
+            && (presence_db == other.presence_db)
+            && (presence_hz == other.presence_hz)
+            && (presence_q == other.presence_q);
+}
+
+uint qHash(const EqBank::Settings& key, uint seed)
+{
+    seed ^= qHash(key.highpass_hz) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.presence_db) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.presence_hz) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    seed ^= qHash(key.presence_q) + 0x9e3779b9u + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+EqBank::EqBank(QObject* parent, int32_t sample_rate)
+    : QObject(parent)
+    , m_sample_rate(sample_rate)
+    , m_lane_info(kMaxLanes)
+    , m_lane_used(kMaxLanes, false)
+    , m_set_refs(kMaxLanes + 1, 0)
+    , m_sets(kMaxLanes + 1)
+    , m_lane_sets(kMaxLanes)
+    , m_lane_epochs(kMaxLanes)
+    , m_groups(kMaxGroups)
+    , m_storage(kMaxGroups * kGroupFloats + 8, 0.0f)
+{
+    this->setObjectName("EqBank");
+
+    const auto kAddress = reinterpret_cast<uintptr_t>(m_storage.data());
+    m_soa = m_storage.data() + ((32 - (kAddress & 31)) & 31) / sizeof(float);
+
+    float values[kCoefficients];
+    compute(Settings(), values);
+    for (auto& set : m_sets)
+    {
+        for (int32_t i = 0; i < kCoefficients; ++i)
+            set.values[i].store(values[i], std::memory_order_relaxed);
+    }
+    for (int32_t lane = 0; lane < kMaxLanes; ++lane)
+    {
+        m_lane_sets[lane].store(-1, std::memory_order_relaxed);
+        m_lane_epochs[lane].store(0, std::memory_order_relaxed);
+    }
+    for (int32_t group = 0; group < kMaxGroups; ++group)
+    {
+        auto& worker_group = m_groups[group];
+        worker_group.sets.fill(-1);
+        worker_group.versions.fill(0);
+        worker_group.epochs.fill(0);
+    }
+}
+
+//! Give a talker a lane; called by DspPipeline::AddSlot
+/*!
+ * \return the lane, its group is lane / kLanes; -1 when all kMaxLanes are in use
+ */
+int32_t EqBank::AddLane(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    const auto kExisting = m_lanes.value(kKey, -1);
+    if (kExisting >= 0)
+        return kExisting;
+
+    int32_t lane = 0;
+    while (lane < kMaxLanes && m_lane_used[lane])
+        ++lane;
+
+    if (lane == kMaxLanes)
+        return -1;
+
+    m_lane_used[lane] = true;
+    m_lanes.insert(kKey, lane);
+    auto& info = m_lane_info[lane];
+    info = Lane();
+    info.client = kKey;
+    m_lane_epochs[lane].fetch_add(1, std::memory_order_release);
+    assign(lane, m_default);
+    return lane;
+}
+
+void EqBank::RemoveLane(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    const auto kLane = m_lanes.take(qMakePair(serverConnectionHandlerID, clientID));
+    if (!m_lane_used[kLane] || m_lane_info[kLane].client != qMakePair(serverConnectionHandlerID, clientID))
+        return;
+
+    m_lane_sets[kLane].store(-1, std::memory_order_release);
+    release_set(m_lane_info[kLane].set);
+    m_lane_info[kLane] = Lane();
+    m_lane_used[kLane] = false;
+}
+
+void EqBank::RemoveLanes(uint64 serverConnectionHandlerID)
+{
+    const auto kKeys = m_lanes.keys();
+    for (const auto& key : kKeys)
+    {
+        if (key.first == serverConnectionHandlerID)
+            RemoveLane(key.first, key.second);
+    }
+}
+
+void EqBank::RemoveLanes()
+{
+    const auto kKeys = m_lanes.keys();
+    for (const auto& key : kKeys)
+        RemoveLane(key.first, key.second);
+}
+
+//! Settings of every talker that has none of its own, e.g. a rumble filter for everyone
+void EqBank::setDefaultSettings(const Settings& settings)
+{
+    if (settings == m_default)
+        return;
+
+    m_default = settings;
+    for (int32_t lane = 0; lane < kMaxLanes; ++lane)
+    {
+        if (m_lane_used[lane] && !m_lane_info[lane].has_settings)
+            assign(lane, m_default);
+    }
+}
+
+EqBank::Settings EqBank::getDefaultSettings() const
+{
+    return m_default;
+}
+
+//! Settings of one talker; ignored when the talker has no lane
+void EqBank::setSettings(uint64 serverConnectionHandlerID, anyID clientID, const Settings& settings)
+{
+    const auto kLane = m_lanes.value(qMakePair(serverConnectionHandlerID, clientID), -1);
+    if (kLane < 0)
+        return;
+
+    auto& info = m_lane_info[kLane];
+    info.has_settings = true;
+    info.settings = settings;
+    assign(kLane, settings);
+}
+
+//! Back to the default settings
+void EqBank::clearSettings(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    const auto kLane = m_lanes.value(qMakePair(serverConnectionHandlerID, clientID), -1);
+    if (kLane < 0)
+        return;
+
+    m_lane_info[kLane].has_settings = false;
+    assign(kLane, m_default);
+}
+
+EqBank::Settings EqBank::getSettings(uint64 serverConnectionHandlerID, anyID clientID) const
+{
+    const auto kLane = m_lanes.value(qMakePair(serverConnectionHandlerID, clientID), -1);
+    if (kLane < 0 || !m_lane_info[kLane].has_settings)
+        return m_default;
+
+    return m_lane_info[kLane].settings;
+}
+
+int32_t EqBank::getCoefficientSetCount() const
+{
+    return m_set_index.size();
+}
+
+void EqBank::assign(int32_t lane, const Settings& settings)
+{
+    auto& info = m_lane_info[lane];
+    const auto kSet = acquire_set(settings);
+    m_lane_sets[lane].store(kSet, std::memory_order_release);
+    release_set(info.set);
+    info.set = kSet;
+}
+
+//! The set for the settings; computed only when no lane uses these settings yet
+int32_t EqBank::acquire_set(const Settings& settings)
+{
+    if (settings == Settings())
+        return kFlatSet;
+
+    auto set = m_set_index.value(settings, -1);
+    if (set < 0)
+    {
+        set = kFlatSet + 1;
+        while (m_set_refs[set] > 0)
+            ++set;
+
+        float values[kCoefficients];
+        compute(settings, values);
+
+        auto& target = m_sets[set];
+        const auto kVersion = target.version.load(std::memory_order_relaxed);
+        target.version.store(kVersion + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int32_t i = 0; i < kCoefficients; ++i)
+            target.values[i].store(values[i], std::memory_order_relaxed);
+
+        target.version.store(kVersion + 2, std::memory_order_release);
+        m_set_index.insert(settings, set);
+    }
+    ++m_set_refs[set];
+    return set;
+}
+
+void EqBank::release_set(int32_t set)
+{
+    if (set == kFlatSet)
+        return;
+
+    if (--m_set_refs[set] == 0)
+        m_set_index.remove(m_set_index.key(set));
+}
+
+//! Biquad coefficients (Audio EQ Cookbook): a Butterworth high-pass, then a peaking filter
+void EqBank::compute(const Settings& settings, float* values) const
+{
+    const auto kPi = 3.14159265358979323846;
+    const auto kMaxHz = 0.45 * m_sample_rate;
+    auto section = values;
+    auto set_section = [&section](double b0, double b1, double b2, double a0, double a1, double a2)
+    {
+        section[0] = static_cast<float>(b0 / a0);
+        section[1] = static_cast<float>(b1 / a0);
+        section[2] = static_cast<float>(b2 / a0);
+        section[3] = static_cast<float>(a1 / a0);
+        section[4] = static_cast<float>(a2 / a0);
+        section += 5;
+    };
+
+    if (settings.highpass_hz > 0.0f)
+    {
+        const auto kW0 = 2.0 * kPi * qMin(static_cast<double>(settings.highpass_hz), kMaxHz) / m_sample_rate;
+        const auto kCos = std::cos(kW0);
+        const auto kAlpha = std::sin(kW0) / (2.0 * M_SQRT1_2);
+        set_section((1.0 + kCos) / 2.0, -(1.0 + kCos), (1.0 + kCos) / 2.0, 1.0 + kAlpha, -2.0 * kCos, 1.0 - kAlpha);
+    }
+    else
+        set_section(1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+
+    if ((settings.presence_db != 0.0f) && (settings.presence_hz > 0.0f) && (settings.presence_q > 0.0f))
+    {
+        const auto kA = std::pow(10.0, settings.presence_db / 40.0);
+        const auto kW0 = 2.0 * kPi * qMin(static_cast<double>(settings.presence_hz), kMaxHz) / m_sample_rate;
+        const auto kCos = std::cos(kW0);
+        const auto kAlpha = std::sin(kW0) / (2.0 * settings.presence_q);
+        set_section(1.0 + kAlpha * kA, -2.0 * kCos, 1.0 - kAlpha * kA, 1.0 + kAlpha / kA, -2.0 * kCos, 1.0 - kAlpha / kA);
+    }
+    else
+        set_section(1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+}
+
+// worker threads
+
+bool EqBank::try_lock_group(int32_t group)
+{
+    return !m_groups[group].busy.test_and_set(std::memory_order_acquire);
+}
+
+void EqBank::unlock_group(int32_t group)
+{
+    m_groups[group].busy.clear(std::memory_order_release);
+}
+
+//! Filter one frame of every talker of a group in one pass; the group must be locked
+/*!
+ * \param group the group
+ * \param planes kLanes mono planes, nullptr for a lane without a frame; its filter state is kept
+ * \param frame_count number of frames of every plane
+ */
+void EqBank::process(int32_t group, float* const* planes, int32_t frame_count)
+{
+    auto& worker_group = m_groups[group];
+    auto soa_coefficients = coefficients(group);
+    auto soa_state = state(group);
+    auto clear_state = [soa_state](int32_t lane)
+    {
+        for (int32_t i = 0; i < kSections * 2; ++i)
+            soa_state[i * kLanes + lane] = 0.0f;
+    };
+
+    bool is_flat = true;
+    for (int32_t lane = 0; lane < kLanes; ++lane)
+    {
+        if (!planes[lane])
+            continue;
+
+        const auto kIndex = group * kLanes + lane;
+        const auto kEpoch = m_lane_epochs[kIndex].load(std::memory_order_acquire);
+        if (kEpoch != worker_group.epochs[lane])
+        {
+            clear_state(lane);
+            worker_group.epochs[lane] = kEpoch;
+            worker_group.sets[lane] = -1;
+        }
+
+        auto set = m_lane_sets[kIndex].load(std::memory_order_acquire);
+        set = (set < 0) ? kFlatSet : set;
+        const auto& kSource = m_sets[set];
+        const auto kVersion = kSource.version.load(std::memory_order_acquire);
+        if ((set != worker_group.sets[lane] || kVersion != worker_group.versions[lane]) && !(kVersion & 1u))
+        {
+            float values[kCoefficients];
+            for (int32_t i = 0; i < kCoefficients; ++i)
+                values[i] = kSource.values[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (kSource.version.load(std::memory_order_relaxed) == kVersion)  // else torn; retry next frame
+            {
+                for (int32_t i = 0; i < kCoefficients; ++i)
+                    soa_coefficients[i * kLanes + lane] = values[i];
+
+                if (set == kFlatSet)
+                    clear_state(lane);
+
+                worker_group.sets[lane] = set;
+                worker_group.versions[lane] = kVersion;
+            }
+        }
+        is_flat = is_flat && (worker_group.sets[lane] == kFlatSet);
+    }
+    if (is_flat)
+        return;
+
+    auto& arena = ScratchArena::local();
+    auto data = arena.allocate_array<float>(frame_count * kLanes);
+    if (!data)
+        return;
+
+    float idle_state[kSections * 2][kLanes];
+    for (int32_t lane = 0; lane < kLanes; ++lane)
+    {
+        if (planes[lane])
+        {
+            const auto kPlane = planes[lane];
+            for (int32_t i = 0; i < frame_count; ++i)
+                data[i * kLanes + lane] = kPlane[i];
+        }
+        else
+        {
+            for (int32_t i = 0; i < frame_count; ++i)
+                data[i * kLanes + lane] = 0.0f;
+            for (int32_t i = 0; i < kSections * 2; ++i)
+                idle_state[i][lane] = soa_state[i * kLanes + lane];
+        }
+    }
+
+    DspKernels::biquad_lanes(soa_coefficients, soa_state, data, frame_count, kSections);
+
+    for (int32_t lane = 0; lane < kLanes; ++lane)
+    {
+        if (planes[lane])
+        {
+            auto plane = planes[lane];
+            for (int32_t i = 0; i < frame_count; ++i)
+                plane[i] = data[i * kLanes + lane];
+        }
+        else
+        {
+            for (int32_t i = 0; i < kSections * 2; ++i)
+                soa_state[i * kLanes + lane] = idle_state[i][lane];
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#include "volume/fft.h"
+
+#include <cmath>
+#include <utility>
+
+namespace {
+    const double kPi = 3.14159265358979323846;
+}
+
+RealFft::RealFft(int32_t size)
+    : m_size(size)
+{
+    const auto kHalf = m_size / 2;
+    int32_t bits = 0;
+    while ((1 << bits) < kHalf)
+        ++bits;
+
+    m_bitrev.resize(kHalf);
+    for (int32_t i = 0; i < kHalf; ++i)
+    {
+        int32_t rev = 0;
+        for (int32_t b = 0; b < bits; ++b)
+            rev |= ((i >> b) & 1) << (bits - 1 - b);
+
+        m_bitrev[i] = rev;
+    }
+
+    m_twiddles.resize(kHalf / 2);
+    for (int32_t i = 0; i < kHalf / 2; ++i)
+        m_twiddles[i] = std::polar(1.0f, static_cast<float>(-2.0 * kPi * i / kHalf));
+
+    m_split.resize(kHalf);
+    for (int32_t i = 0; i < kHalf; ++i)
+        m_split[i] = std::polar(1.0f, static_cast<float>(-2.0 * kPi * i / m_size));
+
+    m_work.resize(kHalf);
+}
+
+//! In-place complex transform of size/2 points
+void RealFft::transform(std::complex<float>* data)
+{
+    const auto kHalf = m_size / 2;
+    for (int32_t i = 0; i < kHalf; ++i)
+    {
+        const auto kRev = m_bitrev[i];
+        if (kRev > i)
+            std::swap(data[i], data[kRev]);
+    }
+
+    for (int32_t len = 2; len <= kHalf; len <<= 1)
+    {
+        const auto kStep = kHalf / len;
+        const auto kSpan = len / 2;
+        for (int32_t start = 0; start < kHalf; start += len)
+        {
+            for (int32_t j = 0; j < kSpan; ++j)
+            {
+                const auto kOdd = data[start + j + kSpan] * m_twiddles[j * kStep];
+                const auto kEven = data[start + j];
+                data[start + j] = kEven + kOdd;
+                data[start + j + kSpan] = kEven - kOdd;
+            }
+        }
+    }
+}
+
+//! Packs the real input into a half size complex transform and splits the result
+void RealFft::forward(const float* in, std::complex<float>* out)
+{
+    const auto kHalf = m_size / 2;
+    for (int32_t i = 0; i < kHalf; ++i)
+        m_work[i] = std::complex<float>(in[2 * i], in[2 * i + 1]);
+
+    transform(m_work.data());
+
+    out[0] = std::complex<float>(m_work[0].real() + m_work[0].imag(), 0.0f);
+    out[kHalf] = std::complex<float>(m_work[0].real() - m_work[0].imag(), 0.0f);
+    for (int32_t k = 1; k < kHalf; ++k)
+    {
+        const auto kZ = m_work[k];
+        const auto kZc = std::conj(m_work[kHalf - k]);
+        const auto kEven = (kZ + kZc) * 0.5f;
+        const auto kOdd = (kZ - kZc) * std::complex<float>(0.0f, -0.5f);
+        out[k] = kEven + m_split[k] * kOdd;
+    }
+}
+
+//! Merges the bins back into a half size complex transform; the conjugated forward transform inverts it
+void RealFft::inverse(const std::complex<float>* in, float* out)
+{
+    const auto kHalf = m_size / 2;
+    for (int32_t k = 0; k < kHalf; ++k)
+    {
+        const auto kX = in[k];
+        const auto kXc = std::conj(in[kHalf - k]);
+        const auto kEven = kX + kXc;
+        const auto kOdd = (kX - kXc) * std::conj(m_split[k]);
+        m_work[k] = std::conj(kEven + std::complex<float>(0.0f, 1.0f) * kOdd);
+    }
+
+    transform(m_work.data());
+
+    for (int32_t i = 0; i < kHalf; ++i)
+    {
+        out[2 * i] = m_work[i].real();
+        out[2 * i + 1] = -m_work[i].imag();
+    }
+}
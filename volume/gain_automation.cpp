@@ -0,0 +1,224 @@
+#include "volume/gain_automation.h"
+
+#include <QtCore/qmath.h>
+
+#include <chrono>
+#include <cstring>
+
+const int32_t GainAutomation::kCapacity;
+const int32_t GainAutomation::kRampChunk;
+const uint32_t GainAutomation::kPendingGain;
+const uint32_t GainAutomation::kPendingMute;
+
+GainAutomation::GainAutomation(int32_t sample_rate)
+    : m_sample_rate(sample_rate)
+{
+}
+
+int64_t GainAutomation::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Queue an event; call from a single thread, e.g. the client lib event handlers
+/*!
+ * When the queue is full, the event is merged into the latest gain / mute state instead of being dropped;
+ * that state takes effect after the queued events, at the start of a block rather than at the event time.
+ * \brief GainAutomation::schedule
+ * \param event events have to come in time order; an earlier one lands where its predecessor did
+ * \return false when the event was merged
+ */
+bool GainAutomation::schedule(const Event& event)
+{
+    if ((m_pending.load(std::memory_order_acquire) == 0) && m_events.push(event))
+        return true;
+
+    if (event.type == Type::GAIN)
+    {
+        m_pending_gain.store(pack(event.gain_db, event.ramp_ms), std::memory_order_relaxed);
+        m_pending.fetch_or(kPendingGain, std::memory_order_release);
+    }
+    else
+    {
+        m_pending_mute.store(pack((event.type == Type::MUTE) ? 1.0f : 0.0f, event.ramp_ms), std::memory_order_relaxed);
+        m_pending.fetch_or(kPendingMute, std::memory_order_release);
+    }
+    return false;
+}
+
+//! Advance the block clock; call once per block before next_segment
+/*!
+ * The block is taken to end at the callback, so an event lands one block after it happened, every time.
+ * The clock runs on the sample count and is pulled slowly towards the callback times, so their jitter
+ * does not move the events around.
+ */
+void GainAutomation::begin_block(int32_t frame_count)
+{
+    const auto kNow = static_cast<double>(now());
+    const auto kDuration = frame_count * 1000000.0 / m_sample_rate;
+    const auto kPredicted = m_block_end + kDuration;
+    if (!m_is_anchored || qAbs(kNow - kPredicted) > kMaxDrift)
+    {
+        m_is_anchored = true;
+        m_block_end = kNow;
+    }
+    else
+        m_block_end = kPredicted + kLockRate * (kNow - kPredicted);
+
+    m_block_start = m_block_end - kDuration;
+}
+
+bool GainAutomation::is_idle() const
+{
+    return (m_gain.left == 0) && (m_gain.value == 0.0f) && (m_mute.left == 0) && !m_muted && (m_mute.value == 0.0f)
+            && m_events.empty() && (m_pending.load(std::memory_order_relaxed) == 0);
+}
+
+//! The next run of frames with a single gain
+/*!
+ * Applies the events due at the position; the run ends at the next event, after a ramp step or at the block end.
+ * \brief GainAutomation::next_segment
+ * \param position frame offset into the block
+ * \param frame_count frames of the block
+ * \param gain_db the automation gain of the run; <= -200: muted
+ * \return number of frames of the run
+ */
+int32_t GainAutomation::next_segment(int32_t position, int32_t frame_count, float& gain_db)
+{
+    auto event = m_events.front();
+    for (;;)
+    {
+        for (; event && (offset_of(event->time_us) <= position); event = m_events.front())
+        {
+            apply(*event);
+            m_events.pop();
+        }
+        if (event || !m_pending.load(std::memory_order_relaxed))
+            break;
+
+        // drained; the merged state follows, then whatever was queued meanwhile
+        apply_pending();
+        event = m_events.front();
+    }
+
+    auto end = frame_count;
+    if (event)
+        end = qMin(end, offset_of(event->time_us));
+    if (m_gain.left > 0)
+        end = qMin(end, position + qMin(kRampChunk, m_gain.left));
+    if (m_mute.left > 0)
+        end = qMin(end, position + qMin(kRampChunk, m_mute.left));
+
+    const auto kCount = qMax(1, end - position);
+    // the ramps are sampled in the middle of the run
+    const auto kHalf = 0.5f * kCount;
+    const auto kGain = m_gain.value + ((m_gain.left > 0) ? m_gain.step * qMin(kHalf, static_cast<float>(m_gain.left)) : 0.0f);
+    const auto kMute = m_mute.value + ((m_mute.left > 0) ? m_mute.step * qMin(kHalf, static_cast<float>(m_mute.left)) : 0.0f);
+    gain_db = m_muted ? kMuted : kGain + kMute;
+
+    m_gain.advance(kCount);
+    m_mute.advance(kCount);
+    if ((m_mute.left == 0) && (m_mute.target <= kMuteFloor))
+        m_muted = true;
+
+    return kCount;
+}
+
+//! Consume a block without samples, e.g. digital silence
+void GainAutomation::skip(int32_t frame_count)
+{
+    float gain_db;
+    for (int32_t position = 0; position < frame_count;)
+        position += next_segment(position, frame_count, gain_db);
+}
+
+int32_t GainAutomation::offset_of(int64_t time_us) const
+{
+    const auto kOffset = (time_us - m_block_start) * m_sample_rate / 1000000.0;
+    return (kOffset <= 0.0) ? 0 : ((kOffset >= 1e9) ? 1000000000 : static_cast<int32_t>(kOffset + 0.5));
+}
+
+void GainAutomation::apply(const Event& event)
+{
+    const auto kFrames = qMax(0, qRound(event.ramp_ms * 0.001f * m_sample_rate));
+    switch (event.type)
+    {
+    case Type::GAIN:
+        m_gain.start(event.gain_db, kFrames);
+        break;
+    case Type::MUTE:
+        m_mute.start(kMuteFloor, kFrames);
+        m_muted = (kFrames == 0);
+        break;
+    case Type::UNMUTE:
+        m_muted = false;
+        m_mute.start(0.0f, kFrames);
+        break;
+    }
+}
+
+//! Apply the merged state of the events that did not fit into the queue
+void GainAutomation::apply_pending()
+{
+    const auto kPending = m_pending.exchange(0, std::memory_order_acquire);
+    Event event;
+    if (kPending & kPendingGain)
+    {
+        event.type = Type::GAIN;
+        unpack(m_pending_gain.load(std::memory_order_relaxed), event.gain_db, event.ramp_ms);
+        apply(event);
+    }
+    if (kPending & kPendingMute)
+    {
+        float muted;
+        unpack(m_pending_mute.load(std::memory_order_relaxed), muted, event.ramp_ms);
+        event.type = (muted != 0.0f) ? Type::MUTE : Type::UNMUTE;
+        apply(event);
+    }
+}
+
+uint64_t GainAutomation::pack(float first, float second)
+{
+    uint32_t first_bits, second_bits;
+    memcpy(&first_bits, &first, sizeof(first_bits));
+    memcpy(&second_bits, &second, sizeof(second_bits));
+    return (static_cast<uint64_t>(first_bits) << 32) | second_bits;
+}
+
+void GainAutomation::unpack(uint64_t packed, float& first, float& second)
+{
+    const auto kFirst = static_cast<uint32_t>(packed >> 32);
+    const auto kSecond = static_cast<uint32_t>(packed);
+    memcpy(&first, &kFirst, sizeof(first));
+    memcpy(&second, &kSecond, sizeof(second));
+}
+
+void GainAutomation::Ramp::start(float to, int32_t frames)
+{
+    target = to;
+    left = frames;
+    if (frames == 0)
+    {
+        value = to;
+        step = 0.0f;
+    }
+    else
+        step = (to - value) / frames;
+}
+
+void GainAutomation::Ramp::advance(int32_t frames)
+{
+    if (left == 0)
+        return;
+
+    if (frames >= left)
+    {
+        value = target;
+        left = 0;
+    }
+    else
+    {
+        value += step * frames;
+        left -= frames;
+    }
+}
@@ -0,0 +1,431 @@
+#include "volume/hrtf_renderer.h"
+
+#include <QtCore/qmath.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "teamspeak/clientlib_publicdefinitions.h"
+
+#include "core/ts_logging_qt.h"
+#include "volume/dsp_helpers.h"
+#include "volume/dsp_kernels.h"
+
+// HrtfConvolver
+
+const int32_t HrtfConvolver::kBlockSize;
+const int32_t HrtfConvolver::kMaxTaps;
+const int32_t HrtfConvolver::kMaxPartitions;
+const int32_t HrtfConvolver::kFftSize;
+const int32_t HrtfConvolver::kBins;
+
+HrtfConvolver::HrtfConvolver()
+    : m_fft(kFftSize)
+    , m_history(kMaxPartitions, Spectrum(kBins))
+    , m_acc(kBins)
+    , m_window(kFftSize, 0.0f)
+    , m_time(kFftSize)
+    , m_faded(kBlockSize)
+    , m_input(kBlockSize, 0.0f)
+{
+    for (auto& filter : m_filters)
+        for (auto& ear : filter)
+            ear.assign(kMaxPartitions, Spectrum(kBins));
+
+    for (auto& output : m_output)
+        output.assign(kBlockSize, 0.0f);
+
+    for (auto& taps : m_taps)
+        taps.assign(kMaxTaps, 0.0f);
+}
+
+//! Forget the signal history, e.g. when the slot is taken by another talker
+void HrtfConvolver::reset()
+{
+    for (auto& spectrum : m_history)
+        std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+
+    std::fill(m_window.begin(), m_window.end(), 0.0f);
+    std::fill(m_input.begin(), m_input.end(), 0.0f);
+    for (auto& output : m_output)
+        std::fill(output.begin(), output.end(), 0.0f);
+
+    m_fill = 0;
+    m_fade = false;
+}
+
+//! Interpolate the HRIRs of a direction and transform their partitions; the next block fades over to them
+/*!
+ * \param set the HRTF set; its sample rate must match the stream
+ * \param azimuth degrees clockwise from the front
+ * \param elevation degrees
+ * \param taps the HRIR length to use, at most kMaxTaps
+ */
+void HrtfConvolver::set_filter(const HrtfSet& set, float azimuth, float elevation, int32_t taps)
+{
+    taps = qMin(qMin(taps, kMaxTaps), set.ir_length());
+    std::fill(m_taps[0].begin(), m_taps[0].end(), 0.0f);
+    std::fill(m_taps[1].begin(), m_taps[1].end(), 0.0f);
+    set.interpolate(azimuth, elevation, taps, m_taps[0].data(), m_taps[1].data());
+
+    const auto kPartitions = (taps + kBlockSize - 1) / kBlockSize;
+    const auto kNext = m_partitions ? (1 - m_current) : m_current;
+    for (int32_t ear = 0; ear < 2; ++ear)
+    {
+        for (int32_t p = 0; p < kPartitions; ++p)
+        {
+            std::fill(m_time.begin(), m_time.end(), 0.0f);
+            memcpy(m_time.data(), m_taps[ear].data() + p * kBlockSize, kBlockSize * sizeof(float));
+            m_fft.forward(m_time.data(), m_filters[kNext][ear][p].data());
+        }
+    }
+    m_fade = (m_partitions != 0) && (kPartitions == m_partitions);
+    m_current = kNext;
+    m_partitions = kPartitions;
+}
+
+//! Convolve a mono int16 stream into two int16 streams; in place when in aliases left or right
+/*!
+ * \param in the talker
+ * \param left output of the left ear
+ * \param right output of the right ear
+ * \param frame_count number of frames
+ * \param stride distance between the frames, the channel count of an interleaved buffer
+ */
+void HrtfConvolver::process(const int16_t* in, int16_t* left, int16_t* right, int32_t frame_count, int32_t stride)
+{
+    for (int32_t i = 0; i < frame_count;)
+    {
+        // up to the block boundary; read before write, so aliased frames still see their input
+        const auto kCount = qMin(frame_count - i, kBlockSize - m_fill);
+        float* input = m_input.data() + m_fill;
+        const float* output_left = m_output[0].data() + m_fill;
+        const float* output_right = m_output[1].data() + m_fill;
+        DspKernels::gather(in + i * stride, &input, kCount, stride, 1u);
+        DspKernels::scatter(&output_left, left + i * stride, kCount, stride, 1u);
+        DspKernels::scatter(&output_right, right + i * stride, kCount, stride, 1u);
+        i += kCount;
+        m_fill += kCount;
+        if (m_fill == kBlockSize)
+        {
+            process_block();
+            m_fill = 0;
+        }
+    }
+}
+
+void HrtfConvolver::process_block()
+{
+    memmove(m_window.data(), m_window.data() + kBlockSize, kBlockSize * sizeof(float));
+    memcpy(m_window.data() + kBlockSize, m_input.data(), kBlockSize * sizeof(float));
+    m_history_pos = (m_history_pos + 1) % kMaxPartitions;
+    m_fft.forward(m_window.data(), m_history[m_history_pos].data());
+
+    for (int32_t ear = 0; ear < 2; ++ear)
+    {
+        auto& output = m_output[ear];
+        if (!m_partitions)
+        {
+            std::fill(output.begin(), output.end(), 0.0f);
+            continue;
+        }
+
+        convolve(m_current, ear, output.data());
+        if (m_fade)
+        {
+            convolve(1 - m_current, ear, m_faded.data());
+            for (int32_t i = 0; i < kBlockSize; ++i)
+            {
+                const auto kWeight = (i + 0.5f) / kBlockSize;
+                output[i] = m_faded[i] + kWeight * (output[i] - m_faded[i]);
+            }
+        }
+    }
+    m_fade = false;
+}
+
+//! Sum of the input spectra times the filter partitions, back to the time domain; overlap-save keeps the second half
+void HrtfConvolver::convolve(int32_t filter, int32_t ear, float* out)
+{
+    std::fill(m_acc.begin(), m_acc.end(), std::complex<float>());
+    for (int32_t p = 0; p < m_partitions; ++p)
+    {
+        const auto& kInput = m_history[(m_history_pos - p + kMaxPartitions) % kMaxPartitions];
+        DspKernels::complex_multiply_add(reinterpret_cast<const float*>(kInput.data()),
+                                         reinterpret_cast<const float*>(m_filters[filter][ear][p].data()),
+                                         reinterpret_cast<float*>(m_acc.data()), kBins);
+    }
+    m_fft.inverse(m_acc.data(), m_time.data());
+    memcpy(out, m_time.data() + kBlockSize, kBlockSize * sizeof(float));
+    DspKernels::scale(out, kBlockSize, 1.0f / kFftSize);
+}
+
+// HrtfRenderer
+
+const int32_t HrtfRenderer::kMaxSources;
+
+namespace
+{
+    const int32_t kQualityTaps[] = { 64, 128, 256 };
+
+    inline TS3_VECTOR sub(const TS3_VECTOR& a, const TS3_VECTOR& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    inline float dot(const TS3_VECTOR& a, const TS3_VECTOR& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    inline TS3_VECTOR cross(const TS3_VECTOR& a, const TS3_VECTOR& b)
+    {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+    inline TS3_VECTOR normalized(const TS3_VECTOR& a)
+    {
+        const auto kLength = std::sqrt(dot(a, a));
+        return (kLength > 0.0f) ? TS3_VECTOR{a.x / kLength, a.y / kLength, a.z / kLength} : a;
+    }
+
+    // whole degrees, azimuth 0..359 in the low half
+    inline uint32_t pack_direction(int32_t azimuth, int32_t elevation)
+    {
+        return static_cast<uint32_t>(azimuth) | (static_cast<uint32_t>(elevation + 90) << 16);
+    }
+}
+
+HrtfRenderer::HrtfRenderer(QObject* parent)
+    : QObject(parent)
+    , m_taps(kQualityTaps[static_cast<int>(Quality::MEDIUM)])
+{
+    this->setObjectName("HrtfRenderer");
+}
+
+//! Load the HRTF set to render with; shared with other renderers using the same file
+/*!
+ * \brief HrtfRenderer::setHrtfSet
+ * \param path the HRIR set file, see HrtfSet; sampled at 48 kHz
+ * \return false if it could not be loaded; the previous set stays in use
+ */
+bool HrtfRenderer::setHrtfSet(const QString& path)
+{
+    QString error;
+    auto set = HrtfSet::Load(path, &error);
+    if (!set)
+    {
+        TSLogging::Error(QString("%1: %2").arg(this->objectName()).arg(error));
+        return false;
+    }
+    if (set->sample_rate() != 48000)
+    {
+        TSLogging::Error(QString("%1: %2 is not sampled at 48 kHz").arg(this->objectName()).arg(path));
+        return false;
+    }
+
+    std::atomic_store(&m_set, set);
+    return true;
+}
+
+//! Trade HRIR length for CPU; the cost per talker is linear in the partition count
+void HrtfRenderer::setQuality(Quality val)
+{
+    m_taps.store(kQualityTaps[static_cast<int>(val)], std::memory_order_relaxed);
+}
+
+HrtfRenderer::Quality HrtfRenderer::getQuality() const
+{
+    const auto kTaps = m_taps.load(std::memory_order_relaxed);
+    return (kTaps <= kQualityTaps[0]) ? Quality::LOW : ((kTaps <= kQualityTaps[1]) ? Quality::MEDIUM : Quality::HIGH);
+}
+
+//! Own position and orientation; left handed like the client lib 3D API
+void HrtfRenderer::setListenerAttributes(uint64 serverConnectionHandlerID, const TS3_VECTOR* position, const TS3_VECTOR* forward, const TS3_VECTOR* up)
+{
+    auto& listener = m_listeners[serverConnectionHandlerID];
+    if (position)
+        listener.position = *position;
+    if (forward)
+        listener.forward = *forward;
+    if (up)
+        listener.up = *up;
+
+    for (auto it = m_positions.cbegin(); it != m_positions.cend(); ++it)
+    {
+        if (it.key().first == serverConnectionHandlerID)
+            updateDirection(it.key().first, it.key().second);
+    }
+}
+
+//! Position a talker; the first call claims one of the kMaxSources render slots
+/*!
+ * \brief HrtfRenderer::setSourcePosition
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param position the talkers position
+ * \return false when all slots are in use; the talker is then left to the client lib
+ */
+bool HrtfRenderer::setSourcePosition(uint64 serverConnectionHandlerID, anyID clientID, const TS3_VECTOR* position)
+{
+    if (!position)
+        return false;
+
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    if (!m_positions.contains(kKey))
+    {
+        Source* free_source = nullptr;
+        for (auto& source : m_sources)
+        {
+            if (source.key.load(std::memory_order_relaxed) == 0)
+            {
+                free_source = &source;
+                break;
+            }
+        }
+        if (!free_source)
+            return false;
+
+        m_positions.insert(kKey, *position);
+        free_source->generation.fetch_add(1, std::memory_order_relaxed);
+        free_source->key.store(make_key(serverConnectionHandlerID, clientID), std::memory_order_release);
+    }
+    else
+        m_positions[kKey] = *position;
+
+    updateDirection(serverConnectionHandlerID, clientID);
+    return true;
+}
+
+void HrtfRenderer::RemoveSource(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    if (!m_positions.remove(qMakePair(serverConnectionHandlerID, clientID)))
+        return;
+
+    if (auto source = find(make_key(serverConnectionHandlerID, clientID)))
+        source->key.store(0, std::memory_order_release);
+}
+
+void HrtfRenderer::RemoveSources(uint64 serverConnectionHandlerID)
+{
+    for (auto it = m_positions.begin(); it != m_positions.end();)
+    {
+        if (it.key().first == serverConnectionHandlerID)
+        {
+            if (auto source = find(make_key(it.key().first, it.key().second)))
+                source->key.store(0, std::memory_order_release);
+
+            it = m_positions.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+//! When disconnecting from a server tab, free its slots
+/*!
+ * \brief HrtfRenderer::onConnectStatusChanged TS Event
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param newStatus used:STATUS_DISCONNECTED
+ * \param errorNumber unused
+ */
+void HrtfRenderer::onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
+{
+    Q_UNUSED(errorNumber);
+    if (newStatus != STATUS_DISCONNECTED)
+        return;
+
+    RemoveSources(serverConnectionHandlerID);
+    m_listeners.remove(serverConnectionHandlerID);
+}
+
+//! Render a talker binaurally into the front left and right channels of a post process buffer
+/*!
+ * \brief HrtfRenderer::Process call from on_playback_post_process
+ * \return false if the talker is not positioned or the buffer has no stereo pair; leave it to the client lib then
+ */
+bool HrtfRenderer::Process(uint64 serverConnectionHandlerID, anyID clientID, int16_t* samples, int32_t frame_count, int32_t channels,
+                           const uint32_t* channel_speaker_array, uint32_t* channel_fill_mask)
+{
+    if (!channel_speaker_array || channels < 2 || channels > 32)
+        return false;
+
+    int left, right;
+    if (!getStereoPair(channel_speaker_array, channels, left, right))
+        return false;
+
+    const auto kFillMask = channel_fill_mask ? *channel_fill_mask : ~0u;
+    auto input = -1;
+    for (auto c : { left, right })
+    {
+        if (kFillMask & (1u << c))
+        {
+            input = c;
+            break;
+        }
+    }
+    for (int32_t c = 0; (input < 0) && (c < channels); ++c)
+        input = (kFillMask & (1u << c)) ? c : -1;
+
+    auto source = find(make_key(serverConnectionHandlerID, clientID));
+    const auto kSet = std::atomic_load(&m_set);
+    if (!source || !kSet || (input < 0) || source->busy.test_and_set(std::memory_order_acquire))
+        return false;
+
+    const auto kGeneration = source->generation.load(std::memory_order_relaxed);
+    if (kGeneration != source->seen_generation)
+    {
+        source->seen_generation = kGeneration;
+        source->seen_direction = ~0u;
+        source->convolver.reset();
+    }
+
+    const auto kDirection = source->direction.load(std::memory_order_relaxed);
+    const auto kTaps = m_taps.load(std::memory_order_relaxed);
+    if ((kDirection != source->seen_direction) || (kTaps != source->seen_taps) || (kSet.get() != source->seen_set))
+    {
+        source->seen_direction = kDirection;
+        source->seen_taps = kTaps;
+        source->seen_set = kSet.get();
+        source->convolver.set_filter(*kSet, static_cast<float>(kDirection & 0xFFFF), static_cast<float>(kDirection >> 16) - 90.0f, kTaps);
+    }
+
+    source->convolver.process(samples + input, samples + left, samples + right, frame_count, channels);
+    source->busy.clear(std::memory_order_release);
+
+    const auto kStereo = (1u << left) | (1u << right);
+    DspKernels::clear_channels(samples, frame_count, channels, kFillMask & ~kStereo);
+    if (channel_fill_mask)
+        *channel_fill_mask = (*channel_fill_mask & ~((channels == 32) ? ~0u : ((1u << channels) - 1))) | kStereo;
+
+    return true;
+}
+
+uint64_t HrtfRenderer::make_key(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    return (static_cast<uint64_t>(serverConnectionHandlerID) << 16) | clientID;
+}
+
+HrtfRenderer::Source* HrtfRenderer::find(uint64_t key)
+{
+    for (auto& source : m_sources)
+    {
+        if (source.key.load(std::memory_order_acquire) == key)
+            return &source;
+    }
+    return nullptr;
+}
+
+//! Direction of a talker relative to the listener, rounded to whole degrees so small moves do not rebuild the filter
+void HrtfRenderer::updateDirection(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    auto source = find(make_key(serverConnectionHandlerID, clientID));
+    if (!source)
+        return;
+
+    const auto kListener = m_listeners.value(serverConnectionHandlerID);
+    const auto kRelative = sub(m_positions.value(qMakePair(serverConnectionHandlerID, clientID)), kListener.position);
+    const auto kForward = normalized(kListener.forward);
+    const auto kUp = normalized(kListener.up);
+    const auto kRight = cross(kUp, kForward);
+
+    const auto kX = dot(kRelative, kRight);
+    const auto kY = dot(kRelative, kUp);
+    const auto kZ = dot(kRelative, kForward);
+    const auto kRadToDeg = 57.2957795f;
+    auto azimuth = qRound(std::atan2(kX, kZ) * kRadToDeg);
+    azimuth = (azimuth < 0) ? azimuth + 360 : azimuth % 360;
+    const auto kElevation = qRound(std::atan2(kY, std::sqrt(kX * kX + kZ * kZ)) * kRadToDeg);
+    source->direction.store(pack_direction(azimuth, kElevation), std::memory_order_relaxed);
+}
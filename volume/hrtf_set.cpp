@@ -0,0 +1,133 @@
+#include "volume/hrtf_set.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    QMutex s_mutex;
+    QHash<QString, std::weak_ptr<const HrtfSet>> s_sets;    // by path
+}
+
+//! Map an HRTF set, or share the one already mapped
+/*!
+ * \brief HrtfSet::Load
+ * \param path the file
+ * \param error the reason when loading failed
+ * \return the set, nullptr when the file is missing or malformed
+ */
+std::shared_ptr<const HrtfSet> HrtfSet::Load(const QString& path, QString* error)
+{
+    QMutexLocker locker(&s_mutex);
+    auto result = s_sets.value(path).lock();
+    if (result)
+        return result;
+
+    std::shared_ptr<HrtfSet> set(new HrtfSet);
+    if (!set->open(path, error))
+        return nullptr;
+
+    s_sets.insert(path, set);
+    return set;
+}
+
+HrtfSet::~HrtfSet()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+}
+
+bool HrtfSet::open(const QString& path, QString* error)
+{
+    m_path = path;
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        if (error)
+            *error = m_file.errorString();
+        return false;
+    }
+
+    const auto kSize = m_file.size();
+    if (kSize < static_cast<qint64>(sizeof(Header)) || !(m_map = m_file.map(0, kSize)))
+    {
+        if (error)
+            *error = QString("Could not map %1").arg(path);
+        return false;
+    }
+
+    memcpy(&m_header, m_map, sizeof(Header));
+    const auto kCount = static_cast<qint64>(m_header.elevation_count) * m_header.azimuth_count * 2 * m_header.ir_length;
+    if (memcmp(m_header.magic, "HRIR", 4) || (m_header.version != 1)
+        || !m_header.ir_length || !m_header.elevation_count || !m_header.azimuth_count
+        || (kSize < static_cast<qint64>(sizeof(Header)) + kCount * static_cast<qint64>(sizeof(float))))
+    {
+        if (error)
+            *error = QString("Not an HRIR set: %1").arg(path);
+        return false;
+    }
+
+    m_data = reinterpret_cast<const float*>(m_map + sizeof(Header));
+    return true;
+}
+
+const float* HrtfSet::response(int32_t elevation, int32_t azimuth) const
+{
+    return m_data + (static_cast<size_t>(elevation) * m_header.azimuth_count + azimuth) * 2 * m_header.ir_length;
+}
+
+//! Bilinear blend of the four measured responses around a direction
+/*!
+ * \brief HrtfSet::interpolate
+ * \param azimuth degrees clockwise from the front
+ * \param elevation degrees, clamped to the measured range
+ * \param taps the number of taps to write, at most ir_length()
+ * \param left taps of the left ear
+ * \param right taps of the right ear
+ */
+void HrtfSet::interpolate(float azimuth, float elevation, int32_t taps, float* left, float* right) const
+{
+    const auto kAzimuthCount = static_cast<int32_t>(m_header.azimuth_count);
+    const auto kElevationCount = static_cast<int32_t>(m_header.elevation_count);
+    const auto kLength = static_cast<int32_t>(m_header.ir_length);
+    taps = (taps < kLength) ? taps : kLength;
+
+    auto az = std::fmod(azimuth, 360.0f);
+    az = ((az < 0.0f) ? az + 360.0f : az) * kAzimuthCount / 360.0f;
+    const auto kAz0 = static_cast<int32_t>(az) % kAzimuthCount;
+    const auto kAz1 = (kAz0 + 1) % kAzimuthCount;
+    const auto kAzFrac = az - std::floor(az);
+
+    auto el = 0.0f;
+    if (kElevationCount > 1)
+    {
+        const auto kRange = m_header.elevation_max - m_header.elevation_min;
+        el = (kRange > 0.0f) ? (elevation - m_header.elevation_min) / kRange * (kElevationCount - 1) : 0.0f;
+        el = (el < 0.0f) ? 0.0f : ((el > kElevationCount - 1) ? kElevationCount - 1 : el);
+    }
+    const auto kEl0 = static_cast<int32_t>(el);
+    const auto kEl1 = (kEl0 + 1 < kElevationCount) ? kEl0 + 1 : kEl0;
+    const auto kElFrac = el - kEl0;
+
+    const float* kResponses[4] = { response(kEl0, kAz0), response(kEl0, kAz1), response(kEl1, kAz0), response(kEl1, kAz1) };
+    const float kWeights[4] = {
+        (1.0f - kElFrac) * (1.0f - kAzFrac), (1.0f - kElFrac) * kAzFrac,
+        kElFrac * (1.0f - kAzFrac), kElFrac * kAzFrac
+    };
+    for (int32_t i = 0; i < taps; ++i)
+    {
+        float l = 0.0f;
+        float r = 0.0f;
+        for (int32_t k = 0; k < 4; ++k)
+        {
+            l += kWeights[k] * kResponses[k][i];
+            r += kWeights[k] * kResponses[k][kLength + i];
+        }
+        left[i] = l;
+        right[i] = r;
+    }
+}
@@ -0,0 +1,133 @@
+#include "volume/noise_gate.h"
+
+#include <QtCore/qmath.h>
+
+#include <cstring>
+
+#include "volume/db.h"
+
+const int32_t NoiseGate::kUnity;
+const int32_t NoiseGate::kRampChunk;
+
+NoiseGate::NoiseGate(int32_t sample_rate)
+    : m_sample_rate(sample_rate)
+    , m_attack_step(qMax(1, qCeil(kUnity * kRampChunk / (kAttack * sample_rate))))
+    , m_release_step(qMax(1, qCeil(kUnity * kRampChunk / (kRelease * sample_rate))))
+{
+    setParameters(Parameters());
+}
+
+//! Set thresholds, hold time and range
+/*!
+ * Takes effect with the next frame; the levels are converted here so the audio thread only compares
+ * \brief NoiseGate::setParameters
+ * \param parameters the close threshold is clamped to the open threshold
+ */
+void NoiseGate::setParameters(const Parameters& parameters)
+{
+    const auto kOpen = db2lin(parameters.open_db);
+    const auto kClose = db2lin(qMin(parameters.close_db, parameters.open_db));
+    m_open_level.store(kOpen * kOpen, std::memory_order_relaxed);
+    m_close_level.store(kClose * kClose, std::memory_order_relaxed);
+    m_hold_frames.store(qMax(0, qRound(parameters.hold_ms * 0.001f * m_sample_rate)), std::memory_order_relaxed);
+    const auto kRange = (parameters.range_db < kRangeClosed) ? 0.0f : qMin(1.0f, db2lin(parameters.range_db));
+    m_range_q15.store(qRound(kRange * kUnity), std::memory_order_relaxed);
+}
+
+void NoiseGate::setEnabled(bool val)
+{
+    if (m_enabled.exchange(val) != val)
+        m_reset.store(true, std::memory_order_release);
+}
+
+//! Open or close on the levels of a frame; one comparison
+/*!
+ * \brief NoiseGate::update
+ * \param levels DspKernels::measure of the interleaved frame; zero for digital silence
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \return is open
+ */
+bool NoiseGate::update(const DspKernels::Levels& levels, int32_t frame_count, int32_t channels)
+{
+    if (m_reset.exchange(false, std::memory_order_acquire))
+        reset();
+
+    const auto kSampleCount = frame_count * channels;
+    if (kSampleCount <= 0)
+        return m_open;
+
+    if (!m_open)
+    {
+        m_open = (levels.energy > m_open_level.load(std::memory_order_relaxed) * kSampleCount);
+        if (m_open)
+            m_hold = m_hold_frames.load(std::memory_order_relaxed);
+    }
+    else if (levels.energy > m_close_level.load(std::memory_order_relaxed) * kSampleCount)
+        m_hold = m_hold_frames.load(std::memory_order_relaxed);
+    else
+    {
+        m_hold -= frame_count;
+        m_open = (m_hold > 0);
+    }
+    m_is_open.store(m_open, std::memory_order_relaxed);
+    return m_open;
+}
+
+//! Apply the gate gain, ramping in steps of kRampChunk frames
+/*!
+ * \brief NoiseGate::apply
+ * \param samples interleaved samples
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \return the frame was zeroed: the gate is closed completely
+ */
+bool NoiseGate::apply(int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    const auto kTarget = m_open ? kUnity : m_range_q15.load(std::memory_order_relaxed);
+    int32_t frame = 0;
+    if (m_gain != kTarget)
+    {
+        const auto kStep = (kTarget > m_gain) ? m_attack_step : -m_release_step;
+        for (; (frame < frame_count) && (m_gain != kTarget); frame += kRampChunk)
+        {
+            m_gain = (kStep > 0) ? qMin(kTarget, m_gain + kStep) : qMax(kTarget, m_gain + kStep);
+            const auto kCount = qMin(kRampChunk, frame_count - frame);
+            DspKernels::apply_gain_q15(samples + frame * channels, kCount * channels, m_gain);
+        }
+        if (frame >= frame_count)
+            return false;
+    }
+
+    if (m_gain == kUnity)
+        return false;
+
+    const auto kRemaining = (frame_count - frame) * channels;
+    if (m_gain > 0)
+    {
+        DspKernels::apply_gain_q15(samples + frame * channels, kRemaining, m_gain);
+        return false;
+    }
+
+    memset(samples + frame * channels, 0, kRemaining * sizeof(int16_t));
+    return (frame == 0);
+}
+
+//! Move the gain as apply would; for frames of digital silence, where there is nothing to attenuate
+void NoiseGate::advance(int32_t frame_count)
+{
+    const auto kTarget = m_open ? kUnity : m_range_q15.load(std::memory_order_relaxed);
+    const auto kSteps = (frame_count + kRampChunk - 1) / kRampChunk;
+    if (kTarget > m_gain)
+        m_gain = static_cast<int32_t>(qMin<int64_t>(kTarget, m_gain + static_cast<int64_t>(kSteps) * m_attack_step));
+    else if (kTarget < m_gain)
+        m_gain = static_cast<int32_t>(qMax<int64_t>(kTarget, m_gain - static_cast<int64_t>(kSteps) * m_release_step));
+}
+
+void NoiseGate::reset()
+{
+    m_open = true;
+    m_hold = m_hold_frames.load(std::memory_order_relaxed);
+    m_gain = kUnity;
+    m_is_open.store(true, std::memory_order_relaxed);
+}
@@ -0,0 +1,181 @@
+#include "volume/noise_suppressor.h"
+
+#include <QtCore/qmath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "volume/db.h"
+
+const int32_t NoiseSuppressor::kFftSize;
+const int32_t NoiseSuppressor::kHop;
+const int32_t NoiseSuppressor::kBins;
+const int32_t NoiseSuppressor::kSubwindows;
+
+NoiseSuppressor::NoiseSuppressor()
+    : m_fft(kFftSize)
+    , m_window(kFftSize)
+    , m_time(kFftSize)
+    , m_spectrum(kBins)
+{
+    // periodic sqrt Hann: the squared windows of two hops add up to one
+    for (int32_t i = 0; i < kFftSize; ++i)
+        m_window[i] = std::sqrt(0.5f - 0.5f * std::cos(2.0f * 3.14159265f * i / kFftSize));
+}
+
+//! Set how much noise is removed; takes effect with the next hop
+/*!
+ * \param val 0: pass through .. 1: bins down to -kMaxAttenuation dB
+ */
+void NoiseSuppressor::setStrength(float val)
+{
+    m_strength.store(qBound(0.0f, val, 1.0f), std::memory_order_relaxed);
+}
+
+float NoiseSuppressor::getStrength() const
+{
+    return m_strength.load(std::memory_order_relaxed);
+}
+
+void NoiseSuppressor::prepare(int32_t sample_rate, int32_t max_channels)
+{
+    const auto kWindowHops = qMax(kSubwindows, qRound(kWindowSeconds * sample_rate / kHop));
+    m_subwindow_hops = (kWindowHops + kSubwindows - 1) / kSubwindows;
+
+    m_channels.resize(max_channels);
+    for (auto& channel : m_channels)
+    {
+        channel.input.resize(kFftSize);
+        channel.overlap.resize(kFftSize);
+        channel.output.resize(kHop);
+        channel.smoothed.resize(kBins);
+        channel.minimum.resize(kBins);
+        channel.subwindows.resize(kSubwindows * kBins);
+        channel.window_minimum.resize(kBins);
+        channel.speech.resize(kBins);
+    }
+    reset();
+}
+
+void NoiseSuppressor::reset()
+{
+    for (auto& channel : m_channels)
+        reset(channel);
+
+    m_hop_count = 0;
+    m_subwindow = 0;
+    m_fill = 0;
+}
+
+void NoiseSuppressor::reset(Channel& channel)
+{
+    std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+    std::fill(channel.overlap.begin(), channel.overlap.end(), 0.0f);
+    std::fill(channel.output.begin(), channel.output.end(), 0.0f);
+    std::fill(channel.speech.begin(), channel.speech.end(), 0.0f);
+    channel.is_primed = false;
+}
+
+//! Feeds the frame through the hop FIFO; the output lags the input by kFftSize samples
+void NoiseSuppressor::process(float* const* planes, int32_t frame_count, int32_t channels)
+{
+    if (channels > static_cast<int32_t>(m_channels.size()))
+        return;
+
+    for (int32_t offset = 0; offset < frame_count;)
+    {
+        const auto kCount = qMin(kHop - m_fill, frame_count - offset);
+        for (int32_t c = 0; c < channels; ++c)
+        {
+            auto& channel = m_channels[c];
+            memcpy(channel.input.data() + kHop + m_fill, planes[c] + offset, kCount * sizeof(float));
+            memcpy(planes[c] + offset, channel.output.data() + m_fill, kCount * sizeof(float));
+        }
+        offset += kCount;
+        m_fill += kCount;
+        if (m_fill < kHop)
+            break;
+
+        m_fill = 0;
+        m_floor = db2lin(-kMaxAttenuation * getStrength());
+        for (int32_t c = 0; c < channels; ++c)
+            process_hop(m_channels[c]);
+
+        if (++m_hop_count == m_subwindow_hops)
+        {
+            for (int32_t c = 0; c < channels; ++c)
+                end_subwindow(m_channels[c]);
+
+            m_hop_count = 0;
+            m_subwindow = (m_subwindow + 1) % kSubwindows;
+        }
+    }
+}
+
+void NoiseSuppressor::process_hop(Channel& channel)
+{
+    for (int32_t i = 0; i < kFftSize; ++i)
+        m_time[i] = channel.input[i] * m_window[i];
+
+    m_fft.forward(m_time.data(), m_spectrum.data());
+
+    if (!channel.is_primed)
+    {
+        for (int32_t k = 0; k < kBins; ++k)
+            channel.smoothed[k] = std::norm(m_spectrum[k]);
+
+        std::copy(channel.smoothed.begin(), channel.smoothed.end(), channel.minimum.begin());
+        std::copy(channel.smoothed.begin(), channel.smoothed.end(), channel.window_minimum.begin());
+        for (int32_t s = 0; s < kSubwindows; ++s)
+            std::copy(channel.smoothed.begin(), channel.smoothed.end(), channel.subwindows.begin() + s * kBins);
+
+        channel.is_primed = true;
+    }
+
+    for (int32_t k = 0; k < kBins; ++k)
+    {
+        // minimum statistics
+        const auto kPower = std::norm(m_spectrum[k]);
+        channel.smoothed[k] = kSmoothing * channel.smoothed[k] + (1.0f - kSmoothing) * kPower;
+        channel.minimum[k] = qMin(channel.minimum[k], channel.smoothed[k]);
+        const auto kNoise = kBias * qMin(channel.window_minimum[k], channel.minimum[k]) + 1e-12f;
+
+        // Wiener gain, decision directed a priori SNR
+        const auto kPosteriori = kPower / kNoise;
+        const auto kPriori = kDecisionDirected * channel.speech[k] / kNoise
+                             + (1.0f - kDecisionDirected) * qMax(kPosteriori - 1.0f, 0.0f);
+        const auto kGain = qMax(kPriori / (1.0f + kPriori), m_floor);
+        channel.speech[k] = kGain * kGain * kPower;
+        m_spectrum[k] *= kGain;
+    }
+
+    m_fft.inverse(m_spectrum.data(), m_time.data());
+
+    const auto kScale = 1.0f / kFftSize;
+    for (int32_t i = 0; i < kFftSize; ++i)
+        channel.overlap[i] += m_time[i] * m_window[i] * kScale;
+
+    memcpy(channel.output.data(), channel.overlap.data(), kHop * sizeof(float));
+    memmove(channel.overlap.data(), channel.overlap.data() + kHop, (kFftSize - kHop) * sizeof(float));
+    std::fill(channel.overlap.begin() + (kFftSize - kHop), channel.overlap.end(), 0.0f);
+    memmove(channel.input.data(), channel.input.data() + kHop, (kFftSize - kHop) * sizeof(float));
+}
+
+//! Rotate the subwindow minima; the oldest subwindow drops out of the noise estimate
+void NoiseSuppressor::end_subwindow(Channel& channel)
+{
+    if (!channel.is_primed)
+        return;
+
+    auto slot = channel.subwindows.begin() + m_subwindow * kBins;
+    std::copy(channel.minimum.begin(), channel.minimum.end(), slot);
+    std::copy(channel.subwindows.begin(), channel.subwindows.begin() + kBins, channel.window_minimum.begin());
+    for (int32_t s = 1; s < kSubwindows; ++s)
+    {
+        const auto kSlot = channel.subwindows.data() + s * kBins;
+        for (int32_t k = 0; k < kBins; ++k)
+            channel.window_minimum[k] = qMin(channel.window_minimum[k], kSlot[k]);
+    }
+    std::copy(channel.smoothed.begin(), channel.smoothed.end(), channel.minimum.begin());
+}
@@ -0,0 +1,40 @@
+#include "volume/pan_law.h"
+
+#include <cmath>
+
+namespace
+{
+    struct Table
+    {
+        Table()
+        {
+            const auto kQuarterPi = 0.785398163397448f;
+            for (int32_t i = 0; i < PanLaw::kSteps; ++i)
+            {
+                const auto kAngle = kQuarterPi * 2.0f * i / (PanLaw::kSteps - 1);
+                gains[i].left = std::cos(kAngle);
+                gains[i].right = std::sin(kAngle);
+            }
+            gains[(PanLaw::kSteps - 1) / 2].right = gains[(PanLaw::kSteps - 1) / 2].left;
+        }
+
+        PanLaw::Gains gains[PanLaw::kSteps];
+    };
+
+    const Table& table()
+    {
+        static const Table kTable;
+        return kTable;
+    }
+}
+
+namespace PanLaw
+{
+    //! Gain pair of the nearest tabulated position
+    const Gains& gains(float position)
+    {
+        position = (position < -1.0f) ? -1.0f : ((position > 1.0f) ? 1.0f : position);
+        const auto kIndex = static_cast<int32_t>((position + 1.0f) * 0.5f * (kSteps - 1) + 0.5f);
+        return table().gains[kIndex];
+    }
+}
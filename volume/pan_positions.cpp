@@ -0,0 +1,179 @@
+#include "volume/pan_positions.h"
+
+#include <QtCore/qmath.h>
+
+#include "teamspeak/public_errors.h"
+
+#include "core/ts_helpers_qt.h"
+
+namespace
+{
+    // centre first, then alternating sides, halving the distance each round
+    const float kSlotPositions[] = {
+        0.0f, -1.0f, 1.0f, -0.5f, 0.5f, -0.75f, 0.75f, -0.25f, 0.25f,
+        -0.875f, 0.875f, -0.625f, 0.625f, -0.375f, 0.375f, -0.125f, 0.125f
+    };
+    const int32_t kSlotCount = sizeof(kSlotPositions) / sizeof(kSlotPositions[0]);
+}
+
+PanPositions::PanPositions(QObject* parent)
+    : QObject(parent)
+{
+    this->setObjectName("PanPositions");
+}
+
+//! Hand out positions to clients without a manual position
+void PanPositions::setAutoPan(bool val)
+{
+    if (m_auto_pan == val)
+        return;
+
+    m_auto_pan = val;
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it)
+        update(it.key(), it.value());
+}
+
+bool PanPositions::isAutoPan() const
+{
+    return m_auto_pan;
+}
+
+void PanPositions::setSpread(float val)
+{
+    val = qBound(0.0f, val, 1.0f);
+    if (m_spread == val)
+        return;
+
+    m_spread = val;
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it)
+        update(it.key(), it.value());
+}
+
+float PanPositions::getSpread() const
+{
+    return m_spread;
+}
+
+//! Pin a client to a position; takes precedence over the automatic one
+/*!
+ * \brief PanPositions::setClientPosition
+ * \param clientUID the unique identifier of the client
+ * \param position -1 (left) .. 1 (right)
+ */
+void PanPositions::setClientPosition(const QString& clientUID, float position)
+{
+    m_uid_positions.insert(clientUID, qBound(-1.0f, position, 1.0f));
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it)
+    {
+        if (it.value().uid == clientUID)
+            update(it.key(), it.value());
+    }
+}
+
+void PanPositions::removeClientPosition(const QString& clientUID)
+{
+    if (!m_uid_positions.remove(clientUID))
+        return;
+
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it)
+    {
+        if (it.value().uid == clientUID)
+            update(it.key(), it.value());
+    }
+}
+
+bool PanPositions::getClientPosition(const QString& clientUID, float& result) const
+{
+    auto it = m_uid_positions.constFind(clientUID);
+    if (it == m_uid_positions.constEnd())
+        return false;
+
+    result = it.value();
+    return true;
+}
+
+//! Register a talker and get its position
+/*!
+ * \brief PanPositions::AddClient called by Volumes::AddVolume
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param position the position (-1..1) when panned
+ * \return is the client panned
+ */
+bool PanPositions::AddClient(uint64 serverConnectionHandlerID, anyID clientID, float& position)
+{
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    auto it = m_clients.find(kKey);
+    if (it == m_clients.end())
+    {
+        Client client;
+        if (TSHelpers::GetClientUID(serverConnectionHandlerID, clientID, client.uid) != ERROR_ok)
+            client.uid.clear();
+
+        client.slot = claimSlot(serverConnectionHandlerID);
+        it = m_clients.insert(kKey, client);
+    }
+    return resolve(it.value(), position);
+}
+
+void PanPositions::RemoveClient(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    m_clients.remove(qMakePair(serverConnectionHandlerID, clientID));
+}
+
+void PanPositions::RemoveClients(uint64 serverConnectionHandlerID)
+{
+    for (auto it = m_clients.begin(); it != m_clients.end();)
+    {
+        if (it.key().first == serverConnectionHandlerID)
+            it = m_clients.erase(it);
+        else
+            ++it;
+    }
+}
+
+void PanPositions::RemoveClients()
+{
+    m_clients.clear();
+}
+
+//! The lowest slot not taken by a talker of the server tab; slots wrap around when more talk at once
+int32_t PanPositions::claimSlot(uint64 serverConnectionHandlerID) const
+{
+    uint64_t used = 0;
+    int32_t count = 0;
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it)
+    {
+        if (it.key().first != serverConnectionHandlerID)
+            continue;
+
+        ++count;
+        if (it.value().slot < kSlotCount)
+            used |= (1ull << it.value().slot);
+    }
+    for (int32_t slot = 0; slot < kSlotCount; ++slot)
+    {
+        if (!(used & (1ull << slot)))
+            return slot;
+    }
+    return count % kSlotCount;
+}
+
+bool PanPositions::resolve(const Client& client, float& position) const
+{
+    if (!client.uid.isEmpty() && getClientPosition(client.uid, position))
+        return true;
+
+    if (!m_auto_pan)
+        return false;
+
+    position = kSlotPositions[client.slot % kSlotCount] * m_spread;
+    return true;
+}
+
+void PanPositions::update(const QPair<uint64, anyID>& key, const Client& client)
+{
+    float position = 0.0f;
+    const auto kIsPanned = resolve(client, position);
+    emit positionChanged(key.first, key.second, kIsPanned, position);
+}
@@ -0,0 +1,292 @@
+#include "volume/radio_stages.h"
+
+#include <QtCore/qmath.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "volume/db.h"
+
+namespace
+{
+    const float kButterworthQ[2] = {0.54119610f, 1.30656296f};     // 4th order, two sections
+
+    inline uint32_t xorshift(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+// RadioBandPass
+
+const int32_t RadioBandPass::kSections;
+
+RadioBandPass::RadioBandPass(float low_hz, float high_hz)
+    : m_low_hz(low_hz)
+    , m_high_hz(high_hz)
+{
+}
+
+//! Set the pass band; the audio thread recomputes the coefficients with its next frame
+void RadioBandPass::setBand(float low_hz, float high_hz)
+{
+    m_low_hz.store(low_hz, std::memory_order_relaxed);
+    m_high_hz.store(high_hz, std::memory_order_relaxed);
+    m_epoch.fetch_add(1, std::memory_order_release);
+}
+
+void RadioBandPass::prepare(int32_t sample_rate, int32_t max_channels)
+{
+    m_sample_rate = sample_rate;
+    m_state.assign(max_channels * kSections * 2, 0.0f);
+    m_applied_epoch = 0;
+}
+
+void RadioBandPass::reset()
+{
+    std::fill(m_state.begin(), m_state.end(), 0.0f);
+}
+
+void RadioBandPass::update_coefficients()
+{
+    const auto kNyquistMargin = 0.45f * m_sample_rate;
+    const auto kLow = qBound(10.0f, m_low_hz.load(std::memory_order_relaxed), kNyquistMargin);
+    const auto kHigh = qBound(kLow, m_high_hz.load(std::memory_order_relaxed), kNyquistMargin);
+    for (int32_t s = 0; s < kSections; ++s)
+    {
+        const auto kIsHighPass = (s < 2);
+        const auto kW0 = 2.0f * static_cast<float>(M_PI) * (kIsHighPass ? kLow : kHigh) / m_sample_rate;
+        const auto kCos = std::cos(kW0);
+        const auto kAlpha = std::sin(kW0) / (2.0f * kButterworthQ[s & 1]);
+        const auto kA0 = 1.0f + kAlpha;
+        auto& section = m_sections[s];
+        section.b0 = (kIsHighPass ? (1.0f + kCos) : (1.0f - kCos)) * 0.5f / kA0;
+        section.b1 = (kIsHighPass ? -(1.0f + kCos) : (1.0f - kCos)) / kA0;
+        section.b2 = section.b0;
+        section.a1 = -2.0f * kCos / kA0;
+        section.a2 = (1.0f - kAlpha) / kA0;
+    }
+}
+
+void RadioBandPass::process(float* const* planes, int32_t frame_count, int32_t channels)
+{
+    if (static_cast<int32_t>(m_state.size()) < channels * kSections * 2)
+        return;
+
+    const auto kEpoch = m_epoch.load(std::memory_order_acquire);
+    if (kEpoch != m_applied_epoch)
+    {
+        m_applied_epoch = kEpoch;
+        update_coefficients();
+    }
+
+    for (int32_t c = 0; c < channels; ++c)
+    {
+        auto data = planes[c];
+        auto state = m_state.data() + c * kSections * 2;
+        for (int32_t s = 0; s < kSections; ++s)
+        {
+            const auto& kSection = m_sections[s];
+            auto z1 = state[2 * s];
+            auto z2 = state[2 * s + 1];
+            for (int32_t i = 0; i < frame_count; ++i)
+            {
+                const auto kX = data[i];
+                const auto kY = kSection.b0 * kX + z1;
+                z1 = kSection.b1 * kX - kSection.a1 * kY + z2;
+                z2 = kSection.b2 * kX - kSection.a2 * kY;
+                data[i] = kY;
+            }
+            // a decayed filter would otherwise carry denormals into the next frame
+            state[2 * s] = (std::fabs(z1) < 1e-15f) ? 0.0f : z1;
+            state[2 * s + 1] = (std::fabs(z2) < 1e-15f) ? 0.0f : z2;
+        }
+    }
+}
+
+// RadioSaturation
+
+RadioSaturation::RadioSaturation(float drive_db)
+    : m_drive(db2lin(drive_db))
+{
+}
+
+void RadioSaturation::setDrive(float drive_db)
+{
+    m_drive.store(db2lin(drive_db), std::memory_order_relaxed);
+}
+
+void RadioSaturation::process(float* const* planes, int32_t frame_count, int32_t channels)
+{
+    const auto kDrive = m_drive.load(std::memory_order_relaxed);
+    for (int32_t c = 0; c < channels; ++c)
+        DspKernels::soft_clip(planes[c], frame_count, kDrive);
+}
+
+// RadioCrush
+
+const int32_t RadioCrush::kChunk;
+
+RadioCrush::RadioCrush()
+{
+}
+
+void RadioCrush::setBits(int32_t bits)
+{
+    m_bits.store(qBound(1, bits, 16), std::memory_order_relaxed);
+}
+
+void RadioCrush::setRing(float frequency_hz, float mix)
+{
+    m_ring_hz.store(qMax(0.0f, frequency_hz), std::memory_order_relaxed);
+    m_ring_mix.store(qBound(0.0f, mix, 1.0f), std::memory_order_relaxed);
+}
+
+void RadioCrush::prepare(int32_t sample_rate, int32_t max_channels)
+{
+    Q_UNUSED(max_channels);
+    m_sample_rate = sample_rate;
+}
+
+void RadioCrush::reset()
+{
+    m_phase_re = 1.0f;
+    m_phase_im = 0.0f;
+}
+
+void RadioCrush::process(float* const* planes, int32_t frame_count, int32_t channels)
+{
+    const auto kBits = m_bits.load(std::memory_order_relaxed);
+    if (kBits < 16)
+    {
+        const auto kLevels = static_cast<float>(1 << (kBits - 1));
+        for (int32_t c = 0; c < channels; ++c)
+            DspKernels::quantize(planes[c], frame_count, kLevels);
+    }
+
+    const auto kMix = m_ring_mix.load(std::memory_order_relaxed);
+    if (kMix <= 0.0f)
+        return;
+
+    // the carrier is computed once per block for all channels: a rotating phasor, renormalized per block
+    const auto kW = 2.0f * static_cast<float>(M_PI) * m_ring_hz.load(std::memory_order_relaxed) / m_sample_rate;
+    const auto kRotRe = std::cos(kW);
+    const auto kRotIm = std::sin(kW);
+    alignas(32) float carrier[kChunk];
+    for (int32_t offset = 0; offset < frame_count; offset += kChunk)
+    {
+        const auto kCount = qMin(kChunk, frame_count - offset);
+        for (int32_t i = 0; i < kCount; ++i)
+        {
+            carrier[i] = (1.0f - kMix) + kMix * m_phase_im;
+            const auto kRe = m_phase_re * kRotRe - m_phase_im * kRotIm;
+            m_phase_im = m_phase_re * kRotIm + m_phase_im * kRotRe;
+            m_phase_re = kRe;
+        }
+        const auto kNorm = 1.0f / std::sqrt(m_phase_re * m_phase_re + m_phase_im * m_phase_im);
+        m_phase_re *= kNorm;
+        m_phase_im *= kNorm;
+
+        for (int32_t c = 0; c < channels; ++c)
+            DspKernels::multiply(planes[c] + offset, carrier, kCount);
+    }
+}
+
+// RadioNoise
+
+const int32_t RadioNoise::kBurstMin;
+const int32_t RadioNoise::kBurstMax;
+
+RadioNoise::RadioNoise(uint32_t seed)
+    : m_seed(seed)
+    , m_hiss_state(seed)
+    , m_crackle_state(seed ^ 0x5bd1e995u)
+    , m_burst_state(seed | 1u)
+{
+}
+
+void RadioNoise::setHiss(float level_db)
+{
+    m_hiss.store(db2lin(level_db), std::memory_order_relaxed);
+}
+
+void RadioNoise::setCrackle(float rate, float level_db)
+{
+    m_crackle_rate.store(qMax(0.0f, rate), std::memory_order_relaxed);
+    m_crackle.store(db2lin(level_db), std::memory_order_relaxed);
+}
+
+void RadioNoise::prepare(int32_t sample_rate, int32_t max_channels)
+{
+    Q_UNUSED(max_channels);
+    m_sample_rate = sample_rate;
+}
+
+//! Restart the noise sequences from the seed
+void RadioNoise::reset()
+{
+    m_hiss_state = DspKernels::DitherState(m_seed);
+    m_crackle_state = DspKernels::DitherState(m_seed ^ 0x5bd1e995u);
+    m_burst_state = m_seed | 1u;
+    m_gap_left = 0;
+    m_burst_left = 0;
+}
+
+void RadioNoise::process(float* const* planes, int32_t frame_count, int32_t channels)
+{
+    if (channels <= 0)
+        return;
+
+    // every channel starts from the same state: identical noise, as from a mono receiver
+    const auto kHiss = m_hiss.load(std::memory_order_relaxed);
+    if (kHiss > 0.0f)
+    {
+        DspKernels::DitherState state = m_hiss_state;
+        for (int32_t c = 0; c < channels; ++c)
+        {
+            state = m_hiss_state;
+            DspKernels::add_noise(planes[c], frame_count, kHiss, state);
+        }
+        m_hiss_state = state;
+    }
+
+    const auto kRate = m_crackle_rate.load(std::memory_order_relaxed);
+    const auto kCrackle = m_crackle.load(std::memory_order_relaxed);
+    if (kRate <= 0.0f || kCrackle <= 0.0f)
+        return;
+
+    // bursts at uniformly distributed gaps with a mean of 1 / rate
+    const auto kMeanGap = m_sample_rate / kRate;
+    for (int32_t offset = 0; offset < frame_count;)
+    {
+        if (m_burst_left > 0)
+        {
+            const auto kCount = qMin(m_burst_left, frame_count - offset);
+            DspKernels::DitherState state = m_crackle_state;
+            for (int32_t c = 0; c < channels; ++c)
+            {
+                state = m_crackle_state;
+                DspKernels::add_noise(planes[c] + offset, kCount, kCrackle, state);
+            }
+            m_crackle_state = state;
+            m_burst_left -= kCount;
+            offset += kCount;
+            continue;
+        }
+
+        if (m_gap_left <= 0)
+        {
+            const auto kUnit = xorshift(m_burst_state) * (1.0f / 4294967296.0f);
+            m_gap_left = qMax(1, static_cast<int32_t>(2.0f * kMeanGap * kUnit));
+        }
+
+        const auto kCount = qMin(m_gap_left, frame_count - offset);
+        m_gap_left -= kCount;
+        offset += kCount;
+        if (m_gap_left == 0)
+            m_burst_left = kBurstMin + static_cast<int32_t>(xorshift(m_burst_state) % (kBurstMax - kBurstMin + 1));
+    }
+}
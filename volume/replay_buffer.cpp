@@ -0,0 +1,292 @@
+#include "volume/replay_buffer.h"
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+
+#include <cstring>
+
+#include "volume/dsp_kernels.h"
+#include "volume/wav_file.h"
+
+namespace
+{
+    const int16_t kStepTable[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+        337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+        2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+    };
+
+    const int8_t kIndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+    const int32_t kDownmixFrames = 256;    // stack chunk of push
+
+    // one IMA ADPCM step; shared by encoder and decoder so both track the same predictor
+    inline void adpcm_update(int32_t code, int32_t& predictor, int32_t& step_index)
+    {
+        const int32_t kStep = kStepTable[step_index];
+        auto diff = kStep >> 3;
+        if (code & 4)
+            diff += kStep;
+        if (code & 2)
+            diff += kStep >> 1;
+        if (code & 1)
+            diff += kStep >> 2;
+
+        predictor += (code & 8) ? -diff : diff;
+        predictor = qBound(-32768, predictor, 32767);
+        step_index = qBound(0, step_index + kIndexTable[code], 88);
+    }
+}
+
+// ReplayHistory
+
+const int32_t ReplayHistory::kBlockFrames;
+
+ReplayHistory::ReplayHistory(int32_t sample_rate, int32_t seconds)
+    : m_sample_rate(sample_rate)
+    , m_capacity(qMax(1, (sample_rate * seconds + kBlockFrames - 1) / kBlockFrames))
+    , m_blocks(new Block[m_capacity])
+{
+}
+
+//! Append a frame of the client; downmixed, coded and published block by block
+void ReplayHistory::push(const int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    if (channels <= 0)
+        return;
+
+    if (channels == 1)
+    {
+        for (int32_t i = 0; i < frame_count; ++i)
+            encode(samples[i]);
+
+        return;
+    }
+
+    alignas(32) float mixed[kDownmixFrames];
+    alignas(32) int16_t mono[kDownmixFrames];
+    for (int32_t i = 0; i < frame_count; i += kDownmixFrames)
+    {
+        const auto kCount = qMin(frame_count - i, kDownmixFrames);
+        DspKernels::downmix(samples + i * channels, mixed, kCount, channels);
+        DspKernels::float_to_int16(mixed, mono, kCount);
+        for (int32_t k = 0; k < kCount; ++k)
+            encode(mono[k]);
+    }
+}
+
+void ReplayHistory::encode(int32_t sample)
+{
+    const auto kNumber = m_written.load(std::memory_order_relaxed);
+    auto& block = m_blocks[kNumber % m_capacity];
+    if (m_fill == 0)
+    {
+        block.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        block.predictor = static_cast<int16_t>(m_predictor);
+        block.step_index = static_cast<uint8_t>(m_step_index);
+    }
+
+    const int32_t kStep = kStepTable[m_step_index];
+    auto diff = sample - m_predictor;
+    int32_t code = 0;
+    if (diff < 0)
+    {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= kStep)
+    {
+        code |= 4;
+        diff -= kStep;
+    }
+    if (diff >= (kStep >> 1))
+    {
+        code |= 2;
+        diff -= kStep >> 1;
+    }
+    if (diff >= (kStep >> 2))
+        code |= 1;
+
+    adpcm_update(code, m_predictor, m_step_index);
+
+    auto& byte = block.data[m_fill >> 1];
+    byte = (m_fill & 1) ? static_cast<uint8_t>((byte & 0x0F) | (code << 4)) : static_cast<uint8_t>(code);
+    if (++m_fill == kBlockFrames)
+    {
+        m_fill = 0;
+        block.sequence.store(kNumber + 1, std::memory_order_release);
+        m_written.store(kNumber + 1, std::memory_order_release);
+    }
+}
+
+//! Decode the newest complete blocks
+/*!
+ * Blocks the writer overwrote while they were copied are left out; that only happens at the old end.
+ * \brief ReplayHistory::decode
+ * \param result mono samples, oldest first
+ * \param max_frames at most this many frames; <= 0: the whole ring
+ * \return number of frames decoded
+ */
+int32_t ReplayHistory::decode(std::vector<int16_t>& result, int32_t max_frames) const
+{
+    const auto kEnd = written();
+    auto count = static_cast<uint64_t>(m_capacity);
+    if (max_frames > 0)
+        count = qMin<uint64_t>(count, (max_frames + kBlockFrames - 1) / kBlockFrames);
+    count = qMin(count, kEnd);
+
+    result.clear();
+    result.reserve(count * kBlockFrames);
+    int16_t header_predictor;
+    uint8_t header_step_index;
+    uint8_t data[kBlockFrames / 2];
+    for (auto number = kEnd - count; number < kEnd; ++number)
+    {
+        const auto& kBlock = m_blocks[number % m_capacity];
+        if (kBlock.sequence.load(std::memory_order_acquire) != number + 1)
+            continue;
+
+        header_predictor = kBlock.predictor;
+        header_step_index = kBlock.step_index;
+        memcpy(data, kBlock.data, sizeof(data));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (kBlock.sequence.load(std::memory_order_relaxed) != number + 1)
+            continue;
+
+        int32_t predictor = header_predictor;
+        int32_t step_index = qMin<int32_t>(header_step_index, 88);
+        for (int32_t i = 0; i < kBlockFrames; ++i)
+        {
+            const auto kCode = (i & 1) ? (data[i >> 1] >> 4) : (data[i >> 1] & 0x0F);
+            adpcm_update(kCode, predictor, step_index);
+            result.push_back(static_cast<int16_t>(predictor));
+        }
+    }
+    return static_cast<int32_t>(result.size());
+}
+
+// ReplayExport
+
+class ReplayExport : public QRunnable
+{
+public:
+    ReplayExport(ReplayBuffer* buffer, std::shared_ptr<ReplayHistory> history, uint64 serverConnectionHandlerID, anyID clientID, const QString& path, int32_t seconds)
+        : m_buffer(buffer)
+        , m_history(std::move(history))
+        , m_server_connection_handler_id(serverConnectionHandlerID)
+        , m_client_id(clientID)
+        , m_path(path)
+        , m_seconds(seconds)
+    {}
+
+    void run() override
+    {
+        std::vector<int16_t> samples;
+        const auto kFrames = m_history->decode(samples, m_seconds * m_history->sample_rate());
+
+        QString error;
+        WavFile::Format format;
+        format.sample_rate = m_history->sample_rate();
+        format.channels = 1;
+        auto is_ok = false;
+        if (kFrames > 0)
+            is_ok = WavFile::Write(m_path, samples.data(), kFrames, format, &error);
+        else
+            error = QString("Nothing recorded");
+
+        emit m_buffer->exportFinished(m_server_connection_handler_id, m_client_id, m_path, is_ok, error);
+    }
+
+private:
+    ReplayBuffer* m_buffer;     // outlives the pool and with it this job
+    std::shared_ptr<ReplayHistory> m_history;
+    uint64 m_server_connection_handler_id;
+    anyID m_client_id;
+    QString m_path;
+    int32_t m_seconds;
+};
+
+// ReplayBuffer
+
+ReplayBuffer::ReplayBuffer(QObject* parent, int32_t sample_rate, int32_t seconds)
+    : QObject(parent)
+    , m_sample_rate(sample_rate)
+    , m_seconds(seconds)
+{
+    this->setObjectName("ReplayBuffer");
+    m_pool.setMaxThreadCount(1);
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+    m_pool.waitForDone();
+}
+
+//! Create the history of a client; hand it to the DspVolume of that client
+/*!
+ * The ring is allocated here, once; feeding it never allocates.
+ * \brief ReplayBuffer::AddClient
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \return the history
+ */
+std::shared_ptr<ReplayHistory> ReplayBuffer::AddClient(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    auto history = std::make_shared<ReplayHistory>(m_sample_rate, m_seconds);
+    QMutexLocker locker(&m_mutex);
+    m_histories.insert(qMakePair(serverConnectionHandlerID, clientID), history);
+    return history;
+}
+
+std::shared_ptr<ReplayHistory> ReplayBuffer::GetClient(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_histories.value(qMakePair(serverConnectionHandlerID, clientID));
+}
+
+void ReplayBuffer::RemoveClient(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    QMutexLocker locker(&m_mutex);
+    m_histories.remove(qMakePair(serverConnectionHandlerID, clientID));
+}
+
+void ReplayBuffer::RemoveClients(uint64 serverConnectionHandlerID)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_histories.begin(); it != m_histories.end();)
+    {
+        if (it.key().first == serverConnectionHandlerID)
+            it = m_histories.erase(it);
+        else
+            ++it;
+    }
+}
+
+void ReplayBuffer::RemoveClients()
+{
+    QMutexLocker locker(&m_mutex);
+    m_histories.clear();
+}
+
+//! Write the recent audio of a client to a WAV file on a worker thread
+/*!
+ * Finishes with exportFinished. The history stays alive for the job even if the client leaves meanwhile.
+ * \brief ReplayBuffer::Export
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param path the file to write; 16 bit mono PCM
+ * \param seconds the newest seconds only; <= 0: all there is
+ * \return false if there is no history for the client
+ */
+bool ReplayBuffer::Export(uint64 serverConnectionHandlerID, anyID clientID, const QString& path, int32_t seconds)
+{
+    auto history = GetClient(serverConnectionHandlerID, clientID);
+    if (!history)
+        return false;
+
+    m_pool.start(new ReplayExport(this, std::move(history), serverConnectionHandlerID, clientID, path, seconds));
+    return true;
+}
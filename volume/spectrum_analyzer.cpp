@@ -0,0 +1,285 @@
+#include "volume/spectrum_analyzer.h"
+
+#include <QtCore/QThread>
+#include <QtCore/QMutexLocker>
+
+#include <cmath>
+
+#include "volume/db.h"
+#include "volume/dsp_kernels.h"
+
+class SpectrumWorker : public QThread
+{
+public:
+    explicit SpectrumWorker(SpectrumAnalyzer* analyzer)
+        : QThread(analyzer)
+        , m_analyzer(analyzer)
+    {}
+
+protected:
+    void run() override
+    {
+        while (!isInterruptionRequested())
+        {
+            m_analyzer->analyze_pending();
+            msleep(static_cast<unsigned long>(1000 / m_analyzer->getAnalysisRate()));
+        }
+    }
+
+private:
+    SpectrumAnalyzer* m_analyzer;
+};
+
+// SpectrumTap
+
+const int32_t SpectrumTap::kWindowSize;
+const int32_t SpectrumTap::kBinCount;
+const int32_t SpectrumTap::kFresh;
+
+SpectrumTap::SpectrumTap(int32_t sample_rate, int32_t analysis_rate)
+    : m_sample_rate(sample_rate)
+{
+    for (auto& snapshot : m_snapshots)
+        snapshot.bins_db.fill(-200.0f);
+
+    set_analysis_rate(analysis_rate);
+}
+
+void SpectrumTap::set_analysis_rate(int32_t analysis_rate)
+{
+    m_interval.store(qMax(kWindowSize, m_sample_rate / qMax(1, analysis_rate)), std::memory_order_relaxed);
+}
+
+//! Copies a mono downmix of the frame into the current window; audio thread, no locks, no allocation
+/*!
+ * Only one window per analysis interval is collected, the samples in between are skipped.
+ * When the worker lags behind and the queue is full, the window is dropped.
+ */
+void SpectrumTap::push(const int16_t* samples, int32_t frame_count, int32_t channels)
+{
+    int32_t frame = 0;
+    while (frame < frame_count)
+    {
+        if (m_countdown > 0)
+        {
+            const auto kSkip = qMin(m_countdown, frame_count - frame);
+            m_countdown -= kSkip;
+            frame += kSkip;
+            continue;
+        }
+
+        if (!m_fill)
+        {
+            m_fill = m_windows.begin_push();
+            m_fill_pos = 0;
+            if (!m_fill)
+            {
+                m_countdown = m_interval.load(std::memory_order_relaxed);
+                continue;
+            }
+        }
+
+        const auto kCount = qMin(kWindowSize - m_fill_pos, frame_count - frame);
+        DspKernels::downmix(samples + frame * channels, m_fill->data() + m_fill_pos, kCount, channels);
+        m_fill_pos += kCount;
+        frame += kCount;
+
+        if (m_fill_pos == kWindowSize)
+        {
+            m_windows.end_push();
+            m_fill = nullptr;
+            m_countdown = qMax(0, m_interval.load(std::memory_order_relaxed) - kWindowSize);
+        }
+    }
+}
+
+void SpectrumTap::publish()
+{
+    m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) & ~kFresh;
+}
+
+//! Gets the latest analysis result; lock free, to be called from one reader thread only
+/*!
+ * \param result the latest snapshot
+ * \return true if the snapshot is newer than the one returned by the previous call
+ */
+bool SpectrumTap::read_snapshot(Snapshot& result)
+{
+    const bool kIsFresh = (m_middle.load(std::memory_order_relaxed) & kFresh) != 0;
+    if (kIsFresh)
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & ~kFresh;
+
+    result = m_snapshots[m_front];
+    return kIsFresh;
+}
+
+// SpectrumAnalyzer
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject* parent, int32_t sample_rate)
+    : QObject(parent)
+    , m_sample_rate(sample_rate)
+    , m_fft(SpectrumTap::kWindowSize)
+{
+    this->setObjectName("SpectrumAnalyzer");
+
+    const auto kSize = SpectrumTap::kWindowSize;
+    m_hann.resize(kSize);
+    float hann_sum = 0.0f;
+    for (int32_t i = 0; i < kSize; ++i)
+    {
+        m_hann[i] = 0.5f - 0.5f * std::cos(2.0f * 3.14159265f * i / kSize);
+        hann_sum += m_hann[i];
+    }
+    // full scale sine reads 0 dBFS
+    m_norm = (2.0f / hann_sum) * (2.0f / hann_sum);
+
+    m_windowed.resize(kSize);
+    m_spectrum.resize(m_fft.bin_count());
+
+    // log spaced bands from 20 Hz to nyquist, at least one fft bin each
+    const auto kNyquist = m_sample_rate / 2.0f;
+    m_band_edges[0] = 1;
+    for (int32_t b = 1; b <= SpectrumTap::kBinCount; ++b)
+    {
+        const auto kFreq = 20.0f * std::pow(kNyquist / 20.0f, static_cast<float>(b) / SpectrumTap::kBinCount);
+        const auto kBin = static_cast<int32_t>(kFreq * kSize / m_sample_rate + 0.5f);
+        m_band_edges[b] = qMax(kBin, m_band_edges[b - 1] + 1);
+    }
+    m_band_edges[SpectrumTap::kBinCount] = qMin(m_band_edges[SpectrumTap::kBinCount], m_fft.bin_count());
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stop();
+}
+
+//! Create a tap for a client; hand it to the DspVolume of that client
+std::shared_ptr<SpectrumTap> SpectrumAnalyzer::AddTap(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    auto tap = std::make_shared<SpectrumTap>(m_sample_rate, getAnalysisRate());
+    QMutexLocker locker(&m_mutex);
+    m_taps.insert(qMakePair(serverConnectionHandlerID, clientID), tap);
+    return tap;
+}
+
+//! Get the tap of a client to read its snapshots; nullptr if there is none
+std::shared_ptr<SpectrumTap> SpectrumAnalyzer::GetTap(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_taps.value(qMakePair(serverConnectionHandlerID, clientID)).lock();
+}
+
+void SpectrumAnalyzer::RemoveTap(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    QMutexLocker locker(&m_mutex);
+    m_taps.remove(qMakePair(serverConnectionHandlerID, clientID));
+}
+
+void SpectrumAnalyzer::RemoveTaps(uint64 serverConnectionHandlerID)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_taps.begin(); it != m_taps.end();)
+    {
+        if (it.key().first == serverConnectionHandlerID)
+            it = m_taps.erase(it);
+        else
+            ++it;
+    }
+}
+
+void SpectrumAnalyzer::RemoveTaps()
+{
+    QMutexLocker locker(&m_mutex);
+    m_taps.clear();
+}
+
+int SpectrumAnalyzer::getAnalysisRate() const
+{
+    return m_analysis_rate.load(std::memory_order_relaxed);
+}
+
+//! Sets the maximum number of analyzed windows per second and client
+void SpectrumAnalyzer::setAnalysisRate(int val)
+{
+    val = qBound(1, val, 60);
+    m_analysis_rate.store(val, std::memory_order_relaxed);
+
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_taps.begin(); it != m_taps.end(); ++it)
+    {
+        if (auto tap = it.value().lock())
+            tap->set_analysis_rate(val);
+    }
+}
+
+void SpectrumAnalyzer::start()
+{
+    if (!m_worker)
+        m_worker = new SpectrumWorker(this);
+
+    if (!m_worker->isRunning())
+        m_worker->start(QThread::LowPriority);
+}
+
+void SpectrumAnalyzer::stop()
+{
+    if (!m_worker)
+        return;
+
+    m_worker->requestInterruption();
+    m_worker->wait();
+}
+
+// worker thread
+
+void SpectrumAnalyzer::analyze_pending()
+{
+    std::vector<std::shared_ptr<SpectrumTap>> taps;
+    {
+        QMutexLocker locker(&m_mutex);
+        taps.reserve(m_taps.size());
+        for (auto it = m_taps.begin(); it != m_taps.end();)
+        {
+            if (auto tap = it.value().lock())
+            {
+                taps.push_back(std::move(tap));
+                ++it;
+            }
+            else
+                it = m_taps.erase(it);
+        }
+    }
+
+    for (const auto& tap : taps)
+    {
+        while (auto window = tap->m_windows.front())
+        {
+            analyze(*tap, *window);
+            tap->m_windows.pop();
+        }
+    }
+}
+
+void SpectrumAnalyzer::analyze(SpectrumTap& tap, const SpectrumTap::Window& window)
+{
+    float peak = 0.0f;
+    for (int32_t i = 0; i < SpectrumTap::kWindowSize; ++i)
+    {
+        peak = qMax(qAbs(window[i]), peak);
+        m_windowed[i] = window[i] * m_hann[i];
+    }
+    m_fft.forward(m_windowed.data(), m_spectrum.data());
+
+    auto& snapshot = tap.m_snapshots[tap.m_back];
+    for (int32_t b = 0; b < SpectrumTap::kBinCount; ++b)
+    {
+        float power = 0.0f;
+        for (auto k = m_band_edges[b]; k < m_band_edges[b + 1]; ++k)
+            power = qMax(std::norm(m_spectrum[k]), power);
+
+        snapshot.bins_db[b] = (power > 0.0f) ? 10.0f * std::log10(power * m_norm) : -200.0f;
+    }
+    snapshot.peak_db = lin2db(peak);
+    snapshot.sequence = ++tap.m_published;
+    tap.publish();
+}
@@ -0,0 +1,354 @@
+#include "volume/submix_bus.h"
+
+#include <QtCore/qmath.h>
+
+#include <cstring>
+
+#include "teamspeak/clientlib_publicdefinitions.h"
+
+#include "volume/dsp_kernels.h"
+
+// SubmixBus
+
+const int32_t SubmixBus::kMaxChannels;
+const int32_t SubmixBus::kMaxFrames;
+
+SubmixBus::SubmixBus(const QString& name, std::unique_ptr<DspChain> chain)
+    : m_name(name)
+    , m_chain(std::move(chain))
+    , m_accumulator(kMaxChannels * kMaxFrames, 0.0f)
+    , m_scratch(kMaxChannels * kMaxFrames, 0.0f)
+{
+    for (int32_t c = 0; c < kMaxChannels; ++c)
+    {
+        m_planes[c] = m_accumulator.data() + c * kMaxFrames;
+        m_scratch_planes[c] = m_scratch.data() + c * kMaxFrames;
+    }
+}
+
+//! Add a members buffer to the sum of the current tick
+/*!
+ * \param samples interleaved samples of the member
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \param channel_fill_mask channels that hold audio
+ * \return false if the buffer does not fit the layout of the tick; route it directly then
+ */
+bool SubmixBus::accumulate(const int16_t* samples, int32_t frame_count, int32_t channels, uint32_t channel_fill_mask)
+{
+    if (m_reset.exchange(false, std::memory_order_acquire))
+        reset();
+
+    if (frame_count <= 0 || frame_count > kMaxFrames || channels <= 0 || channels > kMaxChannels)
+        return false;
+
+    const auto kIsFirst = (m_frame_count == 0);
+    if (kIsFirst)
+    {
+        m_frame_count = frame_count;
+        m_channels = channels;
+        m_member_count = 0;
+    }
+    else if (frame_count != m_frame_count || channels != m_channels)
+        return false;
+
+    // the first member is converted straight into the sum, later ones via the scratch planes
+    DspKernels::deinterleave(samples, kIsFirst ? m_planes.data() : m_scratch_planes.data(), frame_count, channels);
+    for (int32_t c = 0; c < channels; ++c)
+    {
+        const auto kFilled = (channel_fill_mask & (1u << c)) != 0;
+        if (kIsFirst && !kFilled)
+            memset(m_planes[c], 0, frame_count * sizeof(float));
+        else if (!kIsFirst && kFilled)
+            DspKernels::add(m_scratch_planes[c], m_planes[c], frame_count);
+    }
+    ++m_member_count;
+    return true;
+}
+
+//! Run the effects chain over the sum and add it to the master buffer; ends the tick
+/*!
+ * \param samples interleaved master buffer
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \param channel_fill_mask channels of the master buffer that hold audio; the bus channels are added
+ */
+void SubmixBus::mix_into(int16_t* samples, int32_t frame_count, int32_t channels, uint32_t* channel_fill_mask)
+{
+    if (m_reset.exchange(false, std::memory_order_acquire))
+        reset();
+
+    if (m_frame_count == 0)
+    {
+        m_last_member_count.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    m_chain->process(m_planes.data(), m_frame_count, m_channels);
+
+    // the leading kChannels channels of the master buffer as float, plus the bus, back with saturation
+    const auto kFrames = qMin(frame_count, m_frame_count);
+    const auto kChannels = qMin(channels, m_channels);
+    const auto kMask = (1u << kChannels) - 1;
+    DspKernels::gather(samples, m_scratch_planes.data(), kFrames, channels, kMask);
+    for (int32_t c = 0; c < kChannels; ++c)
+    {
+        if (!channel_fill_mask || (*channel_fill_mask & (1u << c)))
+            DspKernels::add(m_planes[c], m_scratch_planes[c], kFrames);
+        else
+            memcpy(m_scratch_planes[c], m_planes[c], kFrames * sizeof(float));
+    }
+    DspKernels::scatter(m_scratch_planes.data(), samples, kFrames, channels, kMask);
+    if (channel_fill_mask)
+        *channel_fill_mask |= kMask;
+
+    m_last_member_count.store(m_member_count, std::memory_order_relaxed);
+    m_frame_count = 0;
+}
+
+void SubmixBus::request_reset()
+{
+    m_reset.store(true, std::memory_order_release);
+}
+
+//! Drop the current tick and the chain state; audio thread
+void SubmixBus::reset()
+{
+    m_frame_count = 0;
+    m_chain->reset();
+}
+
+// SubmixBuses
+
+const int32_t SubmixBuses::kMaxBuses;
+const int32_t SubmixBuses::kMaxConnections;
+
+SubmixBuses::SubmixBuses(QObject* parent, int32_t sample_rate)
+    : QObject(parent)
+    , m_sample_rate(sample_rate)
+{
+    this->setObjectName("SubmixBuses");
+    for (auto& connection : m_connections)
+        connection.store(nullptr, std::memory_order_relaxed);
+}
+
+SubmixBuses::~SubmixBuses()
+{
+    for (auto& connection : m_connections)
+        delete connection.load(std::memory_order_relaxed);
+}
+
+//! Define a bus; existing connections get it as well
+/*!
+ * \param name the bus name
+ * \param factory adds the effect stages of the bus
+ * \return the index of the bus, -1 when all kMaxBuses are in use
+ */
+int32_t SubmixBuses::AddBus(const QString& name, ChainFactory factory)
+{
+    const auto kExisting = GetBusIndex(name);
+    if (kExisting >= 0)
+        return kExisting;
+
+    const auto kIndex = m_bus_count.load(std::memory_order_relaxed);
+    if (kIndex == kMaxBuses)
+        return -1;
+
+    m_names[kIndex] = name;
+    m_factories[kIndex] = std::move(factory);
+    for (auto& entry : m_connections)
+    {
+        if (auto connection = entry.load(std::memory_order_relaxed))
+            connection->buses[kIndex] = make_bus(kIndex);
+    }
+    m_bus_count.store(kIndex + 1, std::memory_order_release);
+    return kIndex;
+}
+
+int32_t SubmixBuses::GetBusIndex(const QString& name) const
+{
+    const auto kCount = m_bus_count.load(std::memory_order_relaxed);
+    for (int32_t i = 0; i < kCount; ++i)
+    {
+        if (m_names[i] == name)
+            return i;
+    }
+    return -1;
+}
+
+//! Get a bus of a connection, e.g. to read its member count; nullptr if there is none
+SubmixBus* SubmixBuses::GetBus(uint64 serverConnectionHandlerID, const QString& name)
+{
+    const auto kIndex = GetBusIndex(name);
+    auto connection = find(serverConnectionHandlerID);
+    return (connection && kIndex >= 0) ? connection->buses[kIndex].get() : nullptr;
+}
+
+//! Route a client to a bus
+/*!
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param name the bus name
+ * \return false if there is no such bus or all connection slots are taken
+ */
+bool SubmixBuses::setRoute(uint64 serverConnectionHandlerID, anyID clientID, const QString& name)
+{
+    const auto kIndex = GetBusIndex(name);
+    if (kIndex < 0)
+        return false;
+
+    auto connection = claim(serverConnectionHandlerID);
+    if (!connection)
+        return false;
+
+    connection->routes[clientID].store(static_cast<int8_t>(kIndex), std::memory_order_relaxed);
+    return true;
+}
+
+//! Route a client directly to the master mix again
+void SubmixBuses::clearRoute(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    if (auto connection = find(serverConnectionHandlerID))
+        connection->routes[clientID].store(-1, std::memory_order_relaxed);
+}
+
+//! The bus name a client is routed to; empty when routed directly
+QString SubmixBuses::getRoute(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    auto connection = find(serverConnectionHandlerID);
+    if (!connection)
+        return QString();
+
+    const auto kIndex = connection->routes[clientID].load(std::memory_order_relaxed);
+    return (kIndex >= 0) ? m_names[kIndex] : QString();
+}
+
+//! Move a post processed client buffer into its bus; call from on_playback_post_process
+/*!
+ * The buffer is silenced and its fill mask cleared, the bus brings the audio back in Mix().
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param samples interleaved samples
+ * \param frame_count number of frames
+ * \param channels number of channels
+ * \param channel_fill_mask the fill mask of the buffer
+ * \return true if the client is routed to a bus and the buffer was taken
+ */
+bool SubmixBuses::Accumulate(uint64 serverConnectionHandlerID, anyID clientID, int16_t* samples, int32_t frame_count, int32_t channels, uint32_t* channel_fill_mask)
+{
+    auto connection = find(serverConnectionHandlerID);
+    if (!connection)
+        return false;
+
+    const auto kIndex = connection->routes[clientID].load(std::memory_order_relaxed);
+    if (kIndex < 0 || kIndex >= m_bus_count.load(std::memory_order_acquire))
+        return false;
+
+    if (channel_fill_mask && !*channel_fill_mask)
+        return true;    // nothing to add
+
+    const auto kFillMask = channel_fill_mask ? *channel_fill_mask : ~0u;
+    if (!connection->buses[kIndex]->accumulate(samples, frame_count, channels, kFillMask))
+        return false;
+
+    memset(samples, 0, frame_count * channels * sizeof(int16_t));
+    if (channel_fill_mask)
+        *channel_fill_mask = 0;
+
+    return true;
+}
+
+//! Run the bus chains once and add them to the mix; call from on_playback_master
+void SubmixBuses::Mix(uint64 serverConnectionHandlerID, int16_t* samples, int32_t frame_count, int32_t channels, uint32_t* channel_fill_mask)
+{
+    auto connection = find(serverConnectionHandlerID);
+    if (!connection)
+        return;
+
+    const auto kCount = m_bus_count.load(std::memory_order_acquire);
+    for (int32_t i = 0; i < kCount; ++i)
+        connection->buses[i]->mix_into(samples, frame_count, channels, channel_fill_mask);
+}
+
+//! When disconnecting from a server tab, clear its routes
+/*!
+ * \brief SubmixBuses::onConnectStatusChanged TS Event
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param newStatus used:STATUS_DISCONNECTED
+ * \param errorNumber unused
+ */
+void SubmixBuses::onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
+{
+    Q_UNUSED(errorNumber);
+    if (newStatus != STATUS_DISCONNECTED)
+        return;
+
+    auto connection = find(serverConnectionHandlerID);
+    if (!connection)
+        return;
+
+    for (auto& route : connection->routes)
+        route.store(-1, std::memory_order_relaxed);
+
+    const auto kCount = m_bus_count.load(std::memory_order_relaxed);
+    for (int32_t i = 0; i < kCount; ++i)
+        connection->buses[i]->request_reset();
+
+    connection->sch_id.store(0, std::memory_order_release);
+}
+
+SubmixBuses::Connection* SubmixBuses::find(uint64 sch_id) const
+{
+    for (auto& entry : m_connections)
+    {
+        auto connection = entry.load(std::memory_order_acquire);
+        if (connection && connection->sch_id.load(std::memory_order_acquire) == sch_id)
+            return connection;
+    }
+    return nullptr;
+}
+
+//! Get or set up the connection of a server tab; Qt side only
+SubmixBuses::Connection* SubmixBuses::claim(uint64 sch_id)
+{
+    if (auto connection = find(sch_id))
+        return connection;
+
+    for (auto& entry : m_connections)
+    {
+        auto connection = entry.load(std::memory_order_relaxed);
+        if (connection && connection->sch_id.load(std::memory_order_relaxed) == 0)
+        {
+            connection->sch_id.store(sch_id, std::memory_order_release);
+            return connection;
+        }
+    }
+
+    for (auto& entry : m_connections)
+    {
+        if (entry.load(std::memory_order_relaxed))
+            continue;
+
+        auto connection = new Connection;
+        for (auto& route : connection->routes)
+            route.store(-1, std::memory_order_relaxed);
+
+        const auto kCount = m_bus_count.load(std::memory_order_relaxed);
+        for (int32_t i = 0; i < kCount; ++i)
+            connection->buses[i] = make_bus(i);
+
+        connection->sch_id.store(sch_id, std::memory_order_relaxed);
+        entry.store(connection, std::memory_order_release);
+        return connection;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<SubmixBus> SubmixBuses::make_bus(int32_t index) const
+{
+    std::unique_ptr<DspChain> chain(new DspChain(m_sample_rate, SubmixBus::kMaxChannels));
+    if (m_factories[index])
+        m_factories[index](*chain);
+
+    return std::unique_ptr<SubmixBus>(new SubmixBus(m_names[index], std::move(chain)));
+}
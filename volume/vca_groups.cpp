@@ -0,0 +1,112 @@
+#include "volume/vca_groups.h"
+
+#include "volume/dsp_volume.h"
+
+// VcaState
+
+const int32_t VcaState::kMaxGroups;
+
+VcaState::VcaState()
+{
+    for (auto& offset : m_offsets)
+        offset.store(VOLUME_0DB, std::memory_order_relaxed);
+}
+
+//! Sum of the offsets of the groups in the mask; audio thread
+float VcaState::sum(uint32_t group_mask) const
+{
+    float result = VOLUME_0DB;
+    for (int32_t group = 0; group_mask; ++group, group_mask >>= 1)
+    {
+        if (group_mask & 1u)
+            result += m_offsets[group].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+// VcaGroups
+
+VcaGroups::VcaGroups(QObject* parent)
+    : QObject(parent)
+    , m_state(std::make_shared<VcaState>())
+{
+    this->setObjectName("VcaGroups");
+}
+
+//! Create a group
+/*!
+ * \brief VcaGroups::AddGroup
+ * \param name the group name, e.g. a squad or server group name
+ * \return the index of the group, -1 when all VcaState::kMaxGroups are in use
+ */
+int32_t VcaGroups::AddGroup(const QString& name)
+{
+    const auto kExisting = GetGroupIndex(name);
+    if (kExisting >= 0)
+        return kExisting;
+
+    if (m_names.size() == VcaState::kMaxGroups)
+        return -1;
+
+    m_names.append(name);
+    return m_names.size() - 1;
+}
+
+int32_t VcaGroups::GetGroupIndex(const QString& name) const
+{
+    return m_names.indexOf(name);
+}
+
+QString VcaGroups::GetGroupName(int32_t group) const
+{
+    return m_names.value(group);
+}
+
+//! Move the fader of a group
+/*!
+ * O(1) regardless of the member count: the offset is stored and the epoch bumped,
+ * members pick the new sum up with their next block.
+ * \brief VcaGroups::setGroupGain
+ * \param group the group index
+ * \param gain_db the group offset (dB)
+ */
+void VcaGroups::setGroupGain(int32_t group, float gain_db)
+{
+    if (group < 0 || group >= m_names.size())
+        return;
+
+    auto& offset = m_state->m_offsets[group];
+    if (offset.load(std::memory_order_relaxed) == gain_db)
+        return;
+
+    offset.store(gain_db, std::memory_order_relaxed);
+    m_state->m_epoch.fetch_add(1, std::memory_order_release);
+    emit groupGainChanged(group, gain_db);
+}
+
+float VcaGroups::getGroupGain(int32_t group) const
+{
+    if (group < 0 || group >= m_names.size())
+        return VOLUME_0DB;
+
+    return m_state->m_offsets[group].load(std::memory_order_relaxed);
+}
+
+//! Add a volume to or remove it from a group
+void VcaGroups::setMember(DspVolume* volume, int32_t group, bool is_member)
+{
+    if (!volume || group < 0 || group >= VcaState::kMaxGroups)
+        return;
+
+    const auto kBit = 1u << group;
+    const auto kMask = volume->getVcaGroups();
+    volume->setVcaGroups(is_member ? (kMask | kBit) : (kMask & ~kBit));
+}
+
+bool VcaGroups::isMember(const DspVolume* volume, int32_t group)
+{
+    if (!volume || group < 0 || group >= VcaState::kMaxGroups)
+        return false;
+
+    return (volume->getVcaGroups() & (1u << group)) != 0;
+}
@@ -0,0 +1,68 @@
+#include "volume/voice_activity.h"
+
+#include <QtCore/qmath.h>
+
+VoiceActivity::VoiceActivity(int32_t sample_rate)
+    : m_sample_rate(sample_rate)
+{
+}
+
+//! Classify a frame and advance onset / hangover
+/*!
+ * \brief VoiceActivity::update
+ * \param levels DspKernels::measure of the interleaved frame
+ * \param frame_count number of frames
+ * \param channels number of channels; the spectral criteria are only meaningful for mono
+ * \return is voice active
+ */
+bool VoiceActivity::update(const DspKernels::Levels& levels, int32_t frame_count, int32_t channels)
+{
+    const auto kSampleCount = frame_count * channels;
+    if (kSampleCount <= 0)
+        return m_active;
+
+    const auto kMeanSquare = levels.energy / kSampleCount;
+    const auto kTime = static_cast<float>(frame_count) / m_sample_rate;
+
+    auto is_voice = (kMeanSquare > kAbsoluteFloor) && (kMeanSquare > kSnr * m_noise_floor);
+    if (is_voice && (channels == 1))
+    {
+        is_voice = (levels.zero_crossings < kMaxCrossingRate * kSampleCount)
+                && (levels.diff_energy < kMaxHighBandRatio * levels.energy);
+    }
+
+    // the floor follows dips quickly and rises slowly, and only while there is no voice
+    if (kMeanSquare < m_noise_floor)
+        m_noise_floor += qMin(1.0f, kTime / kFloorFall) * (kMeanSquare - m_noise_floor);
+    else if (!is_voice)
+        m_noise_floor += qMin(1.0f, kTime / kFloorRise) * (kMeanSquare - m_noise_floor);
+    m_noise_floor = qMax(m_noise_floor, kAbsoluteFloor * 0.01f);
+
+    if (is_voice)
+    {
+        m_voiced += frame_count;
+        if (m_voiced >= static_cast<int32_t>(kOnset * m_sample_rate))
+        {
+            m_active = true;
+            m_hangover = static_cast<int32_t>(kHangover * m_sample_rate);
+        }
+    }
+    else
+    {
+        m_voiced = 0;
+        if (m_active)
+        {
+            m_hangover -= frame_count;
+            m_active = (m_hangover > 0);
+        }
+    }
+    return m_active;
+}
+
+void VoiceActivity::reset()
+{
+    m_noise_floor = kNoiseFloorInit;
+    m_voiced = 0;
+    m_hangover = 0;
+    m_active = false;
+}
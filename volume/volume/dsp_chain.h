@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A float processing step; works on one plane per channel, normalized to [-1, 1)
+class DspStage
+{
+public:
+    virtual ~DspStage() = default;
+
+    // Called off the audio thread before the first frame, with the most channels process will be given; may allocate
+    virtual void prepare(int32_t sample_rate, int32_t max_channels) { (void)sample_rate; (void)max_channels; }
+    // Drop any state carried over from earlier frames; also called when the channel count changes. Must not allocate.
+    virtual void reset() {}
+
+    virtual void process(float* const* planes, int32_t frame_count, int32_t channels) = 0;     // channels <= max_channels
+};
+
+// Runs a list of stages over an interleaved int16 frame with a single int16 <-> float round trip.
+// The float planes are taken from the ScratchArena of the calling thread.
+// Stages are sized for max_channels when added, so a change of the channel count on the audio thread only resets them;
+// frames with more channels are left untouched.
+class DspChain
+{
+public:
+    static const int32_t kMaxChannels = 8;  // 7.1
+
+    explicit DspChain(int32_t sample_rate = 48000, int32_t max_channels = kMaxChannels);
+
+    void add_stage(std::unique_ptr<DspStage> stage);   // before the first process call
+    bool empty() const { return m_stages.empty(); }
+    int32_t sample_rate() const { return m_sample_rate; }
+    int32_t max_channels() const { return m_max_channels; }
+
+    void prepare(int32_t max_channels);     // off the audio thread
+    void reset();
+
+    bool process(int16_t* samples, int32_t frame_count, int32_t channels);
+    bool process(float* const* planes, int32_t frame_count, int32_t channels);
+
+private:
+    const int32_t m_sample_rate;
+    int32_t m_max_channels;
+    int32_t m_channels = 0;                 // of the last frame; audio thread
+    std::vector<std::unique_ptr<DspStage>> m_stages;
+};
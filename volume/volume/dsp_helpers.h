@@ -3,6 +3,8 @@
 
 #include <QtCore/qmath.h>
 
+#include "teamspeak/public_definitions.h"
+
 // Peak
 static inline float getPeak(float *samples, int sampleCount)
 {
@@ -50,4 +52,19 @@ static inline float getPeakRMS(float *samples, int sampleCount, float& rms)
     return peak;
 }
 
+// Channels of the front left and right (or headphone) speakers of a post process / master buffer
+static inline bool getStereoPair(const unsigned int* channelSpeakerArray, int channels, int& left, int& right)
+{
+    left = -1;
+    right = -1;
+    for (int i = 0; i < channels; ++i)
+    {
+        if ((channelSpeakerArray[i] == SPEAKER_FRONT_LEFT) || (channelSpeakerArray[i] == SPEAKER_HEADPHONES_LEFT))
+            left = (left < 0) ? i : left;
+        else if ((channelSpeakerArray[i] == SPEAKER_FRONT_RIGHT) || (channelSpeakerArray[i] == SPEAKER_HEADPHONES_RIGHT))
+            right = (right < 0) ? i : right;
+    }
+    return (left >= 0) && (right >= 0);
+}
+
 #endif // DSP_HELPERS_H
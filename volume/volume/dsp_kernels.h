@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+// Sample format and layout kernels shared by the DSP stages in volume/.
+// Float samples are normalized to [-1, 1). The implementation (scalar, SSE2, AVX2) is picked once at runtime
+// from the CPU features; the aligned code paths are used when all buffers are aligned to the vector width.
+namespace DspKernels
+{
+    enum class Isa : uint_least8_t
+    {
+        SCALAR = 0,
+        SSE2,
+        AVX2
+    };
+
+    Isa get_isa();
+    Isa get_best_isa();
+    void set_isa(Isa isa);  // clamped to get_best_isa(); for benchmarking and debugging
+
+    // Xorshift generator, one state per vector lane; TPDF dither and noise
+    struct DitherState
+    {
+        explicit DitherState(uint32_t seed = 0x9E3779B9u);
+        uint32_t lanes[8];
+    };
+
+    // Format conversion
+    void int16_to_float(const int16_t* in, float* out, int32_t count);
+    void float_to_int16(const float* in, int16_t* out, int32_t count);     // round to nearest, saturating
+    void float_to_int16(const float* in, int16_t* out, int32_t count, DitherState& dither);  // +-1 LSB TPDF
+
+    // Layout; planes are float, the interleaved side int16 as delivered by the client
+    void deinterleave(const int16_t* in, float* const* planes, int32_t frame_count, int32_t channels);
+    void interleave(const float* const* planes, int16_t* out, int32_t frame_count, int32_t channels);
+    int32_t gather(const int16_t* in, float* const* planes, int32_t frame_count, int32_t channels, uint32_t channel_mask);
+    int32_t scatter(const float* const* planes, int16_t* out, int32_t frame_count, int32_t channels, uint32_t channel_mask);
+    void downmix(const int16_t* in, float* out, int32_t frame_count, int32_t channels);    // average of all channels
+
+    // Fused meter pass over mono int16 samples; also feeds the voice activity detector
+    struct Levels
+    {
+        int32_t peak = 0;           // largest magnitude, 0..32767
+        float energy = 0.0f;        // sum of the squared normalized samples
+        float diff_energy = 0.0f;   // same for the first difference; the high band
+        int32_t zero_crossings = 0; // sign changes between neighbouring samples
+    };
+    Levels measure(const int16_t* samples, int32_t count);     // count < 2^18
+
+    // In place int16
+    bool is_silent(const int16_t* samples, int32_t count);
+    void apply_gain_q15(int16_t* samples, int32_t count, int32_t gain_q15);   // gain = gain_q15 / 32768, < 4.0
+    void clear_channels(int16_t* samples, int32_t frame_count, int32_t channels, uint32_t channel_mask);   // others untouched
+    // Volume and pan in one pass: the source channel of each frame is written to the left and right channels
+    // with their own gain; other channels are left untouched
+    void apply_gain_pan_q15(int16_t* samples, int32_t frame_count, int32_t channels,
+                            int32_t source, int32_t left, int32_t right, int32_t gain_left_q15, int32_t gain_right_q15);
+
+    // In place float
+    void scale(float* samples, int32_t count, float gain);
+    void multiply(float* samples, const float* gains, int32_t count);      // samples[i] *= gains[i]
+    void add(const float* in, float* acc, int32_t count);                  // acc[i] += in[i]
+    void soft_clip(float* samples, int32_t count, float drive);    // cubic on the driven signal, output in [-1, 1]
+    void quantize(float* samples, int32_t count, float levels);    // round(x * levels) / levels, x clamped to [-1, 1]
+    // Uniform noise in [-amplitude, amplitude); sample i comes from lane i % 8, so all ISAs agree bit by bit
+    void add_noise(float* samples, int32_t count, float amplitude, DitherState& state);
+
+    // Complex, interleaved re / im as std::complex<float>: acc[i] += a[i] * b[i] for count values
+    void complex_multiply_add(const float* a, const float* b, float* acc, int32_t count);
+
+    // Compressor gain computer over a block: static gain reduction of each magnitude, soft knee.
+    // Levels are in log2 units (1 = 6.02 dB); fast polynomial log2, about 1e-3 dB error.
+    struct CompressorCurve
+    {
+        float threshold = 0.0f;     // log2 of the linear threshold
+        float knee = 0.0f;          // knee width (log2 units)
+        float slope = 0.0f;         // 1 - 1 / ratio
+    };
+    void compressor_curve(const float* magnitudes, float* reduction, int32_t count, const CompressorCurve& curve);   // reduction >= 0
+    void fast_exp2(const float* in, float* out, int32_t count);    // in [-126, 126]; about 1e-4 relative error
+
+    // Biquad cascade over kBiquadLanes independent signals at once, one talker per lane (transposed direct form II).
+    // data: frame_count * kBiquadLanes samples, lane interleaved; coefficients: sections * 5 * kBiquadLanes
+    // (b0, b1, b2, a1, a2, each for all lanes, a0 normalized to 1); state: sections * 2 * kBiquadLanes
+    void biquad_lanes(const float* coefficients, float* state, float* data, int32_t frame_count, int32_t sections);
+
+    const int32_t kBiquadLanes = 8;
+
+    // Largest linear gain apply_gain_q15 takes (integer part 0..3, just above +12 dB)
+    const float kGainQ15Max = 4.0f;
+}
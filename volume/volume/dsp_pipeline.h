@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QSemaphore>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+#include "spsc_queue.h"
+#include "dsp_chain.h"
+
+class EqBank;
+
+// Per client connection between the audio thread and the DspPipeline workers.
+// exchange() hands frame N to the workers and puts the processed frame N-1 into the buffer,
+// so the pipeline adds exactly one frame of latency. When N-1 is not back in time the dry N-1 is used.
+class DspPipelineSlot
+{
+public:
+    static const int32_t kMaxSamples = 2048;   // frames * channels; larger frames are not pipelined
+
+    explicit DspPipelineSlot(std::unique_ptr<DspChain> chain);
+
+    bool exchange(int16_t* samples, int32_t frame_count, int32_t channels);
+
+    uint32_t missed_deadlines() const { return m_missed.load(std::memory_order_relaxed); }
+
+private:
+    friend class DspPipeline;
+
+    struct Frame
+    {
+        uint64_t sequence = 0;
+        int32_t frame_count = 0;
+        int32_t channels = 0;
+        std::array<int16_t, kMaxSamples> samples;
+    };
+
+    bool process_pending();
+
+    // worker side; m_busy keeps the consumer single while workers take turns
+    std::unique_ptr<DspChain> m_chain;
+    std::atomic_flag m_busy = ATOMIC_FLAG_INIT;
+
+    SpscQueue<Frame, 4> m_input;    // audio -> worker
+    SpscQueue<Frame, 4> m_output;   // worker -> audio
+
+    // audio thread
+    Frame m_dry[2];
+    int32_t m_dry_index = 0;
+    uint64_t m_sequence = 0;
+    std::chrono::steady_clock::time_point m_last_exchange;
+    std::atomic<uint32_t> m_missed{0};
+    std::shared_ptr<QSemaphore> m_wakeup;   // of the pipeline; released once per queued frame
+
+    int32_t m_eq_lane = -1;         // lane in the EqBank of the pipeline, -1: none
+};
+
+class DspPipelineWorker;
+
+// Opt-in pipelined mode for heavy per client processing (convolution, spectral noise suppression).
+// The DspChain of every slot runs on a pool of worker threads instead of the clients audio thread.
+class DspPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    using ChainFactory = std::function<void(DspChain& chain)>;
+
+    explicit DspPipeline(QObject* parent = nullptr, int32_t worker_count = 0, int32_t sample_rate = 48000);
+    ~DspPipeline();
+
+    void setChainFactory(ChainFactory factory);
+    void setEqBank(EqBank* bank);
+
+    std::shared_ptr<DspPipelineSlot> AddSlot(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveSlot(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveSlots(uint64 serverConnectionHandlerID);
+    void RemoveSlots();
+
+    uint32_t getMissedDeadlines();
+
+    void start();
+    void stop();
+
+private:
+    friend class DspPipelineWorker;
+    bool process_pending(std::vector<std::shared_ptr<DspPipelineSlot>>& active, uint32_t& generation, size_t first);
+    bool process_group(const std::shared_ptr<DspPipelineSlot>* members, size_t count, int32_t group);
+
+    const int32_t m_sample_rate;
+    int32_t m_worker_count;
+    ChainFactory m_chain_factory;
+    EqBank* m_eq_bank = nullptr;
+
+    QMutex m_mutex;     // guards m_slots between Qt and worker threads; never taken on the audio thread
+    QHash<QPair<uint64, anyID>, std::shared_ptr<DspPipelineSlot> > m_slots;
+    std::atomic<uint32_t> m_generation{0};  // bumped on every change of m_slots
+    std::shared_ptr<QSemaphore> m_wakeup;   // workers sleep on it until a slot queues a frame
+
+    std::vector<DspPipelineWorker*> m_workers;
+};
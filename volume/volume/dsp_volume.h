@@ -2,6 +2,18 @@
 
 #include <QtCore/QObject>
 
+#include <atomic>
+#include <memory>
+
+#include "gain_automation.h"
+#include "noise_gate.h"
+#include "voice_activity.h"
+
+class SpectrumTap;
+class ReplayHistory;
+class DspPipelineSlot;
+class VcaState;
+
 const float VOLUME_0DB = (0.0f);
 const float VOLUME_MUTED = (-200.0f);
 
@@ -14,7 +26,17 @@ class DspVolume : public QObject
     Q_PROPERTY(bool muted READ isMuted WRITE setMuted)
 
 public:
+    // Work skipped by the last process call
+    enum class Bypass_Mode : uint_least8_t
+    {
+        NONE = 0,   // gain applied
+        UNITY,      // current gain is exactly 0 dB
+        MUTED,      // faded out completely; buffer zeroed
+        SILENT      // input is digital silence
+    };
+
     explicit DspVolume(QObject *parent = 0);
+    ~DspVolume();
 
     // Properties
     void setGainCurrent(float val);
@@ -25,9 +47,36 @@ public:
     virtual void setProcessing(bool val);
     void setMuted(bool val);
     bool isMuted() const;
+    Bypass_Mode getBypassMode() const;
+    void setGainRule(float val);
+    float getGainRule() const;
+    void setVcaState(std::shared_ptr<const VcaState> state);
+    void setVcaGroups(uint32_t group_mask);
+    uint32_t getVcaGroups() const;
+
+    void setSpectrumTap(std::shared_ptr<SpectrumTap> tap);
+    void setReplayHistory(std::shared_ptr<ReplayHistory> history);
+    void setPipelineSlot(std::shared_ptr<DspPipelineSlot> slot);
+    void setVoiceSidechain(std::shared_ptr<VoiceSidechain> sidechain);
+    bool isVoiceActive() const;
+    void setPan(float position);
+    void clearPan();
+    bool isPanned() const;
+    float getPan() const;
+    void setNoiseGate(const NoiseGate::Parameters& parameters);
+    void setGainAutomation(std::shared_ptr<GainAutomation> automation);
+    bool hasGainAutomation() const;
+    bool scheduleGain(float gain_db, float ramp_ms = 0.0f, int64_t time_us = GainAutomation::now());
+    bool scheduleMute(bool val, float ramp_ms = 0.0f, int64_t time_us = GainAutomation::now());
+    void clearNoiseGate();
+    bool isGateOpen() const;
 
     virtual void process(short* samples, int sampleCount, int channels);
-    virtual float GetFadeStep(int sampleCount);
+    void processPanned(short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask);
+    virtual bool needsMultichannel() const;
+    void setPreProcessed(bool val);
+    bool takePreProcessed();
+    virtual float GetFadeStep(int frameCount);     // rates are per second, so the step is per frame, not per sample
 
 signals:
     void gainCurrentChanged(float);
@@ -37,11 +86,56 @@ public slots:
     
 protected:
     unsigned short m_sampleRate = 48000;
-    void doProcess(short *samples, int sampleCount);
+    void doProcess(short *samples, int sampleCount, float gain);
+    void processGain(short *samples, int sampleCount, int channels, bool isSilent);
+    float stepGainOffset(int frameCount);
+    void processTaps(short *samples, int sampleCount, int channels);
+    bool processVoiceActivity(const DspKernels::Levels& levels, int sampleCount, int channels);
+    bool processGate(short *samples, int sampleCount, int channels, const DspKernels::Levels& levels, bool isSilent);
+    bool isGateEnabled() const;
     bool m_isProcessing = false;
+    bool m_float_path = false;  // set by subclasses that run float stages; disables the fixed point gain
+    std::shared_ptr<SpectrumTap> m_spectrum_tap;
+    std::shared_ptr<ReplayHistory> m_replay_history;
+    std::shared_ptr<DspPipelineSlot> m_pipeline_slot;
+    std::shared_ptr<VoiceSidechain> m_voice_sidechain;
 
 private:
     float m_gainCurrent = VOLUME_0DB;   // decibels
     float m_gainDesired = VOLUME_0DB;   // decibels
     bool m_muted = false;
+    Bypass_Mode m_bypass_mode = Bypass_Mode::NONE;
+    std::atomic<float> m_gainRule{VOLUME_0DB};  // decibels; resolved by VolumeRules on the Qt thread
+    float m_gainOffset = VOLUME_0DB;            // decibels; audio thread, fades towards the rule plus vca gain
+
+    std::shared_ptr<const VcaState> m_vca_state;
+    std::atomic<uint32_t> m_vca_groups{0};      // member of these groups
+    uint32_t m_vca_epoch = 0;                   // audio thread; state of the cached sum
+    uint32_t m_vca_mask = 0;
+    float m_vca_sum = VOLUME_0DB;
+
+    VoiceActivity m_voice_activity;             // audio thread
+    std::atomic<bool> m_voice_active{false};
+    std::atomic<bool> m_voice_keyed{false};     // counted in m_voice_sidechain
+    void keyVoiceSidechain(bool val);
+
+    std::atomic<bool> m_is_pre_processed{false};   // this block ran in the pre process stage; see Volumes
+
+    NoiseGate m_noise_gate;
+    std::shared_ptr<GainAutomation> m_gain_automation;
+    void processAutomation(short *samples, int sampleCount, int channels, float gain, bool isSilent, bool isMuted);
+
+    // Stereo placement; applied by processPanned in the same pass as the gain
+    struct PanLayout
+    {
+        int source = -1;    // -1: not panning this call
+        int left = 0;
+        int right = 1;
+        int channels = 2;
+        float position = 0.0f;
+    };
+    std::atomic<float> m_pan{0.0f};             // -1 (left) .. 1 (right)
+    std::atomic<bool> m_is_panned{false};
+    PanLayout m_pan_layout;                     // audio thread
+    void doProcessPanned(short *samples, int sampleCount, float gain);
 };
@@ -13,7 +13,7 @@ public:
     explicit DspVolumeAGMU(QObject* parent = nullptr);
 
     void process(int16_t* samples, int32_t sample_count, int32_t channels);
-    float GetFadeStep(int32_t sample_count);
+    float GetFadeStep(int32_t frame_count);
     int16_t GetPeak() const;
     void setPeak(int16_t val);    //Overwrite peak; use for reinitializations with cache values etc.
     float computeGainDesired();
@@ -0,0 +1,56 @@
+#pragma once
+
+// "Gain sharing automatic mixer" variant
+
+#include <QtCore/QObject>
+
+#include <atomic>
+#include <memory>
+
+#include "dsp_volume.h"
+
+// Energy of all talkers of a Volumes object; every DspVolumeAutomix adds its own share
+class AutomixState
+{
+public:
+    static const uint64_t kUnity = 1ull << 32;   // fixed point mean square of a full scale square wave
+
+    uint64_t total() const { return m_total.load(std::memory_order_relaxed); }
+
+private:
+    friend class DspVolumeAutomix;
+    std::atomic<uint64_t> m_total{0};
+};
+
+// Attenuates each talker by its share of the total energy (Dugan style gain sharing),
+// so the sum of all talkers stays at the level of a single one.
+class DspVolumeAutomix : public DspVolume
+{
+    Q_OBJECT
+
+public:
+    explicit DspVolumeAutomix(QObject* parent = nullptr, std::shared_ptr<AutomixState> state = nullptr);
+    ~DspVolumeAutomix();
+
+    void process(int16_t* samples, int32_t sample_count, int32_t channels) override;
+    float GetFadeStep(int32_t frame_count) override;
+    void setProcessing(bool val) override;
+
+    float getShare() const;     // dB, <= 0
+    int16_t getPeak() const;    // of the last frame
+
+private:
+    void publish(uint64_t energy);
+
+    const float kRateLouder = 60.0f;
+    const float kRateQuieter = 240.0f;
+    const float kTimeConstant = 0.1f;   // energy smoothing (s)
+    const float kShareMin = -30.0f;     // dB
+
+    std::shared_ptr<AutomixState> m_state;
+    std::atomic<uint64_t> m_published{0};   // this talkers part of the total
+    std::atomic<bool> m_talking{true};
+    float m_energy = 0.0f;                  // smoothed mean square; audio thread
+    std::atomic<float> m_share{VOLUME_0DB};
+    std::atomic<int16_t> m_peak{0};
+};
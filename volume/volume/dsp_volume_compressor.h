@@ -0,0 +1,71 @@
+#pragma once
+
+// "Compressor" variant
+
+#include <QtCore/QObject>
+
+#include <atomic>
+
+#include "dsp_volume.h"
+#include "dsp_kernels.h"
+
+// Feed forward compressor with threshold, ratio, soft knee, attack and release, ahead of the volume gain.
+// Level detection and the static curve run block-wise in the log2 domain (DspKernels::compressor_curve),
+// the gains are converted back the same way (DspKernels::fast_exp2); only the envelope is per sample.
+// Parameters become coefficients on the calling thread, through a cache shared by all compressors,
+// and reach the audio thread through a triple buffer: no transcendental math on the audio path.
+class DspVolumeCompressor : public DspVolume
+{
+    Q_OBJECT
+
+public:
+    struct Parameters
+    {
+        float threshold_db = -18.0f;
+        float ratio = 3.0f;         // >= 1
+        float knee_db = 6.0f;
+        float attack_ms = 5.0f;
+        float release_ms = 120.0f;
+        float makeup_db = 0.0f;
+
+        bool operator==(const Parameters& other) const;
+        bool operator!=(const Parameters& other) const { return !(*this == other); }
+    };
+
+    explicit DspVolumeCompressor(QObject* parent = nullptr);
+
+    void process(int16_t* samples, int32_t sample_count, int32_t channels) override;
+
+    void setParameters(const Parameters& parameters);
+    Parameters getParameters() const;
+    float getGainReduction() const;     // dB, >= 0; largest of the last frame
+
+private:
+    struct Coefficients
+    {
+        DspKernels::CompressorCurve curve;
+        float attack = 0.0f;    // one pole, per sample
+        float release = 0.0f;
+        float makeup = 0.0f;    // log2 units
+    };
+
+    static Coefficients Lookup(const Parameters& parameters, int32_t sample_rate);
+    void compress(int16_t* samples, int32_t frame_count, int32_t channels);
+    void release(int32_t frame_count);
+
+    static const int32_t kFresh = 4;
+    static const int32_t kChunk = 256;  // frames per block of the gain computer
+
+    Parameters m_parameters;            // Qt thread
+
+    // triple buffer: setParameters writes m_back, the audio thread reads m_front, m_middle is swapped atomically
+    Coefficients m_coefficients[3];
+    std::atomic<int32_t> m_middle{1};
+    int32_t m_back = 0;
+    int32_t m_front = 2;
+
+    float m_envelope = 0.0f;            // smoothed gain reduction (log2 units); audio thread
+    std::atomic<float> m_gain_reduction{0.0f};
+};
+
+uint qHash(const DspVolumeCompressor::Parameters& key, uint seed = 0);
@@ -15,7 +15,7 @@ class DspVolumeDucker : public DspVolume
 public:
     explicit DspVolumeDucker(QObject *parent = 0);
     
-    float GetFadeStep(int sampleCount);
+    float GetFadeStep(int frameCount);
 
     float getAttackRate() const;
     float getDecayRate() const;
@@ -23,6 +23,7 @@ public:
     bool isDuckBlocked() const;
     void setDuckBlocked(bool val);
     void setProcessing(bool val);
+    void setSidechainKey(std::shared_ptr<const VoiceSidechain> key);
 
 signals:
     void attackRateChanged(float);
@@ -39,4 +40,9 @@ private:
 
     bool m_gainAdjustment = false;
     bool m_isDuckBlocked = false;
+    std::shared_ptr<const VoiceSidechain> m_sidechain_key;  // replaces gainAdjustment when set
+
+    bool isDucking() const;
+    bool isAutomated() const;
+    void scheduleDuck();
 };
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QtCore/QString>
+
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "fft.h"
+
+// Far end reference of the echo suppressor: the mixed playback of a server connection, downmixed to mono.
+// push() from on_playback_master, read by one EchoSuppressor in on_captured; single producer / single consumer,
+// lock free. Readers address samples by their absolute position, see head().
+class EchoReference
+{
+public:
+    static const int32_t kSize = 1 << 16;       // 1.36 s at 48 kHz
+    static const int32_t kGuard = 4096;         // never read this close to being overwritten
+
+    EchoReference();
+
+    void push(const int16_t* samples, int32_t frame_count, int32_t channels);
+    uint64_t head() const { return m_head.load(std::memory_order_acquire); }   // samples pushed so far
+    void read(int64_t position, float* out, int32_t count) const;              // zeros where not available
+
+private:
+    std::vector<float> m_ring;
+    std::atomic<uint64_t> m_head{0};
+};
+
+// Finds the bulk delay between playback and its echo in the mic by correlating the block envelopes of both.
+// The correlation of every lag is updated incrementally, so each block costs O(kMaxLag).
+class EchoDelayEstimator
+{
+public:
+    static const int32_t kMaxLag = 188;     // blocks; 500 ms in blocks of 128
+    static const int32_t kWindow = 375;     // blocks correlated; 1 s
+
+    EchoDelayEstimator();
+
+    void reset();
+    void update(float reference_energy, float mic_energy);
+    int32_t lag() const { return m_lag; }   // blocks, -1 until found
+
+private:
+    const float kMinCorrelation = 0.4f;
+    const float kKeepCorrelation = 0.2f;    // hysteresis: the current lag is dropped below this
+    const int32_t kEvaluateInterval = 25;
+
+    float envelope(float energy, float& mean);
+    void evaluate();
+
+    std::vector<float> m_reference;     // ring of kWindow + kMaxLag envelopes
+    std::vector<float> m_mic;           // ring of kWindow envelopes
+    std::vector<double> m_correlation;  // per lag
+    std::vector<double> m_reference_energy;
+    double m_mic_energy = 0.0;
+    float m_reference_mean = 0.0f;
+    float m_mic_mean = 0.0f;
+    int64_t m_block = 0;
+    int32_t m_lag = -1;
+    int32_t m_candidate = -1;
+};
+
+// Acoustic echo suppressor for the capture path: removes the playback picked up by the mic.
+// Bulk delay from EchoDelayEstimator, echo path from a partitioned block frequency domain adaptive filter
+// (NLMS, one gradient constraint per block), Geigel double talk detection freezing adaptation,
+// and a broadband residual suppressor.
+// Fixed budget per block of 128 samples: 5 real FFTs of 256, 2 * kPartitions * 129 complex MACs,
+// O(kMaxLag) for the delay estimate. Adds kBlockSize samples of latency; no allocation after construction.
+class EchoSuppressor
+{
+public:
+    static const int32_t kBlockSize = 128;
+    static const int32_t kPartitions = 16;      // echo tail after the bulk delay: 2048 samples, 43 ms
+
+    explicit EchoSuppressor(std::shared_ptr<const EchoReference> reference);
+
+    void setEnabled(bool val);
+    bool isEnabled() const;
+    void setSuppression(float val);     // depth of the residual suppression (dB, <= 0)
+    float getSuppression() const;
+    int32_t getDelay() const;           // samples, -1 while searching
+    float getErle() const;              // echo return loss enhancement of the filter (dB)
+    void reset();
+
+    void process(int16_t* samples, int32_t frame_count, int32_t channels);     // on_captured, 48 kHz
+
+    static bool ProcessFiles(const QString& playback_path, const QString& mic_path, const QString& out_path, QString* error = nullptr);
+
+private:
+    static const int32_t kFftSize = 2 * kBlockSize;
+    static const int32_t kBins = kFftSize / 2 + 1;
+
+    using Spectrum = std::vector<std::complex<float>>;
+
+    const float kStepSize = 0.5f;
+    const float kGeigel = 0.5f;             // near end louder than half the far end peak: double talk
+    const int32_t kDoubleTalkHold = 30;     // blocks
+    const int32_t kDelayMargin = 2;         // blocks the reference is taken early; the filter covers them
+    const float kOverSuppression = 2.0f;
+
+    void process_block();
+    void restart_filter();
+
+    std::shared_ptr<const EchoReference> m_reference;
+    EchoDelayEstimator m_estimator;
+    RealFft m_fft;
+
+    std::vector<Spectrum> m_history;    // reference spectra, ring of kPartitions
+    std::vector<Spectrum> m_weights;
+    Spectrum m_acc;
+    Spectrum m_error;
+    std::vector<float> m_power;         // smoothed reference power per bin
+    std::vector<float> m_window;        // last two reference blocks
+    std::vector<float> m_time;
+    std::vector<float> m_block_peaks;   // reference peak per block, ring of kPartitions
+
+    // block FIFO
+    std::vector<float> m_mic_block;
+    std::vector<float> m_reference_block;
+    std::vector<float> m_out_block;
+    std::vector<float> m_read;
+    float m_reference_energy = 0.0f;    // of the unaligned reference, for the estimator
+    float m_mic_energy = 0.0f;
+    int32_t m_fill = 0;
+
+    int32_t m_pos = 0;
+    int32_t m_constrain = 0;
+    int32_t m_double_talk = 0;
+    float m_gain = 1.0f;
+    float m_echo_energy = 0.0f;
+    float m_error_energy = 0.0f;
+
+    std::atomic<bool> m_enabled{true};
+    std::atomic<float> m_suppression{-24.0f};
+    std::atomic<int32_t> m_delay{-1};
+    std::atomic<float> m_erle{0.0f};
+};
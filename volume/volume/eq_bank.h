@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+#include "dsp_kernels.h"
+
+// Per talker EQ for the DspPipeline workers: a high-pass against rumble and a presence peak.
+// Coefficients and filter state are laid out structure of arrays in groups of kLanes talkers,
+// so one kernel pass (DspKernels::biquad_lanes) advances the filters of a whole group.
+// Talkers with the same settings share one coefficient set; a set is computed when its settings
+// are first used, not per frame.
+class EqBank : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int32_t kLanes = DspKernels::kBiquadLanes;
+    static const int32_t kSections = 2;
+    static const int32_t kMaxGroups = 32;
+    static const int32_t kMaxLanes = kMaxGroups * kLanes;
+
+    struct Settings
+    {
+        float highpass_hz = 0.0f;       // 0: off
+        float presence_db = 0.0f;       // 0: off
+        float presence_hz = 3000.0f;
+        float presence_q = 1.0f;
+
+        bool operator==(const Settings& other) const;
+        bool operator!=(const Settings& other) const { return !(*this == other); }
+    };
+
+    explicit EqBank(QObject* parent = nullptr, int32_t sample_rate = 48000);
+
+    int32_t AddLane(uint64 serverConnectionHandlerID, anyID clientID);     // -1 when all lanes are in use
+    void RemoveLane(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveLanes(uint64 serverConnectionHandlerID);
+    void RemoveLanes();
+
+    void setDefaultSettings(const Settings& settings);     // for talkers without their own
+    Settings getDefaultSettings() const;
+    void setSettings(uint64 serverConnectionHandlerID, anyID clientID, const Settings& settings);
+    void clearSettings(uint64 serverConnectionHandlerID, anyID clientID);
+    Settings getSettings(uint64 serverConnectionHandlerID, anyID clientID) const;
+    int32_t getCoefficientSetCount() const;    // distinct settings in use
+
+    // worker threads; a group is processed by one thread at a time
+    bool try_lock_group(int32_t group);
+    void unlock_group(int32_t group);
+    void process(int32_t group, float* const* planes, int32_t frame_count);
+
+private:
+    static const int32_t kFlatSet = 0;  // pass through
+    static const int32_t kCoefficients = kSections * 5;
+    static const int32_t kGroupFloats = (kSections * 5 + kSections * 2) * kLanes;
+
+    // Rewritten only while no lane refers to it; the version makes it a seqlock for the workers
+    struct CoefficientSet
+    {
+        std::atomic<uint32_t> version{0};   // odd while being written
+        std::array<std::atomic<float>, kCoefficients> values;
+    };
+
+    struct Lane
+    {
+        QPair<uint64, anyID> client;
+        bool has_settings = false;
+        Settings settings;
+        int32_t set = kFlatSet;
+    };
+
+    // worker side of a group
+    struct Group
+    {
+        std::atomic_flag busy = ATOMIC_FLAG_INIT;
+        std::array<int32_t, kLanes> sets;
+        std::array<uint32_t, kLanes> versions;
+        std::array<uint32_t, kLanes> epochs;
+    };
+
+    int32_t acquire_set(const Settings& settings);
+    void release_set(int32_t set);
+    void assign(int32_t lane, const Settings& settings);
+    void compute(const Settings& settings, float* values) const;
+    float* coefficients(int32_t group) { return m_soa + group * kGroupFloats; }
+    float* state(int32_t group) { return m_soa + group * kGroupFloats + kSections * 5 * kLanes; }
+
+    const int32_t m_sample_rate;
+    Settings m_default;
+
+    // Qt thread
+    QHash<QPair<uint64, anyID>, int32_t> m_lanes;
+    std::vector<Lane> m_lane_info;
+    std::vector<bool> m_lane_used;
+    QHash<Settings, int32_t> m_set_index;
+    QVector<int32_t> m_set_refs;
+
+    // shared with the workers
+    std::vector<CoefficientSet> m_sets;
+    std::vector<std::atomic<int32_t>> m_lane_sets;      // -1: unused
+    std::vector<std::atomic<uint32_t>> m_lane_epochs;   // bumped when a lane gets a new talker
+
+    // workers
+    std::vector<Group> m_groups;
+    std::vector<float> m_storage;
+    float* m_soa = nullptr;     // kGroupFloats per group, 32 byte aligned
+};
+
+uint qHash(const EqBank::Settings& key, uint seed = 0);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+// Pre-planned radix-2 FFT for real input.
+// All tables and the work buffer are allocated in the constructor, transforms do not allocate.
+class RealFft
+{
+public:
+    explicit RealFft(int32_t size);    // size must be a power of two >= 4
+
+    int32_t size() const { return m_size; }
+    int32_t bin_count() const { return m_size / 2 + 1; }
+
+    // in: size() real samples; out: bin_count() complex bins (unscaled)
+    void forward(const float* in, std::complex<float>* out);
+    // in: bin_count() complex bins; out: size() real samples, unscaled: inverse(forward(x)) == size() * x
+    void inverse(const std::complex<float>* in, float* out);
+
+private:
+    void transform(std::complex<float>* data);
+
+    int32_t m_size;
+    std::vector<int32_t> m_bitrev;
+    std::vector<std::complex<float>> m_twiddles;       // complex transform of size/2
+    std::vector<std::complex<float>> m_split;          // real split, exp(-2*pi*i*k/size)
+    std::vector<std::complex<float>> m_work;
+};
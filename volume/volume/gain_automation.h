@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "spsc_queue.h"
+
+// Timestamped gain / mute events of one client, written lock free by an event handler thread and
+// consumed by the audio thread with sample offset precision. The audio thread keeps a smoothed clock
+// of its blocks (steady clock, phase locked to the callbacks), maps every event time to an offset
+// inside the block and splits the block there, so changes land at consistent positions instead of
+// at the start of whichever block comes next.
+class GainAutomation
+{
+public:
+    enum class Type : uint_least8_t
+    {
+        GAIN = 0,   // move the automation gain to gain_db
+        MUTE,
+        UNMUTE
+    };
+
+    struct Event
+    {
+        int64_t time_us = 0;    // GainAutomation::now() based
+        Type type = Type::GAIN;
+        float gain_db = 0.0f;
+        float ramp_ms = 0.0f;   // 0: step
+    };
+
+    explicit GainAutomation(int32_t sample_rate = 48000);
+
+    static int64_t now();   // steady clock (us)
+
+    bool schedule(const Event& event);     // one producer thread, in time order; false when merged, see there
+
+    // audio thread
+    void begin_block(int32_t frame_count);
+    bool is_idle() const;   // nothing queued or ramping, unity gain: the block needs no splitting
+    int32_t next_segment(int32_t position, int32_t frame_count, float& gain_db);
+    void skip(int32_t frame_count);
+
+private:
+    struct Ramp
+    {
+        float value = 0.0f;     // dB
+        float target = 0.0f;
+        float step = 0.0f;      // dB per frame
+        int32_t left = 0;       // frames
+
+        void start(float to, int32_t frames);
+        void advance(int32_t frames);
+    };
+
+    int32_t offset_of(int64_t time_us) const;
+    void apply(const Event& event);
+    void apply_pending();
+    static uint64_t pack(float first, float second);
+    static void unpack(uint64_t packed, float& first, float& second);
+
+    static const int32_t kCapacity = 64;
+    static const int32_t kRampChunk = 32;   // frames per gain step of a ramp
+    static const uint32_t kPendingGain = 1u;
+    static const uint32_t kPendingMute = 2u;
+    const double kMaxDrift = 20000.0;       // us; beyond that the block clock is re-anchored
+    const double kLockRate = 0.05;          // share of the clock error corrected per block
+    const float kMuteFloor = -60.0f;        // dB; mute ramps end here, then the segment is zeroed
+    const float kMuted = -200.0f;
+
+    const int32_t m_sample_rate;
+    SpscQueue<Event, kCapacity> m_events;
+
+    // Latest state of the events that did not fit into the queue, e.g. of a client toggled while not talking.
+    // Applied once the queue has drained; until then, every event goes here, so the order is kept.
+    std::atomic<uint32_t> m_pending{0};         // kPendingGain | kPendingMute
+    std::atomic<uint64_t> m_pending_gain{0};    // gain_db, ramp_ms
+    std::atomic<uint64_t> m_pending_mute{0};    // 1: mute / 0: unmute, ramp_ms
+
+    // audio thread
+    bool m_is_anchored = false;
+    double m_block_start = 0.0;             // us, smoothed
+    double m_block_end = 0.0;
+    Ramp m_gain;
+    Ramp m_mute;                            // 0 .. kMuteFloor
+    bool m_muted = false;                   // reached the floor
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+
+#include <array>
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+#include "fft.h"
+#include "hrtf_set.h"
+
+// Binaural filter of one talker: uniformly partitioned overlap-save convolution with the
+// interpolated left and right HRIRs. Adds kBlockSize frames of latency; the filter is swapped
+// with a one block crossfade so moving talkers do not click. Allocates in the constructor only.
+class HrtfConvolver
+{
+public:
+    static const int32_t kBlockSize = 64;
+    static const int32_t kMaxTaps = 256;
+    static const int32_t kMaxPartitions = kMaxTaps / kBlockSize;
+
+    HrtfConvolver();
+
+    void reset();
+    void set_filter(const HrtfSet& set, float azimuth, float elevation, int32_t taps);
+    void process(const int16_t* in, int16_t* left, int16_t* right, int32_t frame_count, int32_t stride);
+
+private:
+    static const int32_t kFftSize = 2 * kBlockSize;
+    static const int32_t kBins = kFftSize / 2 + 1;
+
+    using Spectrum = std::vector<std::complex<float>>;
+
+    void process_block();
+    void convolve(int32_t filter, int32_t ear, float* out);
+
+    RealFft m_fft;
+    std::array<std::vector<Spectrum>, 2> m_filters[2];      // [filter][ear][partition]
+    std::vector<Spectrum> m_history;                        // input spectra, ring of kMaxPartitions
+    Spectrum m_acc;
+    std::vector<float> m_window;                            // last two input blocks
+    std::vector<float> m_time;
+    std::vector<float> m_faded;
+    std::vector<float> m_input;
+    std::array<std::vector<float>, 2> m_output;
+    std::vector<float> m_taps[2];
+
+    int32_t m_current = 0;          // filter in use
+    int32_t m_partitions = 0;       // 0: no filter yet, silence
+    bool m_fade = false;            // crossfade from the other filter in the next block
+    int32_t m_history_pos = 0;
+    int32_t m_fill = 0;
+};
+
+// Renders positioned talkers binaurally in post process, for positional audio game servers.
+// Feed it the same positions a positional plugin hands to the client lib
+// (systemset3DListenerAttributes / channelset3DAttributes); TeamSpeaks own 3D panning should be off.
+// At most kMaxSources talkers are rendered at once; the quality picks the HRIR length and with it the CPU cost.
+class HrtfRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int32_t kMaxSources = 32;
+
+    enum class Quality : uint_least8_t
+    {
+        LOW = 0,    // 64 taps, one partition
+        MEDIUM,     // 128 taps
+        HIGH        // 256 taps
+    };
+    Q_ENUM(Quality)
+
+    explicit HrtfRenderer(QObject* parent = nullptr);
+
+    bool setHrtfSet(const QString& path);
+    void setQuality(Quality val);
+    Quality getQuality() const;
+
+    void setListenerAttributes(uint64 serverConnectionHandlerID, const TS3_VECTOR* position, const TS3_VECTOR* forward, const TS3_VECTOR* up);
+    bool setSourcePosition(uint64 serverConnectionHandlerID, anyID clientID, const TS3_VECTOR* position);
+    void RemoveSource(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveSources(uint64 serverConnectionHandlerID);
+
+    // audio thread
+    bool Process(uint64 serverConnectionHandlerID, anyID clientID, int16_t* samples, int32_t frame_count, int32_t channels,
+                 const uint32_t* channel_speaker_array, uint32_t* channel_fill_mask);
+
+public slots:
+    void onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber);
+
+private:
+    struct Listener
+    {
+        TS3_VECTOR position = {0.0f, 0.0f, 0.0f};
+        TS3_VECTOR forward = {0.0f, 0.0f, 1.0f};
+        TS3_VECTOR up = {0.0f, 1.0f, 0.0f};
+    };
+
+    struct Source
+    {
+        std::atomic<uint64_t> key{0};           // 0: free
+        std::atomic<uint32_t> generation{0};    // bumped when the slot changes hands
+        std::atomic<uint32_t> direction{0};     // azimuth and elevation, whole degrees
+        std::atomic_flag busy = ATOMIC_FLAG_INIT;
+
+        // audio thread
+        HrtfConvolver convolver;
+        uint32_t seen_generation = 0;
+        uint32_t seen_direction = ~0u;
+        int32_t seen_taps = 0;
+        const HrtfSet* seen_set = nullptr;
+    };
+
+    static uint64_t make_key(uint64 serverConnectionHandlerID, anyID clientID);
+    Source* find(uint64_t key);
+    void updateDirection(uint64 serverConnectionHandlerID, anyID clientID);
+
+    std::shared_ptr<const HrtfSet> m_set;       // std::atomic_load / atomic_store
+    std::atomic<int32_t> m_taps;
+    std::array<Source, kMaxSources> m_sources;
+
+    QHash<uint64, Listener> m_listeners;
+    QHash<QPair<uint64, anyID>, TS3_VECTOR> m_positions;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <cstdint>
+#include <memory>
+
+// A set of head related impulse responses on a regular azimuth / elevation grid, memory mapped from disk.
+// Every path is loaded once per process; all renderers share the mapping.
+//
+// File layout, little endian:
+//   Header
+//   float data[elevation_count][azimuth_count][2][ir_length]    left ear first
+// Azimuth i is at 360 * i / azimuth_count degrees clockwise from the front (90 is right);
+// elevations are evenly spaced from elevation_min to elevation_max degrees.
+class HrtfSet
+{
+public:
+    struct Header
+    {
+        char magic[4];          // "HRIR"
+        uint32_t version;       // 1
+        uint32_t sample_rate;
+        uint32_t ir_length;     // taps per ear
+        uint32_t elevation_count;
+        uint32_t azimuth_count;
+        float elevation_min;
+        float elevation_max;
+    };
+
+    static std::shared_ptr<const HrtfSet> Load(const QString& path, QString* error = nullptr);
+
+    ~HrtfSet();
+
+    const QString& path() const { return m_path; }
+    int32_t sample_rate() const { return m_header.sample_rate; }
+    int32_t ir_length() const { return m_header.ir_length; }
+
+    void interpolate(float azimuth, float elevation, int32_t taps, float* left, float* right) const;
+
+private:
+    HrtfSet() = default;
+    bool open(const QString& path, QString* error);
+    const float* response(int32_t elevation, int32_t azimuth) const;
+
+    QString m_path;
+    QFile m_file;
+    uchar* m_map = nullptr;
+    Header m_header;
+    const float* m_data = nullptr;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+#include "dsp_kernels.h"
+
+// Per client noise gate with hysteresis and hold. Decides once per frame on the mean square of
+// DspKernels::measure: one comparison against the open or close threshold, no per sample envelope.
+// State changes are ramped in short steps of the fixed point gain kernel; a gate that is closed
+// completely zeroes the frame so the caller can take the silence fast path.
+class NoiseGate
+{
+public:
+    struct Parameters
+    {
+        float open_db = -45.0f;     // dBFS (rms); opens above
+        float close_db = -50.0f;    // dBFS (rms); closes below after the hold time, <= open_db
+        float hold_ms = 200.0f;
+        float range_db = -200.0f;   // attenuation when closed; below kRangeClosed: silence
+    };
+
+    explicit NoiseGate(int32_t sample_rate = 48000);
+
+    void setParameters(const Parameters& parameters);  // thread safe
+    void setEnabled(bool val);                          // thread safe; opens the gate
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    bool isOpen() const { return m_is_open.load(std::memory_order_relaxed); }
+
+    // audio thread
+    bool update(const DspKernels::Levels& levels, int32_t frame_count, int32_t channels);
+    bool apply(int16_t* samples, int32_t frame_count, int32_t channels);
+    void advance(int32_t frame_count);  // ramp without samples; digital silence
+    void reset();
+
+private:
+    const float kRangeClosed = -90.0f;  // dB
+    const float kAttack = 0.001f;       // ramp duration (s), closed to open
+    const float kRelease = 0.02f;       // open to closed
+    static const int32_t kUnity = 1 << 15;
+    static const int32_t kRampChunk = 16;   // frames per gain step
+
+    int32_t m_sample_rate;
+    int32_t m_attack_step;              // Q15 per chunk
+    int32_t m_release_step;
+
+    std::atomic<float> m_open_level{0.0f};      // mean square
+    std::atomic<float> m_close_level{0.0f};
+    std::atomic<int32_t> m_hold_frames{0};
+    std::atomic<int32_t> m_range_q15{0};
+    std::atomic<bool> m_enabled{false};
+    std::atomic<bool> m_reset{false};           // set by setEnabled, consumed by the audio thread
+    std::atomic<bool> m_is_open{true};
+
+    // audio thread
+    bool m_open = true;
+    int32_t m_hold = 0;                 // frames left
+    int32_t m_gain = kUnity;            // Q15
+};
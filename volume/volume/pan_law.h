@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Constant power pan law (-3 dB in the centre), tabulated once; no trigonometry on the audio thread
+namespace PanLaw
+{
+    const int32_t kSteps = 257;     // odd, so the centre is exact
+
+    struct Gains
+    {
+        float left;
+        float right;
+    };
+
+    const Gains& gains(float position);     // -1 (left) .. 1 (right), clamped
+}
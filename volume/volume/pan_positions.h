@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+
+#include "teamspeak/public_definitions.h"
+
+// Stereo positions of the talkers: set manually per client UID, or handed out automatically
+// in the order talkers appear, alternating left and right around the centre.
+// Volumes applies them to its DspVolume objects, see Volumes::setPanPositions.
+class PanPositions : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool autoPan READ isAutoPan WRITE setAutoPan)
+    Q_PROPERTY(float spread READ getSpread WRITE setSpread)
+
+public:
+    explicit PanPositions(QObject* parent = nullptr);
+
+    void setAutoPan(bool val);
+    bool isAutoPan() const;
+    void setSpread(float val);      // 0..1, width of the automatic positions
+    float getSpread() const;
+
+    void setClientPosition(const QString& clientUID, float position);
+    void removeClientPosition(const QString& clientUID);
+    bool getClientPosition(const QString& clientUID, float& result) const;
+
+    bool AddClient(uint64 serverConnectionHandlerID, anyID clientID, float& position);
+    void RemoveClient(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveClients(uint64 serverConnectionHandlerID);
+    void RemoveClients();
+
+signals:
+    void positionChanged(uint64 serverConnectionHandlerID, anyID clientID, bool isPanned, float position);
+
+private:
+    struct Client
+    {
+        QString uid;
+        int32_t slot = -1;  // automatic position
+    };
+
+    int32_t claimSlot(uint64 serverConnectionHandlerID) const;
+    bool resolve(const Client& client, float& position) const;
+    void update(const QPair<uint64, anyID>& key, const Client& client);
+
+    bool m_auto_pan = true;
+    float m_spread = 0.8f;
+    QHash<QString, float> m_uid_positions;
+    QHash<QPair<uint64, anyID>, Client> m_clients;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "dsp_chain.h"
+#include "dsp_kernels.h"
+
+// Radio / comm effect stages for RadioFx and friends. Add them to one DspChain, e.g.
+// band pass -> saturation -> crush -> noise, for a single int16 <-> float round trip per frame.
+// Setters are thread safe and take effect with the next frame; process() does not allocate.
+// Everything but the band pass runs on the DspKernels float kernels; the band pass is a short
+// recursive cascade per channel (a few multiply-adds per sample and section).
+
+// Telephone / radio band: 4th order Butterworth high pass and low pass
+class RadioBandPass : public DspStage
+{
+public:
+    RadioBandPass(float low_hz = 300.0f, float high_hz = 3000.0f);
+
+    void setBand(float low_hz, float high_hz);
+
+    void prepare(int32_t sample_rate, int32_t max_channels) override;
+    void reset() override;
+    void process(float* const* planes, int32_t frame_count, int32_t channels) override;
+
+private:
+    static const int32_t kSections = 4;     // two high pass, two low pass
+
+    struct Section
+    {
+        float b0 = 1.0f;
+        float b1 = 0.0f;
+        float b2 = 0.0f;
+        float a1 = 0.0f;
+        float a2 = 0.0f;
+    };
+
+    void update_coefficients();
+
+    Section m_sections[kSections];
+    std::vector<float> m_state;             // channels * kSections * 2
+    int32_t m_sample_rate = 48000;
+    std::atomic<float> m_low_hz;
+    std::atomic<float> m_high_hz;
+    std::atomic<uint32_t> m_epoch{1};
+    uint32_t m_applied_epoch = 0;           // audio thread
+};
+
+// Polynomial (cubic) soft saturation; drive pushes the signal into the curve
+class RadioSaturation : public DspStage
+{
+public:
+    explicit RadioSaturation(float drive_db = 6.0f);
+
+    void setDrive(float drive_db);
+
+    void process(float* const* planes, int32_t frame_count, int32_t channels) override;
+
+private:
+    std::atomic<float> m_drive;             // linear
+};
+
+// Bit depth reduction followed by ring modulation with a sine carrier
+class RadioCrush : public DspStage
+{
+public:
+    RadioCrush();
+
+    void setBits(int32_t bits);             // 1..16; 16 is transparent enough to count as off
+    void setRing(float frequency_hz, float mix);   // mix 0: off .. 1: full ring modulation
+
+    void prepare(int32_t sample_rate, int32_t max_channels) override;
+    void reset() override;
+    void process(float* const* planes, int32_t frame_count, int32_t channels) override;
+
+private:
+    static const int32_t kChunk = 256;      // frames of carrier per block
+
+    int32_t m_sample_rate = 48000;
+    std::atomic<int32_t> m_bits{16};
+    std::atomic<float> m_ring_hz{0.0f};
+    std::atomic<float> m_ring_mix{0.0f};
+    float m_phase_re = 1.0f;                // carrier phasor; audio thread
+    float m_phase_im = 0.0f;
+};
+
+// Deterministic hiss and crackle; the same seed and input give the same output on every ISA.
+// All channels get the same noise, as from a mono receiver.
+class RadioNoise : public DspStage
+{
+public:
+    explicit RadioNoise(uint32_t seed = 0x9E3779B9u);
+
+    void setHiss(float level_db);           // <= -200: off
+    void setCrackle(float rate, float level_db);   // bursts per second
+
+    void prepare(int32_t sample_rate, int32_t max_channels) override;
+    void reset() override;
+    void process(float* const* planes, int32_t frame_count, int32_t channels) override;
+
+private:
+    static const int32_t kBurstMin = 8;     // frames
+    static const int32_t kBurstMax = 64;
+
+    uint32_t m_seed;
+    int32_t m_sample_rate = 48000;
+    std::atomic<float> m_hiss{0.0f};        // linear amplitude
+    std::atomic<float> m_crackle_rate{0.0f};
+    std::atomic<float> m_crackle{0.0f};
+    DspKernels::DitherState m_hiss_state;   // audio thread
+    DspKernels::DitherState m_crackle_state;
+    uint32_t m_burst_state;                 // burst timing
+    int32_t m_gap_left = 0;                 // frames until the next burst
+    int32_t m_burst_left = 0;               // frames
+};
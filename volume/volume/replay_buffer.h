@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+
+// Recent audio of one client, IMA ADPCM coded (4 bits per sample) into a fixed ring of blocks.
+// push() runs on the audio thread and never allocates; every block starts with its own predictor,
+// so any run of blocks decodes on its own. Each block carries a sequence number written last,
+// so a reader can copy blocks while the ring keeps turning and drop those overwritten meanwhile.
+class ReplayHistory
+{
+public:
+    static const int32_t kBlockFrames = 1024;   // 21 ms at 48 kHz
+
+    ReplayHistory(int32_t sample_rate, int32_t seconds);
+
+    void push(const int16_t* samples, int32_t frame_count, int32_t channels);   // audio thread; downmixed to mono
+    int32_t decode(std::vector<int16_t>& result, int32_t max_frames) const;     // any thread; the newest frames
+
+    int32_t sample_rate() const { return m_sample_rate; }
+    int32_t capacity() const { return m_capacity; }    // blocks
+    uint64_t written() const { return m_written.load(std::memory_order_acquire); }  // complete blocks so far
+
+private:
+    struct Block
+    {
+        std::atomic<uint64_t> sequence{0};  // block number + 1; 0 while being written
+        int16_t predictor = 0;
+        uint8_t step_index = 0;
+        uint8_t data[kBlockFrames / 2];
+    };
+
+    void encode(int32_t sample);
+
+    const int32_t m_sample_rate;
+    const int32_t m_capacity;
+    std::unique_ptr<Block[]> m_blocks;
+    std::atomic<uint64_t> m_written{0};
+
+    // audio thread
+    int32_t m_fill = 0;                     // frames into the current block
+    int32_t m_predictor = 0;
+    int32_t m_step_index = 0;
+};
+
+class ReplayExport;
+
+// Instant replay: a ReplayHistory per client, fed from the pre process callback (see Volumes::setReplayBuffer).
+// 30 s at 48 kHz are ~0.7 MB per client instead of 2.8 MB of PCM.
+// Decoding and WAV export run on a worker of a private thread pool.
+class ReplayBuffer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReplayBuffer(QObject* parent = nullptr, int32_t sample_rate = 48000, int32_t seconds = 30);
+    ~ReplayBuffer();
+
+    std::shared_ptr<ReplayHistory> AddClient(uint64 serverConnectionHandlerID, anyID clientID);
+    std::shared_ptr<ReplayHistory> GetClient(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveClient(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveClients(uint64 serverConnectionHandlerID);
+    void RemoveClients();
+
+    bool Export(uint64 serverConnectionHandlerID, anyID clientID, const QString& path, int32_t seconds = 0);
+
+signals:
+    void exportFinished(uint64 serverConnectionHandlerID, anyID clientID, const QString& path, bool isOk, const QString& error);
+
+private:
+    friend class ReplayExport;
+
+    const int32_t m_sample_rate;
+    const int32_t m_seconds;
+
+    QMutex m_mutex;     // guards m_histories between Qt and worker threads; never taken on the audio thread
+    QHash<QPair<uint64, anyID>, std::shared_ptr<ReplayHistory> > m_histories;
+
+    QThreadPool m_pool;
+};
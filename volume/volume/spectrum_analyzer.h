@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+
+#include <array>
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+#include "spsc_queue.h"
+#include "fft.h"
+
+// Per client sample feed of the SpectrumAnalyzer.
+// push() is called on the audio thread, the worker analyzes the queued windows,
+// the Qt side picks up the latest result via read_snapshot() without locking.
+class SpectrumTap
+{
+public:
+    static const int32_t kWindowSize = 1024;
+    static const int32_t kBinCount = 48;
+
+    struct Snapshot
+    {
+        uint64_t sequence = 0;      // 0: nothing analyzed yet
+        float peak_db = -200.0f;    // sample peak of the analyzed window (dBFS)
+        std::array<float, kBinCount> bins_db;  // log spaced magnitude bins (dBFS)
+    };
+
+    SpectrumTap(int32_t sample_rate, int32_t analysis_rate);
+
+    void push(const int16_t* samples, int32_t frame_count, int32_t channels);
+    bool read_snapshot(Snapshot& result);
+
+    void set_analysis_rate(int32_t analysis_rate);
+    int32_t sample_rate() const { return m_sample_rate; }
+
+private:
+    friend class SpectrumAnalyzer;
+    using Window = std::array<float, kWindowSize>;
+    static const int32_t kFresh = 4;
+
+    void publish();
+
+    const int32_t m_sample_rate;
+
+    // audio thread
+    Window* m_fill = nullptr;
+    int32_t m_fill_pos = 0;
+    int32_t m_countdown = 0;
+    std::atomic<int32_t> m_interval;    // samples between the starts of two analyzed windows
+
+    SpscQueue<Window, 4> m_windows;
+
+    // triple buffer: worker writes m_back, reader owns m_front, m_middle is swapped atomically
+    Snapshot m_snapshots[3];
+    std::atomic<int32_t> m_middle{1};
+    int32_t m_back = 0;
+    int32_t m_front = 2;
+    uint64_t m_published = 0;
+};
+
+class SpectrumWorker;
+
+// Runs the FFTs of all taps on a worker thread at a capped rate
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int analysisRate READ getAnalysisRate WRITE setAnalysisRate)
+
+public:
+    explicit SpectrumAnalyzer(QObject* parent = nullptr, int32_t sample_rate = 48000);
+    ~SpectrumAnalyzer();
+
+    std::shared_ptr<SpectrumTap> AddTap(uint64 serverConnectionHandlerID, anyID clientID);
+    std::shared_ptr<SpectrumTap> GetTap(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveTap(uint64 serverConnectionHandlerID, anyID clientID);
+    void RemoveTaps(uint64 serverConnectionHandlerID);
+    void RemoveTaps();
+
+    int getAnalysisRate() const;
+    void setAnalysisRate(int val);
+
+    void start();
+    void stop();
+
+private:
+    friend class SpectrumWorker;
+    void analyze_pending();
+    void analyze(SpectrumTap& tap, const SpectrumTap::Window& window);
+
+    const int32_t m_sample_rate;
+    std::atomic<int32_t> m_analysis_rate{15};   // analyzed windows per second and tap
+
+    QMutex m_mutex;     // guards m_taps between Qt and worker thread; never taken on the audio thread
+    QHash<QPair<uint64, anyID>, std::weak_ptr<SpectrumTap> > m_taps;
+
+    SpectrumWorker* m_worker = nullptr;
+
+    // worker thread
+    RealFft m_fft;
+    std::vector<float> m_hann;
+    std::vector<float> m_windowed;
+    std::vector<std::complex<float>> m_spectrum;
+    std::array<int32_t, SpectrumTap::kBinCount + 1> m_band_edges;
+    float m_norm;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded single producer / single consumer ring.
+// Used to hand fixed-size blocks from the audio callbacks to worker threads without locks or allocation.
+// kCapacity has to be a power of two; one slot is kept free to tell full from empty.
+template <typename T, size_t kCapacity>
+class SpscQueue
+{
+    static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer side. Returns a slot to fill or nullptr when the queue is full.
+    T* begin_push()
+    {
+        const auto kHead = m_head.load(std::memory_order_relaxed);
+        if (((kHead + 1) & kMask) == m_tail.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &m_slots[kHead];
+    }
+
+    void end_push()
+    {
+        const auto kHead = m_head.load(std::memory_order_relaxed);
+        m_head.store((kHead + 1) & kMask, std::memory_order_release);
+    }
+
+    bool push(const T& val)
+    {
+        auto slot = begin_push();
+        if (!slot)
+            return false;
+
+        *slot = val;
+        end_push();
+        return true;
+    }
+
+    // Consumer side. Returns the oldest slot or nullptr when the queue is empty.
+    T* front()
+    {
+        const auto kTail = m_tail.load(std::memory_order_relaxed);
+        if (kTail == m_head.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &m_slots[kTail];
+    }
+
+    void pop()
+    {
+        const auto kTail = m_tail.load(std::memory_order_relaxed);
+        m_tail.store((kTail + 1) & kMask, std::memory_order_release);
+    }
+
+    bool pop(T& result)
+    {
+        auto slot = front();
+        if (!slot)
+            return false;
+
+        result = *slot;
+        pop();
+        return true;
+    }
+
+    bool empty() const
+    {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    static const size_t kMask = kCapacity - 1;
+
+    T m_slots[kCapacity];
+    alignas(64) std::atomic<size_t> m_head{0};  // written by producer
+    alignas(64) std::atomic<size_t> m_tail{0};  // written by consumer
+};
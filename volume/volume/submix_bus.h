@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+#include "dsp_chain.h"
+
+// Sums the post processed buffers of its member clients and runs one effects chain over the sum per tick
+class SubmixBus
+{
+public:
+    static const int32_t kMaxChannels = 8;
+    static const int32_t kMaxFrames = 1024;
+
+    SubmixBus(const QString& name, std::unique_ptr<DspChain> chain);
+
+    const QString& name() const { return m_name; }
+    int32_t member_count() const { return m_last_member_count.load(std::memory_order_relaxed); }  // in the last tick
+
+    // audio thread
+    bool accumulate(const int16_t* samples, int32_t frame_count, int32_t channels, uint32_t channel_fill_mask);
+    void mix_into(int16_t* samples, int32_t frame_count, int32_t channels, uint32_t* channel_fill_mask);
+
+    void request_reset();   // any thread; the audio thread drops the tick and the chain state on its next call
+
+private:
+    void reset();
+
+    const QString m_name;
+    std::unique_ptr<DspChain> m_chain;
+
+    std::vector<float> m_accumulator;   // kMaxChannels planes of kMaxFrames
+    std::array<float*, kMaxChannels> m_planes;
+    std::vector<float> m_scratch;       // same layout; a member buffer or the master buffer as float
+    std::array<float*, kMaxChannels> m_scratch_planes;
+    std::atomic<bool> m_reset{false};   // set by request_reset, consumed by the audio thread
+    int32_t m_frame_count = 0;          // 0: no member this tick
+    int32_t m_channels = 0;
+    int32_t m_member_count = 0;
+    std::atomic<int32_t> m_last_member_count{0};
+};
+
+// Named submix buses, e.g. "whispers", "channel", "priority", per server connection.
+// Route a client to a bus on the Qt side; then call Accumulate() from on_playback_post_process
+// and Mix() from on_playback_master. Neither locks nor allocates on the audio thread.
+class SubmixBuses : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int32_t kMaxBuses = 8;
+    static const int32_t kMaxConnections = 32;
+
+    using ChainFactory = std::function<void(DspChain& chain)>;
+
+    explicit SubmixBuses(QObject* parent = nullptr, int32_t sample_rate = 48000);
+    ~SubmixBuses();
+
+    int32_t AddBus(const QString& name, ChainFactory factory = ChainFactory());
+    int32_t GetBusIndex(const QString& name) const;
+    SubmixBus* GetBus(uint64 serverConnectionHandlerID, const QString& name);
+
+    bool setRoute(uint64 serverConnectionHandlerID, anyID clientID, const QString& name);
+    void clearRoute(uint64 serverConnectionHandlerID, anyID clientID);
+    QString getRoute(uint64 serverConnectionHandlerID, anyID clientID);
+
+    // audio thread
+    bool Accumulate(uint64 serverConnectionHandlerID, anyID clientID, int16_t* samples, int32_t frame_count, int32_t channels, uint32_t* channel_fill_mask);
+    void Mix(uint64 serverConnectionHandlerID, int16_t* samples, int32_t frame_count, int32_t channels, uint32_t* channel_fill_mask);
+
+public slots:
+    void onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber);
+
+private:
+    struct Connection
+    {
+        std::atomic<uint64> sch_id{0};
+        std::array<std::atomic<int8_t>, 65536> routes;  // bus index by client id, -1: direct
+        std::array<std::unique_ptr<SubmixBus>, kMaxBuses> buses;
+    };
+
+    Connection* find(uint64 sch_id) const;
+    Connection* claim(uint64 sch_id);
+    std::unique_ptr<SubmixBus> make_bus(int32_t index) const;
+
+    const int32_t m_sample_rate;
+
+    // bus definitions; only appended on the Qt side, the count is published last
+    std::array<QString, kMaxBuses> m_names;
+    std::array<ChainFactory, kMaxBuses> m_factories;
+    std::atomic<int32_t> m_bus_count{0};
+
+    // connections are reused, never freed while the object lives
+    std::array<std::atomic<Connection*>, kMaxConnections> m_connections;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+class DspVolume;
+
+// Group offsets as read by the audio threads. Any change bumps the epoch;
+// a DspVolume recomputes the sum of its groups only when the epoch or its membership changed.
+class VcaState
+{
+public:
+    static const int32_t kMaxGroups = 32;  // membership is a bit mask
+
+    VcaState();
+
+    uint32_t epoch() const { return m_epoch.load(std::memory_order_acquire); }
+    float sum(uint32_t group_mask) const;   // dB
+
+private:
+    friend class VcaGroups;
+
+    std::array<std::atomic<float>, kMaxGroups> m_offsets;  // dB
+    std::atomic<uint32_t> m_epoch{0};
+};
+
+// VCA style gain groups: one fader moves every member. A client can belong to several groups;
+// its effective desired gain is its own plus the offsets of all its groups.
+class VcaGroups : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VcaGroups(QObject* parent = nullptr);
+
+    int32_t AddGroup(const QString& name);
+    int32_t GetGroupIndex(const QString& name) const;
+    QString GetGroupName(int32_t group) const;
+
+    void setGroupGain(int32_t group, float gain_db);
+    float getGroupGain(int32_t group) const;
+
+    static void setMember(DspVolume* volume, int32_t group, bool is_member);
+    static bool isMember(const DspVolume* volume, int32_t group);
+
+    std::shared_ptr<const VcaState> state() const { return m_state; }
+
+signals:
+    void groupGainChanged(int32_t group, float gain_db);
+
+private:
+    std::shared_ptr<VcaState> m_state;
+    QStringList m_names;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+
+#include "dsp_kernels.h"
+
+// Cheap voice activity detector running on the levels of DspKernels::measure, so it adds
+// nothing to the per sample cost of a meter pass. A frame counts as voice when it is well above
+// the adaptive noise floor and its spectrum is speech like: not too many zero crossings and not
+// too much first difference (high band) energy, which rejects clicks, hiss and breathing.
+// Onset and hangover are counted in frames of audio, independent of the callback size.
+class VoiceActivity
+{
+public:
+    explicit VoiceActivity(int32_t sample_rate = 48000);
+
+    bool update(const DspKernels::Levels& levels, int32_t frame_count, int32_t channels);
+    bool is_active() const { return m_active; }
+    void reset();
+
+private:
+    const float kSnr = 4.0f;                // 6 dB over the noise floor
+    const float kAbsoluteFloor = 1e-6f;     // -60 dBFS mean square
+    const float kNoiseFloorInit = 1e-5f;
+    const float kMaxCrossingRate = 0.35f;   // per sample
+    const float kMaxHighBandRatio = 1.0f;   // diff energy / energy; white noise is at 2
+    const float kFloorFall = 0.05f;         // noise floor time constants (s)
+    const float kFloorRise = 5.0f;
+    const float kOnset = 0.02f;             // s of voice before becoming active
+    const float kHangover = 0.2f;           // s of non voice before becoming inactive
+
+    int32_t m_sample_rate;
+    float m_noise_floor = kNoiseFloorInit;  // mean square
+    int32_t m_voiced = 0;                   // frames
+    int32_t m_hangover = 0;                 // frames left
+    bool m_active = false;
+};
+
+// Counts the sources that currently carry voice; a DspVolume with a sidechain publishes into it,
+// ducking volumes read it (see DspVolume::setVoiceSidechain, DspVolumeDucker::setSidechainKey)
+class VoiceSidechain
+{
+public:
+    int32_t active() const { return m_active.load(std::memory_order_relaxed); }
+    bool is_active() const { return active() > 0; }
+
+private:
+    friend class DspVolume;
+    std::atomic<int32_t> m_active{0};
+};
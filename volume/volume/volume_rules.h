@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+#include "teamspeak/public_definitions.h"
+
+// Hierarchical volume rules of a server: server -> channel -> server group -> client UID.
+// Keyed by the unique identifier of the server, not the connection id of the tab, so the rules
+// survive reconnects and follow the server to whichever tab it is opened in.
+// The most specific matching rule wins; of several matching server groups, the loudest.
+// Rules are resolved on the Qt thread when a client is added, moves or changes groups;
+// the result is cached in the DspVolume of the client (see Volumes::setVolumeRules).
+class VolumeRules : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Scope : uint_least8_t
+    {
+        SERVER = 0,
+        CHANNEL,
+        SERVER_GROUP,
+        CLIENT
+    };
+    Q_ENUM(Scope)
+
+    // What the rules are matched against; gathered from the client lib once per join / move
+    struct ClientContext
+    {
+        QString server_uid;
+        QString uid;
+        uint64 channel_id = 0;
+        QSet<uint64> server_groups;
+    };
+
+    explicit VolumeRules(QObject* parent = nullptr);
+
+    static unsigned int GetClientContext(uint64 serverConnectionHandlerID, anyID clientID, ClientContext& result);
+
+    void setServerRule(const QString& serverUID, float gain_db);
+    void setChannelRule(const QString& serverUID, uint64 channelID, float gain_db);
+    void setServerGroupRule(const QString& serverUID, uint64 serverGroupID, float gain_db);
+    void setClientRule(const QString& serverUID, const QString& clientUID, float gain_db);
+
+    void removeServerRule(const QString& serverUID);
+    void removeChannelRule(const QString& serverUID, uint64 channelID);
+    void removeServerGroupRule(const QString& serverUID, uint64 serverGroupID);
+    void removeClientRule(const QString& serverUID, const QString& clientUID);
+
+    float resolve(const ClientContext& context, Scope* matched = nullptr) const;
+
+signals:
+    void rulesChanged(const QString& serverUID, VolumeRules::Scope scope);
+
+private:
+    struct ServerRules
+    {
+        bool has_server_rule = false;
+        float server = 0.0f;
+        QHash<uint64, float> channels;
+        QHash<uint64, float> server_groups;
+        QHash<QString, float> clients;
+    };
+
+    QHash<QString, ServerRules> m_rules;     // by server UID
+};
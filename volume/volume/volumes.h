@@ -2,8 +2,20 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QHash>
+#include <QtCore/QPointer>
+
+#include <atomic>
+
 #include "teamspeak/public_definitions.h"
 #include "dsp_volume.h"
+#include "spectrum_analyzer.h"
+#include "dsp_pipeline.h"
+#include "volume_rules.h"
+#include "vca_groups.h"
+#include "dsp_volume_automix.h"
+#include "dsp_volume_compressor.h"
+#include "pan_positions.h"
+#include "replay_buffer.h"
 
 class Volumes : public QObject
 {
@@ -15,7 +27,16 @@ public:
     {
         MANUAL = 0,
         DUCKER,
-        AGMU
+        AGMU,
+        AUTOMIX,
+        COMPRESSOR
+    };
+
+    // Where the volumes ran; the mono pre process stage unless a volume needs the speaker layout
+    enum class Stage : uint_least8_t
+    {
+        PRE_PROCESS = 0,
+        POST_PROCESS
     };
 
     explicit Volumes(QObject *parent = 0, Volume_Type volume_type = Volume_Type::MANUAL);
@@ -28,10 +49,47 @@ public:
     bool ContainsVolume(uint64 serverConnectionHandlerID, anyID clientID);
     DspVolume* GetVolume(uint64 serverConnectionHandlerID, anyID clientID);
 
+    bool onPlaybackPreProcess(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int frameCount, int channels);
+    bool onPlaybackPostProcess(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int frameCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask);
+    uint64_t getProcessedSamples(Stage stage) const;
+
+    void setSpectrumAnalyzer(SpectrumAnalyzer* analyzer);
+    void setPipeline(DspPipeline* pipeline);
+    void setVolumeRules(VolumeRules* rules);
+    void setVcaGroups(VcaGroups* groups);
+    void setPanPositions(PanPositions* positions);
+    void setReplayBuffer(ReplayBuffer* buffer);
+    void setCompressorParameters(const DspVolumeCompressor::Parameters& parameters);
+    void setNoiseGate(const NoiseGate::Parameters& parameters);
+    void clearNoiseGate();
+    void setGainAutomation(bool val);
+
 public slots:
     void onConnectStatusChanged(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber);
+    void onClientMove(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID);
+    void onClientServerGroupsChanged(uint64 serverConnectionHandlerID, anyID clientID);
+
+private slots:
+    void onRulesChanged(const QString& serverUID, VolumeRules::Scope scope);
+    void onPanPositionChanged(uint64 serverConnectionHandlerID, anyID clientID, bool isPanned, float position);
 
 private:
+    void resolveRule(uint64 serverConnectionHandlerID, anyID clientID);
+
     QHash<QPair<uint64,anyID>, DspVolume* > m_volumes;
     Volume_Type m_volume_type;
+    std::shared_ptr<AutomixState> m_automix_state;  // AUTOMIX: shared by all volumes
+    QPointer<SpectrumAnalyzer> m_spectrum_analyzer;
+    QPointer<DspPipeline> m_pipeline;
+    QPointer<VolumeRules> m_rules;
+    QPointer<VcaGroups> m_vca_groups;
+    QPointer<PanPositions> m_pan_positions;
+    QPointer<ReplayBuffer> m_replay_buffer;
+    DspVolumeCompressor::Parameters m_compressor_parameters;   // COMPRESSOR: applied to all volumes
+    NoiseGate::Parameters m_gate_parameters;
+    bool m_is_gated = false;
+    bool m_is_automated = false;
+    QHash<QPair<uint64,anyID>, VolumeRules::ClientContext> m_contexts;  // of volumes with rules
+    std::atomic<uint64_t> m_pre_process_samples{0};
+    std::atomic<uint64_t> m_post_process_samples{0};
 };
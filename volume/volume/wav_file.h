@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QtCore/QString>
+
+#include <cstdint>
+#include <vector>
+
+// Minimal RIFF / WAVE I/O for 16 bit PCM; enough for offline testing and exporting captures
+namespace WavFile
+{
+    struct Format
+    {
+        int32_t sample_rate = 48000;
+        int32_t channels = 1;
+    };
+
+    bool Read(const QString& path, std::vector<int16_t>& samples, Format& format, QString* error = nullptr);
+    bool Write(const QString& path, const int16_t* samples, int32_t frame_count, const Format& format, QString* error = nullptr);
+}
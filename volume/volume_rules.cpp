@@ -0,0 +1,153 @@
+#include "volume/volume_rules.h"
+
+#include "teamspeak/public_errors.h"
+#include "teamspeak/clientlib_publicdefinitions.h"
+#include "ts3_functions.h"
+#include "plugin.h"
+
+#include "core/ts_helpers_qt.h"
+#include "volume/dsp_volume.h"
+
+VolumeRules::VolumeRules(QObject* parent)
+    : QObject(parent)
+{
+    this->setObjectName("VolumeRules");
+}
+
+//! Gather what the rules are matched against
+/*!
+ * \brief VolumeRules::GetClientContext
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param result the server uid and the uid, channel and server groups of the client
+ * \return a TeamSpeak error code
+ */
+unsigned int VolumeRules::GetClientContext(uint64 serverConnectionHandlerID, anyID clientID, ClientContext& result)
+{
+    unsigned int error;
+    if ((error = TSHelpers::GetServerUID(serverConnectionHandlerID, result.server_uid)) != ERROR_ok)
+        return error;
+
+    if ((error = TSHelpers::GetClientUID(serverConnectionHandlerID, clientID, result.uid)) != ERROR_ok)
+        return error;
+
+    if ((error = ts3Functions.getChannelOfClient(serverConnectionHandlerID, clientID, &result.channel_id)) != ERROR_ok)
+        return error;
+
+    result.server_groups.clear();
+    return TSHelpers::GetClientServerGroups(serverConnectionHandlerID, clientID, &result.server_groups);
+}
+
+void VolumeRules::setServerRule(const QString& serverUID, float gain_db)
+{
+    auto& rules = m_rules[serverUID];
+    rules.has_server_rule = true;
+    rules.server = gain_db;
+    emit rulesChanged(serverUID, Scope::SERVER);
+}
+
+void VolumeRules::setChannelRule(const QString& serverUID, uint64 channelID, float gain_db)
+{
+    m_rules[serverUID].channels.insert(channelID, gain_db);
+    emit rulesChanged(serverUID, Scope::CHANNEL);
+}
+
+void VolumeRules::setServerGroupRule(const QString& serverUID, uint64 serverGroupID, float gain_db)
+{
+    m_rules[serverUID].server_groups.insert(serverGroupID, gain_db);
+    emit rulesChanged(serverUID, Scope::SERVER_GROUP);
+}
+
+void VolumeRules::setClientRule(const QString& serverUID, const QString& clientUID, float gain_db)
+{
+    m_rules[serverUID].clients.insert(clientUID, gain_db);
+    emit rulesChanged(serverUID, Scope::CLIENT);
+}
+
+void VolumeRules::removeServerRule(const QString& serverUID)
+{
+    if (!m_rules.contains(serverUID))
+        return;
+
+    m_rules[serverUID].has_server_rule = false;
+    emit rulesChanged(serverUID, Scope::SERVER);
+}
+
+void VolumeRules::removeChannelRule(const QString& serverUID, uint64 channelID)
+{
+    if (m_rules.contains(serverUID) && m_rules[serverUID].channels.remove(channelID))
+        emit rulesChanged(serverUID, Scope::CHANNEL);
+}
+
+void VolumeRules::removeServerGroupRule(const QString& serverUID, uint64 serverGroupID)
+{
+    if (m_rules.contains(serverUID) && m_rules[serverUID].server_groups.remove(serverGroupID))
+        emit rulesChanged(serverUID, Scope::SERVER_GROUP);
+}
+
+void VolumeRules::removeClientRule(const QString& serverUID, const QString& clientUID)
+{
+    if (m_rules.contains(serverUID) && m_rules[serverUID].clients.remove(clientUID))
+        emit rulesChanged(serverUID, Scope::CLIENT);
+}
+
+//! Resolve the gain of a client
+/*!
+ * \brief VolumeRules::resolve
+ * \param context the server uid and the uid, channel and server groups of the client
+ * \param matched optional; the scope of the winning rule, unchanged if no rule matched
+ * \return the gain (dB); 0 dB if no rule matched
+ */
+float VolumeRules::resolve(const ClientContext& context, Scope* matched) const
+{
+    const auto kIt = m_rules.constFind(context.server_uid);
+    if (kIt == m_rules.constEnd())
+        return VOLUME_0DB;
+
+    const auto& rules = kIt.value();
+    const auto kClient = rules.clients.constFind(context.uid);
+    if (kClient != rules.clients.constEnd())
+    {
+        if (matched)
+            *matched = Scope::CLIENT;
+
+        return kClient.value();
+    }
+
+    bool is_group_match = false;
+    auto result = VOLUME_MUTED;
+    for (auto server_group : context.server_groups)
+    {
+        const auto kGroup = rules.server_groups.constFind(server_group);
+        if (kGroup != rules.server_groups.constEnd())
+        {
+            result = qMax(result, kGroup.value());
+            is_group_match = true;
+        }
+    }
+    if (is_group_match)
+    {
+        if (matched)
+            *matched = Scope::SERVER_GROUP;
+
+        return result;
+    }
+
+    const auto kChannel = rules.channels.constFind(context.channel_id);
+    if (kChannel != rules.channels.constEnd())
+    {
+        if (matched)
+            *matched = Scope::CHANNEL;
+
+        return kChannel.value();
+    }
+
+    if (rules.has_server_rule)
+    {
+        if (matched)
+            *matched = Scope::SERVER;
+
+        return rules.server;
+    }
+    return VOLUME_0DB;
+}
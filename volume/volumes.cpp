@@ -2,17 +2,21 @@
 
 #include <QtCore/QPointer>
 
+#include "core/ts_helpers_qt.h"
 #include "core/ts_logging_qt.h"
 
 #include "volume/dsp_volume_ducker.h"
 #include "volume/dsp_volume_agmu.h"
 #include "teamspeak/clientlib_publicdefinitions.h"
+#include "teamspeak/public_errors.h"
 
 Volumes::Volumes(QObject *parent, Volume_Type volume_type) :
     QObject(parent)
 {
     this->setObjectName("Volumes");
     m_volume_type = volume_type;
+    if (m_volume_type == Volume_Type::AUTOMIX)
+        m_automix_state = std::make_shared<AutomixState>();
 }
 
 //! Create and add a Volume object to the Volumes map
@@ -20,20 +24,64 @@ Volumes::Volumes(QObject *parent, Volume_Type volume_type) :
  * \brief Volumes::AddVolume Helper function
  * \param serverConnectionHandlerID the connection id of the server
  * \param clientID the client id
+ * \return the new volume, or the one the client already has
  */
 DspVolume* Volumes::AddVolume(uint64 serverConnectionHandlerID, anyID clientID)
 {
+    // attaching another slot, tap or history would replace the ones of the live volume
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    if (auto existing = m_volumes.value(kKey, nullptr))
+        return existing;
+
     DspVolume* dsp_obj;
     if (m_volume_type == Volume_Type::DUCKER)
         dsp_obj = new DspVolumeDucker(this);
     else if (m_volume_type == Volume_Type::AGMU)
         dsp_obj = new DspVolumeAGMU(this);
+    else if (m_volume_type == Volume_Type::AUTOMIX)
+        dsp_obj = new DspVolumeAutomix(this, m_automix_state);
+    else if (m_volume_type == Volume_Type::COMPRESSOR)
+    {
+        auto compressor = new DspVolumeCompressor(this);
+        compressor->setParameters(m_compressor_parameters);
+        dsp_obj = compressor;
+    }
     else
         dsp_obj = new DspVolume(this);
 
-    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
-    if (!m_volumes.contains(kKey))
-        m_volumes.insert(kKey, dsp_obj);
+    if (m_spectrum_analyzer)
+        dsp_obj->setSpectrumTap(m_spectrum_analyzer->AddTap(serverConnectionHandlerID, clientID));
+
+    if (m_replay_buffer)
+        dsp_obj->setReplayHistory(m_replay_buffer->AddClient(serverConnectionHandlerID, clientID));
+
+    if (m_vca_groups)
+        dsp_obj->setVcaState(m_vca_groups->state());
+
+    if (m_is_gated)
+        dsp_obj->setNoiseGate(m_gate_parameters);
+
+    if (m_is_automated)
+        dsp_obj->setGainAutomation(std::make_shared<GainAutomation>());
+
+    if (m_pipeline)
+        dsp_obj->setPipelineSlot(m_pipeline->AddSlot(serverConnectionHandlerID, clientID));
+
+    float position = 0.0f;
+    if (m_pan_positions && m_pan_positions->AddClient(serverConnectionHandlerID, clientID, position))
+        dsp_obj->setPan(position);
+
+    m_volumes.insert(kKey, dsp_obj);
+
+    if (m_rules)
+    {
+        VolumeRules::ClientContext context;
+        if (VolumeRules::GetClientContext(serverConnectionHandlerID, clientID, context) == ERROR_ok)
+        {
+            m_contexts.insert(kKey, context);
+            dsp_obj->setGainRule(m_rules->resolve(context));
+        }
+    }
 
     return dsp_obj;
 }
@@ -83,6 +131,19 @@ void Volumes::RemoveVolume(uint64 serverConnectionHandlerID, anyID clientID)
 
     auto dsp_obj = m_volumes.take(kKey);
     DeleteVolume(dsp_obj);
+    m_contexts.remove(kKey);
+
+    if (m_spectrum_analyzer)
+        m_spectrum_analyzer->RemoveTap(serverConnectionHandlerID, clientID);
+
+    if (m_replay_buffer)
+        m_replay_buffer->RemoveClient(serverConnectionHandlerID, clientID);
+
+    if (m_pipeline)
+        m_pipeline->RemoveSlot(serverConnectionHandlerID, clientID);
+
+    if (m_pan_positions)
+        m_pan_positions->RemoveClient(serverConnectionHandlerID, clientID);
 }
 
 //! Remove all Volume objects of a server
@@ -100,12 +161,25 @@ void Volumes::RemoveVolumes(uint64 serverConnectionHandlerID)
         if (it.key().first == serverConnectionHandlerID)
         {
             DeleteVolume(it.value());
+            m_contexts.remove(it.key());
             it = m_volumes.erase(it);
         }
         else
             ++it;
     }
-    
+
+    if (m_spectrum_analyzer)
+        m_spectrum_analyzer->RemoveTaps(serverConnectionHandlerID);
+
+    if (m_replay_buffer)
+        m_replay_buffer->RemoveClients(serverConnectionHandlerID);
+
+    if (m_pipeline)
+        m_pipeline->RemoveSlots(serverConnectionHandlerID);
+
+    if (m_pan_positions)
+        m_pan_positions->RemoveClients(serverConnectionHandlerID);
+
     //TSLogging::Log("Volumes: Server Volumes cleared",serverConnectionHandlerID,LogLevel_INFO);
 }
 
@@ -122,6 +196,19 @@ void Volumes::RemoveVolumes()
         DeleteVolume(it.value());
 
     m_volumes.clear();
+    m_contexts.clear();
+
+    if (m_spectrum_analyzer)
+        m_spectrum_analyzer->RemoveTaps();
+
+    if (m_replay_buffer)
+        m_replay_buffer->RemoveClients();
+
+    if (m_pipeline)
+        m_pipeline->RemoveSlots();
+
+    if (m_pan_positions)
+        m_pan_positions->RemoveClients();
 }
 
 bool Volumes::ContainsVolume(uint64 serverConnectionHandlerID, anyID clientID)
@@ -135,3 +222,244 @@ DspVolume* Volumes::GetVolume(uint64 serverConnectionHandlerID, anyID clientID)
     const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
     return m_volumes.contains(kKey) ? m_volumes[kKey] : nullptr;
 }
+
+//! Run the volume of a client in the pre process stage, where the buffer is mono
+/*!
+ * Forward both on_playback_pre_process and on_playback_post_process; each volume runs in exactly one of them per block.
+ * Volumes that need the speaker layout (DspVolume::needsMultichannel) are left for the post process stage.
+ * \brief Volumes::onPlaybackPreProcess
+ * \param frameCount number of frames
+ * \return true when the volume ran
+ */
+bool Volumes::onPlaybackPreProcess(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int frameCount, int channels)
+{
+    auto dsp_obj = GetVolume(serverConnectionHandlerID, clientID);
+    if (!dsp_obj || dsp_obj->needsMultichannel())
+        return false;
+
+    dsp_obj->process(samples, frameCount, channels);
+    dsp_obj->setPreProcessed(true);
+    m_pre_process_samples.fetch_add(static_cast<uint64_t>(frameCount) * channels, std::memory_order_relaxed);
+    return true;
+}
+
+//! Run the volume of a client in the post process stage, unless it already ran in the pre process stage
+/*!
+ * \brief Volumes::onPlaybackPostProcess
+ * \param frameCount number of frames
+ * \param channelSpeakerArray the speaker of each channel
+ * \param channelFillMask the channels holding audio; updated when panning
+ * \return true when the volume ran
+ */
+bool Volumes::onPlaybackPostProcess(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int frameCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask)
+{
+    auto dsp_obj = GetVolume(serverConnectionHandlerID, clientID);
+    if (!dsp_obj || dsp_obj->takePreProcessed())
+        return false;
+
+    dsp_obj->processPanned(samples, frameCount, channels, channelSpeakerArray, channelFillMask);
+    m_post_process_samples.fetch_add(static_cast<uint64_t>(frameCount) * channels, std::memory_order_relaxed);
+    return true;
+}
+
+//! Samples (frames * channels) run through the volumes in a stage since construction
+uint64_t Volumes::getProcessedSamples(Stage stage) const
+{
+    if (stage == Stage::PRE_PROCESS)
+        return m_pre_process_samples.load(std::memory_order_relaxed);
+
+    return m_post_process_samples.load(std::memory_order_relaxed);
+}
+
+//! Attach a spectrum analyzer; volumes added from now on feed it
+/*!
+ * \brief Volumes::setSpectrumAnalyzer
+ * \param analyzer the analyzer, nullptr to stop attaching taps
+ */
+void Volumes::setSpectrumAnalyzer(SpectrumAnalyzer* analyzer)
+{
+    m_spectrum_analyzer = analyzer;
+}
+
+//! Run the heavy per client processing pipelined on worker threads
+/*!
+ * \brief Volumes::setPipeline
+ * \param pipeline the pipeline, nullptr for volumes added from now on to process inline
+ */
+void Volumes::setPipeline(DspPipeline* pipeline)
+{
+    m_pipeline = pipeline;
+}
+
+//! Apply hierarchical volume rules to the volumes
+/*!
+ * Rules are resolved when a volume is added and when a rule, the channel or the server groups of its client change;
+ * the audio thread only reads the cached result.
+ * \brief Volumes::setVolumeRules
+ * \param rules the rules, nullptr for volumes added from now on to ignore rules
+ */
+void Volumes::setVolumeRules(VolumeRules* rules)
+{
+    if (m_rules)
+        m_rules->disconnect(this);
+
+    m_rules = rules;
+    if (m_rules)
+        connect(m_rules.data(), &VolumeRules::rulesChanged, this, &Volumes::onRulesChanged, Qt::UniqueConnection);
+}
+
+//! Let VCA group faders act on the volumes
+/*!
+ * Membership is set per volume, see VcaGroups::setMember
+ * \brief Volumes::setVcaGroups
+ * \param groups the groups, nullptr for volumes added from now on to ignore groups
+ */
+void Volumes::setVcaGroups(VcaGroups* groups)
+{
+    m_vca_groups = groups;
+}
+
+//! Place the talkers in the stereo image
+/*!
+ * Takes effect where the volumes are processed with DspVolume::processPanned
+ * \brief Volumes::setPanPositions
+ * \param positions the positions, nullptr for volumes added from now on to stay unpanned
+ */
+void Volumes::setPanPositions(PanPositions* positions)
+{
+    if (m_pan_positions)
+        m_pan_positions->disconnect(this);
+
+    m_pan_positions = positions;
+    if (m_pan_positions)
+        connect(m_pan_positions.data(), &PanPositions::positionChanged, this, &Volumes::onPanPositionChanged, Qt::UniqueConnection);
+}
+
+//! Record the talkers for instant replay
+/*!
+ * \brief Volumes::setReplayBuffer
+ * \param buffer the buffer, nullptr for volumes added from now on to stay unrecorded
+ */
+void Volumes::setReplayBuffer(ReplayBuffer* buffer)
+{
+    m_replay_buffer = buffer;
+}
+
+//! Set the compressor of all talkers
+/*!
+ * Only used with Volume_Type::COMPRESSOR; existing volumes change with their next frame
+ * \brief Volumes::setCompressorParameters
+ * \param parameters threshold, ratio, knee, attack, release and makeup gain
+ */
+void Volumes::setCompressorParameters(const DspVolumeCompressor::Parameters& parameters)
+{
+    m_compressor_parameters = parameters;
+    if (m_volume_type != Volume_Type::COMPRESSOR)
+        return;
+
+    for (auto it = m_volumes.begin(); it != m_volumes.end(); ++it)
+        static_cast<DspVolumeCompressor*>(it.value())->setParameters(parameters);
+}
+
+//! Gate all talkers, e.g. against the background noise of open mics
+/*!
+ * Applies to the existing volumes and those added from now on; a single client can be set through GetVolume
+ * \brief Volumes::setNoiseGate
+ * \param parameters thresholds, hold time and range
+ */
+void Volumes::setNoiseGate(const NoiseGate::Parameters& parameters)
+{
+    m_gate_parameters = parameters;
+    m_is_gated = true;
+    for (auto it = m_volumes.begin(); it != m_volumes.end(); ++it)
+        it.value()->setNoiseGate(parameters);
+}
+
+void Volumes::clearNoiseGate()
+{
+    m_is_gated = false;
+    for (auto it = m_volumes.begin(); it != m_volumes.end(); ++it)
+        it.value()->clearNoiseGate();
+}
+
+//! Give each talker a queue of timestamped gain and mute events, see DspVolume::scheduleGain
+/*!
+ * Only volumes added from now on; with Volume_Type::DUCKER, setGainAdjustment then schedules the duck
+ * \brief Volumes::setGainAutomation
+ * \param val true: automate
+ */
+void Volumes::setGainAutomation(bool val)
+{
+    m_is_automated = val;
+}
+
+//! Re-resolve the rules of a client that changed channels
+/*!
+ * \brief Volumes::onClientMove forward from on_client_move and friends
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ * \param newChannelID the channel the client moved to
+ */
+void Volumes::onClientMove(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID)
+{
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    auto it = m_contexts.find(kKey);
+    if (it == m_contexts.end() || it.value().channel_id == newChannelID)
+        return;
+
+    it.value().channel_id = newChannelID;
+    resolveRule(serverConnectionHandlerID, clientID);
+}
+
+//! Re-query the server groups of a client and re-resolve its rules
+/*!
+ * \brief Volumes::onClientServerGroupsChanged forward from the server group client added / deleted events
+ * \param serverConnectionHandlerID the connection id of the server
+ * \param clientID the client id
+ */
+void Volumes::onClientServerGroupsChanged(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    auto it = m_contexts.find(kKey);
+    if (it == m_contexts.end())
+        return;
+
+    QSet<uint64> server_groups;
+    if (TSHelpers::GetClientServerGroups(serverConnectionHandlerID, clientID, &server_groups) != ERROR_ok)
+        return;
+
+    it.value().server_groups = server_groups;
+    resolveRule(serverConnectionHandlerID, clientID);
+}
+
+void Volumes::onRulesChanged(const QString& serverUID, VolumeRules::Scope scope)
+{
+    Q_UNUSED(scope);
+    for (auto it = m_contexts.cbegin(); it != m_contexts.cend(); ++it)
+    {
+        if (it.value().server_uid == serverUID)
+            resolveRule(it.key().first, it.key().second);
+    }
+}
+
+void Volumes::resolveRule(uint64 serverConnectionHandlerID, anyID clientID)
+{
+    const auto kKey = qMakePair(serverConnectionHandlerID, clientID);
+    auto dsp_obj = m_volumes.value(kKey);
+    if (!dsp_obj || !m_rules)
+        return;
+
+    dsp_obj->setGainRule(m_rules->resolve(m_contexts.value(kKey)));
+}
+
+void Volumes::onPanPositionChanged(uint64 serverConnectionHandlerID, anyID clientID, bool isPanned, float position)
+{
+    auto dsp_obj = GetVolume(serverConnectionHandlerID, clientID);
+    if (!dsp_obj)
+        return;
+
+    if (isPanned)
+        dsp_obj->setPan(position);
+    else
+        dsp_obj->clearPan();
+}
@@ -0,0 +1,135 @@
+#include "volume/wav_file.h"
+
+#include <QtCore/QFile>
+
+#include <cstring>
+
+namespace
+{
+    inline uint32_t read_u32(const char* p)
+    {
+        const auto kBytes = reinterpret_cast<const unsigned char*>(p);
+        return kBytes[0] | (kBytes[1] << 8) | (kBytes[2] << 16) | (static_cast<uint32_t>(kBytes[3]) << 24);
+    }
+
+    inline uint16_t read_u16(const char* p)
+    {
+        const auto kBytes = reinterpret_cast<const unsigned char*>(p);
+        return static_cast<uint16_t>(kBytes[0] | (kBytes[1] << 8));
+    }
+
+    inline void write_u32(char* p, uint32_t val)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = static_cast<char>((val >> (8 * i)) & 0xFF);
+    }
+
+    inline void write_u16(char* p, uint16_t val)
+    {
+        p[0] = static_cast<char>(val & 0xFF);
+        p[1] = static_cast<char>(val >> 8);
+    }
+
+    bool fail(QString* error, const QString& message)
+    {
+        if (error)
+            *error = message;
+        return false;
+    }
+}
+
+namespace WavFile
+{
+    //! Read a 16 bit PCM file
+    /*!
+     * \param path the file
+     * \param samples the interleaved samples
+     * \param format sample rate and channel count of the file
+     * \param error the reason when reading failed
+     * \return true on success
+     */
+    bool Read(const QString& path, std::vector<int16_t>& samples, Format& format, QString* error)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return fail(error, file.errorString());
+
+        const auto kData = file.readAll();
+        if (kData.size() < 12 || memcmp(kData.constData(), "RIFF", 4) || memcmp(kData.constData() + 8, "WAVE", 4))
+            return fail(error, QString("Not a WAVE file: %1").arg(path));
+
+        bool has_format = false;
+        for (int pos = 12; pos + 8 <= kData.size();)
+        {
+            const auto kChunk = kData.constData() + pos;
+            const auto kSize = static_cast<int>(read_u32(kChunk + 4));
+            if (kSize < 0 || pos + 8 + kSize > kData.size())
+                return fail(error, QString("Truncated WAVE file: %1").arg(path));
+
+            if (!memcmp(kChunk, "fmt ", 4) && kSize >= 16)
+            {
+                if ((read_u16(kChunk + 8) != 1) || (read_u16(kChunk + 22) != 16))
+                    return fail(error, QString("Not 16 bit PCM: %1").arg(path));
+
+                format.channels = read_u16(kChunk + 10);
+                format.sample_rate = static_cast<int32_t>(read_u32(kChunk + 12));
+                has_format = (format.channels > 0);
+            }
+            else if (!memcmp(kChunk, "data", 4))
+            {
+                if (!has_format)
+                    return fail(error, QString("No format before the data: %1").arg(path));
+
+                samples.resize(kSize / sizeof(int16_t));
+                for (size_t i = 0; i < samples.size(); ++i)
+                    samples[i] = static_cast<int16_t>(read_u16(kChunk + 8 + 2 * i));
+
+                return true;
+            }
+            pos += 8 + kSize + (kSize & 1);
+        }
+        return fail(error, QString("No data in WAVE file: %1").arg(path));
+    }
+
+    //! Write a 16 bit PCM file
+    /*!
+     * \param path the file, overwritten
+     * \param samples the interleaved samples
+     * \param frame_count number of frames
+     * \param format sample rate and channel count
+     * \param error the reason when writing failed
+     * \return true on success
+     */
+    bool Write(const QString& path, const int16_t* samples, int32_t frame_count, const Format& format, QString* error)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return fail(error, file.errorString());
+
+        const auto kDataSize = static_cast<uint32_t>(frame_count) * format.channels * sizeof(int16_t);
+        char header[44];
+        memcpy(header, "RIFF", 4);
+        write_u32(header + 4, 36 + kDataSize);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        write_u32(header + 16, 16);
+        write_u16(header + 20, 1);
+        write_u16(header + 22, static_cast<uint16_t>(format.channels));
+        write_u32(header + 24, static_cast<uint32_t>(format.sample_rate));
+        write_u32(header + 28, static_cast<uint32_t>(format.sample_rate) * format.channels * sizeof(int16_t));
+        write_u16(header + 32, static_cast<uint16_t>(format.channels * sizeof(int16_t)));
+        write_u16(header + 34, 16);
+        memcpy(header + 36, "data", 4);
+        write_u32(header + 40, kDataSize);
+        if (file.write(header, sizeof(header)) != static_cast<qint64>(sizeof(header)))
+            return fail(error, file.errorString());
+
+        std::vector<char> data(kDataSize);
+        for (uint32_t i = 0; i < kDataSize / 2; ++i)
+            write_u16(data.data() + 2 * i, static_cast<uint16_t>(samples[i]));
+
+        if (file.write(data.data(), kDataSize) != static_cast<qint64>(kDataSize))
+            return fail(error, file.errorString());
+
+        return true;
+    }
+}